@@ -22,23 +22,29 @@
 class NodeBase
 {
 public:
-    explicit NodeBase(std::string name):
+    /**
+     * @param name action server name
+     * @param vehicleNamespace namespace for this vehicle's topics and services when one process runs a few of them
+     * (empty for the usual global ones)
+     */
+    explicit NodeBase(std::string name, std::string vehicleNamespace = ""):
+            m_node_handle(vehicleNamespace), m_VehicleNamespace(std::move(vehicleNamespace)),
             m_action_server(m_node_handle, std::move(name), false), m_CoordinateConverter(m_node_handle)
     {
         m_current_speed = 0.01;
         m_current_heading = 0;
 
-        m_node_handle.advertise<geographic_visualization_msgs::GeoVizItem>("/project11/display",1);
+        m_node_handle.advertise<geographic_visualization_msgs::GeoVizItem>(topic("/project11/display"),1);
 
-        m_controller_msgs_pub = m_node_handle.advertise<std_msgs::String>("/controller_msgs",1);
-        m_display_pub = m_node_handle.advertise<geographic_visualization_msgs::GeoVizItem>("/project11/display",1);
+        m_controller_msgs_pub = m_node_handle.advertise<std_msgs::String>(topic("/controller_msgs"),1);
+        m_display_pub = m_node_handle.advertise<geographic_visualization_msgs::GeoVizItem>(topic("/project11/display"),1);
 
-        m_update_reference_trajectory_client = m_node_handle.serviceClient<path_planner_common::UpdateReferenceTrajectory>("/mpc/update_reference_trajectory");
+        m_update_reference_trajectory_client = m_node_handle.serviceClient<path_planner_common::UpdateReferenceTrajectory>(topic("/mpc/update_reference_trajectory"));
 
-        m_position_sub = m_node_handle.subscribe("/position_map", 10, &NodeBase::positionCallback, this);
-        m_heading_sub = m_node_handle.subscribe("/heading", 10, &NodeBase::headingCallback, this);
-        m_speed_sub = m_node_handle.subscribe("/sog", 10, &NodeBase::speedCallback, this);
-        m_piloting_mode_sub = m_node_handle.subscribe("/project11/piloting_mode", 10, &NodeBase::pilotingModeCallback, this);
+        m_position_sub = m_node_handle.subscribe(topic("/position_map"), 10, &NodeBase::positionCallback, this);
+        m_heading_sub = m_node_handle.subscribe(topic("/heading"), 10, &NodeBase::headingCallback, this);
+        m_speed_sub = m_node_handle.subscribe(topic("/sog"), 10, &NodeBase::speedCallback, this);
+        m_piloting_mode_sub = m_node_handle.subscribe(topic("/project11/piloting_mode"), 10, &NodeBase::pilotingModeCallback, this);
 
         m_action_server.registerGoalCallback(boost::bind(&NodeBase::goalCallback, this));
         m_action_server.registerPreemptCallback(boost::bind(&NodeBase::preemptCallback, this));
@@ -240,6 +246,17 @@ public:
 protected:
     ros::NodeHandle m_node_handle;
 
+    std::string m_VehicleNamespace;
+
+    /**
+     * @param name global topic or service name
+     * @return the name under this vehicle's namespace, if it has one
+     */
+    std::string topic(const std::string& name) const
+    {
+        return m_VehicleNamespace.empty() ? name : "/" + m_VehicleNamespace + name;
+    }
+
     TrajectoryDisplayerHelper m_TrajectoryDisplayer;
 
     actionlib::SimpleActionServer<path_planner::path_plannerAction> m_action_server;
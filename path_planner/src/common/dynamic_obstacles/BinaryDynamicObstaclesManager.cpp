@@ -1,26 +1,104 @@
 #include <tuple>        // std::forward_as_tuple
+#include <cfloat>
 #include "BinaryDynamicObstaclesManager.h"
+#include "BinaryObstacleProjection.h"
 
 double BinaryDynamicObstaclesManager::collisionExists(double x, double y, double time, bool strict) const {
     double sum = 0;
-    for (auto o : m_Obstacles) {
-        // not using references in loop statement because this mutates them
-        auto& obstacle = o.second;
-        if (strict) {
-            obstacle.Width += 2;
-            obstacle.Length += 2;
-        }
-        obstacle.project(time);
-        auto translatedX = x - obstacle.X;
-        auto translatedY = y - obstacle.Y;
-        auto rotatedX = translatedX * cos(obstacle.Yaw) - translatedY * sin(obstacle.Yaw);
-        auto rotatedY = translatedX * sin(obstacle.Yaw) + translatedY * cos(obstacle.Yaw);
-        if (fabs(rotatedX) < obstacle.Length / 2 && fabs(rotatedY) < obstacle.Width / 2) sum++;
+    for (const auto& o : m_Obstacles) {
+        // project a copy of the position rather than copying the whole obstacle
+        const auto& obstacle = o.second;
+        auto width = strict? obstacle.Width + 2 : obstacle.Width;
+        auto length = strict? obstacle.Length + 2 : obstacle.Length;
+        auto c = cos(obstacle.Yaw), s = sin(obstacle.Yaw);
+        auto dt = time - obstacle.Time;
+        auto translatedX = x - (obstacle.X + obstacle.Speed * dt * c);
+        auto translatedY = y - (obstacle.Y + obstacle.Speed * dt * s);
+        auto rotatedX = translatedX * c - translatedY * s;
+        auto rotatedY = translatedX * s + translatedY * c;
+        if (fabs(rotatedX) < length / 2 && fabs(rotatedY) < width / 2) sum++;
     }
 //    if (sum > 0) std::cerr << "Collision \"probability\" non-zero" << std::endl;
     return sum;
 }
 
+double BinaryDynamicObstaclesManager::distanceToNearestPossibleCollision(double x, double y, double time,
+                                                                        bool strict) const {
+    double best = DBL_MAX;
+    for (const auto& o : m_Obstacles) {
+        // same footprint as collisionExists
+        const auto& obstacle = o.second;
+        auto width = strict? obstacle.Width + 2 : obstacle.Width;
+        auto length = strict? obstacle.Length + 2 : obstacle.Length;
+        auto c = cos(obstacle.Yaw), s = sin(obstacle.Yaw);
+        auto dt = time - obstacle.Time;
+        auto translatedX = x - (obstacle.X + obstacle.Speed * dt * c);
+        auto translatedY = y - (obstacle.Y + obstacle.Speed * dt * s);
+        auto rotatedX = translatedX * c - translatedY * s;
+        auto rotatedY = translatedX * s + translatedY * c;
+        auto dx = fmax(fabs(rotatedX) - length / 2, 0);
+        auto dy = fmax(fabs(rotatedY) - width / 2, 0);
+        best = fmin(best, sqrt(dx * dx + dy * dy));
+    }
+    return best;
+}
+
+bool BinaryDynamicObstaclesManager::possibleCollision(double minX, double minY, double maxX, double maxY,
+                                                     double startTime, double endTime, bool strict) const {
+    for (const auto& o : m_Obstacles) {
+        if (possibleCollision(o.second, minX, minY, maxX, maxY, startTime, endTime, strict)) return true;
+    }
+    return false;
+}
+
+bool BinaryDynamicObstaclesManager::possibleCollision(const Obstacle& obstacle, double minX, double minY, double maxX,
+                                                     double maxY, double startTime, double endTime, bool strict) {
+    // the footprint is within half its diagonal of the centre
+    auto width = strict? obstacle.Width + 2 : obstacle.Width;
+    auto length = strict? obstacle.Length + 2 : obstacle.Length;
+    return sweptDiscOverlaps(obstacle.X, obstacle.Y, obstacle.Time, obstacle.Speed * cos(obstacle.Yaw),
+            obstacle.Speed * sin(obstacle.Yaw), sqrt(width * width + length * length) / 2,
+            minX, minY, maxX, maxY, startTime, endTime);
+}
+
+bool BinaryDynamicObstaclesManager::changedNear(const DynamicObstaclesManager& previous, double minX, double minY,
+                                               double maxX, double maxY, double startTime, double endTime,
+                                               bool strict) const {
+    if (&previous == this) return false;
+    auto other = dynamic_cast<const BinaryDynamicObstaclesManager*>(&previous);
+    if (!other) return true;
+    auto near = [&](const Obstacle& o) {
+        return possibleCollision(o, minX, minY, maxX, maxY, startTime, endTime, strict);
+    };
+    for (const auto& o : m_Obstacles) {
+        auto it = other->m_Obstacles.find(o.first);
+        if (it != other->m_Obstacles.end()) {
+            const auto& a = o.second, & b = it->second;
+            if (a.X == b.X && a.Y == b.Y && a.Yaw == b.Yaw && a.Speed == b.Speed && a.Time == b.Time &&
+                a.Width == b.Width && a.Length == b.Length) continue;
+            // moved, so where it was matters as much as where it is now
+            if (near(b)) return true;
+        }
+        if (near(o.second)) return true;
+    }
+    for (const auto& o : other->m_Obstacles) {
+        // gone
+        if (m_Obstacles.find(o.first) == m_Obstacles.end() && near(o.second)) return true;
+    }
+    return false;
+}
+
+DynamicObstaclesManager::SharedPtr BinaryDynamicObstaclesManager::precompute(double startTime, double duration) const {
+    if (m_Obstacles.empty()) return nullptr;
+    return std::make_shared<BinaryObstacleProjection>(*this, startTime, duration);
+}
+
+double BinaryDynamicObstaclesManager::maxObstacleSpeed() const {
+    double speed = 0;
+    for (const auto& o : m_Obstacles) speed = fmax(speed, fabs(o.second.Speed));
+    return speed;
+}
+
 void BinaryDynamicObstaclesManager::update(uint32_t mmsi, double x, double y, double heading, double speed, double time,
         double width, double length) {
     if (!isIgnored(mmsi)) {
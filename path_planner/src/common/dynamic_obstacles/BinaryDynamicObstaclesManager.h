@@ -32,11 +32,39 @@ public:
 
     double collisionExists(double x, double y, double time, bool strict) const override;
 
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const override;
+
+    double maxObstacleSpeed() const override;
+
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const override;
+
+    /**
+     * Only obstacles that appeared, went away or were updated since the previous snapshot count, and only if they're
+     * near the box (where they were before or where they are now).
+     */
+    bool changedNear(const DynamicObstaclesManager& previous, double minX, double minY, double maxX, double maxY,
+                     double startTime, double endTime, bool strict) const override;
+
+    /**
+     * Project the obstacles into time buckets with a spatial hash each (see BinaryObstacleProjection).
+     * @param startTime
+     * @param duration
+     * @return
+     */
+    DynamicObstaclesManager::SharedPtr precompute(double startTime, double duration) const override;
+
     const std::unordered_map<uint32_t, Obstacle>& get() const;
 
 private:
 
     std::unordered_map<uint32_t, Obstacle> m_Obstacles;
+
+    /**
+     * The broad phase for one obstacle.
+     */
+    static bool possibleCollision(const Obstacle& obstacle, double minX, double minY, double maxX, double maxY,
+                                  double startTime, double endTime, bool strict);
 };
 
 
@@ -0,0 +1,92 @@
+#include <cfloat>
+#include <algorithm>
+#include "BinaryObstacleProjection.h"
+#include "BinaryDynamicObstaclesManager.h"
+
+BinaryObstacleProjection::BinaryObstacleProjection(const BinaryDynamicObstaclesManager& manager, double startTime,
+                                                   double duration) : m_StartTime(startTime) {
+    for (const auto& o : manager.get()) {
+        const auto& obstacle = o.second;
+        m_Footprints.push_back({obstacle.X, obstacle.Y, obstacle.Speed, obstacle.Time, cos(obstacle.Yaw),
+                                sin(obstacle.Yaw), obstacle.Length / 2, obstacle.Width / 2, (obstacle.Length + 2) / 2,
+                                (obstacle.Width + 2) / 2});
+        m_MaxSpeed = fmax(m_MaxSpeed, fabs(obstacle.Speed));
+    }
+    m_Buckets.resize((size_t)fmax(ceil(duration / c_BucketDuration), 0));
+    for (size_t b = 0; b < m_Buckets.size(); b++) {
+        auto t1 = m_StartTime + b * c_BucketDuration, t2 = t1 + c_BucketDuration;
+        auto& cells = m_Buckets[b];
+        for (size_t i = 0; i < m_Footprints.size(); i++) {
+            const auto& f = m_Footprints[i];
+            // the centre moves in a straight line so it stays between where it is at either end of the bucket, and
+            // the (strict) footprint stays within its half diagonal of that (plus a bit for rounding)
+            auto x1 = f.X + f.Speed * (t1 - f.Time) * f.Cos, y1 = f.Y + f.Speed * (t1 - f.Time) * f.Sin;
+            auto x2 = f.X + f.Speed * (t2 - f.Time) * f.Cos, y2 = f.Y + f.Speed * (t2 - f.Time) * f.Sin;
+            auto radius = sqrt(f.StrictHalfLength * f.StrictHalfLength + f.StrictHalfWidth * f.StrictHalfWidth) + 1e-3;
+            for (auto cx = cellCoordinate(fmin(x1, x2) - radius); cx <= cellCoordinate(fmax(x1, x2) + radius); cx++) {
+                for (auto cy = cellCoordinate(fmin(y1, y2) - radius); cy <= cellCoordinate(fmax(y1, y2) + radius); cy++) {
+                    cells[key(cx, cy)].push_back((int)i);
+                }
+            }
+        }
+    }
+}
+
+double BinaryObstacleProjection::collisionExists(double x, double y, double time, bool strict) const {
+    double sum = 0;
+    auto b = bucket(time);
+    if (b == -1) {
+        for (const auto& f : m_Footprints) if (inside(f, x, y, time, strict)) sum++;
+        return sum;
+    }
+    const auto& cells = m_Buckets[b];
+    auto it = cells.find(key(cellCoordinate(x), cellCoordinate(y)));
+    if (it == cells.end()) return 0;
+    for (auto i : it->second) if (inside(m_Footprints[i], x, y, time, strict)) sum++;
+    return sum;
+}
+
+double BinaryObstacleProjection::distanceToNearestPossibleCollision(double x, double y, double time,
+                                                                   bool strict) const {
+    double best = DBL_MAX;
+    for (const auto& f : m_Footprints) {
+        // same as the manager, minus working out the trig every time
+        auto dt = time - f.Time;
+        auto translatedX = x - (f.X + f.Speed * dt * f.Cos);
+        auto translatedY = y - (f.Y + f.Speed * dt * f.Sin);
+        auto rotatedX = translatedX * f.Cos - translatedY * f.Sin;
+        auto rotatedY = translatedX * f.Sin + translatedY * f.Cos;
+        auto dx = fmax(fabs(rotatedX) - (strict? f.StrictHalfLength : f.HalfLength), 0);
+        auto dy = fmax(fabs(rotatedY) - (strict? f.StrictHalfWidth : f.HalfWidth), 0);
+        best = fmin(best, sqrt(dx * dx + dy * dy));
+    }
+    return best;
+}
+
+bool BinaryObstacleProjection::possibleCollision(double minX, double minY, double maxX, double maxY,
+                                                double startTime, double endTime, bool strict) const {
+    for (const auto& f : m_Footprints) {
+        auto halfLength = strict? f.StrictHalfLength : f.HalfLength, halfWidth = strict? f.StrictHalfWidth : f.HalfWidth;
+        if (sweptDiscOverlaps(f.X, f.Y, f.Time, f.Speed * f.Cos, f.Speed * f.Sin,
+                sqrt(halfLength * halfLength + halfWidth * halfWidth), minX, minY, maxX, maxY, startTime, endTime)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BinaryObstacleProjection::bucket(double time) const {
+    auto b = floor((time - m_StartTime) / c_BucketDuration);
+    if (!(b >= 0 && b < m_Buckets.size())) return -1; // also catches NaN
+    return (int)b;
+}
+
+bool BinaryObstacleProjection::inside(const Footprint& f, double x, double y, double time, bool strict) {
+    auto dt = time - f.Time;
+    auto translatedX = x - (f.X + f.Speed * dt * f.Cos);
+    auto translatedY = y - (f.Y + f.Speed * dt * f.Sin);
+    auto rotatedX = translatedX * f.Cos - translatedY * f.Sin;
+    auto rotatedY = translatedX * f.Sin + translatedY * f.Cos;
+    return fabs(rotatedX) < (strict? f.StrictHalfLength : f.HalfLength) &&
+           fabs(rotatedY) < (strict? f.StrictHalfWidth : f.HalfWidth);
+}
@@ -0,0 +1,78 @@
+#ifndef SRC_BINARYOBSTACLEPROJECTION_H
+#define SRC_BINARYOBSTACLEPROJECTION_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "DynamicObstaclesManager.h"
+
+class BinaryDynamicObstaclesManager;
+
+/**
+ * Snapshot of a BinaryDynamicObstaclesManager's obstacles, taken when planning starts, that answers the same questions
+ * without looking at every obstacle every time. The planning horizon is cut into fixed time buckets and each obstacle
+ * is put in the cells of a per-bucket spatial hash that its footprint sweeps through during that bucket, so a
+ * collision check only looks at the handful of obstacles near the point. The exact check uses the same arithmetic as
+ * the manager (with the trig done once up front) so the answers are identical; times outside the horizon just check
+ * every obstacle.
+ *
+ * It's immutable once built, so it's fine to share between edge evaluation threads.
+ */
+class BinaryObstacleProjection : public DynamicObstaclesManager {
+public:
+    /**
+     * Take a snapshot.
+     * @param manager
+     * @param startTime start of the planning horizon
+     * @param duration length of the planning horizon (s)
+     */
+    BinaryObstacleProjection(const BinaryDynamicObstaclesManager& manager, double startTime, double duration);
+
+    ~BinaryObstacleProjection() override = default;
+
+    double collisionExists(double x, double y, double time, bool strict) const override;
+
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const override;
+
+    double maxObstacleSpeed() const override { return m_MaxSpeed; }
+
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const override;
+
+    /**
+     * @return number of time buckets over the horizon
+     */
+    size_t buckets() const { return m_Buckets.size(); }
+
+    static constexpr double c_BucketDuration = 1;
+    static constexpr double c_CellSize = 20;
+
+private:
+    struct Footprint {
+        double X, Y, Speed, Time, Cos, Sin;
+        // half length and width, normal and strict (which are 2m bigger in each direction)
+        double HalfLength, HalfWidth, StrictHalfLength, StrictHalfWidth;
+    };
+
+    typedef std::unordered_map<int64_t, std::vector<int>> Cells;
+
+    std::vector<Footprint> m_Footprints;
+    std::vector<Cells> m_Buckets;
+    double m_StartTime;
+    double m_MaxSpeed = 0;
+
+    /**
+     * @param time
+     * @return the bucket covering time, or -1 if it's outside the horizon
+     */
+    int bucket(double time) const;
+
+    static bool inside(const Footprint& f, double x, double y, double time, bool strict);
+
+    static int64_t cellCoordinate(double d) { return (int64_t)floor(d / c_CellSize); }
+
+    static int64_t key(int64_t x, int64_t y) { return (int64_t)(((uint64_t)x << 32) ^ ((uint64_t)y & 0xffffffff)); }
+};
+
+
+#endif //SRC_BINARYOBSTACLEPROJECTION_H
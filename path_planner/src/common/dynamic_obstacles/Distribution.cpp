@@ -24,28 +24,42 @@ double Distribution::time() const {
 }
 
 Distribution Distribution::interpolate(const Distribution& next, double desiredTime) const {
+    return Interpolation(*this, next).at(desiredTime);
+}
+
+Distribution::Interpolation::Interpolation(const Distribution& from, const Distribution& next) : m_From(&from) {
+    double timeDiff = next.m_Time - from.m_Time;
+    m_SameTime = timeDiff == 0;
+    if (m_SameTime) return;
+    for (int i = 0; i < 2; i++) {
+        m_MeanSlope[i] = (next.m_Mean[i] - from.m_Mean[i]) / timeDiff;
+        for (int j = 0; j < 2; j++) {
+            m_CovarianceSlope[i][j] = (next.m_Covariance[i][j] - from.m_Covariance[i][j]) / timeDiff;
+        }
+    }
+    m_HeadingRate = (next.m_Heading - from.m_Heading) / timeDiff;
+}
+
+Distribution Distribution::Interpolation::at(double desiredTime) const {
+    const auto& from = *m_From;
     double mean[2];
     double covariance[2][2];
-    double timeDiff = next.m_Time - m_Time;
-    double desiredTimeDiff = desiredTime - m_Time;
-    if (timeDiff == 0) {
+    double desiredTimeDiff = desiredTime - from.m_Time;
+    if (m_SameTime) {
         if (desiredTimeDiff == 0) {
-            return {m_Mean, m_Covariance, m_Width, m_Length, m_Heading, desiredTime};
+            return {from.m_Mean, from.m_Covariance, from.m_Width, from.m_Length, from.m_Heading, desiredTime};
         } else {
             throw std::logic_error("Cannot interpolate between or extrapolate from two distributions with the same time stamp");
         }
     }
     for (int i = 0; i < 2; i++) {
-        auto slope = (next.m_Mean[i] - m_Mean[i]) / timeDiff;
-        mean[i] = m_Mean[i] + slope * desiredTimeDiff;
+        mean[i] = from.m_Mean[i] + m_MeanSlope[i] * desiredTimeDiff;
         for (int j = 0; j < 2; j++) {
-            slope = (next.m_Covariance[i][j] - m_Covariance[i][j]) / timeDiff;
-            covariance[i][j] = m_Covariance[i][j] + slope * desiredTimeDiff;
+            covariance[i][j] = from.m_Covariance[i][j] + m_CovarianceSlope[i][j] * desiredTimeDiff;
         }
     }
-    double headingRate = (next.m_Heading - m_Heading) / timeDiff;
-    auto heading = m_Heading + headingRate * desiredTimeDiff;
-    return {mean, covariance, m_Width, m_Length, heading, desiredTime};
+    auto heading = from.m_Heading + m_HeadingRate * desiredTimeDiff;
+    return {mean, covariance, from.m_Width, from.m_Length, heading, desiredTime};
 }
 
 const double  (&Distribution::mean() const)[2] {
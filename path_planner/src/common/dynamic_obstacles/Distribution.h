@@ -49,6 +49,28 @@ public:
 
     const double (&mean() const) [2];
 
+    /**
+     * Interpolation between two distributions with the slopes worked out once, for interpolating to a lot of times
+     * between the same pair. interpolate() is exactly Interpolation(*this, next).at(desiredTime).
+     */
+    class Interpolation {
+    public:
+        Interpolation(const Distribution& from, const Distribution& next);
+
+        /**
+         * @param desiredTime
+         * @return the interpolated (or extrapolated) distribution
+         */
+        Distribution at(double desiredTime) const;
+
+    private:
+        const Distribution* m_From;
+        double m_MeanSlope[2];
+        double m_CovarianceSlope[2][2];
+        double m_HeadingRate;
+        bool m_SameTime;
+    };
+
 private:
     // by convention, order the means (and covariance) x, y
     double m_Mean[2];
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "DynamicObstacle.h"
 
 double DynamicObstacle::distanceToEdge(double x, double y, double speed, double time) const {
@@ -5,6 +6,30 @@ double DynamicObstacle::distanceToEdge(double x, double y, double speed, double
     return 0;
 }
 
+void DynamicObstacle::addCollisionDensities(const double* xs, const double* ys, const double* times, size_t n,
+                                            double* densities) const {
+    if (m_Distributions.empty() || n == 0) return;
+    // the pair the binary search in collisionDensityAt ends up at is the last distribution at or before the time (but
+    // not the very last one), and the one after it
+    const auto last = m_Distributions.size() - 1;
+    size_t lower = 0;
+    auto advance = [&](double time) {
+        while (lower + 1 < last && m_Distributions[lower + 1].time() <= time) lower++;
+    };
+    advance(times[0]);
+    auto interpolation = Distribution::Interpolation(m_Distributions[lower], m_Distributions[std::min(lower + 1, last)]);
+    for (size_t i = 0; i < n; i++) {
+        auto previous = lower;
+        if (i > 0 && times[i] < times[i - 1]) lower = 0; // went backwards, so start over
+        advance(times[i]);
+        if (lower != previous) {
+            interpolation = Distribution::Interpolation(m_Distributions[lower],
+                                                        m_Distributions[std::min(lower + 1, last)]);
+        }
+        densities[i] += interpolation.at(times[i]).density(xs[i], ys[i]);
+    }
+}
+
 double DynamicObstacle::collisionDensityAt(double x, double y, double time) const {
     // find the highest time lower than the desired time with a binary search
     unsigned long lower = 0, upper = m_Distributions.size() - 1;
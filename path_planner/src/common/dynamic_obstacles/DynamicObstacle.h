@@ -51,6 +51,19 @@ public:
      */
     double collisionDensityAt(double x, double y, double time) const;
 
+    /**
+     * Compute collisionDensityAt for a batch of samples in order of time, walking forward through the distributions
+     * once instead of searching for each sample, and interpolating with the same slopes for every sample between
+     * the same pair. Out of order samples still work, they just cost a search.
+     * @param xs
+     * @param ys
+     * @param times
+     * @param n number of samples
+     * @param densities output (added to, not overwritten)
+     */
+    void addCollisionDensities(const double* xs, const double* ys, const double* times, size_t n,
+                               double* densities) const;
+
 private:
     std::vector<Distribution> m_Distributions;
     double m_Length, m_Width;
@@ -2,6 +2,7 @@
 #define SRC_DYNAMICOBSTACLESMANAGER_H
 
 #include <memory>
+#include <cfloat>
 #include <path_planner_common/State.h>
 
 /**
@@ -10,6 +11,7 @@
 class DynamicObstaclesManager {
 public:
     typedef std::shared_ptr<DynamicObstaclesManager> SharedPtr;
+    typedef std::shared_ptr<const DynamicObstaclesManager> ConstSharedPtr;
 
     virtual ~DynamicObstaclesManager() = default;
 
@@ -27,6 +29,96 @@ public:
         return collisionExists(s.x(), s.y(), s.time(), strict);
     };
 
+    /**
+     * Lower bound on the distance from the point to the nearest place collisionExists would be non-zero at the given
+     * time. Used to skip ahead during collision checking, so underestimating is fine (zero is always safe). No
+     * obstacles by default, so infinite.
+     * @param x
+     * @param y
+     * @param time
+     * @param strict
+     * @return distance (m)
+     */
+    virtual double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const {
+        return DBL_MAX;
+    }
+
+    /**
+     * @return the fastest any obstacle is moving (m/s), so callers know how quickly clearance can shrink
+     */
+    virtual double maxObstacleSpeed() const { return 0; }
+
+    /**
+     * Broad phase for collision checking: might collisionExists be non-zero anywhere in the box at any time in the
+     * interval? Saying yes when it isn't just costs some time, but saying no when it is would miss collisions. Yes by
+     * default, so managers that don't know any better get checked at every step.
+     * @param minX
+     * @param minY
+     * @param maxX
+     * @param maxY
+     * @param startTime
+     * @param endTime
+     * @param strict
+     * @return false only if there's definitely no collision there
+     */
+    virtual bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                                   bool strict) const { return true; }
+
+    /**
+     * Could collisionExists give a different answer from a previous snapshot's anywhere in the box during the
+     * interval? That's what decides whether an edge checked against the previous snapshot has to be checked again.
+     * Like possibleCollision, saying yes when it isn't so just costs some time. By default everything's changed
+     * unless it's the same snapshot (which is immutable, so it can't have).
+     * @param previous
+     * @param minX
+     * @param minY
+     * @param maxX
+     * @param maxY
+     * @param startTime
+     * @param endTime
+     * @param strict
+     * @return false only if nothing that matters there has changed
+     */
+    virtual bool changedNear(const DynamicObstaclesManager& previous, double minX, double minY, double maxX,
+                             double maxY, double startTime, double endTime, bool strict) const {
+        return &previous != this;
+    }
+
+    /**
+     * Whether a moving disc could touch a box in a time interval, for implementing possibleCollision.
+     * @param x where the centre is at time
+     * @param y
+     * @param time
+     * @param vx velocity of the centre (m/s)
+     * @param vy
+     * @param radius
+     * @param minX
+     * @param minY
+     * @param maxX
+     * @param maxY
+     * @param startTime
+     * @param endTime
+     * @return
+     */
+    static bool sweptDiscOverlaps(double x, double y, double time, double vx, double vy, double radius,
+                                  double minX, double minY, double maxX, double maxY, double startTime, double endTime) {
+        // the centre moves in a straight line so it's between where it is at either end of the interval
+        auto x1 = x + vx * (startTime - time), x2 = x + vx * (endTime - time);
+        auto y1 = y + vy * (startTime - time), y2 = y + vy * (endTime - time);
+        // a little slack for rounding
+        radius += 1e-6;
+        return fmin(x1, x2) - radius <= maxX && fmax(x1, x2) + radius >= minX &&
+               fmin(y1, y2) - radius <= maxY && fmax(y1, y2) + radius >= minY;
+    }
+
+    /**
+     * Take a snapshot of the obstacles that gives the same answers but is quicker to ask over a planning horizon.
+     * @param startTime start of the horizon
+     * @param duration length of the horizon (s)
+     * @return the snapshot, or null if there's nothing to gain (the default)
+     */
+    virtual SharedPtr precompute(double startTime, double duration) const { return nullptr; }
+
 
 };
 
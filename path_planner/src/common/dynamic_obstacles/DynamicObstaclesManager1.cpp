@@ -29,15 +29,28 @@ double DynamicObstaclesManager1::collisionExists(double x, double y, double time
     return sum;
 }
 
+void DynamicObstaclesManager1::collisionExists(const std::vector<State>& samples, std::vector<double>& result) const {
+    std::vector<double> xs, ys, times;
+    xs.reserve(samples.size()); ys.reserve(samples.size()); times.reserve(samples.size());
+    for (const auto& s : samples) {
+        xs.push_back(s.x()); ys.push_back(s.y()); times.push_back(s.time());
+    }
+    // adding obstacle by obstacle sums each sample's densities in the same order as collisionExists does
+    result.assign(samples.size(), 0);
+    for (const auto& o : m_Obstacles) {
+        o.second.addCollisionDensities(xs.data(), ys.data(), times.data(), samples.size(), result.data());
+    }
+}
+
 void DynamicObstaclesManager1::update(uint32_t mmsi, const std::vector<Distribution>& distributions) {
-    if (std::find(m_IgnoreList.begin(), m_IgnoreList.end(), mmsi) != m_IgnoreList.end()) return;
+    if (m_IgnoreList.count(mmsi)) return;
     auto pair = m_Obstacles.emplace(mmsi, distributions);
     if (!pair.second) pair.first->second.update(distributions);
 }
 
 void DynamicObstaclesManager1::add(uint32_t mmsi, const std::vector<Distribution>& distributions,
                                    double width, double length) {
-    if (std::find(m_IgnoreList.begin(), m_IgnoreList.end(), mmsi) != m_IgnoreList.end()) return;
+    if (m_IgnoreList.count(mmsi)) return;
     // hopefully there's nothing already there...
     auto pair = m_Obstacles.insert(std::unordered_map<uint32_t, DynamicObstacle>::value_type(mmsi,
             DynamicObstacle(distributions, length, width)));
@@ -48,9 +61,9 @@ void DynamicObstaclesManager1::forget(uint32_t mmsi) {
 }
 
 void DynamicObstaclesManager1::addIgnore(uint32_t mmsi) {
-    m_IgnoreList.push_back(mmsi);
+    m_IgnoreList.insert(mmsi);
 }
 
 void DynamicObstaclesManager1::removeIgnore(uint32_t mmsi) {
-    m_IgnoreList.erase(std::remove(m_IgnoreList.begin(), m_IgnoreList.end(), 8), m_IgnoreList.end());
+    m_IgnoreList.erase(mmsi);
 }
@@ -5,6 +5,7 @@
 #include <path_planner_common/State.h>
 #include "DynamicObstacle.h"
 #include <unordered_map>
+#include <unordered_set>
 
 /**
  * Manages the dynamic obstacles for the executive.
@@ -19,6 +20,14 @@ public:
     double collisionExists(const State& s) const;
     double collisionExists(double x, double y, double time) const;
 
+    /**
+     * Same as collisionExists for each sample, but for a whole batch (like the samples along an edge) at once, which
+     * is linear in the number of samples when they're in order of time.
+     * @param samples
+     * @param result output, the same size as samples
+     */
+    void collisionExists(const std::vector<State>& samples, std::vector<double>& result) const;
+
     /**
      * Find the distance to the edge of the nearest truncated distribution representing a dynamic obstacle. Check to
      * make sure it's implemented before you use it.
@@ -64,7 +73,7 @@ public:
 
 private:
     std::unordered_map<uint32_t, DynamicObstacle> m_Obstacles;
-    std::vector<uint32_t> m_IgnoreList;
+    std::unordered_set<uint32_t> m_IgnoreList;
 };
 
 
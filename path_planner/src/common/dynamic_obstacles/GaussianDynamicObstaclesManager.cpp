@@ -1,17 +1,120 @@
+#include <cfloat>
 #include "GaussianDynamicObstaclesManager.h"
 
 double GaussianDynamicObstaclesManager::collisionExists(double x, double y, double time, bool strict) const {
+    const auto& k = m_Kernels;
+    const auto n = k.X.size();
+    // First the squared Mahalanobis distances, with the ones past the cutoff pushed out to infinity. No branches or
+    // calls so the compiler can vectorize it
+    static thread_local std::vector<double> quadforms;
+    quadforms.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const double dt = time - k.Time[i];
+        const double dx = x - (k.X[i] + k.Speed[i] * dt * k.Cos[i]);
+        const double dy = y - (k.Y[i] + k.Speed[i] * dt * k.Sin[i]);
+        const double quadform = dx * (k.A[i] * dx + k.B[i] * dy) + dy * (k.C[i] * dx + k.D[i] * dy);
+        quadforms[i] = quadform <= k.QuadformCutoff[i]? quadform : INFINITY;
+    }
+    // then exponentials only for the ones that are close
     double sum = 0;
-    for (auto o : m_Obstacles) {
-        auto& obstacle = o.second;
-        obstacle.project(time);
-        sum += obstacle.pdf(Eigen::Vector2d(x, y));
+    for (size_t i = 0; i < n; i++) {
+        if (quadforms[i] != INFINITY) sum += k.Norm[i] * exp(-0.5 * quadforms[i]);
     }
     // questionable
     if (sum < 1e-5) return 0;
     return sum;
 }
 
+double GaussianDynamicObstaclesManager::distanceToNearestPossibleCollision(double x, double y, double time,
+                                                                          bool strict) const {
+    const auto& k = m_Kernels;
+    double best = DBL_MAX;
+    for (size_t i = 0; i < k.X.size(); i++) {
+        if (k.Radius[i] < 0) continue;
+        const double dt = time - k.Time[i];
+        const double dx = x - (k.X[i] + k.Speed[i] * dt * k.Cos[i]);
+        const double dy = y - (k.Y[i] + k.Speed[i] * dt * k.Sin[i]);
+        best = fmin(best, fmax(sqrt(dx * dx + dy * dy) - k.Radius[i], 0));
+    }
+    return best;
+}
+
+bool GaussianDynamicObstaclesManager::possibleCollision(double minX, double minY, double maxX, double maxY,
+                                                       double startTime, double endTime, bool strict) const {
+    for (size_t i = 0; i < m_Kernels.X.size(); i++) {
+        if (m_Kernels.reaches(i, minX, minY, maxX, maxY, startTime, endTime)) return true;
+    }
+    return false;
+}
+
+bool GaussianDynamicObstaclesManager::Kernels::reaches(size_t i, double minX, double minY, double maxX, double maxY,
+                                                       double startTime, double endTime) const {
+    // same cutoff radius as distanceToNearestPossibleCollision
+    if (Radius[i] < 0) return false;
+    return sweptDiscOverlaps(X[i], Y[i], Time[i], Speed[i] * Cos[i], Speed[i] * Sin[i], Radius[i],
+                             minX, minY, maxX, maxY, startTime, endTime);
+}
+
+bool GaussianDynamicObstaclesManager::changedNear(const DynamicObstaclesManager& previous, double minX, double minY,
+                                                 double maxX, double maxY, double startTime, double endTime,
+                                                 bool strict) const {
+    if (&previous == this) return false;
+    auto other = dynamic_cast<const GaussianDynamicObstaclesManager*>(&previous);
+    if (!other) return true;
+    const auto& k = m_Kernels, & p = other->m_Kernels;
+    // only a handful of obstacles, so matching them up by looking through the whole list is fine
+    auto find = [](const Kernels& kernels, uint32_t id) {
+        for (size_t i = 0; i < kernels.Id.size(); i++) if (kernels.Id[i] == id) return (long)i;
+        return -1L;
+    };
+    for (size_t i = 0; i < k.Id.size(); i++) {
+        auto j = find(p, k.Id[i]);
+        if (j >= 0) {
+            if (k.X[i] == p.X[j] && k.Y[i] == p.Y[j] && k.Speed[i] == p.Speed[j] && k.Time[i] == p.Time[j] &&
+                k.Cos[i] == p.Cos[j] && k.Sin[i] == p.Sin[j] && k.A[i] == p.A[j] && k.B[i] == p.B[j] &&
+                k.C[i] == p.C[j] && k.D[i] == p.D[j] && k.Norm[i] == p.Norm[j]) continue;
+            // moved, so where it was matters as much as where it is now
+            if (p.reaches(j, minX, minY, maxX, maxY, startTime, endTime)) return true;
+        }
+        if (k.reaches(i, minX, minY, maxX, maxY, startTime, endTime)) return true;
+    }
+    for (size_t j = 0; j < p.Id.size(); j++) {
+        // gone
+        if (find(k, p.Id[j]) < 0 && p.reaches(j, minX, minY, maxX, maxY, startTime, endTime)) return true;
+    }
+    return false;
+}
+
+double GaussianDynamicObstaclesManager::maxObstacleSpeed() const {
+    return m_Kernels.MaxSpeed;
+}
+
+void GaussianDynamicObstaclesManager::rebuildKernels() {
+    m_Kernels = Kernels();
+    auto& k = m_Kernels;
+    for (const auto& o : m_Obstacles) {
+        const auto& obstacle = o.second;
+        const auto& inverse = obstacle.inverseCovariance;
+        k.X.push_back(obstacle.X); k.Y.push_back(obstacle.Y);
+        k.Speed.push_back(obstacle.Speed); k.Time.push_back(obstacle.Time);
+        k.Cos.push_back(cos(obstacle.Yaw)); k.Sin.push_back(sin(obstacle.Yaw));
+        k.A.push_back(inverse(0, 0)); k.B.push_back(inverse(0, 1));
+        k.C.push_back(inverse(1, 0)); k.D.push_back(inverse(1, 1));
+        k.Norm.push_back(obstacle.norm);
+        // norm * exp(-q / 2) < cutoff exactly when q is past this
+        auto quadformCutoff = obstacle.norm > c_DensityCutoff? 2 * log(obstacle.norm / c_DensityCutoff) : -1;
+        k.QuadformCutoff.push_back(quadformCutoff);
+        // q is at least the smallest eigenvalue of (the symmetric part of) the inverse covariance times the squared
+        // distance, so past this radius q is past its cutoff too
+        auto s11 = inverse(0, 0), s22 = inverse(1, 1), s12 = (inverse(0, 1) + inverse(1, 0)) / 2;
+        auto smallest = (s11 + s22) / 2 - sqrt((s11 - s22) * (s11 - s22) / 4 + s12 * s12);
+        if (quadformCutoff < 0) k.Radius.push_back(-1);
+        else k.Radius.push_back(smallest > 0? sqrt(quadformCutoff / smallest) : DBL_MAX); // not positive definite
+        k.Id.push_back(o.first);
+        k.MaxSpeed = fmax(k.MaxSpeed, fabs(obstacle.Speed));
+    }
+}
+
 void GaussianDynamicObstaclesManager::update(uint32_t mmsi, double x, double y, double heading, double speed,
                                              double time) {
     if (!isIgnored(mmsi)) {
@@ -21,11 +124,13 @@ void GaussianDynamicObstaclesManager::update(uint32_t mmsi, double x, double y,
         if (!result.second) {
             result.first->second = Obstacle(x, y, heading, speed, time);
         }
+        rebuildKernels();
     }
 }
 
 void GaussianDynamicObstaclesManager::forget(uint32_t mmsi) {
     m_Obstacles.erase(mmsi);
+    rebuildKernels();
 }
 
 const std::unordered_map<uint32_t, GaussianDynamicObstaclesManager::Obstacle>& GaussianDynamicObstaclesManager::get() const {
@@ -41,5 +146,6 @@ void GaussianDynamicObstaclesManager::update(uint32_t mmsi, double x, double y,
         if (!result.second) {
             result.first->second = Obstacle(x, y, heading, speed, time, covariance);
         }
+        rebuildKernels();
     }
 }
@@ -5,6 +5,7 @@
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/LU>
 #include <utility>
+#include <vector>
 
 /**
  * Class to manage Gaussian-like dynamic obstacles.
@@ -19,14 +20,20 @@ public:
         double X, Y, Yaw, Speed, Time;
         Eigen::Vector2d mean;
         Eigen::Matrix<double, 2, 2> covariance;
+        // worked out once when the obstacle is made, rather than on every evaluation
+        Eigen::Matrix<double, 2, 2> inverseCovariance;
+        double norm;
         Obstacle(double x, double y, double heading, double speed, double time)
                 : X(x), Y(y), Yaw(M_PI_2 - heading), Speed(speed), Time(time), mean(x, y){
             covariance << 30, 10,
                           10, 30;
+            precompute();
         }
 
         Obstacle(double x, double y, double heading, double speed, double time, Eigen::Matrix<double, 2, 2> covariance)
-                : X(x), Y(y), Yaw(M_PI_2 - heading), Speed(speed), Time(time), mean(x, y), covariance(std::move(covariance)) {}
+                : X(x), Y(y), Yaw(M_PI_2 - heading), Speed(speed), Time(time), mean(x, y), covariance(std::move(covariance)) {
+            precompute();
+        }
 
         void project(double desiredTime) {
             double dt = desiredTime - Time;
@@ -37,17 +44,40 @@ public:
         }
 
         double pdf(const Eigen::Vector2d& x) const {
-            double twoPi = 2 * M_PI;
-            double quadform  = (x - mean).transpose() * covariance.inverse() * (x - mean);
-            double norm = 1.0 / twoPi / std::sqrt(covariance.determinant());
+            double quadform  = (x - mean).transpose() * inverseCovariance * (x - mean);
             return norm * exp(-0.5 * quadform);
         }
+
+    private:
+        void precompute() {
+            double twoPi = 2 * M_PI;
+            inverseCovariance = covariance.inverse();
+            norm = 1.0 / twoPi / std::sqrt(covariance.determinant());
+        }
     };
 
     ~GaussianDynamicObstaclesManager() override = default;
 
     double collisionExists(double x, double y, double time, bool strict) const override;
 
+    /**
+     * Densities have unbounded support, but collisionExists ignores an obstacle's density once it drops below
+     * c_DensityCutoff, so nowhere farther than each obstacle's cutoff radius from its mean gets a penalty from it.
+     */
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const override;
+
+    double maxObstacleSpeed() const override;
+
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const override;
+
+    /**
+     * Only obstacles that appeared, went away or were updated since the previous snapshot count, and only if their
+     * densities reach the box (where they were before or where they are now).
+     */
+    bool changedNear(const DynamicObstaclesManager& previous, double minX, double minY, double maxX, double maxY,
+                     double startTime, double endTime, bool strict) const override;
+
     void update(uint32_t mmsi, double x, double y, double heading, double speed, double time);
 
     void update(uint32_t mmsi, double x, double y, double heading, double speed, double time, Eigen::Matrix<double, 2, 2> covariance);
@@ -56,8 +86,33 @@ public:
 
     const std::unordered_map<uint32_t, Obstacle>& get() const;
 
+    // Densities below this don't get added in. Even with a hundred obstacles that's well under the 1e-5 floor on the
+    // total, but it means far away obstacles can be skipped without evaluating the exponential
+    static constexpr double c_DensityCutoff = 1e-8;
+
 private:
     std::unordered_map<uint32_t, Obstacle> m_Obstacles;
+
+    // The obstacles again, one array per field so the loop over them vectorizes. Rebuilt whenever they change.
+    struct Kernels {
+        std::vector<double> X, Y, Speed, Time, Cos, Sin;
+        // inverse covariance entries and normalization
+        std::vector<double> A, B, C, D, Norm;
+        // squared Mahalanobis distance past which the density is below the cutoff, and the Euclidean distance that's
+        // guaranteed to be past it (negative when the obstacle never gets above the cutoff)
+        std::vector<double> QuadformCutoff, Radius;
+        // whose they are
+        std::vector<uint32_t> Id;
+        double MaxSpeed = 0;
+
+        /**
+         * Whether kernel i could put a density anywhere in the box during the interval.
+         */
+        bool reaches(size_t i, double minX, double minY, double maxX, double maxY, double startTime,
+                     double endTime) const;
+    } m_Kernels;
+
+    void rebuildKernels();
 };
 
 
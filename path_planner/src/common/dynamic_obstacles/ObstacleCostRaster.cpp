@@ -0,0 +1,72 @@
+#include <cmath>
+#include <stdexcept>
+#include "ObstacleCostRaster.h"
+
+ObstacleCostRaster::ObstacleCostRaster(DynamicObstaclesManager::ConstSharedPtr source, double minX, double maxX,
+                                       double minY, double maxY, double startTime, double duration, double cellSize,
+                                       double timeStep, size_t maxCells, const ParallelFor& parallelFor)
+        : m_Source(std::move(source)), m_MinX(minX), m_MinY(minY), m_StartTime(startTime), m_CellSize(cellSize),
+          m_TimeStep(timeStep) {
+    if (!m_Source) throw std::invalid_argument("Cannot rasterize a null obstacles manager");
+    if (!(cellSize > 0 && timeStep > 0)) throw std::invalid_argument("Obstacle raster resolution must be positive");
+    if (!(maxX >= minX && maxY >= minY && duration >= 0)) throw std::invalid_argument("Empty obstacle raster window");
+    // the last slice is at or past the end of the horizon so everything in it is inside the grid
+    m_NT = (size_t)ceil(duration / m_TimeStep) + 1;
+    while (true) {
+        m_NX = (size_t)ceil((maxX - minX) / m_CellSize) + 1;
+        m_NY = (size_t)ceil((maxY - minY) / m_CellSize) + 1;
+        auto needed = 2.0 * m_NX * m_NY * m_NT;
+        if (needed <= maxCells) break;
+        if (m_NX == 1 && m_NY == 1) throw std::invalid_argument("Obstacle raster cannot fit in the maximum cells");
+        // cells scale with the square of the spacing; round up a little so this doesn't take many goes
+        m_CellSize *= fmax(sqrt(needed / maxCells), 1.01);
+    }
+    m_Normal.resize(m_NX * m_NY * m_NT);
+    m_Strict.resize(m_Normal.size());
+    auto slice = [&](size_t k) {
+        auto t = m_StartTime + k * m_TimeStep;
+        for (size_t j = 0; j < m_NY; j++) {
+            auto y = m_MinY + j * m_CellSize;
+            for (size_t i = 0; i < m_NX; i++) {
+                auto x = m_MinX + i * m_CellSize;
+                m_Normal[index(i, j, k)] = (float)m_Source->collisionExists(x, y, t, false);
+                m_Strict[index(i, j, k)] = (float)m_Source->collisionExists(x, y, t, true);
+            }
+        }
+    };
+    if (parallelFor) parallelFor(m_NT, slice);
+    else for (size_t k = 0; k < m_NT; k++) slice(k);
+}
+
+double ObstacleCostRaster::collisionExists(double x, double y, double time, bool strict) const {
+    auto fx = (x - m_MinX) / m_CellSize, fy = (y - m_MinY) / m_CellSize, ft = (time - m_StartTime) / m_TimeStep;
+    // written so NaN goes to the source too
+    if (!(fx >= 0 && fx <= m_NX - 1 && fy >= 0 && fy <= m_NY - 1 && ft >= 0 && ft <= m_NT - 1)) {
+        return m_Source->collisionExists(x, y, time, strict);
+    }
+    // clamp the lower corner so points on the far edges interpolate within the last cell
+    auto i = (size_t)fmin(floor(fx), m_NX > 1 ? m_NX - 2 : 0);
+    auto j = (size_t)fmin(floor(fy), m_NY > 1 ? m_NY - 2 : 0);
+    auto k = (size_t)fmin(floor(ft), m_NT > 1 ? m_NT - 2 : 0);
+    auto u = fx - i, v = fy - j, w = ft - k;
+    size_t di = m_NX > 1 ? 1 : 0, dj = m_NY > 1 ? m_NX : 0, dk = m_NT > 1 ? m_NX * m_NY : 0;
+    const auto* c = (strict ? m_Strict.data() : m_Normal.data()) + index(i, j, k);
+    auto lerp = [](double a, double b, double s) { return a + (b - a) * s; };
+    auto front = lerp(lerp(c[0], c[di], u), lerp(c[dj], c[dj + di], u), v);
+    auto back = lerp(lerp(c[dk], c[dk + di], u), lerp(c[dk + dj], c[dk + dj + di], u), v);
+    return lerp(front, back, w);
+}
+
+double ObstacleCostRaster::distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const {
+    // a lookup is only non-zero if one of its cell's corners is, and those are within a cell diagonal and a time step
+    // (during which obstacles can't move further than their top speed) of the point
+    auto d = m_Source->distanceToNearestPossibleCollision(x, y, time, strict);
+    return fmax(d - m_CellSize * M_SQRT2 - m_Source->maxObstacleSpeed() * m_TimeStep, 0);
+}
+
+bool ObstacleCostRaster::possibleCollision(double minX, double minY, double maxX, double maxY, double startTime,
+                                           double endTime, bool strict) const {
+    // same reasoning: the corners any lookup in the box uses are within a cell and a time step of it
+    return m_Source->possibleCollision(minX - m_CellSize, minY - m_CellSize, maxX + m_CellSize, maxY + m_CellSize,
+                                       startTime - m_TimeStep, endTime + m_TimeStep, strict);
+}
@@ -0,0 +1,71 @@
+#ifndef SRC_OBSTACLECOSTRASTER_H
+#define SRC_OBSTACLECOSTRASTER_H
+
+#include <vector>
+#include <functional>
+#include "DynamicObstaclesManager.h"
+
+/**
+ * Another obstacles manager's costs sampled onto an (x, y, t) grid over the planning window, so a collision check is
+ * a trilinear lookup no matter how many obstacles there are. That's an approximation (obstacles get smeared over a
+ * cell and a time step) which is why it's optional, but with dense traffic it's a lot quicker than asking every
+ * obstacle at every collision checking step. Anything outside the window goes to the original manager.
+ *
+ * Both the normal and strict costs are rasterized, one time slice per task, so it can be spread over a worker pool.
+ * It's immutable once built.
+ */
+class ObstacleCostRaster : public DynamicObstaclesManager {
+public:
+    typedef std::function<void(size_t, const std::function<void(size_t)>&)> ParallelFor;
+
+    /**
+     * Rasterize a manager. If the grid would need more than maxCells values the cells are made bigger until it fits.
+     * @param source manager to rasterize (kept around for queries outside the window)
+     * @param minX window
+     * @param maxX
+     * @param minY
+     * @param maxY
+     * @param startTime
+     * @param duration
+     * @param cellSize spacing of the grid (m)
+     * @param timeStep spacing of the time slices (s)
+     * @param maxCells most values to store, counting both the normal and strict grids
+     * @param parallelFor runs task(0) ... task(n - 1), in parallel if you like (serial if empty)
+     */
+    ObstacleCostRaster(DynamicObstaclesManager::ConstSharedPtr source, double minX, double maxX, double minY,
+                       double maxY, double startTime, double duration, double cellSize, double timeStep,
+                       size_t maxCells, const ParallelFor& parallelFor = ParallelFor());
+
+    ~ObstacleCostRaster() override = default;
+
+    double collisionExists(double x, double y, double time, bool strict) const override;
+
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const override;
+
+    double maxObstacleSpeed() const override { return m_Source->maxObstacleSpeed(); }
+
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const override;
+
+    /**
+     * @return the cell size actually used, which can be bigger than asked for to keep memory bounded
+     */
+    double cellSize() const { return m_CellSize; }
+
+    /**
+     * @return number of values stored (both grids)
+     */
+    size_t cells() const { return m_Normal.size() + m_Strict.size(); }
+
+private:
+    DynamicObstaclesManager::ConstSharedPtr m_Source;
+    double m_MinX, m_MinY, m_StartTime, m_CellSize, m_TimeStep;
+    // grid vertices in each dimension
+    size_t m_NX, m_NY, m_NT;
+    std::vector<float> m_Normal, m_Strict;
+
+    size_t index(size_t i, size_t j, size_t k) const { return (k * m_NY + j) * m_NX + i; }
+};
+
+
+#endif //SRC_OBSTACLECOSTRASTER_H
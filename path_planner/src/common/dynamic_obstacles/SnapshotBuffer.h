@@ -0,0 +1,86 @@
+#ifndef SRC_SNAPSHOTBUFFER_H
+#define SRC_SNAPSHOTBUFFER_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Double buffer for something that one thread keeps changing and another reads a lot, like the obstacles managers
+ * (contact callbacks write, the planner reads at every collision check). Changes go into a writer-side copy, and
+ * publish() copies that into a new immutable snapshot and swaps it in with one atomic pointer store. Readers grab
+ * the current snapshot once and can use it as long as they like without any synchronization, since nothing ever
+ * changes it; it goes away when the last reader lets go.
+ *
+ * The writer side has a mutex, but it's only between modify() and publish(), which happen a few times a second. The
+ * read path never touches it.
+ *
+ * Each new snapshot bumps version(), so readers can cheaply tell whether anything's changed since they last looked.
+ * @tparam T copyable
+ */
+template <class T>
+class SnapshotBuffer {
+public:
+    typedef std::shared_ptr<const T> Snapshot;
+
+    SnapshotBuffer() : m_Published(std::make_shared<const T>()) {}
+
+    /**
+     * Change the writer-side copy. Readers don't see it until the next publish().
+     * @param f called with the writer-side copy
+     */
+    template <class F>
+    void modify(F f) {
+        std::lock_guard<std::mutex> lock(m_WriterMutex);
+        f(m_Writer);
+        m_Dirty = true;
+    }
+
+    /**
+     * Throw away everything, for readers too (after the next publish()).
+     */
+    void reset() {
+        modify([](T& t) { t = T(); });
+    }
+
+    /**
+     * Make the writer-side copy the current snapshot, if it's changed since last time.
+     */
+    void publish() {
+        std::unique_lock<std::mutex> lock(m_WriterMutex);
+        if (!m_Dirty) return;
+        auto snapshot = std::make_shared<const T>(m_Writer);
+        m_Dirty = false;
+        lock.unlock();
+        std::atomic_store(&m_Published, Snapshot(std::move(snapshot)));
+        m_Version.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @return the last published snapshot
+     */
+    Snapshot current() const {
+        return std::atomic_load(&m_Published);
+    }
+
+    /**
+     * The version goes up after the snapshot is swapped in, so a snapshot grabbed after reading the version is at
+     * least that new.
+     * @return number of snapshots published so far
+     */
+    uint64_t version() const {
+        return m_Version.load(std::memory_order_acquire);
+    }
+
+private:
+    std::mutex m_WriterMutex;
+    T m_Writer;
+    bool m_Dirty = false;
+    // only ever accessed with the atomic shared_ptr functions
+    Snapshot m_Published;
+    std::atomic<uint64_t> m_Version{0};
+};
+
+
+#endif //SRC_SNAPSHOTBUFFER_H
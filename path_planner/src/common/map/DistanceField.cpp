@@ -0,0 +1,108 @@
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include "DistanceField.h"
+
+DistanceField::DistanceField(const OccupancyGrid& grid, unsigned threads)
+        : m_Cols(grid.cols()), m_Rows(grid.rows()) {
+    const auto inf = std::numeric_limits<float>::infinity();
+    m_SquaredDistances.resize(m_Cols * m_Rows);
+    for (size_t row = 0; row < m_Rows; row++) {
+        for (size_t col = 0; col < m_Cols; col++) {
+            m_SquaredDistances[row * m_Cols + col] = grid.cellBlocked(col, row) ? 0 : inf;
+        }
+    }
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    // run transform over count lines, with the work split between the threads
+    auto pass = [&](size_t count, size_t length, size_t lineStride, size_t stride) {
+        auto work = [&](size_t first, size_t last) {
+            std::vector<int> v(length);
+            std::vector<double> z(length + 1);
+            std::vector<float> out(length);
+            for (size_t i = first; i < last; i++) {
+                transform(m_SquaredDistances.data() + i * lineStride, length, stride, v.data(), z.data(), out.data());
+            }
+        };
+        auto n = std::min<size_t>(threads, count);
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < n; t++) workers.emplace_back(work, count * t / n, count * (t + 1) / n);
+        work(0, n == 0 ? 0 : count / n);
+        for (auto& w : workers) w.join();
+    };
+    pass(m_Rows, m_Cols, m_Cols, 1);
+    pass(m_Cols, m_Rows, 1, m_Cols);
+}
+
+DistanceField::DistanceField(size_t cols, size_t rows, std::vector<float> squaredDistances)
+        : m_Cols(cols), m_Rows(rows), m_SquaredDistances(std::move(squaredDistances)) {
+    if (m_SquaredDistances.size() != cols * rows) throw std::invalid_argument("Distance field doesn't match its size");
+}
+
+double DistanceField::cellDistance(size_t col, size_t row) const {
+    return sqrt((double)m_SquaredDistances[row * m_Cols + col]);
+}
+
+double DistanceField::distanceToBlocked(double col, double row) const {
+    if (!((col >= 0) & (col < m_Cols) & (row >= 0) & (row < m_Rows))) return 0;
+    // the point and the nearest blocked cell's closest point are each within half a diagonal of their cells' centres;
+    // the little bit extra covers float rounding of big squared distances
+    auto d = cellDistance((size_t)col, (size_t)row) * (1 - 1e-6) - M_SQRT2;
+    auto edge = std::min(std::min(col, m_Cols - col), std::min(row, m_Rows - row));
+    return fmax(fmin(d, edge), 0);
+}
+
+double DistanceField::interpolate(double col, double row, double& dCol, double& dRow) const {
+    dCol = dRow = 0;
+    if (!((col >= 0) & (col < m_Cols) & (row >= 0) & (row < m_Rows))) return 0;
+    // the cell centres around the point, clamped so the outermost half cells extrapolate from the last patch
+    auto u = col - 0.5, v = row - 0.5;
+    auto c0 = (size_t)std::min(std::max(floor(u), 0.0), (double)(m_Cols > 1 ? m_Cols - 2 : 0));
+    auto r0 = (size_t)std::min(std::max(floor(v), 0.0), (double)(m_Rows > 1 ? m_Rows - 2 : 0));
+    auto c1 = std::min(c0 + 1, m_Cols - 1), r1 = std::min(r0 + 1, m_Rows - 1);
+    auto d00 = cellDistance(c0, r0), d10 = cellDistance(c1, r0), d01 = cellDistance(c0, r1), d11 = cellDistance(c1, r1);
+    if (std::isinf(d00 + d10 + d01 + d11)) return std::numeric_limits<double>::infinity();
+    auto t = std::min(std::max(u - c0, 0.0), 1.0), s = std::min(std::max(v - r0, 0.0), 1.0);
+    auto bottom = d00 + (d10 - d00) * t, top = d01 + (d11 - d01) * t;
+    if (c1 != c0) dCol = (d10 - d00) * (1 - s) + (d11 - d01) * s;
+    if (r1 != r0) dRow = top - bottom;
+    return bottom + (top - bottom) * s;
+}
+
+void DistanceField::transform(float* f, size_t n, size_t stride, int* v, double* z, float* out) {
+    const auto inf = std::numeric_limits<float>::infinity();
+    const auto infinity = std::numeric_limits<double>::infinity();
+    // lower envelope of the parabolas rooted at the finite values
+    int k = -1;
+    for (int q = 0; q < (int)n; q++) {
+        auto fq = f[q * stride];
+        if (fq == inf) continue;
+        if (k == -1) {
+            k = 0; v[0] = q; z[0] = -infinity; z[1] = infinity;
+            continue;
+        }
+        // in doubles since squared coordinates of big maps are more than floats can hold exactly
+        double s;
+        while (true) {
+            auto p = v[k];
+            s = (((double)fq + (double)q * q) - ((double)f[p * stride] + (double)p * p)) / (2.0 * (q - p));
+            if (s > z[k] || k == 0) break;
+            k--;
+        }
+        // if it's below everything, it replaces the first one too
+        if (s <= z[k]) {
+            v[k] = q; z[k] = -infinity; z[k + 1] = infinity;
+        } else {
+            k++; v[k] = q; z[k] = s; z[k + 1] = infinity;
+        }
+    }
+    if (k == -1) return; // nothing blocked on this line so it's all still infinite
+    int j = 0;
+    for (int q = 0; q < (int)n; q++) {
+        while (z[j + 1] < q) j++;
+        auto d = (double)(q - v[j]);
+        out[q] = (float)(d * d + f[v[j] * stride]);
+    }
+    for (size_t q = 0; q < n; q++) f[q * stride] = out[q];
+}
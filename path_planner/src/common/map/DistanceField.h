@@ -0,0 +1,91 @@
+#ifndef SRC_DISTANCEFIELD_H
+#define SRC_DISTANCEFIELD_H
+
+#include <vector>
+#include "OccupancyGrid.h"
+
+/**
+ * Distance from every cell of an occupancy grid to the nearest blocked cell, worked out once when a map loads so
+ * clearance queries are a lookup. This is the brushfire the maps used to have commented out, except it's an exact
+ * Euclidean distance transform (Felzenszwalb and Huttenlocher's lower envelope of parabolas, one pass along the rows
+ * and then one down the columns) so it's linear in the number of cells, and the rows (then columns) are split between
+ * threads.
+ *
+ * Everything is in cells; maps scale by their resolution.
+ */
+class DistanceField {
+public:
+    DistanceField() = default;
+
+    /**
+     * Compute the field for a grid.
+     * @param grid
+     * @param threads how many threads to use (0 for one per core)
+     */
+    explicit DistanceField(const OccupancyGrid& grid, unsigned threads = 0);
+
+    /**
+     * Field straight from squared distances (from squaredDistances(), say).
+     * @param cols
+     * @param rows
+     * @param squaredDistances
+     */
+    DistanceField(size_t cols, size_t rows, std::vector<float> squaredDistances);
+
+    /**
+     * @param col
+     * @param row
+     * @return distance between the centres of the cell and the nearest blocked cell (infinite if nothing's blocked)
+     */
+    double cellDistance(size_t col, size_t row) const;
+
+    /**
+     * Lower bound on the distance from a point to the nearest blocked cell or the edge of the grid (off the grid counts
+     * as blocked, like the maps do).
+     * @param col fractional grid coordinates
+     * @param row
+     * @return distance (cells), zero if the point is blocked or off the grid
+     */
+    double distanceToBlocked(double col, double row) const;
+
+    /**
+     * Smooth version of the distance: bilinear between the cell centres, so it has a gradient pointing away from the
+     * nearest blocked cells. Not a bound like distanceToBlocked, just for things that want pushing away from obstacles.
+     * @param col fractional grid coordinates
+     * @param row
+     * @param dCol output gradient (cells per cell)
+     * @param dRow
+     * @return distance (cells), infinite if nothing's blocked, and zero with no gradient off the grid
+     */
+    double interpolate(double col, double row, double& dCol, double& dRow) const;
+
+    bool empty() const { return m_SquaredDistances.empty(); }
+
+    /**
+     * @return bytes held for the distances
+     */
+    size_t memoryUsage() const { return m_SquaredDistances.capacity() * sizeof(float); }
+
+    /**
+     * @return squared centre to centre distances (cells), row-major
+     */
+    const std::vector<float>& squaredDistances() const { return m_SquaredDistances; }
+
+private:
+    size_t m_Cols = 0, m_Rows = 0;
+    std::vector<float> m_SquaredDistances;
+
+    /**
+     * One dimensional transform of n values spaced stride apart, in place.
+     * @param f squared distances (or infinity)
+     * @param n
+     * @param stride
+     * @param v scratch space for n ints
+     * @param z scratch space for n + 1 doubles
+     * @param out scratch space for n floats
+     */
+    static void transform(float* f, size_t n, size_t stride, int* v, double* z, float* out);
+};
+
+
+#endif //SRC_DISTANCEFIELD_H
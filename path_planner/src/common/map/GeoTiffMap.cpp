@@ -3,9 +3,12 @@
 #include <ogr_spatialref.h>
 #include <cfloat>
 #include <queue>
+#include <cmath>
+#include <algorithm>
 #include "GeoTiffMap.h"
 
-GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double originLatitude) {
+GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double originLatitude,
+                       const std::function<bool()>& cancelled) {
     GDALAllRegister();
     auto dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly));
     if (!dataset) throw std::runtime_error("GeoTiffMap failed to load map file");
@@ -22,21 +25,31 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
         throw std::runtime_error("GeoTiffMap failed to invert geo transform");
     }
     int rasterCols = band->GetXSize(), rasterRows = band->GetYSize();
-    m_Data = std::vector<std::vector<float>>(rasterRows);
-    auto line = static_cast<float*>(CPLMalloc(sizeof(float) * rasterCols));
-    // Read a row at a time. Efficiency shouldn't matter here and I'm more comfortable programming it this way
-    for (int i = 0; i < rasterRows; i++) {
-        auto err3 = band->RasterIO(GF_Read, 0, i, rasterCols, 1, line, rasterCols, 1, GDT_Float32, 0, 0);
+    std::vector<float> data((size_t)rasterCols * rasterRows);
+    // Read a block of rows at a time, as many as the file stores together (or a scanline's worth). That's also as often
+    // as we check whether to give up
+    int blockCols = 0, blockRows = 0;
+    band->GetBlockSize(&blockCols, &blockRows);
+    if (blockRows < 1) blockRows = 1;
+    for (int i = 0; i < rasterRows; i += blockRows) {
+        if (cancelled && cancelled()) {
+            GDALClose(dataset);
+            delete[] geoTransform;
+            throw MapLoadCancelled();
+        }
+        auto rows = std::min(blockRows, rasterRows - i);
+        auto err3 = band->RasterIO(GF_Read, 0, i, rasterCols, rows, data.data() + (size_t)i * rasterCols,
+                                   rasterCols, rows, GDT_Float32, 0, 0);
         if (err3 != CE_None) {
             std::ostringstream stringStream;
             stringStream << "GeoTiffMap failed to access data at row " << i << "of band 1";
             throw std::runtime_error(stringStream.str());
         }
-        for (int j = 0; j < rasterCols; j++) {
-            m_Data[i].push_back(line[j]);
-        }
     }
-    CPLFree(line);
+    m_Grid = OccupancyGrid(std::move(data), rasterCols, rasterRows, c_MinimumDepth);
+    // the distance transform does what the brushfire below was for
+    m_Distances = DistanceField(m_Grid);
+    finishLoading();
 
 //    std::cerr << "Done reading map. Starting distances calculations" << std::endl;
 
@@ -79,21 +92,6 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
 //    std::queue<BrushFireCell> brushFireQueue;
 //    m_Distances = std::vector<std::vector<double>>(rasterRows, std::vector<double>(rasterCols, DBL_MAX));
 //
-    int blockedCount = 0;
-    for (int y = 0; y < rasterRows; y++) {
-        for (int x = 0; x < rasterCols; x++) {
-            if (m_Data[y][x] < c_MinimumDepth) {
-//                brushFireQueue.push(BrushFireCell(x, y, -1));
-                blockedCount++;
-//                std::cerr << "#";
-            }
-//            else {
-//                std::cerr << "_";
-//            }
-        }
-//        std::cerr << std::endl;
-    }
-
     // prints out the map (upside down)
 //    for (int y = 0; y < rows; y++) {
 //        for (int x = 0; x < cols; x++) {
@@ -102,7 +100,7 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
 //        std::cerr << std::endl;
 //    }
 
-    std::cerr << blockedCount << " out of " << rasterCols*rasterRows << " cells blocked" << std::endl;
+    std::cerr << m_Grid.blockedCount() << " out of " << rasterCols*rasterRows << " cells blocked" << std::endl;
 //
 //    while (!brushFireQueue.empty()) {
 //        auto& cell = brushFireQueue.front();
@@ -115,21 +113,74 @@ GeoTiffMap::GeoTiffMap(const std::string& path, double originLongitude, double o
 
     std::cerr << "Done loading map from " << path << std::endl;
 
+    GDALClose(dataset);
     delete[] geoTransform;
 }
 
+GeoTiffMap::GeoTiffMap(std::vector<double> inverseGeoTransform, OccupancyGrid grid, DistanceField distances)
+        : m_Grid(std::move(grid)), m_Distances(std::move(distances)), m_InverseGeoTransform(std::move(inverseGeoTransform)),
+          m_XOrigin(0), m_YOrigin(0) {
+    if (m_InverseGeoTransform.size() != 6) throw std::invalid_argument("GeoTiffMap needs a six element geo transform");
+    finishLoading();
+}
+
+void GeoTiffMap::finishLoading() {
+    m_Pyramid = OccupancyPyramid(m_Grid);
+    // the smallest singular value of the pixel to metre part of the transform, which is one over the biggest of the
+    // inverse's
+    auto& n = m_InverseGeoTransform;
+    auto sumOfSquares = n[1] * n[1] + n[2] * n[2] + n[4] * n[4] + n[5] * n[5];
+    auto determinant = n[1] * n[5] - n[2] * n[4];
+    m_MinimumPixelSize = 1 / sqrt((sumOfSquares + sqrt(fmax(sumOfSquares * sumOfSquares -
+            4 * determinant * determinant, 0))) / 2);
+}
+
 float GeoTiffMap::getDepth(double x, double y) const {
-    auto xi = m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2];
-    auto yi = m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5];
-    // bad: using exceptions for control flow
-    try {
-        return m_Data.at((int)yi).at((int)xi);
-    } catch(std::out_of_range&) {
-        return 0;
+    double col, row;
+    gridCoordinates(x, y, col, row);
+    // (off the map is blocked too, and c_MinimumDepth is 0 like the off the map depth, so it's the same either way)
+    if (!m_Grid.hasValues()) return m_Grid.blockedAt(col, row) ? c_MinimumDepth : NAN;
+    return m_Grid.valueAt(col, row, 0);
+}
+
+void GeoTiffMap::checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+    for (size_t i = 0; i < n; i++) {
+        double col, row;
+        gridCoordinates(x[i], y[i], col, row);
+        blocked[i] = m_Grid.blockedAt(col, row);
     }
+}
 
+double GeoTiffMap::distanceToBlocked(double x, double y) const {
+    // untruncated, so the sliver before the first row and column just gets zero, which is safe
+    auto col = m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2];
+    auto row = m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5];
+    return m_Distances.distanceToBlocked(col, row) * m_MinimumPixelSize;
 }
 
-bool GeoTiffMap::isBlocked(double x, double y) const {
-    return getDepth(x, y) <= c_MinimumDepth;
+bool GeoTiffMap::clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const {
+    if (m_Distances.empty()) return false;
+    auto col = m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2];
+    auto row = m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5];
+    double dCol, dRow;
+    distance = m_Distances.interpolate(col, row, dCol, dRow) * m_MinimumPixelSize;
+    // back through the geotransform to metres per metre
+    gradientX = (dCol * m_InverseGeoTransform[1] + dRow * m_InverseGeoTransform[4]) * m_MinimumPixelSize;
+    gradientY = (dCol * m_InverseGeoTransform[2] + dRow * m_InverseGeoTransform[5]) * m_MinimumPixelSize;
+    return true;
+}
+
+bool GeoTiffMap::possiblyBlocked(double minX, double minY, double maxX, double maxY) const {
+    // the rectangle's corners bound the parallelogram it turns into on the raster
+    double minCol = DBL_MAX, maxCol = -DBL_MAX, minRow = DBL_MAX, maxRow = -DBL_MAX;
+    for (auto x : {minX, maxX}) {
+        for (auto y : {minY, maxY}) {
+            double col, row;
+            gridCoordinates(x, y, col, row);
+            minCol = fmin(minCol, col); maxCol = fmax(maxCol, col);
+            minRow = fmin(minRow, row); maxRow = fmax(maxRow, row);
+        }
+    }
+    if (!(minCol >= 0 && maxCol < m_Grid.cols() && minRow >= 0 && maxRow < m_Grid.rows())) return true;
+    return m_Pyramid.anyBlocked((size_t)minCol, (size_t)minRow, (size_t)maxCol, (size_t)maxRow);
 }
@@ -3,7 +3,12 @@
 
 #include <gdal_priv.h>
 #include <string>
+#include <cmath>
+#include <functional>
 #include "Map.h"
+#include "OccupancyGrid.h"
+#include "DistanceField.h"
+#include "OccupancyPyramid.h"
 
 /**
  * Represent a map loaded from a GeoTiff.
@@ -16,24 +21,93 @@ public:
      * @param path path to the map file.
      * @param longitude origin longitude
      * @param originLatitude origin latitude
+     * @param cancelled checked between blocks of rows; if it ever says yes, loading stops with a MapLoadCancelled
      */
-    explicit GeoTiffMap(const std::string& path, double longitude, double originLatitude);
+    explicit GeoTiffMap(const std::string& path, double longitude, double originLatitude,
+                        const std::function<bool()>& cancelled = nullptr);
+
+    /**
+     * Put a map back together from what inverseGeoTransform(), grid() and distances() gave (out of a MapCache, say).
+     * The grid doesn't need depths.
+     * @param inverseGeoTransform
+     * @param grid
+     * @param distances
+     */
+    GeoTiffMap(std::vector<double> inverseGeoTransform, OccupancyGrid grid, DistanceField distances);
 
     ~GeoTiffMap() override = default;
 
+    /**
+     * @param x
+     * @param y
+     * @return depth (0 off the map), or if the map came without depths, c_MinimumDepth where blocked and NaN elsewhere
+     */
     float getDepth(double x, double y) const;
 
-    bool isBlocked(double x, double y) const override;
+    // in here so the planner's edge sweep (which calls it without going through the vtable) can inline it
+    bool isBlocked(double x, double y) const override {
+        double col, row;
+        gridCoordinates(x, y, col, row);
+        return m_Grid.blockedAt(col, row);
+    }
+
+    void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const override;
+
+    /**
+     * Looked up in the distance field computed when the map loads.
+     * @param x
+     * @param y
+     * @return
+     */
+    double distanceToBlocked(double x, double y) const override;
+
+    bool clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const override;
+
+    bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const override;
+
+    size_t memoryUsage() const override {
+        return m_Grid.memoryUsage() + m_Distances.memoryUsage() + m_Pyramid.memoryUsage();
+    }
+
+    const std::vector<double>& inverseGeoTransform() const { return m_InverseGeoTransform; }
+
+    const OccupancyGrid& grid() const { return m_Grid; }
+
+    const DistanceField& distances() const { return m_Distances; }
+
+    static constexpr double c_MinimumDepth = 0;
 
     // TODO! -- to be useful in PF planner, override resolution function to allow querying at the right intervals
 
 private:
 //    GDALDataset* m_Dataset;
-    std::vector<std::vector<float>> m_Data;
-    std::vector<std::vector<double>> m_Distances;
+    // depths, blocked where they're at or below c_MinimumDepth
+    OccupancyGrid m_Grid;
+    DistanceField m_Distances;
+    OccupancyPyramid m_Pyramid;
+    // the least a step of one pixel can be in metres, for turning pixel distances into lower bounds in metres
+    double m_MinimumPixelSize;
     std::vector<double> m_InverseGeoTransform;
     double m_XOrigin, m_YOrigin;
-    static constexpr double c_MinimumDepth = 0;
+
+    /**
+     * Work out the rest from the grid, distance field and geo transform.
+     */
+    void finishLoading();
+
+    /**
+     * Apply the inverse geo transform to get the (integer valued) grid cell a point is in.
+     * @param x
+     * @param y
+     * @param col
+     * @param row
+     */
+    void gridCoordinates(double x, double y, double& col, double& row) const {
+        // truncated rather than floored to match the int casts lookups always used, so the sliver just before the
+        // first row and column still counts as on the map
+        col = trunc(m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2]);
+        row = trunc(m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5]);
+    }
 };
 
 
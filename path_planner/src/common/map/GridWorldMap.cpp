@@ -24,10 +24,7 @@ GridWorldMap::GridWorldMap(const std::string& path) {
     }
     std::reverse(lines.begin(), lines.end());
 
-    m_Blocked = std::vector<std::vector<bool>>(rows, std::vector<bool>(cols, false));
-
-    m_Extremes[0] = 0; m_Extremes[1] = m_Blocked.front().size() * m_Resolution;
-    m_Extremes[2] = 0; m_Extremes[3] = m_Blocked.size() * m_Resolution;
+    m_Grid = OccupancyGrid(cols, rows);
 
 //    class BrushFireCell {
 //    public:
@@ -57,12 +54,16 @@ GridWorldMap::GridWorldMap(const std::string& path) {
     for (int y = 0; y < rows; y++) {
         for (int x = 0; x < cols; x++) {
             if (lines[y][x] == '#') {
-                m_Blocked[y][x] = true;
+                m_Grid.setBlocked(x, y, true);
 //                brushFireQueue.push(BrushFireCell(x, y, -1));
             }
         }
     }
 
+    // the distance transform does what the brushfire was for
+    m_Distances = DistanceField(m_Grid);
+    finishLoading();
+
     // prints out the map (upside down)
 //    for (int y = 0; y < rows; y++) {
 //        for (int x = 0; x < cols; x++) {
@@ -81,15 +82,39 @@ GridWorldMap::GridWorldMap(const std::string& path) {
 //    }
 }
 
-bool GridWorldMap::isBlocked(double x, double y) const {
-    if (x < 0 || x / m_Resolution >= m_Blocked.front().size()) return true;
-    if (y < 0 || y / m_Resolution >= m_Blocked.size()) return true;
-//    try {
-        return m_Blocked.at(y / m_Resolution).at(x / m_Resolution);
-//    }
-//    catch (std::out_of_range&) {
-//        return true;
-//    }
+GridWorldMap::GridWorldMap(double resolution, OccupancyGrid grid, DistanceField distances)
+        : m_Grid(std::move(grid)), m_Distances(std::move(distances)), m_Resolution(resolution) {
+    finishLoading();
+}
+
+void GridWorldMap::finishLoading() {
+    m_Extremes[0] = 0; m_Extremes[1] = m_Grid.cols() * m_Resolution;
+    m_Extremes[2] = 0; m_Extremes[3] = m_Grid.rows() * m_Resolution;
+    m_Pyramid = OccupancyPyramid(m_Grid);
+}
+
+double GridWorldMap::distanceToBlocked(double x, double y) const {
+    return m_Distances.distanceToBlocked(x / m_Resolution, y / m_Resolution) * m_Resolution;
+}
+
+bool GridWorldMap::clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const {
+    if (m_Distances.empty()) return false;
+    // (the gradient's the same in cells and metres)
+    distance = m_Distances.interpolate(x / m_Resolution, y / m_Resolution, gradientX, gradientY) * m_Resolution;
+    return true;
+}
+
+bool GridWorldMap::possiblyBlocked(double minX, double minY, double maxX, double maxY) const {
+    auto minCol = minX / m_Resolution, maxCol = maxX / m_Resolution;
+    auto minRow = minY / m_Resolution, maxRow = maxY / m_Resolution;
+    // off the map is blocked (and this catches NaN too)
+    if (!(minCol >= 0 && maxCol < m_Grid.cols() && minRow >= 0 && maxRow < m_Grid.rows())) return true;
+    return m_Pyramid.anyBlocked((size_t)minCol, (size_t)minRow, (size_t)maxCol, (size_t)maxRow);
+}
+
+void GridWorldMap::checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+    // same as isBlocked, without going through the virtual call
+    for (size_t i = 0; i < n; i++) blocked[i] = m_Grid.blockedAt(x[i] / m_Resolution, y[i] / m_Resolution);
 }
 
 const double* GridWorldMap::extremes() const {
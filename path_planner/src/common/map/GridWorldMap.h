@@ -3,6 +3,9 @@
 
 #include <vector>
 #include "Map.h"
+#include "OccupancyGrid.h"
+#include "DistanceField.h"
+#include "OccupancyPyramid.h"
 
 /**
  * Represent a map loaded from a grid-world text file.
@@ -15,18 +18,58 @@ public:
      */
     GridWorldMap(const std::string& path);
 
+    /**
+     * Put a map back together from what grid(), distances() and resolution() gave (out of a MapCache, say).
+     * @param resolution
+     * @param grid
+     * @param distances
+     */
+    GridWorldMap(double resolution, OccupancyGrid grid, DistanceField distances);
+
     ~GridWorldMap() override = default;
 
-    bool isBlocked(double x, double y) const override;
+    // in here so the planner's edge sweep (which calls it without going through the vtable) can inline it
+    bool isBlocked(double x, double y) const override {
+        return m_Grid.blockedAt(x / m_Resolution, y / m_Resolution);
+    }
+
+    void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const override;
+
+    /**
+     * Looked up in the distance field computed when the map loads.
+     * @param x
+     * @param y
+     * @return
+     */
+    double distanceToBlocked(double x, double y) const override;
+
+    bool clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const override;
+
+    bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const override;
 
     const double* extremes() const override;
 
     double resolution() const override;
 
+    size_t memoryUsage() const override {
+        return m_Grid.memoryUsage() + m_Distances.memoryUsage() + m_Pyramid.memoryUsage();
+    }
+
+    const OccupancyGrid& grid() const { return m_Grid; }
+
+    const DistanceField& distances() const { return m_Distances; }
+
 private:
-    std::vector<std::vector<bool>> m_Blocked;
+    OccupancyGrid m_Grid;
+    DistanceField m_Distances;
+    OccupancyPyramid m_Pyramid;
     double m_Resolution;
     double m_Extremes[4];
+
+    /**
+     * Work out the rest from the grid and distance field.
+     */
+    void finishLoading();
 };
 
 
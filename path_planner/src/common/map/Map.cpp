@@ -5,6 +5,24 @@ bool Map::isBlocked(double x, double y) const {
     return false;
 }
 
+void Map::checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+    for (size_t i = 0; i < n; i++) blocked[i] = isBlocked(x[i], y[i]);
+}
+
+double Map::distanceToBlocked(double x, double y) const {
+    return DBL_MAX;
+}
+
+bool Map::clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const {
+    distance = DBL_MAX;
+    gradientX = gradientY = 0;
+    return true;
+}
+
+bool Map::possiblyBlocked(double minX, double minY, double maxX, double maxY) const {
+    return true;
+}
+
 const double* Map::extremes() const {
     return m_Extremes;
 }
@@ -12,3 +30,11 @@ const double* Map::extremes() const {
 double Map::resolution() const {
     return 0;
 }
+
+void Map::focus(double x, double y, double yaw) {}
+
+void Map::focusAlong(double x1, double y1, double x2, double y2) {}
+
+size_t Map::memoryUsage() const {
+    return 0;
+}
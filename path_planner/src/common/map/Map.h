@@ -4,6 +4,8 @@
 
 #include <memory>
 #include <cfloat>
+#include <cstddef>
+#include <stdexcept>
 
 /**
  * Base class to represent a map. This class has only the default implementation (nowhere is blocked).
@@ -22,6 +24,51 @@ public:
      */
     virtual bool isBlocked(double x, double y) const;
 
+    /**
+     * Check a batch of points at once. One virtual call for the lot, so subclasses can loop over their grid directly.
+     * @param x
+     * @param y
+     * @param n number of points
+     * @param blocked output array of length n, set to 1 where blocked and 0 elsewhere
+     */
+    virtual void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const;
+
+    /**
+     * Lower bound on the distance from the given point to the nearest blocked point, for skipping ahead during
+     * collision checking. It's fine for this to underestimate (zero is always safe), just never overestimate.
+     * Nowhere is blocked by default so this is infinite.
+     * @param x
+     * @param y
+     * @return distance (m)
+     */
+    virtual double distanceToBlocked(double x, double y) const;
+
+    /**
+     * Smooth distance to the nearest blocked point and its gradient (which points away from it), for pushing things
+     * away from obstacles like the potential fields planner does. Unlike distanceToBlocked this can overestimate a
+     * little. Maps with a distance field interpolate it; maps without one return false and callers have to look at the
+     * cells themselves. Nowhere is blocked by default so this is infinite.
+     * @param x
+     * @param y
+     * @param distance output (m)
+     * @param gradientX output
+     * @param gradientY
+     * @return whether the map could say
+     */
+    virtual bool clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const;
+
+    /**
+     * Broad phase for static obstacles: might anything in the rectangle be blocked? Saying yes when it isn't just
+     * costs the per-point checks, but saying no when it is would miss collisions. Yes by default, so maps that don't
+     * know any better get checked point by point.
+     * @param minX
+     * @param minY
+     * @param maxX
+     * @param maxY
+     * @return false only if nothing in the rectangle is blocked
+     */
+    virtual bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const;
+
     /**
      * Get the bounding rectangle of the map (minX, maxX, minY, maxY). These are +/- double max by default.
      * @return array of length 4 containing extremes of the map
@@ -30,9 +77,42 @@ public:
 
     virtual double resolution() const;
 
+    /**
+     * Hint about where lookups are about to happen, for maps that only keep part of themselves in memory. They should
+     * get the area around the vessel (and ahead of it) ready. Does nothing by default.
+     * @param x vessel position
+     * @param y
+     * @param yaw vessel yaw (radians)
+     */
+    virtual void focus(double x, double y, double yaw);
+
+    /**
+     * Like focus, but for the area along a segment (a survey line, say). Does nothing by default.
+     * @param x1
+     * @param y1
+     * @param x2
+     * @param y2
+     */
+    virtual void focusAlong(double x1, double y1, double x2, double y2);
+
+    /**
+     * Roughly how much memory the map's holding on to, for reporting. Nothing by default.
+     * @return bytes
+     */
+    virtual size_t memoryUsage() const;
+
 private:
     double m_Extremes[4] = {-DBL_MAX, DBL_MAX, -DBL_MAX, DBL_MAX};
 };
 
 
+/**
+ * Thrown by map constructors that were asked to stop loading part way through.
+ */
+class MapLoadCancelled : public std::runtime_error {
+public:
+    MapLoadCancelled() : std::runtime_error("Map loading cancelled") {}
+};
+
+
 #endif //SRC_MAP_H
@@ -0,0 +1,154 @@
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MapCache.h"
+#include "GridWorldMap.h"
+#include "GeoTiffMap.h"
+
+namespace {
+const char c_Magic[8] = {'P', 'P', 'M', 'A', 'P', 'C', 'A', 'C'};
+
+std::string absolutePath(const std::string& path) {
+    char* resolved = realpath(path.c_str(), nullptr);
+    std::string absolute = resolved ? resolved : path;
+    free(resolved);
+    return absolute;
+}
+}
+
+MapCache::MapCache(std::string directory) : m_Directory(std::move(directory)) {
+    // make each level of the path in turn; ones that are already there fail harmlessly
+    for (size_t i = 1; i <= m_Directory.size(); i++) {
+        if (i == m_Directory.size() || m_Directory[i] == '/') mkdir(m_Directory.substr(0, i).c_str(), 0755);
+    }
+}
+
+std::string MapCache::defaultDirectory() {
+    if (auto cache = getenv("XDG_CACHE_HOME")) if (cache[0]) return std::string(cache) + "/path_planner";
+    if (auto home = getenv("HOME")) if (home[0]) return std::string(home) + "/.cache/path_planner";
+    return "/tmp/path_planner";
+}
+
+std::string MapCache::cachePath(const std::string& source) const {
+    // the full path is in the file too so a hash collision just looks like a miss
+    auto absolute = absolutePath(source);
+    std::ostringstream stream;
+    stream << m_Directory << "/" << std::hex << std::hash<std::string>()(absolute) << ".mapcache";
+    return stream.str();
+}
+
+bool MapCache::describeSource(const std::string& source, Header& header) {
+    struct stat s{};
+    if (stat(source.c_str(), &s) != 0) return false;
+    memcpy(header.Magic, c_Magic, sizeof(c_Magic));
+    header.Version = c_Version;
+    header.SourceModifiedSeconds = s.st_mtim.tv_sec;
+    header.SourceModifiedNanoseconds = s.st_mtim.tv_nsec;
+    header.SourceSize = s.st_size;
+    return true;
+}
+
+Map::SharedPtr MapCache::load(const std::string& source) const {
+    Header expected{};
+    if (!describeSource(source, expected)) return nullptr;
+    auto fd = open(cachePath(source).c_str(), O_RDONLY);
+    if (fd == -1) return nullptr;
+    struct stat s{};
+    if (fstat(fd, &s) != 0 || (size_t)s.st_size < sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+    auto size = (size_t)s.st_size;
+    auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    // the mapping goes away however we leave
+    std::unique_ptr<void, std::function<void(void*)>> mapping(data, [size](void* p) { munmap(p, size); });
+    const auto* bytes = static_cast<const char*>(data);
+    Header header;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.Magic, c_Magic, sizeof(c_Magic)) != 0 || header.Version != c_Version ||
+        header.SourceModifiedSeconds != expected.SourceModifiedSeconds ||
+        header.SourceModifiedNanoseconds != expected.SourceModifiedNanoseconds ||
+        header.SourceSize != expected.SourceSize) {
+        return nullptr;
+    }
+    if (header.Type == Kind::GeoTiff && header.MinimumDepth != GeoTiffMap::c_MinimumDepth) return nullptr;
+    // sizes have to add up exactly (checking each bit first so nothing overflows on a corrupt file)
+    if (header.PathLength > size || (header.Cols != 0 && header.Rows > size / header.Cols)) return nullptr;
+    auto cells = header.Cols * header.Rows;
+    auto words = (cells + 63) / 64;
+    auto pathOffset = padded(sizeof(Header)), bitsOffset = pathOffset + padded(header.PathLength);
+    auto distancesOffset = bitsOffset + words * sizeof(uint64_t);
+    if (distancesOffset + padded(cells * sizeof(float)) != size) return nullptr;
+    auto absolute = absolutePath(source);
+    if (std::string(bytes + pathOffset, header.PathLength) != absolute) return nullptr;
+
+    std::vector<uint64_t> bits(words);
+    memcpy(bits.data(), bytes + bitsOffset, words * sizeof(uint64_t));
+    std::vector<float> squaredDistances(cells);
+    memcpy(squaredDistances.data(), bytes + distancesOffset, cells * sizeof(float));
+    OccupancyGrid grid(header.Cols, header.Rows, std::move(bits));
+    DistanceField distances(header.Cols, header.Rows, std::move(squaredDistances));
+    switch (header.Type) {
+        case Kind::GridWorld:
+            return std::make_shared<GridWorldMap>(header.Georeferencing[0], std::move(grid), std::move(distances));
+        case Kind::GeoTiff:
+            return std::make_shared<GeoTiffMap>(std::vector<double>(header.Georeferencing, header.Georeferencing + 6),
+                                                std::move(grid), std::move(distances));
+        default:
+            return nullptr;
+    }
+}
+
+void MapCache::store(const std::string& source, const GridWorldMap& map) const {
+    Header header{};
+    header.Type = Kind::GridWorld;
+    header.Georeferencing[0] = map.resolution();
+    header.Cols = map.grid().cols(); header.Rows = map.grid().rows();
+    write(source, header, map.grid().blockedBits(), map.distances().squaredDistances());
+}
+
+void MapCache::store(const std::string& source, const GeoTiffMap& map) const {
+    Header header{};
+    header.Type = Kind::GeoTiff;
+    header.MinimumDepth = GeoTiffMap::c_MinimumDepth;
+    header.Cols = map.grid().cols(); header.Rows = map.grid().rows();
+    std::copy(map.inverseGeoTransform().begin(), map.inverseGeoTransform().end(), header.Georeferencing);
+    write(source, header, map.grid().blockedBits(), map.distances().squaredDistances());
+}
+
+void MapCache::write(const std::string& source, Header header, const std::vector<uint64_t>& bits,
+                     const std::vector<float>& squaredDistances) const {
+    if (!describeSource(source, header)) throw std::runtime_error("Cannot cache map with missing source " + source);
+    auto absolute = absolutePath(source);
+    header.PathLength = absolute.size();
+    auto path = cachePath(source);
+    // write beside it and rename over it so nobody ever maps a half written file
+    auto temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) throw std::runtime_error("Cannot write map cache file " + temporary);
+        const char zeros[8] = {};
+        auto pad = [&](uint64_t written) { file.write(zeros, padded(written) - written); };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(sizeof(header));
+        file.write(absolute.data(), absolute.size());
+        pad(absolute.size());
+        file.write(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(squaredDistances.data()), squaredDistances.size() * sizeof(float));
+        pad(squaredDistances.size() * sizeof(float));
+        if (!file) throw std::runtime_error("Failed writing map cache file " + temporary);
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        throw std::runtime_error("Cannot move map cache file into place at " + path);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef SRC_MAPCACHE_H
+#define SRC_MAPCACHE_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+class GridWorldMap;
+class GeoTiffMap;
+
+/**
+ * On-disk cache of maps after all the work of loading them is done: the blocked bitset, the distance field and the
+ * georeferencing, in one flat file per source map. Loading one is a memory map and a couple of bulk copies instead
+ * of parsing the source and redoing the distance transform, so reloading a big chart takes milliseconds.
+ *
+ * Entries are keyed by the source's path, modification time and size (and c_MinimumDepth for GeoTIFFs), so they go
+ * stale on their own when the source changes. Depths aren't kept, so GeoTIFFs from the cache can't say how deep
+ * anything is, only whether it's blocked.
+ */
+class MapCache {
+public:
+    /**
+     * @param directory where cache files go (made if it isn't there)
+     */
+    explicit MapCache(std::string directory);
+
+    /**
+     * @return $XDG_CACHE_HOME/path_planner, or ~/.cache/path_planner, or /tmp/path_planner if there's no home
+     */
+    static std::string defaultDirectory();
+
+    /**
+     * @param source path of the source map
+     * @return the cached map, or null if there isn't an up to date one
+     */
+    Map::SharedPtr load(const std::string& source) const;
+
+    /**
+     * Write a cache entry for a map loaded from source. Throws if it can't.
+     * @param source
+     * @param map
+     */
+    void store(const std::string& source, const GridWorldMap& map) const;
+
+    void store(const std::string& source, const GeoTiffMap& map) const;
+
+    /**
+     * @param source
+     * @return the cache file for a source map
+     */
+    std::string cachePath(const std::string& source) const;
+
+    static constexpr uint32_t c_Version = 1;
+
+private:
+    std::string m_Directory;
+
+    enum class Kind : uint32_t { GridWorld = 1, GeoTiff = 2 };
+
+    // fixed size start of every file; the path, bitset and distance field follow, each padded to 8 bytes
+    struct Header {
+        char Magic[8];
+        uint32_t Version;
+        Kind Type;
+        int64_t SourceModifiedSeconds, SourceModifiedNanoseconds, SourceSize;
+        double MinimumDepth;
+        uint64_t Cols, Rows;
+        // resolution in the first for grid worlds, the inverse geo transform for GeoTIFFs
+        double Georeferencing[6];
+        uint64_t PathLength;
+    };
+
+    /**
+     * Fill in the parts of the header that come from the source file.
+     * @param source
+     * @param header
+     * @return false if the source can't be found
+     */
+    static bool describeSource(const std::string& source, Header& header);
+
+    void write(const std::string& source, Header header, const std::vector<uint64_t>& bits,
+               const std::vector<float>& squaredDistances) const;
+
+    static uint64_t padded(uint64_t bytes) { return (bytes + 7) / 8 * 8; }
+};
+
+
+#endif //SRC_MAPCACHE_H
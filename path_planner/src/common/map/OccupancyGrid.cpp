@@ -0,0 +1,59 @@
+#include <stdexcept>
+#include <map>
+#include "OccupancyGrid.h"
+
+OccupancyGrid::OccupancyGrid(size_t cols, size_t rows)
+    : m_Cols(cols), m_Rows(rows), m_Blocked((cols * rows + 63) / 64, 0) {}
+
+OccupancyGrid::OccupancyGrid(std::vector<float> values, size_t cols, size_t rows, float blockedAtOrBelow)
+    : OccupancyGrid(cols, rows) {
+    if (values.size() != cols * rows) throw std::invalid_argument("Occupancy grid values don't match its size");
+    m_Values = std::move(values);
+    for (size_t row = 0; row < m_Rows; row++) {
+        for (size_t col = 0; col < m_Cols; col++) {
+            if (m_Values[row * m_Cols + col] <= blockedAtOrBelow) setBlocked(col, row, true);
+        }
+    }
+}
+
+OccupancyGrid::OccupancyGrid(size_t cols, size_t rows, std::vector<uint64_t> blockedBits)
+    : m_Cols(cols), m_Rows(rows), m_Blocked(std::move(blockedBits)) {
+    if (m_Blocked.size() != (cols * rows + 63) / 64) throw std::invalid_argument("Occupancy grid bits don't match its size");
+}
+
+size_t OccupancyGrid::blockedCount() const {
+    size_t count = 0;
+    for (auto word : m_Blocked) count += __builtin_popcountll(word);
+    return count;
+}
+
+std::vector<OccupancyGrid::Rectangle> OccupancyGrid::blockedRectangles() const {
+    std::vector<Rectangle> rectangles;
+    // rectangles still growing, by the (start column, width) of the run they came from
+    std::map<std::pair<size_t, size_t>, Rectangle> open, next;
+    for (size_t row = 0; row < m_Rows; row++) {
+        for (size_t col = 0; col < m_Cols;) {
+            if (!cellBlocked(col, row)) {
+                col++;
+                continue;
+            }
+            auto start = col;
+            while (col < m_Cols && cellBlocked(col, row)) col++;
+            auto run = std::make_pair(start, col - start);
+            auto it = open.find(run);
+            if (it != open.end()) {
+                it->second.Rows++;
+                next.insert(*it);
+                open.erase(it);
+            } else {
+                next.insert({run, Rectangle{start, row, col - start, 1}});
+            }
+        }
+        // whatever didn't carry on into this row is finished
+        for (const auto& r : open) rectangles.push_back(r.second);
+        open.swap(next);
+        next.clear();
+    }
+    for (const auto& r : open) rectangles.push_back(r.second);
+    return rectangles;
+}
@@ -0,0 +1,125 @@
+#ifndef SRC_OCCUPANCYGRID_H
+#define SRC_OCCUPANCYGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Grid storage shared by the raster maps: one contiguous row-major buffer of values (optional, for maps that have
+ * something like depths) and a bitset of which cells are blocked, worked out once up front so collision checks don't
+ * compare anything. Lookups outside the grid count as blocked. Row 0 is whatever the map says it is.
+ */
+class OccupancyGrid {
+public:
+    OccupancyGrid() = default;
+
+    /**
+     * Grid with nothing blocked and no values.
+     * @param cols
+     * @param rows
+     */
+    OccupancyGrid(size_t cols, size_t rows);
+
+    /**
+     * Grid of values, with cells at or below the threshold blocked.
+     * @param values row-major, cols * rows of them
+     * @param cols
+     * @param rows
+     * @param blockedAtOrBelow
+     */
+    OccupancyGrid(std::vector<float> values, size_t cols, size_t rows, float blockedAtOrBelow);
+
+    /**
+     * Grid straight from a blocked bitset (from blockedBits(), say), with no values.
+     * @param cols
+     * @param rows
+     * @param blockedBits
+     */
+    OccupancyGrid(size_t cols, size_t rows, std::vector<uint64_t> blockedBits);
+
+    size_t cols() const { return m_Cols; }
+    size_t rows() const { return m_Rows; }
+
+    void setBlocked(size_t col, size_t row, bool blocked) {
+        auto i = row * m_Cols + col;
+        if (blocked) m_Blocked[i >> 6] |= uint64_t(1) << (i & 63);
+        else m_Blocked[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+
+    /**
+     * Unchecked, so only for cells known to be on the grid.
+     * @param col
+     * @param row
+     * @return
+     */
+    bool cellBlocked(size_t col, size_t row) const {
+        auto i = row * m_Cols + col;
+        return (m_Blocked[i >> 6] >> (i & 63)) & 1;
+    }
+
+    /**
+     * @param col fractional grid coordinates; the cell is the one they floor to
+     * @param row
+     * @return whether the cell is blocked, or true if it's off the grid
+     */
+    bool blockedAt(double col, double row) const {
+        // & rather than && so it's one test, and written so NaN is off the grid
+        if (!((col >= 0) & (col < m_Cols) & (row >= 0) & (row < m_Rows))) return true;
+        return cellBlocked((size_t)col, (size_t)row);
+    }
+
+    /**
+     * @param col fractional grid coordinates, like blockedAt
+     * @param row
+     * @param outside what to return for points off the grid
+     * @return the value at the cell (which only makes sense if the grid has values)
+     */
+    float valueAt(double col, double row, float outside) const {
+        if (!((col >= 0) & (col < m_Cols) & (row >= 0) & (row < m_Rows))) return outside;
+        return m_Values[(size_t)row * m_Cols + (size_t)col];
+    }
+
+    /**
+     * @return number of blocked cells
+     */
+    size_t blockedCount() const;
+
+    /**
+     * @return the blocked bitset, cell i (row-major) at bit i % 64 of word i / 64
+     */
+    const std::vector<uint64_t>& blockedBits() const { return m_Blocked; }
+
+    bool hasValues() const { return !m_Values.empty(); }
+
+    /**
+     * @return bytes held for the values and the bitset
+     */
+    size_t memoryUsage() const {
+        return m_Values.capacity() * sizeof(float) + m_Blocked.capacity() * sizeof(uint64_t);
+    }
+
+    /**
+     * Block of cells, Cols wide and Rows high starting at (Col, Row).
+     */
+    struct Rectangle {
+        size_t Col, Row, Cols, Rows;
+    };
+
+    /**
+     * Cover the blocked cells with rectangles that don't overlap, by merging each row's runs of blocked cells with
+     * identical runs in the rows above. It's not the fewest possible rectangles, but it's linear in the size of the
+     * grid and it gets the usual blobs of land down to a tiny fraction of the cell count, which is what matters for
+     * drawing the map.
+     * @return the rectangles, in order of where they end
+     */
+    std::vector<Rectangle> blockedRectangles() const;
+
+private:
+    size_t m_Cols = 0, m_Rows = 0;
+    std::vector<float> m_Values;
+    std::vector<uint64_t> m_Blocked;
+};
+
+
+#endif //SRC_OCCUPANCYGRID_H
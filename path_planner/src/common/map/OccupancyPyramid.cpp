@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "OccupancyPyramid.h"
+
+OccupancyPyramid::OccupancyPyramid(const OccupancyGrid& grid) {
+    OccupancyGrid bits(grid.cols(), grid.rows());
+    for (size_t row = 0; row < grid.rows(); row++) {
+        for (size_t col = 0; col < grid.cols(); col++) {
+            if (grid.cellBlocked(col, row)) bits.setBlocked(col, row, true);
+        }
+    }
+    m_Levels.push_back(std::move(bits));
+    // halve until one cell covers everything
+    while (m_Levels.back().cols() > 1 || m_Levels.back().rows() > 1) {
+        const auto& below = m_Levels.back();
+        OccupancyGrid above((below.cols() + 1) / 2, (below.rows() + 1) / 2);
+        for (size_t row = 0; row < below.rows(); row++) {
+            for (size_t col = 0; col < below.cols(); col++) {
+                if (below.cellBlocked(col, row)) above.setBlocked(col / 2, row / 2, true);
+            }
+        }
+        m_Levels.push_back(std::move(above));
+    }
+}
+
+bool OccupancyPyramid::anyBlocked(size_t minCol, size_t minRow, size_t maxCol, size_t maxRow) const {
+    if (m_Levels.empty() || minCol > maxCol || minRow > maxRow) return false;
+    // start where the rectangle is at most two cells across each way, so it's no more than four lookups
+    size_t k = 0;
+    while (k + 1 < levels() && ((maxCol >> k) - (minCol >> k) > 1 || (maxRow >> k) - (minRow >> k) > 1)) k++;
+    for (auto row = minRow >> k; row <= maxRow >> k; row++) {
+        for (auto col = minCol >> k; col <= maxCol >> k; col++) {
+            if (anyBlocked(k, col, row, minCol, minRow, maxCol, maxRow)) return true;
+        }
+    }
+    return false;
+}
+
+bool OccupancyPyramid::anyBlocked(size_t k, size_t col, size_t row, size_t minCol, size_t minRow, size_t maxCol,
+                                  size_t maxRow) const {
+    if (!m_Levels[k].cellBlocked(col, row)) return false;
+    if (k == 0) return true;
+    // something's blocked in the block, so look at the quarters of it that overlap the rectangle
+    const auto& below = m_Levels[k - 1];
+    auto firstCol = std::max(col * 2, minCol >> (k - 1)), lastCol = std::min(col * 2 + 1, maxCol >> (k - 1));
+    auto firstRow = std::max(row * 2, minRow >> (k - 1)), lastRow = std::min(row * 2 + 1, maxRow >> (k - 1));
+    lastCol = std::min(lastCol, below.cols() - 1);
+    lastRow = std::min(lastRow, below.rows() - 1);
+    for (auto r = firstRow; r <= lastRow; r++) {
+        for (auto c = firstCol; c <= lastCol; c++) {
+            if (anyBlocked(k - 1, c, r, minCol, minRow, maxCol, maxRow)) return true;
+        }
+    }
+    return false;
+}
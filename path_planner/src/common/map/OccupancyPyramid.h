@@ -0,0 +1,55 @@
+#ifndef SRC_OCCUPANCYPYRAMID_H
+#define SRC_OCCUPANCYPYRAMID_H
+
+#include <vector>
+#include "OccupancyGrid.h"
+
+/**
+ * Max-pyramid over an occupancy grid's blocked cells: level k has a cell for every 2^k by 2^k block of the grid, which
+ * is blocked if anything in the block is. Asking whether anything in a rectangle is blocked starts at a level where
+ * the rectangle is only a couple of cells across and only goes down into the blocks that have something in them,
+ * so rectangles over open water take a handful of lookups however big they are.
+ */
+class OccupancyPyramid {
+public:
+    OccupancyPyramid() = default;
+
+    /**
+     * Build the pyramid for a grid. Level 0 is a copy of just its blocked bits, so the grid can go away.
+     * @param grid
+     */
+    explicit OccupancyPyramid(const OccupancyGrid& grid);
+
+    /**
+     * @param minCol cells of the rectangle (inclusive, and on the grid)
+     * @param minRow
+     * @param maxCol
+     * @param maxRow
+     * @return whether any cell in the rectangle is blocked
+     */
+    bool anyBlocked(size_t minCol, size_t minRow, size_t maxCol, size_t maxRow) const;
+
+    /**
+     * @return number of levels, including the grid
+     */
+    size_t levels() const { return m_Levels.size(); }
+
+    /**
+     * @return bytes held for the levels
+     */
+    size_t memoryUsage() const {
+        size_t bytes = 0;
+        for (const auto& level : m_Levels) bytes += level.memoryUsage();
+        return bytes;
+    }
+
+private:
+    // finest first
+    std::vector<OccupancyGrid> m_Levels;
+
+    bool anyBlocked(size_t k, size_t col, size_t row, size_t minCol, size_t minRow, size_t maxCol,
+                    size_t maxRow) const;
+};
+
+
+#endif //SRC_OCCUPANCYPYRAMID_H
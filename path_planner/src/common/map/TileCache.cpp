@@ -0,0 +1,92 @@
+#include <stdexcept>
+#include <atomic>
+#include "TileCache.h"
+
+namespace {
+std::atomic<uint64_t> g_NextCacheId{1};
+
+// the last tile each thread got, and which cache it came from
+struct LastTile {
+    uint64_t Cache = 0;
+    uint64_t Key = 0;
+    TileCache::Tile Tile;
+};
+thread_local LastTile t_LastTile;
+}
+
+TileCache::TileCache(size_t capacity, Loader loader)
+        : m_Id(g_NextCacheId++), m_Capacity(capacity), m_Loader(std::move(loader)) {
+    if (m_Capacity == 0) throw std::invalid_argument("Tile cache needs room for at least one tile");
+}
+
+TileCache::Tile TileCache::get(size_t tileCol, size_t tileRow) {
+    auto k = key(tileCol, tileRow);
+    auto& last = t_LastTile;
+    if (last.Cache == m_Id && last.Key == k) return last.Tile;
+    Tile tile;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        tile = find(k);
+    }
+    if (!tile) {
+        std::lock_guard<std::mutex> loadLock(m_LoadMutex);
+        // someone else might have loaded it while we were waiting
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            tile = find(k);
+        }
+        if (!tile) {
+            tile = std::make_shared<const OccupancyGrid>(m_Loader(tileCol, tileRow));
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Loads++;
+            m_Order.push_front(k);
+            m_Tiles.emplace(k, std::make_pair(tile, m_Order.begin()));
+            evict();
+        }
+    }
+    last.Cache = m_Id;
+    last.Key = k;
+    last.Tile = tile;
+    return tile;
+}
+
+bool TileCache::resident(size_t tileCol, size_t tileRow) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Tiles.find(key(tileCol, tileRow)) != m_Tiles.end();
+}
+
+size_t TileCache::residentCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Tiles.size();
+}
+
+size_t TileCache::loads() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Loads;
+}
+
+size_t TileCache::capacity() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Capacity;
+}
+
+void TileCache::setCapacity(size_t capacity) {
+    if (capacity == 0) throw std::invalid_argument("Tile cache needs room for at least one tile");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Capacity = capacity;
+    evict();
+}
+
+TileCache::Tile TileCache::find(uint64_t k) {
+    auto it = m_Tiles.find(k);
+    if (it == m_Tiles.end()) return nullptr;
+    m_Order.splice(m_Order.begin(), m_Order, it->second.second);
+    return it->second.first;
+}
+
+void TileCache::evict() {
+    while (m_Tiles.size() > m_Capacity) {
+        m_Tiles.erase(m_Order.back());
+        m_Order.pop_back();
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef SRC_TILECACHE_H
+#define SRC_TILECACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include "OccupancyGrid.h"
+
+/**
+ * LRU cache of map tiles for maps too big to keep in memory all at once. Tiles are loaded on demand by a function
+ * the map supplies, and once there are more than the capacity the least recently used one gets dropped. Tiles are
+ * handed out as shared pointers, so one that's evicted while somebody is still looking at it stays valid for them.
+ *
+ * It's thread-safe. Loads happen one at a time, since the loaders (GDAL, for one) usually aren't, but outside the lock
+ * on the tiles, so threads looking up tiles that are already loaded don't wait for them. Each thread also remembers
+ * the last tile it got, since lookups mostly land in the same tile as the one before, and those don't lock at all
+ * (or count as a use).
+ */
+class TileCache {
+public:
+    typedef std::function<OccupancyGrid(size_t tileCol, size_t tileRow)> Loader;
+    typedef std::shared_ptr<const OccupancyGrid> Tile;
+
+    /**
+     * @param capacity most tiles to keep loaded at once (at least one)
+     * @param loader makes the tile at the given tile coordinates
+     */
+    TileCache(size_t capacity, Loader loader);
+
+    /**
+     * Get a tile, loading it if it isn't already, and mark it as just used.
+     * @param tileCol
+     * @param tileRow
+     * @return
+     */
+    Tile get(size_t tileCol, size_t tileRow);
+
+    /**
+     * @param tileCol
+     * @param tileRow
+     * @return whether the tile is loaded right now (without marking it used)
+     */
+    bool resident(size_t tileCol, size_t tileRow) const;
+
+    /**
+     * @return number of tiles loaded right now
+     */
+    size_t residentCount() const;
+
+    /**
+     * @return number of times the loader has been called
+     */
+    size_t loads() const;
+
+    size_t capacity() const;
+
+    /**
+     * Change how many tiles to keep, dropping the least recently used ones if there are too many now.
+     * @param capacity at least one
+     */
+    void setCapacity(size_t capacity);
+
+private:
+    typedef std::list<uint64_t> Order;
+
+    // so threads' last tiles can't be mistaken for another cache's
+    const uint64_t m_Id;
+    size_t m_Capacity;
+    Loader m_Loader;
+    mutable std::mutex m_Mutex;
+    // held while loading, so loads don't overlap
+    std::mutex m_LoadMutex;
+    // most recently used at the front
+    Order m_Order;
+    std::unordered_map<uint64_t, std::pair<Tile, Order::iterator>> m_Tiles;
+    size_t m_Loads = 0;
+
+    static uint64_t key(size_t tileCol, size_t tileRow) { return ((uint64_t)tileRow << 32) | (uint32_t)tileCol; }
+
+    /**
+     * Look a tile up and mark it used; needs the lock.
+     */
+    Tile find(uint64_t k);
+
+    void evict();
+};
+
+
+#endif //SRC_TILECACHE_H
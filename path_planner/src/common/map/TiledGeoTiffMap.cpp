@@ -0,0 +1,145 @@
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include "TiledGeoTiffMap.h"
+
+TiledGeoTiffMap::TiledGeoTiffMap(const std::string& path, double residentRadius, size_t capacity)
+        : m_ResidentRadius(residentRadius),
+          m_Tiles(1, [this](size_t tileCol, size_t tileRow) { return loadTile(tileCol, tileRow); }) {
+    GDALAllRegister();
+    m_Dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GDALAccess::GA_ReadOnly));
+    if (!m_Dataset) throw std::runtime_error("TiledGeoTiffMap failed to load map file");
+    m_Band = m_Dataset->GetRasterBand(1);
+    double geoTransform[6];
+    std::vector<double> inverse(6);
+    if (!m_Band || m_Dataset->GetGeoTransform(geoTransform) == CPLErr::CE_Failure ||
+        !GDALInvGeoTransform(geoTransform, inverse.data())) {
+        GDALClose(m_Dataset);
+        throw std::runtime_error("TiledGeoTiffMap failed to find or invert geo transform");
+    }
+    m_InverseGeoTransform = inverse;
+    m_Cols = m_Band->GetXSize(); m_Rows = m_Band->GetYSize();
+    int blockCols, blockRows;
+    m_Band->GetBlockSize(&blockCols, &blockRows);
+    // reading a window of whole blocks is as cheap as it gets, but scanline (or tiny) blocks make skinny tiles
+    if (blockCols >= 64 && blockRows >= 64) {
+        m_TileCols = blockCols; m_TileRows = blockRows;
+    } else {
+        m_TileCols = m_TileRows = c_TileSize;
+    }
+    // what focus() loads, with room for as much again so moving along doesn't throw out what's still around
+    if (capacity == 0) capacity = 2 * (tilesAround(m_ResidentRadius) + tilesAround(m_ResidentRadius / 2));
+    m_Tiles.setCapacity(capacity);
+    std::cerr << "Opened tiled GEOTiff map " << path << " (" << m_Cols << "x" << m_Rows << ", tiles " << m_TileCols
+              << "x" << m_TileRows << ", keeping up to " << capacity << ")" << std::endl;
+}
+
+TiledGeoTiffMap::~TiledGeoTiffMap() {
+    GDALClose(m_Dataset);
+}
+
+float TiledGeoTiffMap::getDepth(double x, double y) const {
+    double col, row;
+    gridCoordinates(x, y, col, row);
+    if (!onRaster(col, row)) return 0;
+    auto c = (size_t)col, r = (size_t)row;
+    return m_Tiles.get(c / m_TileCols, r / m_TileRows)->valueAt(c % m_TileCols, r % m_TileRows, 0);
+}
+
+bool TiledGeoTiffMap::isBlocked(double x, double y) const {
+    double col, row;
+    gridCoordinates(x, y, col, row);
+    if (!onRaster(col, row)) return true;
+    auto c = (size_t)col, r = (size_t)row;
+    return m_Tiles.get(c / m_TileCols, r / m_TileRows)->cellBlocked(c % m_TileCols, r % m_TileRows);
+}
+
+void TiledGeoTiffMap::checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+    // batches are usually along an edge so they mostly stay in one tile; only go to the cache when they leave it
+    TileCache::Tile tile;
+    size_t tileCol = 0, tileRow = 0;
+    for (size_t i = 0; i < n; i++) {
+        double col, row;
+        gridCoordinates(x[i], y[i], col, row);
+        if (!onRaster(col, row)) {
+            blocked[i] = 1;
+            continue;
+        }
+        auto c = (size_t)col, r = (size_t)row;
+        if (!tile || c / m_TileCols != tileCol || r / m_TileRows != tileRow) {
+            tileCol = c / m_TileCols; tileRow = r / m_TileRows;
+            tile = m_Tiles.get(tileCol, tileRow);
+        }
+        blocked[i] = tile->cellBlocked(c % m_TileCols, r % m_TileRows);
+    }
+}
+
+void TiledGeoTiffMap::focus(double x, double y, double yaw) {
+    loadAround(x, y, m_ResidentRadius);
+    // and prefetch where we're headed
+    loadAround(x + m_ResidentRadius * cos(yaw), y + m_ResidentRadius * sin(yaw), m_ResidentRadius / 2);
+}
+
+void TiledGeoTiffMap::focusAlong(double x1, double y1, double x2, double y2) {
+    // step by half the smaller tile side (in metres) so no tile the segment crosses gets skipped over
+    auto step = 0.5 * fmin(m_TileCols / hypot(m_InverseGeoTransform[1], m_InverseGeoTransform[2]),
+                           m_TileRows / hypot(m_InverseGeoTransform[4], m_InverseGeoTransform[5]));
+    auto length = hypot(x2 - x1, y2 - y1);
+    auto steps = (size_t)ceil(length / step);
+    for (size_t i = 0; i <= steps; i++) {
+        auto s = steps == 0 ? 0 : (double)i / steps;
+        double col, row;
+        gridCoordinates(x1 + s * (x2 - x1), y1 + s * (y2 - y1), col, row);
+        if (onRaster(col, row)) m_Tiles.get((size_t)col / m_TileCols, (size_t)row / m_TileRows);
+    }
+}
+
+OccupancyGrid TiledGeoTiffMap::loadTile(size_t tileCol, size_t tileRow) {
+    // tiles on the right and bottom edges can be partial
+    auto col = tileCol * m_TileCols, row = tileRow * m_TileRows;
+    auto cols = std::min(m_TileCols, m_Cols - col), rows = std::min(m_TileRows, m_Rows - row);
+    std::vector<float> values(cols * rows);
+    auto err = m_Band->RasterIO(GF_Read, (int)col, (int)row, (int)cols, (int)rows, values.data(), (int)cols,
+                                (int)rows, GDT_Float32, 0, 0);
+    if (err != CE_None) {
+        std::ostringstream stringStream;
+        stringStream << "TiledGeoTiffMap failed to read tile (" << tileCol << ", " << tileRow << ") of band 1";
+        throw std::runtime_error(stringStream.str());
+    }
+    // pad partial tiles out to the full size (blocked) so lookups can use the same strides everywhere
+    if (cols == m_TileCols && rows == m_TileRows) return OccupancyGrid(std::move(values), cols, rows, c_MinimumDepth);
+    std::vector<float> padded(m_TileCols * m_TileRows, c_MinimumDepth);
+    for (size_t r = 0; r < rows; r++) {
+        std::copy(values.begin() + r * cols, values.begin() + (r + 1) * cols, padded.begin() + r * m_TileCols);
+    }
+    return OccupancyGrid(std::move(padded), m_TileCols, m_TileRows, c_MinimumDepth);
+}
+
+void TiledGeoTiffMap::gridCoordinates(double x, double y, double& col, double& row) const {
+    col = trunc(m_InverseGeoTransform[0] + x * m_InverseGeoTransform[1] + y * m_InverseGeoTransform[2]);
+    row = trunc(m_InverseGeoTransform[3] + x * m_InverseGeoTransform[4] + y * m_InverseGeoTransform[5]);
+}
+
+void TiledGeoTiffMap::loadAround(double x, double y, double radius) {
+    double col, row;
+    gridCoordinates(x, y, col, row);
+    auto colRadius = radius * hypot(m_InverseGeoTransform[1], m_InverseGeoTransform[2]);
+    auto rowRadius = radius * hypot(m_InverseGeoTransform[4], m_InverseGeoTransform[5]);
+    // clip to the raster; nothing to load if the square misses it entirely
+    auto minCol = fmax(col - colRadius, 0), maxCol = fmin(col + colRadius, m_Cols - 1.0);
+    auto minRow = fmax(row - rowRadius, 0), maxRow = fmin(row + rowRadius, m_Rows - 1.0);
+    if (!(minCol <= maxCol && minRow <= maxRow)) return;
+    for (auto tr = (size_t)minRow / m_TileRows; tr <= (size_t)maxRow / m_TileRows; tr++) {
+        for (auto tc = (size_t)minCol / m_TileCols; tc <= (size_t)maxCol / m_TileCols; tc++) {
+            m_Tiles.get(tc, tr);
+        }
+    }
+}
+
+size_t TiledGeoTiffMap::tilesAround(double radius) const {
+    // a square n tiles wide can straddle n + 1 of them
+    auto cols = ceil(2 * radius * hypot(m_InverseGeoTransform[1], m_InverseGeoTransform[2]) / m_TileCols) + 1;
+    auto rows = ceil(2 * radius * hypot(m_InverseGeoTransform[4], m_InverseGeoTransform[5]) / m_TileRows) + 1;
+    auto gridCols = ceil((double)m_Cols / m_TileCols), gridRows = ceil((double)m_Rows / m_TileRows);
+    return (size_t)(fmin(cols, gridCols) * fmin(rows, gridRows));
+}
@@ -0,0 +1,97 @@
+#ifndef SRC_TILEDGEOTIFFMAP_H
+#define SRC_TILEDGEOTIFFMAP_H
+
+#include <gdal_priv.h>
+#include <string>
+#include <vector>
+#include "Map.h"
+#include "TileCache.h"
+
+/**
+ * GeoTIFF map that doesn't read the whole raster up front. Opening it only reads the header, and tiles (the file's
+ * own blocks when they're a sensible shape, squares otherwise) get read the first time something looks at them and
+ * are kept in an LRU cache. focus() loads everything within the resident radius of the vessel plus the area ahead of
+ * it, and focusAlong() the tiles along the survey lines, so by the time the planner looks there it's all in memory.
+ *
+ * Lookups give the same answers as GeoTiffMap would for the same file.
+ */
+class TiledGeoTiffMap : public Map {
+public:
+    /**
+     * Open a map. Doesn't read any of the raster yet.
+     * @param path path to the map file
+     * @param residentRadius how far around the vessel to keep loaded (m)
+     * @param capacity most tiles to keep in memory, or 0 for enough to hold what focus() loads a couple of times over
+     */
+    TiledGeoTiffMap(const std::string& path, double residentRadius, size_t capacity = 0);
+
+    ~TiledGeoTiffMap() override;
+
+    float getDepth(double x, double y) const;
+
+    bool isBlocked(double x, double y) const override;
+
+    void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const override;
+
+    double distanceToBlocked(double x, double y) const override { return 0; }
+
+    bool clearance(double x, double y, double& distance, double& gradientX, double& gradientY) const override {
+        return false;
+    }
+
+    void focus(double x, double y, double yaw) override;
+
+    void focusAlong(double x1, double y1, double x2, double y2) override;
+
+    /**
+     * @return roughly what the resident tiles take up, counting them all as full size (and just their depths, since
+     * the bitsets are a 32nd of that)
+     */
+    size_t memoryUsage() const override {
+        return m_Tiles.residentCount() * m_TileCols * m_TileRows * sizeof(float);
+    }
+
+    /**
+     * @return the tile cache, for seeing how much is loaded
+     */
+    const TileCache& tiles() const { return m_Tiles; }
+
+    // tile side (pixels) for files without usable blocks, like ones stored a scanline at a time
+    static constexpr int c_TileSize = 256;
+
+private:
+    GDALDataset* m_Dataset;
+    GDALRasterBand* m_Band;
+    std::vector<double> m_InverseGeoTransform;
+    size_t m_Cols, m_Rows, m_TileCols, m_TileRows;
+    double m_ResidentRadius;
+    // mutable since lookups load tiles, but the cache does its own locking
+    mutable TileCache m_Tiles;
+
+    static constexpr double c_MinimumDepth = 0;
+
+    OccupancyGrid loadTile(size_t tileCol, size_t tileRow);
+
+    /**
+     * Same as GeoTiffMap's.
+     */
+    void gridCoordinates(double x, double y, double& col, double& row) const;
+
+    bool onRaster(double col, double row) const {
+        return (col >= 0) & (col < m_Cols) & (row >= 0) & (row < m_Rows);
+    }
+
+    /**
+     * Load every tile overlapping the square of the given radius around a point.
+     */
+    void loadAround(double x, double y, double radius);
+
+    /**
+     * @param radius
+     * @return most tiles a square of the given radius can overlap
+     */
+    size_t tilesAround(double radius) const;
+};
+
+
+#endif //SRC_TILEDGEOTIFFMAP_H
@@ -81,8 +81,9 @@ public:
 //            sleep(11); // sleep a little extra to make sure we've started the plan
             State sample;
             sample.time() = getTime();
-            while (plan.containsTime(sample.time())) {
-                plan.sample(sample);
+            DubinsPlan::Cursor cursor(plan);
+            while (cursor.containsTime(sample.time())) {
+                cursor.sample(sample);
                 displayPlannerStart(sample);
                 sleep(1);
                 sample.time() = getTime();
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "InputLog.h"
+#include "executive.h"
+
+constexpr char InputLog::c_Magic[8];
+
+std::vector<InputLog::Event> InputLog::read(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open input log " + path);
+    char magic[sizeof(c_Magic)];
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, c_Magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(path + " is not an input log");
+    }
+    std::vector<Event> events;
+    while (true) {
+        Event event;
+        uint8_t kind, count;
+        if (!file.read((char*)&kind, sizeof(kind)) || !file.read((char*)&event.Time, sizeof(event.Time)) ||
+            !file.read((char*)&count, sizeof(count))) break;
+        event.Kind = (Type)kind;
+        event.Values.resize(count);
+        if (!file.read((char*)event.Values.data(), count * sizeof(double))) break;
+        uint16_t length;
+        if (!file.read((char*)&length, sizeof(length))) break;
+        event.Text.resize(length);
+        if (!file.read(&event.Text[0], length)) break;
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+void InputLog::apply(const Event& event, Executive& executive) {
+    const auto& v = event.Values;
+    switch (event.Kind) {
+        case Position: executive.updateCovered(v.at(0), v.at(1), v.at(2), v.at(3), v.at(4)); break;
+        case AddRibbon: executive.addRibbon(v.at(0), v.at(1), v.at(2), v.at(3)); break;
+        case ClearRibbons: executive.clearRibbons(); break;
+        case Contact:
+            executive.updateDynamicObstacle((uint32_t)v.at(0), State(v.at(1), v.at(2), v.at(3), v.at(4), v.at(5)),
+                                            v.at(6), v.at(7));
+            break;
+        case Configuration:
+            executive.setConfiguration(v.at(0), v.at(1), v.at(2), v.at(3), v.at(4), (int)v.at(5), (int)v.at(6),
+                                       v.at(7), v.at(8), v.at(9), (int)v.at(10), v.at(11) != 0, v.at(12) != 0,
+                                       v.at(13) != 0, v.at(14) != 0);
+            break;
+        case Map: executive.refreshMap(event.Text, v.at(0), v.at(1)); break;
+        case MapTiling: executive.setMapTiling(v.at(0) != 0, v.at(1)); break;
+        case PipelinedPlanning: executive.setPipelinedPlanning(v.at(0) != 0); break;
+        case WarmStart: executive.setWarmStart(v.at(0) != 0); break;
+        case ControllerTimeout: executive.setControllerTimeout(v.at(0)); break;
+        case LocalRibbons: executive.setLocalRibbons((int)v.at(0)); break;
+        case PortfolioSize: executive.setPortfolioSize((int)v.at(0)); break;
+        case StartPlanner: executive.startPlanner(); break;
+        case CancelPlanner: executive.cancelPlanner(); break;
+        // not an input, and anything newer than this reader can't be either
+        default: break;
+    }
+}
+
+bool InputLog::isSetting(Type type) {
+    switch (type) {
+        case Configuration:
+        case Map:
+        case MapTiling:
+        case PipelinedPlanning:
+        case WarmStart:
+        case ControllerTimeout:
+        case LocalRibbons:
+        case PortfolioSize:
+            return true;
+        default:
+            return false;
+    }
+}
+
+InputRecorder::InputRecorder(const std::string& path) : m_File(path, std::ios::binary | std::ios::trunc) {
+    if (!m_File) throw std::runtime_error("Could not open " + path + " to record inputs");
+    m_File.write(InputLog::c_Magic, sizeof(InputLog::c_Magic));
+}
+
+void InputRecorder::write(const InputLog::Event& event) {
+    auto kind = (uint8_t)event.Kind;
+    auto count = (uint8_t)event.Values.size();
+    auto length = (uint16_t)std::min<size_t>(event.Text.size(), UINT16_MAX);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_File.write((const char*)&kind, sizeof(kind));
+    m_File.write((const char*)&event.Time, sizeof(event.Time));
+    m_File.write((const char*)&count, sizeof(count));
+    m_File.write((const char*)event.Values.data(), count * sizeof(double));
+    m_File.write((const char*)&length, sizeof(length));
+    m_File.write(event.Text.data(), length);
+}
+
+void InputRecorder::flush() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_File.flush();
+}
@@ -0,0 +1,102 @@
+#ifndef SRC_INPUTLOG_H
+#define SRC_INPUTLOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+
+class Executive;
+
+/**
+ * A log of everything the Executive gets told, so a mission can be planned again offline with the same inputs at the
+ * same times: ribbons, positions, contacts, configuration changes, starting and stopping, and the controller's
+ * replies to each plan.
+ *
+ * The file is a short header and then one record per event: the type (one byte), the time it came in (a double), how
+ * many numbers follow (one byte), the numbers (doubles), and a string for the types that need one (two byte length
+ * then the characters). Everything's in the recording machine's byte order. Integers like MMSIs and flags get stored
+ * as doubles, which hold them exactly, so every record reads the same way and readers can skip types they don't know.
+ */
+class InputLog {
+public:
+    enum Type : uint8_t {
+        Position, // x, y, speed, heading, t
+        AddRibbon, // x1, y1, x2, y2
+        ClearRibbons,
+        Contact, // mmsi, x, y, heading, speed, t, width, length
+        Configuration, // setConfiguration's arguments in order
+        Map, // latitude, longitude, and the path
+        MapTiling, // tiled, resident radius
+        PipelinedPlanning, // pipelined
+        WarmStart, // warm start
+        StartPlanner,
+        CancelPlanner,
+        ControllerReply, // x, y, heading, speed, time
+        ControllerTimeout, // timeout
+        LocalRibbons, // local ribbons
+        PortfolioSize, // portfolio size
+    };
+
+    struct Event {
+        Type Kind;
+        double Time;
+        std::vector<double> Values;
+        std::string Text;
+    };
+
+    /**
+     * Read a whole log. A record cut off at the end (like when the node got killed mid-write) is left out.
+     * @param path
+     * @return the events in the order they were recorded
+     */
+    static std::vector<Event> read(const std::string& path);
+
+    /**
+     * Tell an executive about an event the way it was told the first time. Controller replies aren't inputs to the
+     * executive (they're what publishPlan returns), so they're ignored here.
+     * @param event
+     * @param executive
+     */
+    static void apply(const Event& event, Executive& executive);
+
+    /**
+     * @param type
+     * @return whether only the latest event of this type matters, so a recording started part way through a mission
+     * needs to begin with it
+     */
+    static bool isSetting(Type type);
+
+    static constexpr char c_Magic[8] = {'P', 'P', 'I', 'N', 'P', 'U', 'T', '1'};
+};
+
+/**
+ * Writes events to a log as they happen. Safe to use from any number of threads.
+ */
+class InputRecorder {
+public:
+    typedef std::shared_ptr<InputRecorder> SharedPtr;
+
+    /**
+     * Start a new log, replacing whatever's at the path.
+     * @param path
+     * @throws std::runtime_error if the file can't be opened
+     */
+    explicit InputRecorder(const std::string& path);
+
+    void write(const InputLog::Event& event);
+
+    /**
+     * Push everything written so far out to the file.
+     */
+    void flush();
+
+private:
+    std::mutex m_Mutex;
+    std::ofstream m_File;
+};
+
+
+#endif //SRC_INPUTLOG_H
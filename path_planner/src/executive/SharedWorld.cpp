@@ -0,0 +1,85 @@
+#include "SharedWorld.h"
+
+bool SharedWorld::requestMap(const std::string& request) {
+    std::lock_guard<std::mutex> lock(m_MapMutex);
+    if (request == m_MapRequest) return false;
+    m_MapRequest = request;
+    m_DisplayedMap = nullptr;
+    return true;
+}
+
+bool SharedWorld::isCurrentRequest(const std::string& request) const {
+    std::lock_guard<std::mutex> lock(m_MapMutex);
+    return request == m_MapRequest;
+}
+
+void SharedWorld::forgetRequest(const std::string& request) {
+    std::lock_guard<std::mutex> lock(m_MapMutex);
+    if (m_MapRequest == request) m_MapRequest.clear();
+}
+
+void SharedWorld::setMap(Map::SharedPtr map) {
+    if (!map) return;
+    std::atomic_store(&m_Map, std::move(map));
+    m_MapVersion.fetch_add(1, std::memory_order_release);
+}
+
+Map::SharedPtr SharedWorld::map() const {
+    return std::atomic_load(&m_Map);
+}
+
+void SharedWorld::setDisplayedMap(const std::string& request, std::shared_ptr<const GridWorldMap> map) {
+    std::lock_guard<std::mutex> lock(m_MapMutex);
+    if (request == m_MapRequest) m_DisplayedMap = std::move(map);
+}
+
+std::shared_ptr<const GridWorldMap> SharedWorld::displayedMap() const {
+    std::lock_guard<std::mutex> lock(m_MapMutex);
+    return m_DisplayedMap;
+}
+
+void SharedWorld::queueDynamicObstacle(uint32_t mmsi, const State& obstacle, double width, double length) {
+    std::lock_guard<std::mutex> lock(m_QueuedContactsMutex);
+    auto pair = m_QueuedContacts.emplace(mmsi, QueuedContact{obstacle, width, length});
+    // reports can show up out of order, so the newest one wins rather than the last one
+    if (!pair.second && pair.first->second.Obstacle.time() <= obstacle.time()) {
+        pair.first->second = QueuedContact{obstacle, width, length};
+    }
+}
+
+size_t SharedWorld::ingestDynamicObstacles(
+        const std::function<std::vector<Distribution>(const State&)>& distributions) {
+    std::unordered_map<uint32_t, QueuedContact> contacts;
+    {
+        std::lock_guard<std::mutex> lock(m_QueuedContactsMutex);
+        contacts.swap(m_QueuedContacts);
+    }
+    if (contacts.empty()) return 0;
+    {
+        std::lock_guard<std::mutex> lock(m_DynamicObstaclesMutex);
+        for (const auto& c : contacts) m_DynamicObstaclesManager.update(c.first, distributions(c.second.Obstacle));
+    }
+    m_BinaryDynamicObstacles.modify([&](BinaryDynamicObstaclesManager& manager) {
+        for (const auto& c : contacts) {
+            const auto& obstacle = c.second.Obstacle;
+            manager.update(c.first, obstacle.x(), obstacle.y(), obstacle.heading(), obstacle.speed(), obstacle.time(),
+                           c.second.Width, c.second.Length);
+        }
+    });
+    m_GaussianDynamicObstacles.modify([&](GaussianDynamicObstaclesManager& manager) {
+        for (const auto& c : contacts) {
+            const auto& obstacle = c.second.Obstacle;
+            manager.update(c.first, obstacle.x(), obstacle.y(), obstacle.heading(), obstacle.speed(), obstacle.time());
+        }
+    });
+    return contacts.size();
+}
+
+void SharedWorld::forgetDynamicObstacles() {
+    {
+        std::lock_guard<std::mutex> lock(m_QueuedContactsMutex);
+        m_QueuedContacts.clear();
+    }
+    m_BinaryDynamicObstacles.reset();
+    m_GaussianDynamicObstacles.reset();
+}
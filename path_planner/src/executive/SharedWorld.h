@@ -0,0 +1,133 @@
+#ifndef SRC_SHAREDWORLD_H
+#define SRC_SHAREDWORLD_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../common/map/Map.h"
+#include "../common/map/GridWorldMap.h"
+#include "../common/dynamic_obstacles/DynamicObstaclesManager1.h"
+#include "../common/dynamic_obstacles/BinaryDynamicObstaclesManager.h"
+#include "../common/dynamic_obstacles/GaussianDynamicObstaclesManager.h"
+#include "../common/dynamic_obstacles/SnapshotBuffer.h"
+
+/**
+ * The part of the world that looks the same to every vehicle: the map (and the distance field and whatever else it
+ * builds when it loads) and the contacts. Every Executive has one of these, and when several of them run in one
+ * process (one per boat) they can share it, so the map gets loaded once and each contact update happens once no
+ * matter how many boats there are. Ribbons, planners and search trees stay with each Executive.
+ *
+ * Readers never wait: the map is swapped in whole with a version number like SnapshotBuffer does, and the contacts
+ * live in snapshot buffers. Loaded maps aren't changed after the handoff, except that tiled maps load tiles as
+ * vessels move around, which their tile cache already makes safe from any number of threads.
+ */
+class SharedWorld {
+public:
+    typedef std::shared_ptr<SharedWorld> SharedPtr;
+
+    /**
+     * Claim a map request, so the same request from every vehicle only gets loaded once.
+     * @param request key for what's being asked for (path and loading options)
+     * @return false if that's what was asked for last, in which case it's loaded or on its way
+     */
+    bool requestMap(const std::string& request);
+
+    /**
+     * @param request
+     * @return whether request is still the latest one
+     */
+    bool isCurrentRequest(const std::string& request) const;
+
+    /**
+     * Let a request that didn't work out be tried again, unless there's been a newer one since.
+     * @param request
+     */
+    void forgetRequest(const std::string& request);
+
+    /**
+     * Make a map the current one. Null means nothing changes.
+     * @param map
+     */
+    void setMap(Map::SharedPtr map);
+
+    /**
+     * @return the current map (null before there is one)
+     */
+    Map::SharedPtr map() const;
+
+    /**
+     * Goes up after the map is swapped in, so a map grabbed after reading the version is at least that new.
+     * @return number of maps set so far
+     */
+    uint64_t mapVersion() const { return m_MapVersion.load(std::memory_order_acquire); }
+
+    /**
+     * Remember the grid world map on display, for requests that don't need loading but want to see it.
+     * @param request the request it was loaded for (ignored if that's not the latest any more)
+     * @param map
+     */
+    void setDisplayedMap(const std::string& request, std::shared_ptr<const GridWorldMap> map);
+
+    /**
+     * @return the grid world map for the latest request, if it's loaded and it's a grid world map
+     */
+    std::shared_ptr<const GridWorldMap> displayedMap() const;
+
+    /**
+     * Queue up information about a contact, for everybody. Nothing sees it until the next ingestDynamicObstacles(),
+     * and by then only the latest report about each contact is kept, so a burst of them costs a map insert each
+     * rather than an update to every manager.
+     * @param mmsi
+     * @param obstacle
+     * @param width
+     * @param length
+     */
+    void queueDynamicObstacle(uint32_t mmsi, const State& obstacle, double width, double length);
+
+    /**
+     * Update the managers with the contacts queued since last time, all at once. The planning loop does this just
+     * before taking its snapshot.
+     * @param distributions makes the distributions a contact's report stands for
+     * @return how many contacts got updated
+     */
+    size_t ingestDynamicObstacles(const std::function<std::vector<Distribution>(const State&)>& distributions);
+
+    /**
+     * Forget every contact, queued or not (for readers, after the next publish).
+     */
+    void forgetDynamicObstacles();
+
+    SnapshotBuffer<BinaryDynamicObstaclesManager>& binaryDynamicObstacles() { return m_BinaryDynamicObstacles; }
+
+    SnapshotBuffer<GaussianDynamicObstaclesManager>& gaussianDynamicObstacles() { return m_GaussianDynamicObstacles; }
+
+private:
+    // for the request and the displayed map
+    mutable std::mutex m_MapMutex;
+    // only ever accessed with the atomic shared_ptr functions
+    Map::SharedPtr m_Map;
+    std::atomic<uint64_t> m_MapVersion{0};
+    std::string m_MapRequest;
+    std::shared_ptr<const GridWorldMap> m_DisplayedMap;
+
+    // latest report about each contact since the last ingestDynamicObstacles()
+    struct QueuedContact {
+        State Obstacle;
+        double Width, Length;
+    };
+    std::mutex m_QueuedContactsMutex;
+    std::unordered_map<uint32_t, QueuedContact> m_QueuedContacts;
+
+    std::mutex m_DynamicObstaclesMutex;
+    DynamicObstaclesManager1 m_DynamicObstaclesManager;
+    // contact callbacks update these from their own thread, and planners get a snapshot at the start of each cycle
+    SnapshotBuffer<BinaryDynamicObstaclesManager> m_BinaryDynamicObstacles;
+    SnapshotBuffer<GaussianDynamicObstaclesManager> m_GaussianDynamicObstacles;
+};
+
+
+#endif //SRC_SHAREDWORLD_H
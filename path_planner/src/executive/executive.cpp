@@ -3,24 +3,52 @@
 #include <wait.h>
 #include <future>
 #include <memory>
+#include <sstream>
+#include <cmath>
+#include <sys/stat.h>
+#include <pthread.h>
 #include "executive.h"
 #include "../planner/SamplingBasedPlanner.h"
 #include "../planner/AStarPlanner.h"
 #include "../common/map/GeoTiffMap.h"
+#include "../common/map/TiledGeoTiffMap.h"
+#include "../common/map/MapCache.h"
 #include "../common/map/GridWorldMap.h"
 #include "../planner/PotentialFieldsPlanner.h"
+#include "../planner/PortfolioPlanner.h"
+#include "../planner/utilities/CycleScheduler.h"
+#include "../planner/utilities/BinaryVisualizer.h"
+#include "../planner/utilities/Tracer.h"
+#include "../planner/search/CheckedPlan.h"
 
 using namespace std;
 
-Executive::Executive(TrajectoryPublisher *trajectoryPublisher)
+Executive::Executive(TrajectoryPublisher *trajectoryPublisher, SharedWorld::SharedPtr world)
+        : m_World(world ? world : std::make_shared<SharedWorld>()), m_SharedWorld(world != nullptr)
 {
     m_TrajectoryPublisher = trajectoryPublisher;
     m_PlannerConfig.setNowFunction([&] { return m_TrajectoryPublisher->getTime(); });
+    // consecutive plans share most of their samples near the boat, so keep Dubins solutions around between them
+    m_PlannerConfig.setDubinsCache(std::make_shared<DubinsCache>());
+    m_PlannerConfig.setUseDubinsCache(true);
+    // and heuristic values, which stay good for as long as the same ribbons are left
+    m_PlannerConfig.setHeuristicCache(std::make_shared<HeuristicCache>());
+    m_PlannerConfig.setUseHeuristicCache(true);
+    // contacts are checked at every step of every edge, so bucket them by time and place once per plan
+    m_PlannerConfig.setPrecomputeObstacles(true);
+    // and expansion only needs Dubins lengths to find the closest samples
+    m_PlannerConfig.setBatchDubins(true);
+    // the potential fields fallback can use the map's distance field instead of scanning cells around the boat
+    m_PlannerConfig.setPotentialFieldsUseDistanceField(true);
+    // the planner gets remade each cycle, so the samples still in the new window are kept out here
+    m_PlannerConfig.setSamplePool(std::make_shared<SamplePool>());
+    // and what the last plan was checked against, so checking it again only sweeps the edges something's changed near
+    m_PlannerConfig.setCheckedPlan(std::make_shared<CheckedPlan>());
 }
 
 Executive::~Executive() {
     terminate();
-    m_PlanningFuture.wait_for(chrono::seconds(2));
+    if (m_PlanningFuture.valid()) m_PlanningFuture.wait_for(chrono::seconds(2));
 }
 
 double Executive::getCurrentTime()
@@ -32,21 +60,56 @@ double Executive::getCurrentTime()
 
 void Executive::updateCovered(double x, double y, double speed, double heading, double t)
 {
+    record(InputLog::Position, x, y, speed, heading, t);
     if ((m_LastHeading - heading) / m_LastUpdateTime <= c_CoverageHeadingRateMax) {
-        std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-        m_RibbonManager.cover(x, y, false);
+        // the plan loop covers these in a batch; if it isn't keeping up (or isn't running) do it here
+        if (!m_CoverageQueue.push({x, y})) {
+            drainCoverage();
+            m_CoverageQueue.push({x, y});
+        }
     }
     m_LastUpdateTime = t; m_LastHeading = heading;
     m_LastState = State(x, y, heading, speed, t);
 }
 
+void Executive::drainCoverage() {
+    Tracer::Span wait("ribbon mutex wait");
+    std::lock_guard<std::mutex> lock(m_CoverageMutex);
+    wait.stop();
+    std::vector<double> xs, ys;
+    m_CoverageQueue.drain([&](const CoveragePoint& p) {
+        xs.push_back(p.X);
+        ys.push_back(p.Y);
+    });
+    if (xs.empty()) return;
+    m_Ribbons.modify([&](RibbonManager& ribbonManager) { ribbonManager.cover(xs, ys, false); });
+    m_Ribbons.publish();
+}
+
+template <class F>
+void Executive::modifyRibbons(F f) {
+    drainCoverage();
+    Tracer::Span wait("ribbon mutex wait");
+    std::lock_guard<std::mutex> lock(m_CoverageMutex);
+    wait.stop();
+    m_Ribbons.modify(f);
+    m_Ribbons.publish();
+}
+
 void Executive::planLoop() {
+    Tracer::nameThread("planner");
     double trialStartTime = m_TrajectoryPublisher->getTime(), cumulativeCollisionPenalty = 0;
     // TODO? -- record uncovered or poorly covered?
 
-    // Forget all dynamic obstacles. In practice this is not a good idea but for testing it's sort of OK
-    m_BinaryDynamicObstaclesManager = std::make_shared<BinaryDynamicObstaclesManager>();
-    m_GaussianDynamicObstaclesManager = std::make_shared<GaussianDynamicObstaclesManager>();
+    // Forget all dynamic obstacles. In practice this is not a good idea but for testing it's sort of OK (not when
+    // they're the other vehicles' contacts too, though)
+    if (!m_SharedWorld) {
+        m_World->forgetDynamicObstacles();
+    }
+
+    if (m_PlanningCore >= 0 && !pinCurrentThread(m_PlanningCore)) {
+        *m_PlannerConfig.output() << "Could not pin the planner to core " << m_PlanningCore << endl;
+    }
 
     try {
         cerr << "Initializing planner" << endl;
@@ -75,18 +138,80 @@ void Executive::planLoop() {
         // keep track of how many times in a row we fail to find a plan
         int failureCount = 0;
 
+        // version of the world's map the planner has
+        uint64_t mapVersion = 0;
+
+        // in pipelined mode, the last plan we handed off and the controller's (eventual) answer to it
+        DubinsPlan publishedPlan;
+        std::future<State> publication;
+
+        // the planner, which only sticks around between cycles when it's warm starting
+        unique_ptr<Planner> planner;
+        bool plannerKept = false;
+
+        // don't redraw the ribbons unless they've changed
+        uint64_t displayedRibbonsVersion = 0;
+
+        // how long the parts of the cycle around planning take, so planning gets whatever time is actually left
+        CycleScheduler scheduler(c_PlanningTimeSeconds);
+
+        // Called once the plan is on its way to the controller
+        auto handedOff = [&](double cycleStart, double handoffStart) {
+            auto now = m_TrajectoryPublisher->getTime();
+            scheduler.record(CycleScheduler::Publish, now - handoffStart);
+            auto late = scheduler.finishCycle(cycleStart, now);
+            if (late > 0) {
+                *m_PlannerConfig.output() << "Failed to meet real-time bound by " << std::lround(late * 1000)
+                    << "ms (" << scheduler.missedDeadlines() << " of " << scheduler.cycles() << " cycles; "
+                    << scheduler.summary() << ")" << endl;
+            }
+        };
+
+        // Check the controller's answer to a plan, which is the state it expects to be in when the next plan goes out.
+        // If that isn't on the plan it can't follow it
+        auto followable = [&](const DubinsPlan& plan, const State& reply) {
+            State expectedStartState(reply);
+            plan.sample(expectedStartState);
+            if (!reply.isCoLocated(expectedStartState)) {
+                lastPlanAchievable = false;
+                // reset turning radius shrink because we can't follow original plan anymore
+                if (c_RadiusShrinkEnabled) {
+                    m_PlannerConfig.setTurningRadius(m_PlannerConfig.turningRadius() + m_RadiusShrink);
+                    m_PlannerConfig.setCoverageTurningRadius(
+                            m_PlannerConfig.coverageTurningRadius() + m_RadiusShrink);
+                    m_RadiusShrink = 0;
+                }
+                return false;
+            }
+            // expected start state is along plan so allow plan to be passed to planner as previous plan
+            m_RadiusShrink += c_RadiusShrinkAmount;
+            lastPlanAchievable = true;
+            return true;
+        };
+
         while (true) {
+            // last cycle's timeline goes out before this one starts
+            auto tracer = Tracer::current();
+            if (tracer) tracer->flush();
+            Tracer::Span cycle("plan cycle");
             double startTime = m_TrajectoryPublisher->getTime();
             // logging time each time through the loop for making sure we're hitting the time bound
 //            *m_PlannerConfig.output() << "Top of plan loop at time " << std::to_string(startTime) << std::endl;
 
-            // planner is stateless so we can make a new instance each time
-            unique_ptr<Planner> planner;
-            if (m_UsePotentialFields) {
-                planner = std::unique_ptr<Planner>(new PotentialFieldsPlanner);
-            } else {
-                planner = std::unique_ptr<Planner>(new AStarPlanner);
+            m_PlannerConfig.setPortfolioSize(m_PortfolioSize);
+            // planner is stateless so we can make a new instance each time, unless it's keeping its tree around
+            const bool warmStart = m_WarmStart && !m_UsePotentialFields && m_PlannerConfig.portfolioSize() <= 1;
+            m_PlannerConfig.setWarmStart(warmStart);
+            if (!warmStart || !plannerKept) {
+                if (m_UsePotentialFields) {
+                    planner = std::unique_ptr<Planner>(new PotentialFieldsPlanner);
+                } else if (m_PlannerConfig.portfolioSize() > 1) {
+                    planner = std::unique_ptr<Planner>(new PortfolioPlanner(m_PlannerConfig.portfolioSize()));
+                } else {
+                    planner = std::unique_ptr<Planner>(new AStarPlanner);
+                }
             }
+            plannerKept = warmStart;
 
             { // new scope for RAII again
                 unique_lock<mutex> lock(m_PlannerStateMutex);
@@ -95,48 +220,57 @@ void Executive::planLoop() {
                     break;
                 }
             }
-            { // and again
-                std::lock_guard<std::mutex> lock1(m_RibbonManagerMutex);
-                if (m_RibbonManager.done()) {
-                    // tell the node we're done
-                    cerr << "Finished covering ribbons" << endl;
-                    m_TrajectoryPublisher->allDone();
-                    break;
-                }
+            // cover wherever we've been since last time and take this cycle's snapshot of the ribbons
+            auto phaseStart = m_TrajectoryPublisher->getTime();
+            drainCoverage();
+            auto ribbonsVersion = m_Ribbons.version();
+            auto ribbons = m_Ribbons.current();
+            scheduler.record(CycleScheduler::RibbonCopy, m_TrajectoryPublisher->getTime() - phaseStart);
+            if (ribbons->done()) {
+                // tell the node we're done
+                cerr << "Finished covering ribbons" << endl;
+                m_TrajectoryPublisher->allDone();
+                break;
             }
             // display ribbons
-            { // one more time
-                std::lock_guard<std::mutex> lock1(m_RibbonManagerMutex);
-                m_TrajectoryPublisher->displayRibbons(m_RibbonManager);
+            if (ribbonsVersion != displayedRibbonsVersion) {
+                m_TrajectoryPublisher->displayRibbons(*ribbons);
+                displayedRibbonsVersion = ribbonsVersion;
+            }
+
+            // With a plan still on its way to the controller, don't wait to hear where it thinks we'll be; assume it
+            // follows the plan and start from there. The answer gets checked before this cycle's plan goes out
+            if (publication.valid()) {
+                startState = State();
+                startState.time() = scheduler.deadline(startTime);
+                if (publishedPlan.containsTime(startState.time())) publishedPlan.sample(startState);
+                else startState.time() = -1;
             }
 
             // if the state estimator returned an error naively do it ourselves
             if (startState.time() == -1) {
                 startState = m_LastState.push(
-                        m_TrajectoryPublisher->getTime() + c_PlanningTimeSeconds - m_LastState.time());
+                        scheduler.deadline(m_TrajectoryPublisher->getTime()) - m_LastState.time());
             }
 
-            // copy the map pointer if it's been set (don't wait for the mutex because it may be a while)
+            // pick up the map if there's a new one (this never waits)
             {
-                std::unique_lock<std::mutex> lock1(m_MapMutex, std::defer_lock);
-                if (lock1.try_lock()) {
-                    if (m_NewMap) {
-                        m_PlannerConfig.setMap(m_NewMap);
-                    }
-                    m_NewMap = nullptr;
-
-                    // check if start state is blocked
-                    // I don't remember why I put this inside the locked block but I'm sure I had a good reason
-                    if (m_PlannerConfig.map()->isBlocked(startState.x(), startState.y())) {
-                        *m_PlannerConfig.output() << "We've run aground, according to the most recent map!\n" <<
-                        "Ending task now" << endl;
-//                        cerr << "Starting state (" << startState.toString()
-//                             << ") is blocked, according to most recent map. Trying again in 1s." << endl;
-//                        sleep(1);
-//                        continue;
-                        m_TrajectoryPublisher->allDone();
-                        break;
-                    }
+                auto version = m_World->mapVersion();
+                if (version != mapVersion) {
+                    mapVersion = version;
+                    m_PlannerConfig.setMap(m_World->map());
+                }
+
+                // check if start state is blocked
+                if (m_PlannerConfig.map()->isBlocked(startState.x(), startState.y())) {
+                    *m_PlannerConfig.output() << "We've run aground, according to the most recent map!\n" <<
+                    "Ending task now" << endl;
+//                    cerr << "Starting state (" << startState.toString()
+//                         << ") is blocked, according to most recent map. Trying again in 1s." << endl;
+//                    sleep(1);
+//                    continue;
+                    m_TrajectoryPublisher->allDone();
+                    break;
                 }
             }
 
@@ -152,41 +286,68 @@ void Executive::planLoop() {
                 m_RadiusShrink += c_RadiusShrinkAmount;
             }
 
-            // check for collision penalty
-            double collisionPenalty = 0;
+            // take this cycle's snapshot of the obstacles, with whatever contacts came in since last time; nothing
+            // changes it while we plan
+            m_World->ingestDynamicObstacles(&Executive::inventDistributions);
+            DynamicObstaclesManager::ConstSharedPtr obstacles;
             if (m_UseGaussianDynamicObstacles) {
-                collisionPenalty = m_GaussianDynamicObstaclesManager->DynamicObstaclesManager::collisionExists(
-                        m_LastState, false);
+                m_World->gaussianDynamicObstacles().publish();
+                obstacles = m_World->gaussianDynamicObstacles().current();
             } else {
-                collisionPenalty = m_BinaryDynamicObstaclesManager->DynamicObstaclesManager::collisionExists(
-                        m_LastState, false);
+                m_World->binaryDynamicObstacles().publish();
+                obstacles = m_World->binaryDynamicObstacles().current();
             }
+
+            // check for collision penalty
+            double collisionPenalty = obstacles->collisionExists(m_LastState, false);
             cumulativeCollisionPenalty += collisionPenalty;
 
             try {
-                if (m_UseGaussianDynamicObstacles) {
-                    m_PlannerConfig.setObstaclesManager(m_GaussianDynamicObstaclesManager);
-                } else{
-                    m_PlannerConfig.setObstaclesManager(m_BinaryDynamicObstaclesManager);
+                m_PlannerConfig.setObstaclesManager(obstacles);
+                // where the contacts will be over the horizon gets worked out once, for every planner this cycle
+                if (m_PlannerConfig.precomputeObstacles()) {
+                    m_PlannerConfig.setObstacleProjection(
+                            obstacles->precompute(startState.time(), m_PlannerConfig.timeHorizon()));
                 }
                 // display (binary) dynamic obstacles
-//                for (auto o : m_BinaryDynamicObstaclesManager->get()) {
+//                for (auto o : m_BinaryDynamicObstacles.current()->get()) {
 //                    auto& obstacle = o.second;
 //                    obstacle.project(m_TrajectoryPublisher->getTime());
 //                    m_TrajectoryPublisher->displayDynamicObstacle(obstacle.X, obstacle.Y, obstacle.Yaw, obstacle.Width, obstacle.Length, o.first);
 //                }
                 // TODO! -- display gaussian dynamic obstacles somehow
 
-                // trying to fix seg fault by eliminating concurrent access to ribbon manager (seems to have fixed it)
-                RibbonManager ribbonManagerCopy;
-                {
-                    std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-                    ribbonManagerCopy = m_RibbonManager;
-                }
+                // the snapshot is immutable and the copy shares its ribbons until something gets covered
+                RibbonManager ribbonManagerCopy = *ribbons;
+                phaseStart = m_TrajectoryPublisher->getTime();
                 // cover up to the state that we're planning from
                 ribbonManagerCopy.coverBetween(m_LastState.x(), m_LastState.y(), startState.x(), startState.y(), false);
-                stats = planner->plan(ribbonManagerCopy, startState, m_PlannerConfig, stats.Plan,
-                                     startTime + c_PlanningTimeSeconds - m_TrajectoryPublisher->getTime());
+                // with a big survey, just the next few ribbons in order (the rest gets summarized)
+                auto localRibbons = m_LocalRibbons.load();
+                if (localRibbons > 0) {
+                    refreshSurveyOrder(ribbons, ribbonsVersion, startState.x(), startState.y());
+                    auto order = std::atomic_load(&m_SurveyOrder);
+                    if (order) ribbonManagerCopy = order->localView(ribbonManagerCopy, localRibbons);
+                }
+                // get maps that load lazily ready where we're about to look (nothing for the others), in the
+                // background; anything the planner gets to first it loads itself
+                std::vector<std::pair<std::pair<double, double>, std::pair<double, double>>> lines;
+                for (const auto& r : ribbonManagerCopy.get()) lines.emplace_back(r.start(), r.end());
+                auto map = m_PlannerConfig.map();
+                m_MapFocuser.submit([map, startState, lines](const std::atomic<bool>& cancelled) {
+                    map->focus(startState.x(), startState.y(), startState.yaw());
+                    for (const auto& l : lines) {
+                        if (cancelled) return;
+                        map->focusAlong(l.first.first, l.first.second, l.second.first, l.second.second);
+                    }
+                });
+                auto phaseEnd = m_TrajectoryPublisher->getTime();
+                scheduler.record(CycleScheduler::Cover, phaseEnd - phaseStart);
+                phaseStart = phaseEnd;
+                // leave enough time after planning to get the plan out by the time we're predicted to be at the start
+                auto budget = scheduler.planningBudget(startTime, phaseStart);
+                stats = planner->plan(ribbonManagerCopy, startState, m_PlannerConfig, stats.Plan, budget);
+                scheduler.record(CycleScheduler::PlanOverrun, m_TrajectoryPublisher->getTime() - phaseStart - budget);
             } catch (const std::exception& e) {
                 cerr << "Exception thrown while planning:" << endl;
                 cerr << e.what() << endl;
@@ -194,23 +355,62 @@ void Executive::planLoop() {
                 stats.Plan = DubinsPlan();
             } catch (...) {
                 cerr << "Unknown exception thrown while planning; pausing" << endl;
-                cancelPlanner();
+                stopPlanner();
                 throw;
             }
 
+            stats.ControllerRoundTrip = m_ControllerRoundTrip;
             m_TrajectoryPublisher->publishStats(stats, collisionPenalty * Edge::collisionPenaltyFactor(),
-                                                0, lastPlanAchievable);
+                                                (unsigned long)std::lround(stats.CpuTime * 1e6), lastPlanAchievable);
 
-            // calculate remaining time (to sleep)
+            // calculate remaining time (to sleep) before the plan has to start going out
             double endTime = m_TrajectoryPublisher->getTime();
-            int sleepTime = ((int) ((c_PlanningTimeSeconds - (endTime - startTime)) * 1000));
-            if (sleepTime >= 0) {
-//                *m_PlannerConfig.output() << "Finished with " << sleepTime << "ms extra time. Sleeping." << endl;
-                this_thread::sleep_for(chrono::milliseconds(sleepTime));
+            auto handoffTime = scheduler.handoffTime(startTime);
+            if (handoffTime > endTime) {
+//                *m_PlannerConfig.output() << "Finished with " << handoffTime - endTime << "s extra time. Sleeping." << endl;
+                m_TrajectoryPublisher->sleepUntil(handoffTime);
+            }
+            double handoffStart = m_TrajectoryPublisher->getTime();
+
+            if (publication.valid()) {
+                // the controller has had all cycle to answer about the last plan
+                State reply;
+                try {
+                    reply = publication.get();
+                } catch (const std::exception& e) {
+                    cerr << "Exception thrown while updating controller's reference trajectory:" << endl;
+                    cerr << e.what() << endl;
+                    cerr << "Pausing." << endl;
+                    stopPlanner();
+                }
+                if (!publishedPlan.containsTime(reply.time())) {
+                    unique_lock<mutex> lock2(m_PlannerStateMutex);
+                    if (m_PlannerState == PlannerState::Cancelled) {
+                        break;
+                    }
+                }
+                if (!followable(publishedPlan, reply)) {
+                    // this plan started from where we'd be on that one, so it's no good either
+                    stats.Plan = DubinsPlan();
+                    startState = State();
+                    continue;
+                }
+            }
+
+            if (m_PipelinedPlanning && !stats.Plan.empty()) {
+                failureCount = 0;
+                // display and send it off on another thread and get on with the next one
+                publishedPlan = stats.Plan;
+                auto plan = stats.Plan;
+                publication = std::async(std::launch::async, [this, plan] {
+                    Tracer::nameThread("publisher");
+                    Tracer::Span span("publishPlan");
+                    m_TrajectoryPublisher->displayTrajectory(plan.getHalfSecondSamples(), true, plan.dangerous());
+                    return callController(plan);
+                });
+                handedOff(startTime, handoffStart);
+                continue;
             }
-//            else {
-//                *m_PlannerConfig.output() << "Failed to meet real-time bound by " << -sleepTime << "ms" << endl;
-//            }
 
             // display the trajectory
             m_TrajectoryPublisher->displayTrajectory(stats.Plan.getHalfSecondSamples(), true, stats.Plan.dangerous());
@@ -218,19 +418,35 @@ void Executive::planLoop() {
             if (!stats.Plan.empty()) {
                 failureCount = 0;
                 // send trajectory to controller
+                bool answered = true;
                 try {
-                    startState = m_TrajectoryPublisher->publishPlan(stats.Plan);
+                    Tracer::Span span("publishPlan");
+                    auto timeout = m_ControllerTimeout.load();
+                    if (timeout > 0) {
+                        answered = callController(stats.Plan, timeout, startState);
+                    } else {
+                        startState = callController(stats.Plan);
+                    }
                 } catch (const std::exception& e) {
                     cerr << "Exception thrown while updating controller's reference trajectory:" << endl;
                     cerr << e.what() << endl;
                     cerr << "Pausing." << endl;
-                    cancelPlanner();
+                    stopPlanner();
                 } catch (...) {
                     cerr << "Unknown exception thrown while updating controller's reference trajectory; pausing"
                          << endl;
-                    cancelPlanner();
+                    stopPlanner();
                     throw;
                 }
+                handedOff(startTime, handoffStart);
+                if (!answered) {
+                    // predict the start state ourselves next cycle, and plan on the controller getting this one
+                    *m_PlannerConfig.output() << "Controller didn't answer within "
+                        << std::lround(m_ControllerTimeout.load() * 1000) << "ms; predicting the next start state"
+                        << endl;
+                    startState = State();
+                    continue;
+                }
                 // if we cancelled the planner, the controller might not give us a valid next plan start, so we
                 // should nope out now rather than fail with an exception in a couple of lines
                 if (!stats.Plan.containsTime(startState.time())) {
@@ -239,26 +455,8 @@ void Executive::planLoop() {
                         break;
                     }
                 }
-                State expectedStartState(startState);
-                stats.Plan.sample(expectedStartState);
-                if (!startState.isCoLocated(expectedStartState)) {
-                    // reset plan because controller says we can't make it
-                    stats.Plan = DubinsPlan();
-                    lastPlanAchievable = false;
-
-                    // reset turning radius shrink because we can't follow original plan anymore
-                    if (c_RadiusShrinkEnabled) {
-                        m_PlannerConfig.setTurningRadius(m_PlannerConfig.turningRadius() + m_RadiusShrink);
-                        m_PlannerConfig.setCoverageTurningRadius(
-                                m_PlannerConfig.coverageTurningRadius() + m_RadiusShrink);
-                        m_RadiusShrink = 0;
-                    }
-
-                } else {
-                    // expected start state is along plan so allow plan to be passed to planner as previous plan
-                    m_RadiusShrink += c_RadiusShrinkAmount;
-                    lastPlanAchievable = true;
-                }
+                // reset plan because controller says we can't make it
+                if (!followable(stats.Plan, startState)) stats.Plan = DubinsPlan();
             } else {
                 cerr << "Planner returned empty trajectory." << endl;
                 startState = State();
@@ -281,7 +479,7 @@ void Executive::planLoop() {
         cerr << "Exception thrown in plan loop:" << endl;
         cerr << e.what() << endl;
         cerr << "Pausing." << endl;
-        cancelPlanner();
+        stopPlanner();
     } catch (...) {
         cerr << "Unknown exception thrown in plan loop" << endl;
     }
@@ -292,7 +490,8 @@ void Executive::planLoop() {
     // multiply penalties by weights
     cumulativeCollisionPenalty *= Edge::collisionPenaltyFactor();
     auto timePenalty = wallClockTime * Edge::timePenaltyFactor();
-    auto uncoveredLength = m_RibbonManager.getTotalUncoveredLength();
+    drainCoverage();
+    auto uncoveredLength = m_Ribbons.current()->getTotalUncoveredLength();
 
     m_TrajectoryPublisher->publishTaskLevelStats(wallClockTime, cumulativeCollisionPenalty,
                                                  timePenalty + cumulativeCollisionPenalty,
@@ -306,70 +505,114 @@ void Executive::planLoop() {
 void Executive::terminate()
 {
     // cancel planner so thread can finish
-    cancelPlanner();
+    stopPlanner();
 }
 
 void Executive::updateDynamicObstacle(uint32_t mmsi, State obstacle, double width, double length) {
-    m_DynamicObstaclesManager.update(mmsi, inventDistributions(obstacle));
-    m_BinaryDynamicObstaclesManager->update(mmsi, obstacle.x(), obstacle.y(), obstacle.heading(),
-            obstacle.speed(), obstacle.time(), width, length);
-    m_GaussianDynamicObstaclesManager->update(mmsi, obstacle.x(), obstacle.y(), obstacle.heading(),
-            obstacle.speed(), obstacle.time());
+    record(InputLog::Contact, (double)mmsi, obstacle.x(), obstacle.y(), obstacle.heading(), obstacle.speed(),
+           obstacle.time(), width, length);
+    m_World->queueDynamicObstacle(mmsi, obstacle, width, length);
 }
 
 void Executive::refreshMap(const std::string& pathToMapFile, double latitude, double longitude) {
-    // Run asynchronously and headless. The ol' fire-off-and-pray method
-    thread([this, pathToMapFile, latitude, longitude] {
-        std::lock_guard<std::mutex> lock(m_MapMutex);
-        // skip re-loading if we've already loaded it
-//        if (m_CurrentMapPath != pathToMapFile) {
-            if (pathToMapFile.empty()) {
-                m_NewMap = make_shared<Map>();
-                m_CurrentMapPath = pathToMapFile;
-                *m_PlannerConfig.output() << "Map cleared. Using empty map now." << endl;
-                m_TrajectoryPublisher->displayMap(pathToMapFile);
-                return;
-            }
-            // could take some time for I/O
-            try {
-                // If the name looks like it's one of our gridworld maps, load it in that format, otherwise assume GeoTIFF
-                if ( access( pathToMapFile.c_str(), F_OK ) == -1 ) {
-                    *m_PlannerConfig.output() << "Cannot find map file: " << pathToMapFile << endl;
-                    *m_PlannerConfig.output() << "Using empty map  for now." << endl;
-                    m_NewMap = make_shared<Map>();
-                    m_CurrentMapPath = "";
-                    m_TrajectoryPublisher->displayMap("");
-                    return;
-                }
-                if (pathToMapFile.find(".map") == -1) {
-                    // don't try to display geotiff maps
-                    m_TrajectoryPublisher->displayMap("");
-                    m_NewMap = make_shared<GeoTiffMap>(pathToMapFile, longitude, latitude);
-                } else {
-                    m_NewMap = make_shared<GridWorldMap>(pathToMapFile);
-                    m_TrajectoryPublisher->displayMap(pathToMapFile);
-                }
-                m_CurrentMapPath = pathToMapFile;
-                *m_PlannerConfig.output() << "Loaded map file: " << pathToMapFile << endl;
+    record(InputLog::Map, {latitude, longitude}, pathToMapFile);
+    auto tiled = m_TiledMaps;
+    auto residentRadius = m_MapResidentRadius;
+    // every reconfigure ends up here, so only start a load if it's for something different from the last one (or
+    // the file's changed since)
+    std::ostringstream request;
+    {
+        struct stat s{};
+        request << "map:" << pathToMapFile << "|" << tiled << "|" << residentRadius;
+        if (stat(pathToMapFile.c_str(), &s) == 0) request << "|" << s.st_mtim.tv_sec << "." << s.st_mtim.tv_nsec;
+        // (with a shared world, the same request from another vehicle counts as a repeat)
+        if (!m_World->requestMap(request.str())) {
+            // nothing to load, but whoever asked probably wants to see it
+            auto displayed = m_World->displayedMap();
+            if (displayed) m_TrajectoryPublisher->displayMap(displayed);
+            return;
+        }
+    }
+    // one loader at a time, and only for the latest request; one that's already going gets told to give up
+    auto key = request.str();
+    m_MapLoader.submit([this, key, pathToMapFile, latitude, longitude, tiled, residentRadius]
+                               (const std::atomic<bool>& cancelled) {
+        loadMap(key, pathToMapFile, latitude, longitude, tiled, residentRadius, cancelled);
+    });
+}
+
+void Executive::loadMap(const std::string& request, const std::string& pathToMapFile, double latitude,
+                        double longitude, bool tiled, double residentRadius, const std::atomic<bool>& cancelled) {
+    Tracer::nameThread("map loader");
+    Tracer::Span span("load map");
+    // if this doesn't work out, let the same request try again (unless there's been another one since)
+    auto forgetRequest = [this, &request] { m_World->forgetRequest(request); };
+    if (pathToMapFile.empty()) {
+        m_World->setMap(make_shared<Map>());
+        *m_PlannerConfig.output() << "Map cleared. Using empty map now." << endl;
+        m_TrajectoryPublisher->displayMap(nullptr);
+        return;
+    }
+    // could take some time for I/O
+    try {
+        auto loadStart = chrono::steady_clock::now();
+        // If the name looks like it's one of our gridworld maps, load it in that format, otherwise assume GeoTIFF
+        if ( access( pathToMapFile.c_str(), F_OK ) == -1 ) {
+            *m_PlannerConfig.output() << "Cannot find map file: " << pathToMapFile << endl;
+            *m_PlannerConfig.output() << "Using empty map  for now." << endl;
+            m_World->setMap(make_shared<Map>());
+            m_TrajectoryPublisher->displayMap(nullptr);
+            forgetRequest();
+            return;
+        }
+        Map::SharedPtr map;
+        std::shared_ptr<GridWorldMap> gridWorldMap;
+        if (pathToMapFile.find(".map") == -1) {
+            // don't try to display geotiff maps
+            m_TrajectoryPublisher->displayMap(nullptr);
+            if (tiled) {
+                map = make_shared<TiledGeoTiffMap>(pathToMapFile, residentRadius);
+            } else if (!(map = MapCache(MapCache::defaultDirectory()).load(pathToMapFile))) {
+                auto geoTiffMap = make_shared<GeoTiffMap>(pathToMapFile, longitude, latitude,
+                                                          [&cancelled] { return cancelled.load(); });
+                cacheMap(pathToMapFile, *geoTiffMap);
+                map = geoTiffMap;
             }
-            catch (...) {
-                // swallow all errors in this thread
-                *m_PlannerConfig.output() << "Encountered an error loading map at path " << pathToMapFile << ".\nMap was not updated." << endl;
-                *m_PlannerConfig.output() << "Set the map path to an empty string to clear the map." << endl;
-                m_NewMap = nullptr;
-                m_CurrentMapPath = "";
+        } else {
+            gridWorldMap = dynamic_pointer_cast<GridWorldMap>(MapCache(MapCache::defaultDirectory()).load(pathToMapFile));
+            if (!gridWorldMap) {
+                gridWorldMap = make_shared<GridWorldMap>(pathToMapFile);
+                cacheMap(pathToMapFile, *gridWorldMap);
             }
-//        } else {
-            // refresh display anyway
-//            if (pathToMapFile.find(".map") != -1)
-//                m_TrajectoryPublisher->displayMap(pathToMapFile);
-//        }
-    }).detach();
+            map = gridWorldMap;
+        }
+        // someone's asked for something else while we were loading (maybe for another vehicle), so this one's not
+        // wanted any more
+        if (cancelled || !m_World->isCurrentRequest(request)) throw MapLoadCancelled();
+        m_World->setMap(map);
+        if (gridWorldMap) {
+            m_World->setDisplayedMap(request, gridWorldMap);
+            m_TrajectoryPublisher->displayMap(gridWorldMap);
+        }
+        auto loadTime = chrono::duration<double>(chrono::steady_clock::now() - loadStart).count();
+        *m_PlannerConfig.output() << "Loaded map file: " << pathToMapFile << " in " << std::lround(loadTime * 1000)
+            << "ms (" << map->memoryUsage() / (1 << 20) << " MiB)" << endl;
+    }
+    catch (const MapLoadCancelled&) {
+        // the newer request has it from here
+        *m_PlannerConfig.output() << "Stopped loading map at path " << pathToMapFile << " for a newer request" << endl;
+    }
+    catch (...) {
+        // swallow all errors in this thread
+        *m_PlannerConfig.output() << "Encountered an error loading map at path " << pathToMapFile << ".\nMap was not updated." << endl;
+        *m_PlannerConfig.output() << "Set the map path to an empty string to clear the map." << endl;
+        forgetRequest();
+    }
 }
 
 void Executive::addRibbon(double x1, double y1, double x2, double y2) {
-    std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-    m_RibbonManager.add(x1, y1, x2, y2);
+    record(InputLog::AddRibbon, {x1, y1, x2, y2});
+    modifyRibbons([=](RibbonManager& ribbonManager) { ribbonManager.add(x1, y1, x2, y2); });
 }
 
 std::vector<Distribution> Executive::inventDistributions(State obstacle) {
@@ -386,8 +629,11 @@ std::vector<Distribution> Executive::inventDistributions(State obstacle) {
 }
 
 void Executive::clearRibbons() {
-    std::lock_guard<std::mutex> lock(m_RibbonManagerMutex);
-    m_RibbonManager = RibbonManager(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons, m_PlannerConfig.turningRadius(), 2);
+    record(InputLog::ClearRibbons);
+    auto turningRadius = m_PlannerConfig.turningRadius();
+    modifyRibbons([=](RibbonManager& ribbonManager) {
+        ribbonManager = RibbonManager(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons, turningRadius, 2);
+    });
 }
 
 void Executive::setConfiguration(double turningRadius, double coverageTurningRadius, double maxSpeed, double slowSpeed,
@@ -395,19 +641,28 @@ void Executive::setConfiguration(double turningRadius, double coverageTurningRad
                                  double collisionCheckingIncrement, int initialSamples, bool useBrownPaths,
                                  bool useGaussianDynamicObstacles, bool ignoreDynamicObstacles,
                                  bool usePotentialFields) {
+    record(InputLog::Configuration, {turningRadius, coverageTurningRadius, maxSpeed, slowSpeed, lineWidth, (double)k,
+                                     (double)heuristic, timeHorizon, timeMinimum, collisionCheckingIncrement,
+                                     (double)initialSamples, (double)useBrownPaths,
+                                     (double)useGaussianDynamicObstacles, (double)ignoreDynamicObstacles,
+                                     (double)usePotentialFields});
     m_PlannerConfig.setTurningRadius(turningRadius);
     m_PlannerConfig.setCoverageTurningRadius(coverageTurningRadius);
     m_PlannerConfig.setMaxSpeed(maxSpeed);
     m_PlannerConfig.setSlowSpeed(slowSpeed);
     RibbonManager::setRibbonWidth(lineWidth);
     m_PlannerConfig.setBranchingFactor(k);
+    auto setHeuristic = [this](RibbonManager::Heuristic h) {
+        modifyRibbons([h](RibbonManager& ribbonManager) { ribbonManager.setHeuristic(h); });
+    };
     switch (heuristic) {
         // check the .cfg file if this is breaking or if you change these
-        case 0: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspPointRobotNoSplitAllRibbons); break;
-        case 1: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons); break;
-        case 2: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::MaxDistance); break;
-        case 3: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitAllRibbons); break;
-        case 4: m_RibbonManager.setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitKRibbons); break;
+        case 0: setHeuristic(RibbonManager::Heuristic::TspPointRobotNoSplitAllRibbons); break;
+        case 1: setHeuristic(RibbonManager::Heuristic::TspPointRobotNoSplitKRibbons); break;
+        case 2: setHeuristic(RibbonManager::Heuristic::MaxDistance); break;
+        case 3: setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitAllRibbons); break;
+        case 4: setHeuristic(RibbonManager::Heuristic::TspDubinsNoSplitKRibbons); break;
+        case 5: setHeuristic(RibbonManager::Heuristic::MinimumSpanningTree); break;
         default: *m_PlannerConfig.output() << "Unknown heuristic. Ignoring." << endl; break;
     }
     m_PlannerConfig.setTimeHorizon(timeHorizon);
@@ -421,6 +676,7 @@ void Executive::setConfiguration(double turningRadius, double coverageTurningRad
 }
 
 void Executive::startPlanner() {
+    record(InputLog::StartPlanner);
     if (!m_PlannerConfig.map()) {
         m_PlannerConfig.setMap(make_shared<Map>());
     }
@@ -432,6 +688,11 @@ void Executive::startPlanner() {
 }
 
 void Executive::cancelPlanner() {
+    record(InputLog::CancelPlanner);
+    stopPlanner();
+}
+
+void Executive::stopPlanner() {
     std::unique_lock<mutex> lock(m_PlannerStateMutex);
     if (m_PlannerState == PlannerState::Running) {
         m_PlannerState = PlannerState::Cancelled;
@@ -439,14 +700,208 @@ void Executive::cancelPlanner() {
     }
 }
 
+template <class T>
+void Executive::cacheMap(const std::string& pathToMapFile, const T& map) {
+    // not being able to cache it just means loading it from scratch next time
+    try {
+        MapCache(MapCache::defaultDirectory()).store(pathToMapFile, map);
+    } catch (const std::exception& e) {
+        *m_PlannerConfig.output() << "Could not cache map: " << e.what() << endl;
+    }
+}
+
+void Executive::setMapTiling(bool tiled, double residentRadius) {
+    record(InputLog::MapTiling, {(double)tiled, residentRadius});
+    m_TiledMaps = tiled;
+    m_MapResidentRadius = residentRadius;
+}
+
+void Executive::setPipelinedPlanning(bool pipelined) {
+    record(InputLog::PipelinedPlanning, {(double)pipelined});
+    m_PipelinedPlanning = pipelined;
+}
+
+void Executive::setControllerTimeout(double timeout) {
+    record(InputLog::ControllerTimeout, {timeout});
+    m_ControllerTimeout = timeout;
+}
+
+void Executive::setLocalRibbons(int localRibbons) {
+    record(InputLog::LocalRibbons, {(double)localRibbons});
+    m_LocalRibbons = localRibbons;
+}
+
+void Executive::refreshSurveyOrder(std::shared_ptr<const RibbonManager> ribbons, uint64_t version, double x,
+                                   double y) {
+    if (version == m_SurveyOrderVersion || m_OrderingSurvey.exchange(true)) return;
+    m_SurveyOrderVersion = version;
+    // the snapshot never changes, so it's fine to read it over there
+    m_SurveyOrderer.submit([this, ribbons, x, y](const std::atomic<bool>&) {
+        Tracer::nameThread("survey orderer");
+        Tracer::Span span("orderSurvey");
+        SurveyOrder::ConstSharedPtr order = std::make_shared<SurveyOrder>(*ribbons, x, y);
+        std::atomic_store(&m_SurveyOrder, order);
+        m_OrderingSurvey = false;
+    });
+}
+
+void Executive::setWarmStart(bool warmStart) {
+    record(InputLog::WarmStart, {(double)warmStart});
+    m_WarmStart = warmStart;
+}
+
+void Executive::setPortfolioSize(int portfolioSize) {
+    record(InputLog::PortfolioSize, {(double)portfolioSize});
+    m_PortfolioSize = portfolioSize;
+}
+
+void Executive::setPlanningCore(int core) {
+    m_PlanningCore = core;
+}
+
+void Executive::setRecording(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_RecordingMutex);
+    if (path == m_RecordingPath) return;
+    m_RecordingPath = path;
+    InputRecorder::SharedPtr recorder;
+    if (!path.empty()) {
+        try {
+            recorder = std::make_shared<InputRecorder>(path);
+        } catch (const std::exception& e) {
+            *m_PlannerConfig.output() << e.what() << ". Not recording." << endl;
+            m_RecordingPath.clear();
+        }
+    }
+    if (recorder) {
+        // catch the log up to where things are now, so replaying it starts from here
+        auto now = m_TrajectoryPublisher->getTime();
+        for (const auto& setting : m_Settings) {
+            auto event = setting.second;
+            event.Time = now;
+            recorder->write(event);
+        }
+        recorder->write({InputLog::ClearRibbons, now, {}, ""});
+        for (const auto& r : m_Ribbons.current()->get()) {
+            recorder->write({InputLog::AddRibbon, now, {r.start().first, r.start().second, r.end().first,
+                                                        r.end().second}, ""});
+        }
+        auto last = m_LastState;
+        if (last.time() != -1) {
+            recorder->write({InputLog::Position, now, {last.x(), last.y(), last.speed(), last.heading(), last.time()},
+                             ""});
+        }
+        std::unique_lock<mutex> stateLock(m_PlannerStateMutex);
+        if (m_PlannerState == PlannerState::Running) recorder->write({InputLog::StartPlanner, now, {}, ""});
+        *m_PlannerConfig.output() << "Recording planner inputs to " << path << endl;
+    }
+    std::atomic_store(&m_Recorder, recorder);
+}
+
+void Executive::setSampleSeed(long seed) {
+    m_PlannerConfig.setSampleSeed(seed);
+}
+
+void Executive::record(InputLog::Type type, std::vector<double> values, std::string text) {
+    const bool setting = InputLog::isSetting(type);
+    // (not even a lock for positions and contacts when nothing's recording)
+    if (!setting && !std::atomic_load(&m_Recorder)) return;
+    InputLog::Event event{type, m_TrajectoryPublisher->getTime(), std::move(values), std::move(text)};
+    if (setting) {
+        std::lock_guard<std::mutex> lock(m_RecordingMutex);
+        m_Settings[type] = event;
+        // under the lock so it can't fall between a new recording catching up and starting
+        auto recorder = std::atomic_load(&m_Recorder);
+        if (recorder) recorder->write(event);
+        return;
+    }
+    auto recorder = std::atomic_load(&m_Recorder);
+    if (recorder) recorder->write(event);
+}
+
+void Executive::recordReply(const State& reply) {
+    record(InputLog::ControllerReply, reply.x(), reply.y(), reply.heading(), reply.speed(), reply.time());
+    auto recorder = std::atomic_load(&m_Recorder);
+    if (recorder) recorder->flush();
+}
+
+State Executive::callController(const DubinsPlan& plan) {
+    auto start = std::chrono::steady_clock::now();
+    auto reply = m_TrajectoryPublisher->publishPlan(plan);
+    m_ControllerRoundTrip = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    recordReply(reply);
+    return reply;
+}
+
+bool Executive::callController(const DubinsPlan& plan, double timeout, State& reply) {
+    auto promise = std::make_shared<std::promise<State>>();
+    auto answer = promise->get_future();
+    m_ControllerClient.submit([this, plan, promise](const std::atomic<bool>&) {
+        Tracer::nameThread("controller client");
+        // (the worker swallows exceptions, so pass them on)
+        try {
+            promise->set_value(callController(plan));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    if (answer.wait_for(std::chrono::duration<double>(timeout)) != std::future_status::ready) return false;
+    reply = answer.get();
+    return true;
+}
+
+bool Executive::pinCurrentThread(int core) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
 void Executive::setPlannerVisualization(bool visualize, const std::string& visualizationFilePath) {
     m_PlannerConfig.setVisualizations(visualize);
     if (visualize) {
-        m_Visualizer = Visualizer::UniquePtr(new Visualizer(visualizationFilePath));
+        try {
+            if (m_BinaryVisualization) {
+                m_Visualizer = Visualizer::UniquePtr(new BinaryVisualizer(visualizationFilePath));
+            } else {
+                m_Visualizer = Visualizer::UniquePtr(new Visualizer(visualizationFilePath));
+            }
+        } catch (const std::exception& e) {
+            *m_PlannerConfig.output() << e.what() << ". Not visualizing." << endl;
+            m_PlannerConfig.setVisualizations(false);
+            return;
+        }
+        m_Visualizer->setSampleRate(Visualizer::Vertices, m_VisualizationVertexRate);
+        m_Visualizer->setSampleRate(Visualizer::Trajectories, m_VisualizationTrajectoryRate);
         m_PlannerConfig.setVisualizer(&m_Visualizer);
     }
 }
 
+void Executive::setVisualizationFormat(bool binary, unsigned vertexSampleRate, unsigned trajectorySampleRate) {
+    m_BinaryVisualization = binary;
+    m_VisualizationVertexRate = vertexSampleRate;
+    m_VisualizationTrajectoryRate = trajectorySampleRate;
+}
+
+void Executive::setTracing(const std::string& path) {
+    if (path == m_TracePath) return;
+    m_TracePath = path;
+    Tracer::SharedPtr tracer;
+    if (!path.empty()) {
+        try {
+            tracer = std::make_shared<Tracer>(path);
+            *m_PlannerConfig.output() << "Tracing plan cycles to " << path << endl;
+        } catch (const std::exception& e) {
+            *m_PlannerConfig.output() << e.what() << ". Not tracing." << endl;
+            m_TracePath.clear();
+        }
+    }
+    Tracer::install(tracer);
+}
+
 //void Executive::updateDynamicObstacle(uint32_t mmsi, const std::vector<Distribution>& obstacle) {
 //    m_DynamicObstaclesManager.update(mmsi, obstacle);
 //    // TODO! -- other representations
@@ -2,13 +2,18 @@
 #define SRC_EXECUTIVE_H
 
 #include <condition_variable>
+#include <atomic>
 #include "../planner/utilities/RibbonManager.h"
+#include "../planner/utilities/SpscRing.h"
+#include "../planner/utilities/LatestTaskWorker.h"
+#include "../planner/utilities/SurveyOrder.h"
 #include "../trajectory_publisher.h"
 #include "../planner/Planner.h"
-#include "../common/dynamic_obstacles/BinaryDynamicObstaclesManager.h"
-#include "../common/dynamic_obstacles/GaussianDynamicObstaclesManager.h"
+#include "SharedWorld.h"
+#include "InputLog.h"
 #include <future>
 #include <fstream>
+#include <map>
 
 /**
  * Class calls the planner and manages associated configurations and other data.
@@ -22,10 +27,12 @@ class Executive
 public:
 
     /**
-     * Construct an executive object. This probably only needs to happen once per ROS node.
+     * Construct an executive object. This probably only needs to happen once per ROS node, or once per vehicle when
+     * one node plans for a few of them.
      * @param trajectoryPublisher - Intended to be a ROS node
+     * @param world map and contacts shared with other executives, if there are any (otherwise it gets its own)
      */
-    explicit Executive(TrajectoryPublisher *trajectoryPublisher);
+    explicit Executive(TrajectoryPublisher *trajectoryPublisher, SharedWorld::SharedPtr world = nullptr);
 
     /**
      * Attempts to stop the planning thread. Waits up to two seconds.
@@ -82,6 +89,76 @@ public:
      */
     void refreshMap(const std::string& pathToMapFile, double latitude, double longitude);
 
+    /**
+     * Choose whether GeoTIFF maps are read tile by tile as the vessel gets near them instead of all at once. Takes
+     * effect at the next refreshMap.
+     * @param tiled
+     * @param residentRadius how far around the vessel to keep loaded (m)
+     */
+    void setMapTiling(bool tiled, double residentRadius);
+
+    /**
+     * Choose whether each plan gets displayed and sent to the controller on another thread while the next one is
+     * planned, starting from where the vessel should be on the plan that's on its way. The controller's answer is
+     * checked before the next plan goes out, and if it couldn't follow the last one the new one gets thrown away
+     * too. Takes effect on the next cycle.
+     * @param pipelined
+     */
+    void setPipelinedPlanning(bool pipelined);
+
+    /**
+     * Choose how long to wait for the controller to answer a plan (when not pipelining). Plans go to the controller on
+     * a client thread, and if the answer doesn't come in time the next cycle starts from where the vessel is predicted
+     * to be instead of where the controller says. A late answer is dropped, and while the client's still waiting on
+     * one the newest plan waits behind it rather than piling up. Takes effect on the next cycle.
+     * @param timeout seconds, or 0 to wait as long as it takes
+     */
+    void setControllerTimeout(double timeout);
+
+    /**
+     * Choose whether to plan on just the next few ribbons of a big survey. The whole survey gets put in order in the
+     * background (again whenever it's changed, like by being covered), and each plan then gets the first few ribbons
+     * left in that order and a summary of the cost of the rest, instead of all of them. Takes effect on the next
+     * cycle, and until the first order's ready plans still get the whole survey.
+     * @param localRibbons how many ribbons each plan gets, or 0 for all of them
+     */
+    void setLocalRibbons(int localRibbons);
+
+    /**
+     * Choose whether to keep the planner and its search tree from one cycle to the next, so each plan starts from
+     * what's left of the last one's tree instead of from scratch. Only works with the A* planner (not a portfolio or
+     * potential fields). Takes effect on the next cycle.
+     * @param warmStart
+     */
+    void setWarmStart(bool warmStart);
+
+    /**
+     * Choose how many A* planners to run side by side each cycle, each with its own samples and sharing the best plan
+     * found so far (see PortfolioPlanner). More than one turns warm starting off. Takes effect on the next cycle.
+     * @param portfolioSize 1 for just the one planner
+     */
+    void setPortfolioSize(int portfolioSize);
+
+    /**
+     * Keep the planning thread on one core, so planners for different vehicles in the same process don't fight over
+     * one. Takes effect the next time the planner starts.
+     * @param core core to run on, or -1 to let the scheduler decide
+     */
+    void setPlanningCore(int core);
+
+    /**
+     * Record everything this gets told from here on to a log that can be replayed offline (see InputLog), starting
+     * with the ribbons and settings as they are now. Asking for the same path again carries on with the same log.
+     * @param path where to write the log, or empty to stop recording
+     */
+    void setRecording(const std::string& path);
+
+    /**
+     * Draw every plan's samples with the same seed, so runs with the same inputs search the same samples.
+     * @param seed seed to use, or -1 to seed each plan differently
+     */
+    void setSampleSeed(long seed);
+
     /**
      * Utility to get the current time. Public for testing, and only used when disconnected from ROS.
      * @return
@@ -109,6 +186,24 @@ public:
      */
     void setPlannerVisualization(bool visualize, const std::string& visualizationFilePath);
 
+    /**
+     * Choose how the next setPlannerVisualization records things: the text the visualization tools read, or compact
+     * binary events written in the background, which barely slow the planner down (convert them with
+     * visualization_to_text). Either way only so many of the vertices and edges can be kept.
+     * @param binary
+     * @param vertexSampleRate keep one vertex in this many
+     * @param trajectorySampleRate keep one edge's states in this many
+     */
+    void setVisualizationFormat(bool binary, unsigned vertexSampleRate, unsigned trajectorySampleRate);
+
+    /**
+     * Write a timeline of each plan cycle (planning iterations, searches, handing plans off, map loads and waits for
+     * the ribbons) in the Chrome trace format (see Tracer). Tracing is for the whole process, so with several vehicles
+     * in one node the last one to set it wins.
+     * @param path where to write the trace, or empty to stop tracing
+     */
+    void setTracing(const std::string& path);
+
 private:
 
     /**
@@ -125,8 +220,16 @@ private:
     std::mutex m_PlannerStateMutex;
     std::condition_variable m_CancelCV;
 
-    std::mutex m_RibbonManagerMutex;
-    RibbonManager m_RibbonManager;
+    // Position callbacks queue up the points they'd cover and the plan loop covers them all at once at the top of each
+    // cycle, so the callbacks never wait for the planner. The plan loop (and anything else) reads the ribbons from
+    // the last published snapshot
+    struct CoveragePoint {
+        double X, Y;
+    };
+    SpscRing<CoveragePoint> m_CoverageQueue{c_CoverageQueueSize};
+    // whoever holds this is the queue's consumer and the only one changing the ribbons
+    std::mutex m_CoverageMutex;
+    SnapshotBuffer<RibbonManager> m_Ribbons;
     double m_LastUpdateTime = 1; // could use the time in m_LastState I think but this is cleaner
     double m_LastHeading = 0; // TODO! -- use moving average or something
     State m_LastState;
@@ -139,15 +242,32 @@ private:
     bool m_UsePotentialFields = false;
 
     Visualizer::UniquePtr m_Visualizer;
+    bool m_BinaryVisualization = false;
+    unsigned m_VisualizationVertexRate = 1, m_VisualizationTrajectoryRate = 1;
+
+    // the map and contacts, which might be shared with other vehicles' executives
+    SharedWorld::SharedPtr m_World;
+    // whether anybody else uses m_World, in which case its contacts aren't ours to forget
+    bool m_SharedWorld;
+    bool m_TiledMaps = false;
+    double m_MapResidentRadius = 2000;
+
+    // whether to overlap publishing each plan with planning the next one
+    std::atomic<bool> m_PipelinedPlanning{false};
+
+    // longest to wait for the controller's answer to a plan (s, 0 for no limit)
+    std::atomic<double> m_ControllerTimeout{0};
+    // how long the controller took to answer the last plan it answered (s)
+    std::atomic<double> m_ControllerRoundTrip{0};
 
-    DynamicObstaclesManager1 m_DynamicObstaclesManager;
-    BinaryDynamicObstaclesManager::SharedPtr m_BinaryDynamicObstaclesManager = std::make_shared<BinaryDynamicObstaclesManager>();
-    GaussianDynamicObstaclesManager::SharedPtr m_GaussianDynamicObstaclesManager = std::make_shared<GaussianDynamicObstaclesManager>();
+    // whether to keep the planner's search tree between cycles
+    std::atomic<bool> m_WarmStart{false};
 
-    // start with no new map
-    std::shared_ptr<Map> m_NewMap = nullptr;
-    std::string m_CurrentMapPath = "";
-    std::mutex m_MapMutex;
+    // how many planners to run side by side each cycle
+    std::atomic<int> m_PortfolioSize{1};
+
+    // core to pin the plan loop to (-1 for none)
+    std::atomic<int> m_PlanningCore{-1};
 
     // hold onto the thread doing planning, for elegant error handling and shutdown I guess
     std::future<void> m_PlanningFuture;
@@ -157,12 +277,137 @@ private:
 
     double m_RadiusShrink = 0;
 
+    // where inputs are being recorded, if anywhere. Only ever accessed with the atomic shared_ptr functions
+    InputRecorder::SharedPtr m_Recorder;
+    // for the recording, and the latest of each setting (to start new recordings with)
+    std::mutex m_RecordingMutex;
+    std::string m_RecordingPath;
+    std::map<InputLog::Type, InputLog::Event> m_Settings;
+
+    // where the timeline's going, if anywhere
+    std::string m_TracePath;
+
+    // how many ribbons each plan gets (0 for all), and the order they're picked in. The order's only ever accessed
+    // with the atomic shared_ptr functions
+    std::atomic<int> m_LocalRibbons{0};
+    SurveyOrder::ConstSharedPtr m_SurveyOrder;
+    // version of the ribbons the last order was started on (plan loop only), and whether it's still being worked out
+    uint64_t m_SurveyOrderVersion = UINT64_MAX;
+    std::atomic<bool> m_OrderingSurvey{false};
+    // puts the survey in order in the background
+    LatestTaskWorker m_SurveyOrderer;
+
+    // sends plans to the controller when there's a timeout on the answer
+    LatestTaskWorker m_ControllerClient;
+
+    // gets maps that load lazily ready where the planner's about to look, so the plan loop doesn't wait on the reads
+    LatestTaskWorker m_MapFocuser;
+
+    // loads maps in the background, one at a time. Last so it goes (and waits for any load) before everything else
+    LatestTaskWorker m_MapLoader;
+
     static constexpr bool c_RadiusShrinkEnabled = false;
     static constexpr double c_RadiusShrinkAmount = 1e-6;
 
     static constexpr bool c_ReusePlanEnabled = true;
     static constexpr double c_CoverageHeadingRateMax = 0.1; // (in radians/sec)
     static constexpr double c_PlanningTimeSeconds = 0.85;
+    static constexpr size_t c_CoverageQueueSize = 1024;
+
+    /**
+     * Load a map and hand it to the plan loop, on the map loader's thread. Checks whether to give up every so often.
+     * @param request the key refreshMap made for this request
+     * @param pathToMapFile
+     * @param latitude
+     * @param longitude
+     * @param tiled
+     * @param residentRadius
+     * @param cancelled set once a newer request comes in
+     */
+    void loadMap(const std::string& request, const std::string& pathToMapFile, double latitude, double longitude,
+                 bool tiled, double residentRadius, const std::atomic<bool>& cancelled);
+
+    /**
+     * Write a freshly loaded map to the map cache, reporting (but otherwise ignoring) failures.
+     * @tparam T GridWorldMap or GeoTiffMap
+     * @param pathToMapFile
+     * @param map
+     */
+    template <class T>
+    void cacheMap(const std::string& pathToMapFile, const T& map);
+
+    /**
+     * Cover everything in the coverage queue and publish the ribbons. Takes m_CoverageMutex so it can be called from
+     * anywhere.
+     */
+    void drainCoverage();
+
+    /**
+     * Change the ribbons (after covering anything that's queued up, since those points came first) and publish them.
+     * @tparam F called with the ribbon manager
+     * @param f
+     */
+    template <class F>
+    void modifyRibbons(F f);
+
+    /**
+     * Start putting the survey in order again in the background if the ribbons have changed since the last time and
+     * the last one's finished.
+     * @param ribbons
+     * @param version
+     * @param x where the vessel's starting from
+     * @param y
+     */
+    void refreshSurveyOrder(std::shared_ptr<const RibbonManager> ribbons, uint64_t version, double x, double y);
+
+    /**
+     * Write an input to the recording, if there is one, and remember it if it's a setting.
+     * @param type
+     * @param values
+     * @param text
+     */
+    void record(InputLog::Type type, std::vector<double> values = {}, std::string text = "");
+
+    /**
+     * Same, for the inputs that come in all the time (positions, contacts, replies), so the values only get put in a
+     * vector when something's recording them.
+     * @param type
+     * @param value
+     * @param values
+     */
+    template <class... Values>
+    void record(InputLog::Type type, double value, Values... values) {
+        if (!InputLog::isSetting(type) && !std::atomic_load(&m_Recorder)) return;
+        record(type, std::vector<double>{value, (double)values...});
+    }
+
+    /**
+     * Record the controller's reply to a plan, and make sure this cycle's inputs have made it to the file.
+     * @param reply
+     */
+    void recordReply(const State& reply);
+
+    /**
+     * Send a plan to the controller and wait for the answer, timing it and recording the reply.
+     * @param plan
+     * @return the controller's reply
+     */
+    State callController(const DubinsPlan& plan);
+
+    /**
+     * Send a plan to the controller on the client thread, waiting only so long for the answer.
+     * @param plan
+     * @param timeout (s)
+     * @param reply set to the answer if it came in time
+     * @return whether it did
+     * @throws whatever publishPlan threw, if it came to that in time
+     */
+    bool callController(const DubinsPlan& plan, double timeout, State& reply);
+
+    /**
+     * Tell the planning thread to terminate, without counting it as an input. For when it stops itself.
+     */
+    void stopPlanner();
 
     /**
      * Make sure the threads can exit and kill the planner (if it's running).
@@ -174,6 +419,13 @@ private:
      */
     void planLoop();
 
+    /**
+     * Pin the calling thread to a core.
+     * @param core
+     * @return whether it worked (it only can on Linux)
+     */
+    static bool pinCurrentThread(int core);
+
     /**
      * Nothing provides the distributions for dynamic obstacles yet so the executive invents them.
      * @param obstacle
@@ -4,11 +4,14 @@
 #include "marine_msgs/Contact.h"
 #include "marine_msgs/NavEulerStamped.h"
 #include <vector>
+#include <thread>
+#include <memory>
 #include "project11/gz4d_geo.h"
 #include "path_planner/path_plannerAction.h"
 #include <project11_transformations/LatLongToMap.h>
 #include <geometry_msgs/PoseStamped.h>
 #include "executive/executive.h"
+#include "common/map/GridWorldMap.h"
 #include "trajectory_publisher.h"
 #include "NodeBase.h"
 #include <path_planner/path_plannerConfig.h>
@@ -27,15 +30,31 @@
 class PathPlanner final: public NodeBase, public TrajectoryPublisher
 {
 public:
-    explicit PathPlanner(std::string name): NodeBase(std::move(name))
+    /**
+     * @param name action server name
+     * @param vehicleNamespace namespace for the vehicle's topics, or empty for the only vehicle
+     * @param world map and contacts shared with the other vehicles in this process (null for the only vehicle)
+     * @param planningCore core for the planning thread, or -1 for any
+     * @param listenForContacts whether to subscribe to contacts (they're the same for everybody, so with a shared
+     * world only one vehicle needs to)
+     */
+    explicit PathPlanner(std::string name, std::string vehicleNamespace = "", SharedWorld::SharedPtr world = nullptr,
+                         int planningCore = -1, bool listenForContacts = true):
+        NodeBase(std::move(name), vehicleNamespace),
+        m_Dynamic_Reconfigure_Server(ros::NodeHandle(vehicleNamespace.empty() ? "~" : "~/" + vehicleNamespace))
 {
-    m_Executive = new Executive(this);
+    m_Executive = new Executive(this, world);
+    m_Executive->setPlanningCore(planningCore);
 
-    m_contact_sub = m_node_handle.subscribe("/contact", 10, &PathPlanner::contactCallback, this);
+    if (listenForContacts) {
+        // contacts just get queued up until the next cycle, so there's no harm in keeping around more of them
+        m_contact_sub = m_node_handle.subscribe("/contact", 100, &PathPlanner::contactCallback, this);
+    }
     m_origin_sub = m_node_handle.subscribe("/origin", 1, &PathPlanner::originCallback, this);
 
-    m_stats_pub = m_node_handle.advertise<path_planner_common::Stats>("/path_planner/stats", 1);
-    m_task_level_stats_pub = m_node_handle.advertise<path_planner_common::TaskLevelStats>("/path_planner/task_level_stats", 1);
+    m_stats_pub = m_node_handle.advertise<path_planner_common::Stats>(topic("/path_planner/stats"), 1);
+    m_task_level_stats_pub = m_node_handle.advertise<path_planner_common::TaskLevelStats>(
+            topic("/path_planner/task_level_stats"), 1);
 
     dynamic_reconfigure::Server<path_planner::path_plannerConfig>::CallbackType f;
     f = boost::bind(&PathPlanner::reconfigureCallback, this, _1, _2);
@@ -208,6 +227,15 @@ public:
     }
 
     void reconfigureCallback(path_planner::path_plannerConfig &config, uint32_t level) {
+        // first, so a new recording picks up the rest of these
+        m_Executive->setRecording(config.input_log);
+        m_Executive->setTracing(config.trace_file);
+        m_Executive->setMapTiling(config.tiled_map, config.map_resident_radius);
+        m_Executive->setPipelinedPlanning(config.pipelined_planning);
+        m_Executive->setControllerTimeout(config.controller_timeout);
+        m_Executive->setLocalRibbons(config.local_ribbons);
+        m_Executive->setWarmStart(config.warm_start);
+        m_Executive->setPortfolioSize(config.portfolio_size);
         m_Executive->refreshMap(config.planner_geotiff_map, m_origin.latitude, m_origin.longitude);
         m_Executive->setConfiguration(config.non_coverage_turning_radius, config.coverage_turning_radius,
                                       config.max_speed, config.slow_speed, config.line_width, config.branching_factor,
@@ -218,6 +246,8 @@ public:
                                       config.use_brown_paths,
                                       config.dynamic_obstacles == 1, config.ignore_dynamic_obstacles,
                                       config.use_potential_fields_planner);
+        m_Executive->setVisualizationFormat(config.binary_visualization, config.visualization_vertex_rate,
+                                            config.visualization_trajectory_rate);
         m_Executive->setPlannerVisualization(config.dump_visualization, config.visualization_file);
     }
 
@@ -278,110 +308,64 @@ public:
         m_display_pub.publish(geoVizItem);
     }
 
-    void displayMap(std::string path) override {
-        geographic_visualization_msgs::GeoVizItem geoVizItem;
-        geoVizItem.id = "GridWorldMap";
-
-        // publish empty map to hopefully wipe previous one
-        if (path.empty()) {
-            m_display_pub.publish(geoVizItem);
-            return;
+    void displayMap(std::shared_ptr<const GridWorldMap> map) override {
+        std::lock_guard<std::mutex> lock(m_MapDisplayMutex);
+        // the same map again just needs the message we already built
+        if (map != m_DisplayedMap || !map) {
+            m_DisplayedMap = map;
+            m_MapDisplay = geographic_visualization_msgs::GeoVizItem();
+            m_MapDisplay.id = "GridWorldMap";
+            // an empty item hopefully wipes the previous map
+            if (map) buildMapDisplay(*map, m_MapDisplay);
         }
+        m_display_pub.publish(m_MapDisplay);
+    }
 
-        // parse map file
-        std::ifstream infile(path);
-        std::string line;
-        std::vector<std::string> lines;
-        int cols = -1, rows = 0;
-        double resolution;
-        try {
-            std::getline(infile, line);
-            std::istringstream s(line);
-            s >> resolution;
-            while (std::getline(infile, line)) {
-                if (cols == -1) cols = line.length();
-                else if (line.length() < cols) cols = line.length();
-                rows++;
-                lines.push_back(line);
-            }
-        } catch (...) {
-            std::cerr << "Error loading map for display. Ignoring" << std::endl;
-            m_display_pub.publish(geoVizItem);
-            return;
-        }
-        if (lines.empty()) {
-            m_display_pub.publish(geoVizItem);
-            return;
-        }
-        std::reverse(lines.begin(), lines.end());
-
-        // add squares of appropriate size at blocked coordinates
-        for (int y = 0; y < rows; y++) {
-            for (int x = 0; x < cols; x++) {
-                if (lines[y][x] == '#') {
-//                    std::cerr << "Adding blocked square to the map" << std::endl;
-                    geographic_visualization_msgs::GeoVizPolygon polygon;
-                    geographic_visualization_msgs::GeoVizSimplePolygon simplePolygon;
-                    auto xCoord = x * resolution; auto yCoord = y * resolution;
-                    auto bottomLeft = convertToLatLong(State(xCoord, yCoord, 0, 0, 0));
-                    auto bottomRight = convertToLatLong(State(xCoord + resolution, yCoord, 0, 0, 0));
-                    auto topLeft = convertToLatLong(State(xCoord, yCoord + resolution, 0, 0, 0));
-                    auto topRight = convertToLatLong(State(xCoord + resolution, yCoord + resolution, 0, 0, 0));
-                    simplePolygon.points.push_back(topRight); simplePolygon.points.push_back(topLeft);
-                    simplePolygon.points.push_back(bottomLeft); simplePolygon.points.push_back(bottomRight);
-                    polygon.outer = simplePolygon;
-                    polygon.edge_color.a = 0.5;
-                    polygon.edge_color.r = 0;
-                    polygon.edge_color.g = 0;
-                    polygon.edge_color.b = 0;
-                    polygon.fill_color = polygon.edge_color;
-                    geoVizItem.polygons.push_back(polygon);
-                }
-            }
+    /**
+     * Draw a grid world map as merged rectangles of blocked cells (a polygon per cell is far too many on big maps)
+     * and a boundary.
+     * @param map
+     * @param geoVizItem
+     */
+    void buildMapDisplay(const GridWorldMap& map, geographic_visualization_msgs::GeoVizItem& geoVizItem) {
+        auto resolution = map.resolution();
+        for (const auto& r : map.grid().blockedRectangles()) {
+            geographic_visualization_msgs::GeoVizPolygon polygon;
+            geographic_visualization_msgs::GeoVizSimplePolygon simplePolygon;
+            auto x1 = r.Col * resolution, y1 = r.Row * resolution;
+            auto x2 = (r.Col + r.Cols) * resolution, y2 = (r.Row + r.Rows) * resolution;
+            simplePolygon.points.push_back(convertToLatLong(State(x2, y2, 0, 0, 0)));
+            simplePolygon.points.push_back(convertToLatLong(State(x1, y2, 0, 0, 0)));
+            simplePolygon.points.push_back(convertToLatLong(State(x1, y1, 0, 0, 0)));
+            simplePolygon.points.push_back(convertToLatLong(State(x2, y1, 0, 0, 0)));
+            polygon.outer = simplePolygon;
+            polygon.edge_color.a = 0.5;
+            polygon.edge_color.r = 0;
+            polygon.edge_color.g = 0;
+            polygon.edge_color.b = 0;
+            polygon.fill_color = polygon.edge_color;
+            geoVizItem.polygons.push_back(polygon);
         }
 
         // add boundary lines
+        auto width = resolution * map.grid().cols(), height = resolution * map.grid().rows();
         auto bottomLeft = convertToLatLong(State(0, 0, 0, 0, 0));
-        auto bottomRight = convertToLatLong(State(resolution * lines[0].size(), 0, 0, 0, 0));
-        auto topRight = convertToLatLong(State(resolution * lines[0].size(), resolution * lines.size(), 0, 0, 0));
-        auto topLeft = convertToLatLong(State(0, resolution * lines.size(), 0, 0, 0));
-
-        geographic_visualization_msgs::GeoVizPointList bottom, right, top, left;
-        bottom.points.push_back(bottomLeft); bottom.points.push_back(bottomRight);
-        bottom.size = 5;
-        bottom.color.r = 0;
-        bottom.color.g = 0;
-        bottom.color.b = 0;
-        bottom.color.a = 1;
-
-        right.points.push_back(topRight); right.points.push_back(bottomRight);
-        right.size = 5;
-        right.color.r = 0;
-        right.color.g = 0;
-        right.color.b = 0;
-        right.color.a = 1;
-
-        top.points.push_back(topLeft); top.points.push_back(topRight);
-        top.size = 5;
-        top.color.r = 0;
-        top.color.g = 0;
-        top.color.b = 0;
-        top.color.a = 1;
-
-        left.points.push_back(bottomLeft); left.points.push_back(topLeft);
-        left.size = 5;
-        left.color.r = 0;
-        left.color.g = 0;
-        left.color.b = 0;
-        left.color.a = 1;
-
-        geoVizItem.lines.push_back(bottom);
-        geoVizItem.lines.push_back(right);
-        geoVizItem.lines.push_back(top);
-        geoVizItem.lines.push_back(left);
-
-        // publish
-        m_display_pub.publish(geoVizItem);
+        auto bottomRight = convertToLatLong(State(width, 0, 0, 0, 0));
+        auto topRight = convertToLatLong(State(width, height, 0, 0, 0));
+        auto topLeft = convertToLatLong(State(0, height, 0, 0, 0));
+
+        std::pair<geographic_msgs::GeoPoint, geographic_msgs::GeoPoint> sides[] = {{bottomLeft, bottomRight},
+                {topRight, bottomRight}, {topLeft, topRight}, {bottomLeft, topLeft}};
+        for (const auto& side : sides) {
+            geographic_visualization_msgs::GeoVizPointList line;
+            line.points.push_back(side.first); line.points.push_back(side.second);
+            line.size = 5;
+            line.color.r = 0;
+            line.color.g = 0;
+            line.color.b = 0;
+            line.color.a = 1;
+            geoVizItem.lines.push_back(line);
+        }
     }
 
     void publishStats(const Planner::Stats& stats, double collisionPenalty, unsigned long cpuTime,
@@ -403,6 +387,21 @@ public:
         statsMsg.collision_penalty = collisionPenalty;
         statsMsg.cpu_time = cpuTime;
         statsMsg.last_plan_achievable = lastPlanAchievable;
+        statsMsg.controller_round_trip = stats.ControllerRoundTrip;
+        if (Profiler::c_Enabled) {
+            for (int p = 0; p < Profiler::PhaseCount; p++) {
+                statsMsg.phase_names.push_back(Profiler::phaseName((Profiler::Phase)p));
+                statsMsg.phase_wall_time.push_back(stats.Profile[p].WallTime);
+                statsMsg.phase_cpu_time.push_back(stats.Profile[p].CpuTime);
+                statsMsg.phase_calls.push_back(stats.Profile[p].Calls);
+            }
+            for (int o = 0; o < Profiler::ObjectCount; o++) {
+                statsMsg.object_names.push_back(Profiler::objectName((Profiler::Object)o));
+                statsMsg.object_allocations.push_back(stats.Allocations[o].Allocations);
+                statsMsg.object_copies.push_back(stats.Allocations[o].Copies);
+                statsMsg.object_bytes.push_back(stats.Allocations[o].Bytes);
+            }
+        }
         m_stats_pub.publish(statsMsg);
     }
 
@@ -435,6 +434,11 @@ private:
 
     bool m_Paused = false;
 
+    // display message for the last map shown, built once when it loads
+    std::mutex m_MapDisplayMutex;
+    std::shared_ptr<const GridWorldMap> m_DisplayedMap;
+    geographic_visualization_msgs::GeoVizItem m_MapDisplay;
+
     bool m_CurrentGoalIsValid = false;
 
     // handle on Executive
@@ -447,7 +451,28 @@ int main(int argc, char **argv)
 {
     std::cerr << "Starting planner node" << std::endl;
     ros::init(argc, argv, "path_planner");
-    PathPlanner pp("path_planner_action");
+
+    // A list of vehicle namespaces means planning for all of them from here, with one map and one set of contacts
+    // between them. Each gets its own ribbons, planner and planning thread (on its own core if there are enough).
+    std::vector<std::string> vehicles;
+    ros::NodeHandle("~").getParam("vehicles", vehicles);
+    if (vehicles.empty()) {
+        PathPlanner pp("path_planner_action");
+        ros::spin();
+        return 0;
+    }
+
+    auto world = std::make_shared<SharedWorld>();
+    auto cores = (int)std::thread::hardware_concurrency();
+    std::vector<std::unique_ptr<PathPlanner>> planners;
+    for (size_t i = 0; i < vehicles.size(); i++) {
+        std::cerr << "Planning for vehicle " << vehicles[i] << std::endl;
+        // leave the first core for callbacks
+        auto core = (int)i + 1 < cores ? (int)i + 1 : -1;
+        planners.emplace_back(new PathPlanner("path_planner_action", vehicles[i], world, core, i == 0));
+    }
+    // callbacks all run here, one at a time, like they do for one vehicle; the planning is what takes the time and
+    // that's on each executive's own thread
     ros::spin();
 
     return 0;
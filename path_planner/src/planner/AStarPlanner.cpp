@@ -1,8 +1,16 @@
 #include "AStarPlanner.h"
 #include <utility>
+#include <sstream>
+#include <unordered_map>
+#include "utilities/Tracer.h"
+#include "search/CheckedPlan.h"
 
 using std::shared_ptr;
 
+AStarPlanner::AStarPlanner() {
+    m_UseOpenList = true;
+}
+
 std::function<bool(shared_ptr<Vertex> v1, shared_ptr<Vertex> v2)> AStarPlanner::getVertexComparator() {
     return [] (const shared_ptr<Vertex>& v1, const shared_ptr<Vertex>& v2) {
         return v1->f() > v2->f();
@@ -11,17 +19,28 @@ std::function<bool(shared_ptr<Vertex> v1, shared_ptr<Vertex> v2)> AStarPlanner::
 
 Planner::Stats AStarPlanner::plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
                               const DubinsPlan& previousPlan, double timeRemaining) {
+    Tracer::Span span("plan");
     m_Config = std::move(config); // gotta do this before we can call now()
     double endTime = timeRemaining + now();
     m_Config.setStartStateTime(start.time());
     m_RibbonManager = ribbonManager;
     m_RibbonManager.changeHeuristicIfTooManyRibbons(); // make sure ribbon heuristic is calculable
+    m_RibbonManager.precomputeDistances(); // so vertices only work out their own distances to the ribbons
     if (m_RibbonManager.done()) m_RibbonManager.setCoverageCompletedTime(start.time());
     m_Stats = Stats();
+    // everything done for this plan, here and on the worker pool, counts towards its profile
+    Profiler profiler;
+    Profiler::Attach attachProfiler(&profiler);
+    auto cpuStart = Profiler::threadCpuTime();
+    // before it gets swapped for a projection, so it's comparable between plans
+    auto obstacles = m_Config.obstaclesManagerPtr();
+    setUpDubinsCache();
+    setUpHeuristicCache();
+    setUpObstacleProjection();
 //    m_ExpandedCount = 0;
     m_IterationCount = 0;
     m_StartStateTime = start.time();
-    m_Samples.clear();
+    clearSamples();
     m_AttemptedSamples = 0;
     double minX, maxX, minY, maxY, minSpeed = m_Config.maxSpeed(), maxSpeed = m_Config.maxSpeed();
     double magnitude = m_Config.maxSpeed() * m_Config.timeHorizon();
@@ -30,8 +49,16 @@ Planner::Stats AStarPlanner::plan(const RibbonManager& ribbonManager, const Stat
     maxX = fmin(start.x() + magnitude, mapExtremes[1]);
     minY = fmax(start.y() - magnitude, mapExtremes[2]);
     maxY = fmin(start.y() + magnitude, mapExtremes[3]);
-    auto seed = (unsigned long)endTime; // for different results each time. For consistency, use like 7 or something
+    setUpObstacleRaster(minX, maxX, minY, maxY);
+    // the map and obstacles are settled for this plan now, so the edges can all use the sweep compiled for them
+    m_Config.setEdgeSweep(Edge::pickSweep(m_Config));
+    const SamplePool::Window window(minX, maxX, minY, maxY);
+    takePooledSamples(window);
+    // for different results each time, unless we're asked for consistency
+    auto seed = (m_Config.sampleSeed() >= 0 ? (unsigned long)m_Config.sampleSeed() : (unsigned long)endTime) +
+                m_SeedOffset;
     StateGenerator generator = StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, seed, m_RibbonManager); // lucky seed
+    if (m_Config.useHaltonSamples()) generator.setSequence(StateGenerator::Sequence::Halton);
     auto startV = Vertex::makeRoot(start, m_RibbonManager);
     startV->state().speed() = m_Config.maxSpeed();
     startV->computeApproxToGo(m_Config);
@@ -42,74 +69,108 @@ Planner::Stats AStarPlanner::plan(const RibbonManager& ribbonManager, const Stat
         brownPathSamples = m_RibbonManager.findNearStatesOnRibbons(start, m_Config.coverageTurningRadius());
     }
 
-    // collision check old plan
+    // collision check old plan (only the parts that might have changed, if we know what it was checked against)
+    const auto& checkedPlan = m_Config.checkedPlan();
     Vertex::SharedPtr lastPlanEnd = startV;
+    std::vector<Vertex::SharedPtr> planVertices{startV};
     if (!previousPlan.empty()) {
         for (const auto& p : previousPlan.get()) {
             if (p.getEndTime() <= start.time()) continue;
             if (p.getNetTime() == 0) continue; // There is sometimes a zero length edge at the end. Not sure why
-            lastPlanEnd = Vertex::connect(lastPlanEnd, p, p.getRho() == m_Config.coverageTurningRadius());
-            lastPlanEnd->parentEdge()->computeTrueCost(m_Config);
+            const bool coverageAllowed = p.getRho() == m_Config.coverageTurningRadius();
+            auto checked = checkedPlan ?
+                    checkedPlan->find(p, *lastPlanEnd, coverageAllowed, m_Config, obstacles) : nullptr;
+            lastPlanEnd = Vertex::connect(lastPlanEnd, p, coverageAllowed);
+            m_Stats.PreviousPlanEdges++;
+            if (checked) {
+                lastPlanEnd->parentEdge()->adoptTrueCost(*checked->parentEdge(), m_Config);
+                m_Stats.PreviousPlanReused++;
+            } else {
+                lastPlanEnd->parentEdge()->computeTrueCost(m_Config);
+            }
             if (lastPlanEnd->parentEdge()->infeasible()) {
                 lastPlanEnd = startV;
                 break;
             }
+            planVertices.push_back(lastPlanEnd);
             if (goalCondition(lastPlanEnd)) break;
         }
     }
+    if (m_Config.warmStart()) {
+        carryOverTree(planVertices, obstacles);
+    } else {
+        m_WarmTree.clear();
+        m_CarriedVertices.clear();
+    }
+    m_IterationTree.clear();
+    m_NextWarmTree.clear();
     // big loop
-    while (now() < endTime) {
-        clearVertexQueue();
-        if (m_BestVertex && m_BestVertex->f() <= startV->f()) {
+    m_ExpandedVertices.clear();
+    const bool incremental = m_Config.incrementalSearch();
+    const auto maxIterations = m_Config.maxIterations();
+    while (now() < endTime && (maxIterations <= 0 || m_Stats.Iterations < (unsigned long)maxIterations)) {
+        Tracer::Span iteration("iteration");
+        // In incremental mode the tree (and open list) carries over between iterations, so we only start over once
+        const bool freshTree = !incremental || m_Stats.Iterations == 0;
+        if (freshTree) {
+            clearVertexQueue();
+            // the last iteration's tree is gone (apart from the incumbent's branch) so start a fresh arena
+            if (m_Config.useSearchArena()) m_Arena = acquireArena();
+        }
+        if ((m_BestVertex && m_BestVertex->f() <= startV->f()) ||
+            (m_SharedIncumbent && m_SharedIncumbent->f() <= startV->f())) {
             *m_Config.output() << "Found best possible plan, assuming heuristic admissibility" << std::endl;
             break;
         }
         visualizeVertex(startV, "start", false);
 
         if (m_Config.visualizations()) {
-            // copied here for debugging but it's necessary for visualizing the previous plan
-            lastPlanEnd = startV;
-            if (!previousPlan.empty()) {
-                for (const auto& p : previousPlan.get()) {
-                    if (p.getEndTime() <= start.time()) continue;
-                    if (p.getNetTime() == 0) continue; // just trying this I guess
-                    lastPlanEnd = Vertex::connect(lastPlanEnd, p, p.getRho() == m_Config.coverageTurningRadius());
-                    lastPlanEnd->parentEdge()->computeTrueCost(m_Config);
-                    lastPlanEnd->computeApproxToGo(m_Config);
-                    visualizeVertex(lastPlanEnd, "lastPlanEnd", false);
-                    if (lastPlanEnd->parentEdge()->infeasible()) {
-                        lastPlanEnd = startV;
-                        break;
-                    }
-                    if (goalCondition(lastPlanEnd)) break;
-                }
-            }
+            // the previous plan as it was checked above, rather than sweeping it all again
+            for (size_t i = 1; i < planVertices.size(); i++) visualizeVertex(planVertices[i], "lastPlanEnd", false);
         }
 
-        if (m_Config.visualizations()) {
-            m_Config.visualizationStream() << "Incumbent f-value: " << (m_BestVertex? m_BestVertex->f() : 0) << std::endl;
-            m_Config.visualizationStream() << m_RibbonManager.dumpRibbons() << "End Ribbons" << std::endl;
+        if (m_Config.visualizations() && m_Config.visualizer().sample(Visualizer::Notes)) {
+            std::ostringstream incumbent;
+            incumbent << "Incumbent f-value: " << (m_BestVertex? m_BestVertex->f() : 0);
+            m_Config.visualizer().note(incumbent.str());
+            m_Config.visualizer().note(m_RibbonManager.dumpRibbons() + "End Ribbons");
         }
-        pushVertexQueue(startV);
-        if (lastPlanEnd != startV) pushVertexQueue(lastPlanEnd);
-        // manually expand starting node to include states on nearby ribbons far enough away such that the boat doesn't
-        // have to loop around
+        if (freshTree) {
+            m_IterationTree.clear();
+            pushVertexQueue(startV);
+            if (lastPlanEnd != startV) pushVertexQueue(lastPlanEnd);
+            for (const auto& carried : m_CarriedVertices) pushVertexQueue(carried);
+            // manually expand starting node to include states on nearby ribbons far enough away such that the boat
+            // doesn't have to loop around
 
-//        expandToCoverSpecificSamples(startV, ribbonSamples, m_Config.obstacles(), true);
-        expandToCoverSpecificSamples(startV, brownPathSamples, m_Config.obstaclesManager(), true);
+//            expandToCoverSpecificSamples(startV, ribbonSamples, m_Config.obstacles(), true);
+            expandToCoverSpecificSamples(startV, brownPathSamples, m_Config.obstaclesManager(), true);
+        } else {
+            // everything we expanded last time needs to be connected to the new samples
+            for (const auto& expanded : m_ExpandedVertices) {
+                if (expanded->replaced()) continue;
+                if (m_BestVertex && expanded->f() >= m_BestVertex->f()) continue;
+                requeueVertex(expanded);
+            }
+            m_ExpandedVertices.clear();
+        }
         // On the first iteration add initialSamples samples, otherwise just double them
         if (m_Samples.size() < m_Config.initialSamples()) addSamples(generator, m_Config.initialSamples());
         else addSamples(generator); // double samples (BIT* linearly increases them...)
         // visualize all samples each iteration
-        if (m_Config.visualizations()) {
-            for (const auto& s : m_Samples)
-                m_Config.visualizationStream() << "State: (" << s.toStringRad() << "), f: " << 0 << ", g: " << 0 << ", h: " <<
-                                           0 << " sample" << std::endl;
+        if (m_Config.visualizations() && m_Config.visualizer().sample(Visualizer::Samples)) {
+            for (size_t i = 0; i < m_Samples.size(); i++) {
+                m_Config.visualizer().state(m_Samples.state(i), 0, 0, 0, Visualizer::SampleState);
+            }
         }
+        iteration.setArg("samples", m_Samples.size());
         auto v = aStar(m_Config.obstaclesManager(), endTime);
         if (!m_BestVertex || (v && v->f() + 0.0 < m_BestVertex->f())) { // add fudge factor to favor earlier (simpler) plans
             // found a (better) plan
             m_BestVertex = v;
+            if (v && m_SharedIncumbent) m_SharedIncumbent->offer(v->f());
+            // this iteration's tree has the new plan's branch in it, so it's the one to build on next time
+            if (v && m_Config.warmStart()) m_NextWarmTree = m_IterationTree;
             if (v && m_Config.visualizations()) {
                 visualizePlan(tracePlan(v, false, m_Config.obstaclesManager()));
                 visualizeVertex(v, "goal", false);
@@ -119,6 +180,7 @@ Planner::Stats AStarPlanner::plan(const RibbonManager& ribbonManager, const Stat
     }
     // Add expected final cost, total accrued cost (not here)
     m_Stats.Samples = m_Samples.size();
+    keepSamples(window);
     if (!m_BestVertex) {
         *m_Config.output() << "Failed to find a plan" << std::endl;
     } else {
@@ -128,18 +190,67 @@ Planner::Stats AStarPlanner::plan(const RibbonManager& ribbonManager, const Stat
         m_Stats.PlanHValue = m_BestVertex->approxToGo();
         m_Stats.Plan = std::move(tracePlan(m_BestVertex, false, m_Config.obstaclesManager()));
     }
+    if (checkedPlan) {
+        if (m_BestVertex) checkedPlan->record(m_BestVertex, m_Config, obstacles);
+        else checkedPlan->clear();
+    }
+    recordDubinsCacheStats();
+    recordHeuristicCacheStats();
+    m_DubinsCache = nullptr;
+    m_Arena = nullptr;
+    m_ExpandedVertices.clear();
+    m_CarriedVertices.clear();
+    if (m_Config.warmStart()) {
+        m_WarmTree = std::move(m_NextWarmTree);
+        m_WarmObstacles = obstacles;
+        m_WarmMap = m_Config.map();
+    }
+    m_IterationTree.clear();
+    m_NextWarmTree.clear();
+    m_Stats.CpuTime = Profiler::threadCpuTime() - cpuStart;
+    m_Stats.Profile = profiler.report();
+    m_Stats.Allocations = profiler.allocations();
     return m_Stats;
 }
 
 shared_ptr<Vertex> AStarPlanner::aStar(const DynamicObstaclesManager& obstacles, double endTime) {
+    Tracer::Span span("aStar");
+    if (vertexQueueEmpty()) return Vertex::SharedPtr(nullptr);
     auto vertex = popVertexQueue();
     while (now() < endTime) {
-        // relying on the filter on the vertex queue to give us a better goal
-        if (goalCondition(vertex)) {
-            visualizeVertex(vertex, "vertex", false);
-            return vertex;
+        if (m_Config.incrementalSearch()) {
+            // The open list outlives the incumbent here, so it can hold stuff that's worse than it. The list is in f
+            // order, so once we hit that there's nothing more to be found this iteration.
+            if (m_BestVertex && vertex->f() >= m_BestVertex->f()) {
+                clearVertexQueue();
+                return Vertex::SharedPtr(nullptr);
+            }
+        }
+        if (!vertex->evaluated()) {
+            // lazy search - now it's worth sweeping the edge
+            auto lazyF = vertex->f();
+            vertex->parentEdge()->computeTrueCost(m_Config);
+            m_Stats.EdgesEvaluated++;
+            if (vertex->parentEdge()->infeasible()) {
+                vertex = nullptr;
+            } else if (vertex->f() > lazyF) {
+                // turned out worse than we thought, so it goes back in line (if it's still better than the incumbent)
+                if (!m_BestVertex || vertex->f() < m_BestVertex->f()) requeueVertex(vertex);
+                vertex = nullptr;
+            }
+        }
+        if (vertex && !vertex->replaced()) {
+            // relying on the filter on the vertex queue to give us a better goal
+            if (goalCondition(vertex)) {
+                visualizeVertex(vertex, "vertex", false);
+                return vertex;
+            }
+            expand(vertex, obstacles);
+            if (m_Config.incrementalSearch()) m_ExpandedVertices.push_back(vertex);
+            if (m_Config.warmStart() && m_IterationTree.size() < c_MaxWarmStartVertices) {
+                m_IterationTree.push_back(vertex);
+            }
         }
-        expand(vertex, obstacles);
 
         if (vertexQueueEmpty()) return Vertex::SharedPtr(nullptr);
         vertex = popVertexQueue();
@@ -147,13 +258,61 @@ shared_ptr<Vertex> AStarPlanner::aStar(const DynamicObstaclesManager& obstacles,
     return shared_ptr<Vertex>(nullptr);
 }
 
+void AStarPlanner::carryOverTree(const std::vector<Vertex::SharedPtr>& planVertices,
+                                 const DynamicObstaclesManager::ConstSharedPtr& obstacles) {
+    m_CarriedVertices.clear();
+    auto oldTree = std::move(m_WarmTree);
+    m_WarmTree.clear();
+    if (oldTree.empty()) return;
+    const bool sameSurroundings = obstacles == m_WarmObstacles && m_Config.map() == m_WarmMap;
+    // old vertex -> its stand-in in the new tree
+    std::unordered_map<const Vertex*, Vertex::SharedPtr> carried;
+    auto standIn = [&](const Vertex::SharedPtr& v) -> Vertex::SharedPtr {
+        auto it = carried.find(v.get());
+        if (it != carried.end()) return it->second;
+        // matching the previous plan exactly, so the states are the same
+        for (const auto& p : planVertices) {
+            if (p->state().time() == v->state().time() && p->state().x() == v->state().x() &&
+                p->state().y() == v->state().y()) {
+                carried[v.get()] = p;
+                return p;
+            }
+        }
+        return nullptr;
+    };
+    for (const auto& v : oldTree) {
+        // on the previous plan, so it's already in the tree
+        if (standIn(v)) continue;
+        if (v->isRoot()) continue;
+        auto newParent = standIn(v->parent());
+        // branched off in the past (or from something that did), or from something whose cost isn't known yet, whose
+        // children get made again anyway when it's expanded
+        if (!newParent || !newParent->evaluated()) continue;
+        const auto& oldEdge = *v->parentEdge();
+        auto vertex = Vertex::connect(newParent, oldEdge.getPlan(m_Config), v->coverageAllowed());
+        const auto& oldRibbons = v->parent()->ribbonManager();
+        if (sameSurroundings && oldRibbons.sameRibbonsAs(newParent->ribbonManager()) &&
+            oldRibbons.coverageCompletedTime() == newParent->ribbonManager().coverageCompletedTime()) {
+            vertex->parentEdge()->adoptTrueCost(oldEdge, m_Config);
+            m_Stats.WarmStartReused++;
+        } else {
+            vertex->setLazyCost(m_Config);
+        }
+        carried[v.get()] = vertex;
+        m_CarriedVertices.push_back(vertex);
+    }
+    m_Stats.WarmStartVertices = m_CarriedVertices.size();
+}
+
 void AStarPlanner::expandToCoverSpecificSamples(Vertex::SharedPtr root, const std::vector<State>& samples,
                                                 const DynamicObstaclesManager& obstacles, bool coverageAllowed) {
     if (m_Config.coverageTurningRadius() > 0) {
         for (auto s : samples) {
             for (const auto& speed : {m_Config.maxSpeed(), m_Config.slowSpeed()}) {
                 s.speed() = speed;
-                auto destinationVertex = Vertex::connect(root, s, m_Config.coverageTurningRadius(), coverageAllowed);
+                auto destinationVertex = Vertex::connect(root, s, m_Config.coverageTurningRadius(), coverageAllowed,
+                                                         m_Arena);
+                destinationVertex->parentEdge()->computeApproxCost(m_DubinsCache);
                 destinationVertex->parentEdge()->computeTrueCost(m_Config);
                 pushVertexQueue(destinationVertex);
             }
@@ -12,16 +12,41 @@ public:
     /**
      * Construct an AStarPlanner.
      */
-    AStarPlanner() = default;
+    AStarPlanner();
 
     ~AStarPlanner() override = default;
 
     Stats plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
                     const DubinsPlan& previousPlan, double timeRemaining) override;
 
+    /**
+     * Offset the seed for the sample generator, so planners running side by side don't all draw the same samples.
+     * @param seedOffset
+     */
+    void setSeedOffset(unsigned long seedOffset) { m_SeedOffset = seedOffset; }
+
 protected:
     int m_IterationCount = 0;
+    unsigned long m_SeedOffset = 0;
+
+    // incremental search: vertices expanded so far this iteration, to be re-expanded towards the next batch of samples
+    std::vector<Vertex::SharedPtr> m_ExpandedVertices;
+
+    // warm start: the vertices expanded in the iteration that found the last plan (parents before children), and the
+    // map and obstacles their edges were evaluated against. Also the ones expanded so far this iteration, and, for
+    // next time, the ones from this plan's best iteration
+    std::vector<Vertex::SharedPtr> m_WarmTree, m_IterationTree, m_NextWarmTree;
+    DynamicObstaclesManager::ConstSharedPtr m_WarmObstacles;
+    Map::SharedPtr m_WarmMap;
+    // what's left of that tree, hanging off this plan's tree
+    std::vector<Vertex::SharedPtr> m_CarriedVertices;
+
+    static constexpr size_t c_MaxWarmStartVertices = 10000;
 
+    /**
+     * Only used if the open list is turned off - plain A* uses the OpenList, which orders by f the same way.
+     * @return
+     */
     std::function<bool(std::shared_ptr<Vertex> v1, std::shared_ptr<Vertex> v2)> getVertexComparator() override;
 
     /**
@@ -32,6 +57,18 @@ protected:
      */
     std::shared_ptr<Vertex> aStar(const DynamicObstaclesManager& obstacles, double endTime);
 
+    /**
+     * Warm start: re-root what's left of the last plan's tree onto this one. Vertices in the new tree along the previous
+     * plan stand in for the matching ones in the old tree, and the old vertices descended from those get rebuilt
+     * underneath them (into m_CarriedVertices). Anything that branched off before the new start is in the past and goes
+     * away. Edges keep their costs if nothing they depend on (the ribbons at their start, the map and the obstacles)
+     * has changed; the rest are left for lazy evaluation.
+     * @param planVertices vertices of the new tree along the previous plan, starting with the root
+     * @param obstacles the obstacles this plan was given
+     */
+    void carryOverTree(const std::vector<Vertex::SharedPtr>& planVertices,
+                       const DynamicObstaclesManager::ConstSharedPtr& obstacles);
+
     /**
      * Specifically expand root to connect to the given samples.
      * @param root
@@ -8,6 +8,7 @@
 #include "search/Vertex.h"
 #include <path_planner_common/DubinsPlan.h>
 #include "PlannerConfig.h"
+#include "utilities/Profiler.h"
 
 /**
  * Interface to represent all planners. This might not have been really necessary but when I ported everything to C++
@@ -18,20 +19,44 @@ class Planner {
 public:
     /**
      * Hold all the stats for the planner.
-     *
-     * TODO! -- CPU time?
      */
     struct Stats {
         unsigned long Samples;
         unsigned long Generated;
+        // samples carried over from the last plan instead of being made again
+        unsigned long ReusedSamples;
         unsigned long Expanded;
         unsigned long Iterations;
+        // vertices that landed in a closed list cell with the same ribbons as one already there (one of the two got
+        // dropped)
+        unsigned long Dominated;
+        // memory bounded search: vertices dropped from the open list to stay under the budget, how many got made again
+        // when their parents came back off it, and the most the search tree took up at any point (bytes, roughly,
+        // whether or not there's a budget)
+        unsigned long Forgotten, Regenerated;
+        size_t PeakSearchMemory;
+        unsigned long EdgesEvaluated; // edges that got the full collision and coverage sweep
+        unsigned long DubinsCacheHits, DubinsCacheMisses;
+        double DubinsCacheHitRate;
+        unsigned long HeuristicCacheHits, HeuristicCacheMisses;
+        // warm start: vertices carried over from the last plan's tree, and how many of those kept their edge costs
+        unsigned long WarmStartVertices, WarmStartReused;
+        // edges of the previous plan checked again, and how many of those kept their costs from last time
+        unsigned long PreviousPlanEdges, PreviousPlanReused;
         double PlanFValue;
         double PlanCollisionPenalty = 0;
         double PlanTimePenalty;
         double PlanHValue;
         unsigned long PlanDepth;
         DubinsPlan Plan;
+        // CPU time the planning thread spent on this plan (s)
+        double CpuTime = 0;
+        // how long the controller took to answer the last plan it answered (s; the executive fills this in)
+        double ControllerRoundTrip = 0;
+        // where the time went, by phase (all zeros unless built with profiling)
+        Profiler::Report Profile;
+        // what got made and copied, by kind of object (also all zeros unless built with profiling)
+        Profiler::Allocations Allocations;
     };
 
     Planner();
@@ -7,6 +7,13 @@
 #include "../common/map//Map.h"
 #include "../common/dynamic_obstacles/DynamicObstaclesManager1.h"
 #include "../common/dynamic_obstacles/DynamicObstaclesManager.h"
+#include "search/DubinsCache.h"
+#include "utilities/HeuristicCache.h"
+#include "utilities/SamplePool.h"
+
+// the last plan's edges, which need Vertex (and so this)
+class CheckedPlan;
+class Edge;
 
 /**
  * Class that holds all the configurations for the planner. These need to get passed around periodically so it was
@@ -14,6 +21,9 @@
  */
 class PlannerConfig {
 public:
+    // an edge collision and coverage sweep compiled for a particular kind of map and obstacles (see Edge::pickSweep)
+    typedef double (*EdgeSweep)(Edge& edge, PlannerConfig& config);
+
 
     explicit PlannerConfig(std::ostream* output) : m_Output(output) {}
 
@@ -65,10 +75,10 @@ public:
         m_Visualizations = visualizations;
     }
 
-    std::ostream& visualizationStream() const {
-        assert(m_Visualizations && "Visualization stream accessed when visualizations are disabled");
+    Visualizer& visualizer() const {
+        assert(m_Visualizations && "Visualizer accessed when visualizations are disabled");
 //        assert(m_VisualizationStream && *m_VisualizationStream && "Visualization stream accessed but does not exist");
-        return (*m_Visualizer)->stream();
+        return **m_Visualizer;
     }
 
     void setVisualizationStream(std::ostream** visualizationStream) {
@@ -85,6 +95,8 @@ public:
 
     void setMap(const Map::SharedPtr& map) {
         m_Map = map;
+        // might not be the kind it was for any more
+        m_EdgeSweep = nullptr;
     }
 
     const DynamicObstaclesManager1& obstacles() const {
@@ -99,8 +111,41 @@ public:
         return *m_ObstaclesManager;
     }
 
-    void setObstaclesManager(DynamicObstaclesManager::SharedPtr obstaclesManager) {
+    DynamicObstaclesManager::ConstSharedPtr obstaclesManagerPtr() const {
+        return m_ObstaclesManager;
+    }
+
+    void setObstaclesManager(DynamicObstaclesManager::ConstSharedPtr obstaclesManager) {
         m_ObstaclesManager = obstaclesManager;
+        m_EdgeSweep = nullptr;
+        m_ObstacleProjection = nullptr;
+    }
+
+    /**
+     * The obstacles manager's precompute() over the planning horizon, if somebody's already done it (like the
+     * executive, once a cycle for however many planners), so precomputing obstacles doesn't do it again. It gets
+     * forgotten when the obstacles manager changes.
+     * @return null if it hasn't been done
+     */
+    DynamicObstaclesManager::ConstSharedPtr obstacleProjection() const {
+        return m_ObstacleProjection;
+    }
+
+    void setObstacleProjection(DynamicObstaclesManager::ConstSharedPtr obstacleProjection) {
+        m_ObstacleProjection = std::move(obstacleProjection);
+    }
+
+    /**
+     * The edge sweep to use for the current map and obstacles. It gets forgotten when either changes; if it isn't set
+     * each edge picks for itself.
+     * @return
+     */
+    EdgeSweep edgeSweep() const {
+        return m_EdgeSweep;
+    }
+
+    void setEdgeSweep(EdgeSweep edgeSweep) {
+        m_EdgeSweep = edgeSweep;
     }
 
     std::ostream* output() const {
@@ -174,6 +219,297 @@ public:
         m_SlowSpeed = slowSpeed;
     }
 
+    bool useHaltonSamples() const {
+        return m_UseHaltonSamples;
+    }
+
+    void setUseHaltonSamples(bool useHaltonSamples) {
+        m_UseHaltonSamples = useHaltonSamples;
+    }
+
+    /**
+     * Seed for the sample generator, or -1 to seed it from the time each plan has to be done by.
+     * @return
+     */
+    long sampleSeed() const {
+        return m_SampleSeed;
+    }
+
+    void setSampleSeed(long sampleSeed) {
+        m_SampleSeed = sampleSeed;
+    }
+
+    int portfolioSize() const {
+        return m_PortfolioSize;
+    }
+
+    void setPortfolioSize(int portfolioSize) {
+        m_PortfolioSize = portfolioSize;
+    }
+
+    bool useDubinsCache() const {
+        return m_UseDubinsCache;
+    }
+
+    void setUseDubinsCache(bool useDubinsCache) {
+        m_UseDubinsCache = useDubinsCache;
+    }
+
+    /**
+     * Dubins cache to use if caching is on. If this isn't set the planner uses its own, starting empty each plan; set
+     * it to keep solutions around between plans.
+     * @return
+     */
+    const DubinsCache::SharedPtr& dubinsCache() const {
+        return m_DubinsCache;
+    }
+
+    void setDubinsCache(DubinsCache::SharedPtr dubinsCache) {
+        m_DubinsCache = std::move(dubinsCache);
+    }
+
+    bool batchDubins() const {
+        return m_BatchDubins;
+    }
+
+    void setBatchDubins(bool batchDubins) {
+        m_BatchDubins = batchDubins;
+    }
+
+    bool useHeuristicCache() const {
+        return m_UseHeuristicCache;
+    }
+
+    void setUseHeuristicCache(bool useHeuristicCache) {
+        m_UseHeuristicCache = useHeuristicCache;
+    }
+
+    /**
+     * Heuristic cache to use if caching is on. It's keyed by the remaining ribbons so entries stay good between plans;
+     * if this isn't set the planner uses its own.
+     * @return
+     */
+    const HeuristicCache::SharedPtr& heuristicCache() const {
+        return m_HeuristicCache;
+    }
+
+    void setHeuristicCache(HeuristicCache::SharedPtr heuristicCache) {
+        m_HeuristicCache = std::move(heuristicCache);
+    }
+
+    /**
+     * Samples to carry over between plans. The planner takes the last plan's samples that are still in its window
+     * instead of generating them again, and only makes fresh ones for the part of the window that's new. If this
+     * isn't set every plan samples from scratch.
+     * @return
+     */
+    const SamplePool::SharedPtr& samplePool() const {
+        return m_SamplePool;
+    }
+
+    void setSamplePool(SamplePool::SharedPtr samplePool) {
+        m_SamplePool = std::move(samplePool);
+    }
+
+    /**
+     * The last plan's edges and what they were checked against. If this is set, checking the previous plan again only
+     * sweeps the edges whose surroundings or starting ribbons have changed, taking the rest of the costs from here.
+     * @return
+     */
+    const std::shared_ptr<CheckedPlan>& checkedPlan() const {
+        return m_CheckedPlan;
+    }
+
+    void setCheckedPlan(std::shared_ptr<CheckedPlan> checkedPlan) {
+        m_CheckedPlan = std::move(checkedPlan);
+    }
+
+    bool adaptiveCollisionChecking() const {
+        return m_AdaptiveCollisionChecking;
+    }
+
+    void setAdaptiveCollisionChecking(bool adaptiveCollisionChecking) {
+        m_AdaptiveCollisionChecking = adaptiveCollisionChecking;
+    }
+
+    bool batchedEdgeSweep() const {
+        return m_BatchedEdgeSweep;
+    }
+
+    /**
+     * Sweep edges in two stages: sample the whole edge into arrays, then check the map, coverage and obstacles in
+     * separate passes over them. Same answers as the step-by-step sweep without adaptive collision checking (which
+     * it ignores).
+     * @param batchedEdgeSweep
+     */
+    void setBatchedEdgeSweep(bool batchedEdgeSweep) {
+        m_BatchedEdgeSweep = batchedEdgeSweep;
+    }
+
+    bool validateEdgeSweep() const {
+        return m_ValidateEdgeSweep;
+    }
+
+    /**
+     * With batched edge sweeps, also do every edge step by step and throw std::logic_error if they don't agree
+     * exactly. Twice the work, so for testing.
+     * @param validateEdgeSweep
+     */
+    void setValidateEdgeSweep(bool validateEdgeSweep) {
+        m_ValidateEdgeSweep = validateEdgeSweep;
+    }
+
+    bool analyticCoverage() const {
+        return m_AnalyticCoverage;
+    }
+
+    /**
+     * Work out what each edge covers from the geometry of its Dubins curve, a lookup per ribbon for each straight
+     * segment (and each short chord of the turns, when it's allowed to cover while turning), rather than covering at
+     * sample after sample along it. Turns only get credit for what they're sure to cover, so it's a touch pessimistic
+     * there.
+     * @param analyticCoverage
+     */
+    void setAnalyticCoverage(bool analyticCoverage) {
+        m_AnalyticCoverage = analyticCoverage;
+    }
+
+    bool lazyEdgeEvaluation() const {
+        return m_LazyEdgeEvaluation;
+    }
+
+    void setLazyEdgeEvaluation(bool lazyEdgeEvaluation) {
+        m_LazyEdgeEvaluation = lazyEdgeEvaluation;
+    }
+
+    int edgeEvaluationThreads() const {
+        return m_EdgeEvaluationThreads;
+    }
+
+    void setEdgeEvaluationThreads(int edgeEvaluationThreads) {
+        m_EdgeEvaluationThreads = edgeEvaluationThreads;
+    }
+
+    bool incrementalSearch() const {
+        return m_IncrementalSearch;
+    }
+
+    void setIncrementalSearch(bool incrementalSearch) {
+        m_IncrementalSearch = incrementalSearch;
+    }
+
+    bool closedList() const {
+        return m_ClosedList;
+    }
+
+    /**
+     * Drop vertices that end up in nearly the same state as one that's already been generated, with the same ribbons
+     * left, and cost more to get there (or replace the old one when the new one costs less). Nearly the same means in
+     * the same cell of x, y, heading and time, with the time cells as long as it takes to cross a position cell at top
+     * speed. It can throw away a vertex whose children would have done better than the one it kept, so it's a
+     * trade of some plan quality for search effort.
+     * @param closedList
+     */
+    void setClosedList(bool closedList) {
+        m_ClosedList = closedList;
+    }
+
+    double closedListResolution() const {
+        return m_ClosedListResolution;
+    }
+
+    void setClosedListResolution(double closedListResolution) {
+        m_ClosedListResolution = closedListResolution;
+    }
+
+    double closedListHeadingResolution() const {
+        return m_ClosedListHeadingResolution;
+    }
+
+    void setClosedListHeadingResolution(double closedListHeadingResolution) {
+        m_ClosedListHeadingResolution = closedListHeadingResolution;
+    }
+
+    size_t searchMemoryBudget() const {
+        return m_SearchMemoryBudget;
+    }
+
+    void setSearchMemoryBudget(size_t searchMemoryBudget) {
+        m_SearchMemoryBudget = searchMemoryBudget;
+    }
+
+    bool warmStart() const {
+        return m_WarmStart;
+    }
+
+    void setWarmStart(bool warmStart) {
+        m_WarmStart = warmStart;
+    }
+
+    int maxIterations() const {
+        return m_MaxIterations;
+    }
+
+    void setMaxIterations(int maxIterations) {
+        m_MaxIterations = maxIterations;
+    }
+
+    bool useSearchArena() const {
+        return m_UseSearchArena;
+    }
+
+    void setUseSearchArena(bool useSearchArena) {
+        m_UseSearchArena = useSearchArena;
+    }
+
+    bool precomputeObstacles() const {
+        return m_PrecomputeObstacles;
+    }
+
+    void setPrecomputeObstacles(bool precomputeObstacles) {
+        m_PrecomputeObstacles = precomputeObstacles;
+    }
+
+    bool useObstacleRaster() const {
+        return m_UseObstacleRaster;
+    }
+
+    void setUseObstacleRaster(bool useObstacleRaster) {
+        m_UseObstacleRaster = useObstacleRaster;
+    }
+
+    bool potentialFieldsUseDistanceField() const {
+        return m_PotentialFieldsUseDistanceField;
+    }
+
+    void setPotentialFieldsUseDistanceField(bool useDistanceField) {
+        m_PotentialFieldsUseDistanceField = useDistanceField;
+    }
+
+    double obstacleRasterCellSize() const {
+        return m_ObstacleRasterCellSize;
+    }
+
+    void setObstacleRasterCellSize(double obstacleRasterCellSize) {
+        m_ObstacleRasterCellSize = obstacleRasterCellSize;
+    }
+
+    double obstacleRasterTimeStep() const {
+        return m_ObstacleRasterTimeStep;
+    }
+
+    void setObstacleRasterTimeStep(double obstacleRasterTimeStep) {
+        m_ObstacleRasterTimeStep = obstacleRasterTimeStep;
+    }
+
+    size_t obstacleRasterMaxCells() const {
+        return m_ObstacleRasterMaxCells;
+    }
+
+    void setObstacleRasterMaxCells(size_t obstacleRasterMaxCells) {
+        m_ObstacleRasterMaxCells = obstacleRasterMaxCells;
+    }
+
 private:
     // search branching factor
     int m_BranchingFactor = 9;
@@ -189,6 +525,66 @@ private:
     int m_InitialSamples = 100;
     // whether or not to be clever about getting onto the ribbon with some hand-picked curves
     bool m_UseBrownPaths = false;
+    // whether to draw samples from a (randomly shifted) Halton sequence instead of uniformly at random
+    bool m_UseHaltonSamples = false;
+    // seed to draw every plan's samples with, so runs can be repeated (-1 for a different seed each plan)
+    long m_SampleSeed = -1;
+    // number of A* planners (with different seeds) to run side by side each cycle, keeping the best plan
+    int m_PortfolioSize = 1;
+    // whether to cache Dubins solutions, and a cache to share between plans (optional)
+    bool m_UseDubinsCache = false;
+    DubinsCache::SharedPtr m_DubinsCache;
+    // whether to solve for the Dubins lengths to a batch of samples at once during expansion, only making edges for
+    // the closest (the cache doesn't get used for samples then)
+    bool m_BatchDubins = false;
+    // whether to memoize ribbon heuristic values, and a cache to share between plans (optional)
+    bool m_UseHeuristicCache = false;
+    HeuristicCache::SharedPtr m_HeuristicCache;
+    // samples to share between plans (optional)
+    SamplePool::SharedPtr m_SamplePool;
+    // the last plan, for revalidating it (optional)
+    std::shared_ptr<CheckedPlan> m_CheckedPlan;
+    // picked for the map and obstacles (optional)
+    EdgeSweep m_EdgeSweep = nullptr;
+    // whether to skip collision checks along stretches of edges known to be clear of the map and obstacles
+    bool m_AdaptiveCollisionChecking = false;
+    // whether to cover along edges' segments all at once instead of at samples
+    bool m_AnalyticCoverage = false;
+    // whether to sample edges into arrays before checking them
+    bool m_BatchedEdgeSweep = false;
+    // whether to check batched sweeps against the step-by-step one
+    bool m_ValidateEdgeSweep = false;
+    // whether to put off computing edges' true costs until their end vertices come off the open list (lazy A*)
+    bool m_LazyEdgeEvaluation = false;
+    // number of threads (including the planning thread) to evaluate child edges with during expansion
+    int m_EdgeEvaluationThreads = 1;
+    // whether to keep the search tree between sample-doubling iterations instead of starting over each time
+    bool m_IncrementalSearch = false;
+    // whether to drop vertices close to ones already generated with the same ribbons and a lower cost, and the size
+    // of the cells they have to share (m and radians)
+    bool m_ClosedList = false;
+    double m_ClosedListResolution = 0.5;
+    double m_ClosedListHeadingResolution = 0.1;
+    // roughly how much memory (bytes) the A* search tree can take up before the open list's worst vertices get dropped
+    // to make room, SMA* style (0 for no limit)
+    size_t m_SearchMemoryBudget = 0;
+    // whether to keep the search tree between plans and start the next one from what's left of it (only does anything
+    // when the same AStarPlanner does the planning each time)
+    bool m_WarmStart = false;
+    // most A* iterations (rounds of sampling and searching) to do in a plan, whatever time is left (0 for no limit)
+    int m_MaxIterations = 0;
+    // whether to bump allocate each iteration's search tree from an arena instead of the heap
+    bool m_UseSearchArena = false;
+    // whether to snapshot the dynamic obstacles into a quicker to query form at the start of each plan
+    bool m_PrecomputeObstacles = false;
+    // whether to sample the dynamic obstacles' costs onto an (x, y, t) grid over the planning window for each plan,
+    // at what resolution (m and s), and the most values it can store (the cells get coarser to fit)
+    bool m_UseObstacleRaster = false;
+    double m_ObstacleRasterCellSize = 5, m_ObstacleRasterTimeStep = 1;
+    size_t m_ObstacleRasterMaxCells = 1u << 22;
+    // whether the potential fields planner pushes away from the map using its distance field (one lookup a step)
+    // instead of looking at every cell nearby
+    bool m_PotentialFieldsUseDistanceField = false;
     // whether to dump the motion tree to a file. tends to make search go a little slower, and files get big fast
     bool m_Visualizations = false;
     Visualizer::UniquePtr* m_Visualizer;
@@ -198,7 +594,9 @@ private:
     Map::SharedPtr m_Map;
     // dynamic obstacles
     DynamicObstaclesManager1 m_Obstacles;
-    DynamicObstaclesManager::SharedPtr m_ObstaclesManager = std::make_shared<DynamicObstaclesManager>();
+    DynamicObstaclesManager::ConstSharedPtr m_ObstaclesManager = std::make_shared<DynamicObstaclesManager>();
+    // its precompute() over the horizon, when that's been done already
+    DynamicObstaclesManager::ConstSharedPtr m_ObstacleProjection;
     // Stream for output. Maybe this should go to its own ROS topic?
     std::ostream* m_Output;
     // function we pass in to let the planner check the time
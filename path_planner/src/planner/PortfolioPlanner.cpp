@@ -0,0 +1,67 @@
+#include <thread>
+#include "PortfolioPlanner.h"
+#include "search/CheckedPlan.h"
+
+PortfolioPlanner::PortfolioPlanner(int instances) {
+    if (instances < 1) throw std::invalid_argument("Portfolio needs at least one planner");
+    for (int i = 0; i < instances; i++) {
+        m_Planners.emplace_back(new AStarPlanner);
+        // seeds far enough apart that consecutive plans (seeded by time) don't line up with another instance's
+        m_Planners.back()->setSeedOffset(i * 7919);
+    }
+}
+
+Planner::Stats PortfolioPlanner::plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+                                      const DubinsPlan& previousPlan, double timeRemaining) {
+    auto incumbent = std::make_shared<SharedIncumbent>();
+    auto n = m_Planners.size();
+    std::vector<PlannerConfig> configs(n, config);
+    std::vector<RibbonManager> ribbonManagers(n, ribbonManager);
+    std::vector<Stats> results(n);
+    std::vector<std::exception_ptr> errors(n);
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) configs[i].setVisualizations(false);
+        configs[i].setDubinsCache(nullptr);
+        // the rest would only find it empty, and their own samples are what makes them worth running
+        if (i > 0) configs[i].setSamplePool(nullptr);
+        // each records its own plan, and the winner's gets kept
+        if (config.checkedPlan()) configs[i].setCheckedPlan(std::make_shared<CheckedPlan>(*config.checkedPlan()));
+        if (m_Variation) m_Variation((int)i, configs[i], ribbonManagers[i]);
+        m_Planners[i]->setSharedIncumbent(incumbent);
+    }
+    auto run = [&](size_t i) {
+        try {
+            results[i] = m_Planners[i]->plan(ribbonManagers[i], start, configs[i], previousPlan, timeRemaining);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; i++) threads.emplace_back(run, i);
+    run(0);
+    for (auto& t : threads) t.join();
+    for (const auto& p : m_Planners) p->setSharedIncumbent(nullptr);
+    for (const auto& e : errors) if (e) std::rethrow_exception(e);
+
+    // best f wins; ties go to the lower instance
+    int best = -1;
+    for (size_t i = 0; i < n; i++) {
+        if (results[i].Plan.empty()) continue;
+        if (best == -1 || results[i].PlanFValue < results[best].PlanFValue) best = (int)i;
+    }
+    if (config.checkedPlan()) {
+        if (best == -1) config.checkedPlan()->clear();
+        else *config.checkedPlan() = *configs[best].checkedPlan();
+    }
+    // the winner's stats, but with the work all of them did
+    auto stats = results[best == -1? 0 : best];
+    stats.CpuTime = 0;
+    stats.Profile = Profiler::Report();
+    stats.Allocations = Profiler::Allocations();
+    for (const auto& r : results) {
+        stats.CpuTime += r.CpuTime;
+        Profiler::accumulate(stats.Profile, r.Profile);
+        Profiler::accumulate(stats.Allocations, r.Allocations);
+    }
+    return stats;
+}
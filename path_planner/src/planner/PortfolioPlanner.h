@@ -0,0 +1,50 @@
+#ifndef SRC_PORTFOLIOPLANNER_H
+#define SRC_PORTFOLIOPLANNER_H
+
+#include <functional>
+#include "AStarPlanner.h"
+
+/**
+ * Runs several AStarPlanners on the same problem at once, each on its own thread with its own sample seed, and returns
+ * whichever plan has the best f-value at the deadline. The planners share their incumbent f-value so each one can
+ * prune against the best found by any of them.
+ *
+ * Everything in the config is shared read-only between the instances (map, obstacles). Visualizations are left on for
+ * the first instance only, and the instances don't share a Dubins cache since it isn't thread-safe.
+ */
+class PortfolioPlanner : public Planner {
+public:
+    /**
+     * Tweak the problem for one instance (a different heuristic or branching factor, say) before it plans.
+     */
+    typedef std::function<void(int instance, PlannerConfig& config, RibbonManager& ribbonManager)> Variation;
+
+    /**
+     * Construct a portfolio.
+     * @param instances number of planners to run (and threads to use)
+     */
+    explicit PortfolioPlanner(int instances);
+
+    ~PortfolioPlanner() override = default;
+
+    Stats plan(const RibbonManager& ribbonManager, const State& start, PlannerConfig config,
+               const DubinsPlan& previousPlan, double timeRemaining) override;
+
+    /**
+     * Set a variation to apply to each instance. By default they only differ by seed.
+     * @param variation
+     */
+    void setVariation(Variation variation) { m_Variation = std::move(variation); }
+
+    /**
+     * @return the number of planner instances
+     */
+    int instances() const { return (int)m_Planners.size(); }
+
+private:
+    std::vector<std::unique_ptr<AStarPlanner>> m_Planners;
+    Variation m_Variation;
+};
+
+
+#endif //SRC_PORTFOLIOPLANNER_H
@@ -15,7 +15,8 @@ Planner::Stats PotentialFieldsPlanner::plan(const RibbonManager& ribbonManager,
     // can't get onto a line reliably but once on we're pretty okay
     for (int i = 0; i < c_LookaheadSteps; i++) {
         const auto& ribbons = localRibbonManager.get();
-        Force net(0, 0);
+        // where each ribbon pulls us towards, and how hard
+        m_X.clear(); m_Y.clear(); m_Magnitudes.clear();
         for (const auto& r : ribbons) {
             // get ribbon endpoints and distances
             auto s = r.startAsState();
@@ -70,33 +71,30 @@ Planner::Stats PotentialFieldsPlanner::plan(const RibbonManager& ribbonManager,
                     closest = e;
                 }
             }
-            auto dClosest = fmin(ds, de);
-            auto dirClosest = M_PI_2 - current.headingTo(closest);
-            net = net + Force(getRibbonMagnitude(dClosest), dirClosest);
+            m_X.push_back(closest.x());
+            m_Y.push_back(closest.y());
+            m_Magnitudes.push_back(getRibbonMagnitude(fmin(ds, de)));
         }
+        // (the ribbons' force has to be added up before the map's, since scanning the map reuses the scratch space)
+        auto net = sumForces(current, m_X, m_Y, m_Magnitudes);
+        net = net + staticObstacleForce(current, config);
 
-        // just query at the resolution in the map at all relevant distances
-        auto resolution = config.map()->resolution();
-        if (resolution > 0) {
-            for (double x = current.x() - c_StaticObsIgnoreThreshold; x <= current.x() + c_StaticObsIgnoreThreshold; x += resolution) {
-                for (double y = current.y() - c_StaticObsIgnoreThreshold; y <= current.y() + c_StaticObsIgnoreThreshold; y += resolution) {
-                    if (config.map()->isBlocked(x, y)) {
-                        net = net - Force(getStaticObstacleMagnitude(current.distanceTo(x, y)),
-                                          M_PI_2 - current.headingTo(x, y));
-                    }
-                }
-            }
-        }
         // for dynamic obstacles let's maybe cast it to a binary obstacles manager and use the method for display?
         try {
             const auto& obstaclesManager = dynamic_cast<const BinaryDynamicObstaclesManager&>(config.obstaclesManager());
+            m_X.clear(); m_Y.clear(); m_Magnitudes.clear();
             for (const auto& o : obstaclesManager.get()) {
-                auto obstacle = o.second;
-                obstacle.project(current.time());
-                auto d = current.distanceTo(obstacle.X, obstacle.Y);
-                auto dir = M_PI_2 - current.headingTo(obstacle.X, obstacle.Y);
-                net = net - Force(getDynamicObstacleMagnitude(d, obstacle.Width, obstacle.Length), dir);
+                // project the position without copying the obstacle
+                const auto& obstacle = o.second;
+                auto dt = current.time() - obstacle.Time;
+                auto x = obstacle.X + obstacle.Speed * dt * cos(obstacle.Yaw);
+                auto y = obstacle.Y + obstacle.Speed * dt * sin(obstacle.Yaw);
+                m_X.push_back(x);
+                m_Y.push_back(y);
+                m_Magnitudes.push_back(-getDynamicObstacleMagnitude(current.distanceTo(x, y), obstacle.Width,
+                                                                    obstacle.Length));
             }
+            net = net + sumForces(current, m_X, m_Y, m_Magnitudes);
         }
         catch (std::bad_cast&) {
             *m_Config.output() << "Warning: cannot use unknown dynamic obstacles manager with potential fields planner" << std::endl;
@@ -118,3 +116,74 @@ Planner::Stats PotentialFieldsPlanner::plan(const RibbonManager& ribbonManager,
     }
     return stats;
 }
+
+double PotentialFieldsPlanner::getStaticFieldMagnitude(double distance) {
+    const double r = c_StaticObsIgnoreThreshold, k = 15;
+    if (distance >= r) return 0;
+    distance = fmax(distance, 0);
+    // integrate getStaticObstacleMagnitude's push towards the shore over the part of the half plane past the shoreline
+    // that's within the threshold, in polar coordinates: exactly along each ray, numerically across them
+    auto g = [k](double rho) { return -k * exp(-rho / k) * (rho + k); }; // integral of rho * e^(-rho / k)
+    const int steps = 32;
+    auto halfAngle = acos(distance / r);
+    auto dTheta = 2 * halfAngle / steps;
+    double sum = 0;
+    for (int i = 0; i < steps; i++) {
+        auto theta = -halfAngle + (i + 0.5) * dTheta;
+        auto c = cos(theta);
+        sum += c * (g(r) - g(distance / c));
+    }
+    return sum * dTheta;
+}
+
+PotentialFieldsPlanner::Force PotentialFieldsPlanner::sumForces(const State& from, const std::vector<double>& x,
+                                                                const std::vector<double>& y,
+                                                                const std::vector<double>& magnitudes) {
+    double fx = 0, fy = 0;
+    const auto n = magnitudes.size();
+    for (size_t i = 0; i < n; i++) {
+        auto dx = x[i] - from.x(), dy = y[i] - from.y();
+        auto d = sqrt(dx * dx + dy * dy);
+        // right on top of it, it pulls east (like atan2(0, 0) would have it)
+        auto inverse = d > 0 ? 1 / d : 0;
+        fx += magnitudes[i] * (d > 0 ? dx * inverse : 1);
+        fy += magnitudes[i] * dy * inverse;
+    }
+    Force result{};
+    result.X = fx;
+    result.Y = fy;
+    return result;
+}
+
+PotentialFieldsPlanner::Force PotentialFieldsPlanner::staticObstacleForce(const State& current,
+                                                                          const PlannerConfig& config) {
+    Force none(0, 0);
+    const auto& map = *config.map();
+    double distance, gradientX, gradientY;
+    if (config.potentialFieldsUseDistanceField() &&
+        map.clearance(current.x(), current.y(), distance, gradientX, gradientY)) {
+        // the distance grows fastest directly away from the nearest blocked area
+        auto norm = sqrt(gradientX * gradientX + gradientY * gradientY);
+        if (distance >= c_StaticObsIgnoreThreshold || norm == 0) return none;
+        auto magnitude = getStaticFieldMagnitude(distance) / norm;
+        Force push{};
+        push.X = gradientX * magnitude;
+        push.Y = gradientY * magnitude;
+        return push;
+    }
+    // just query at the resolution in the map at all relevant distances
+    auto resolution = map.resolution();
+    // blocked points further than the threshold don't push, so if the nearest one is we can skip the scan
+    if (resolution <= 0 || map.distanceToBlocked(current.x(), current.y()) > c_StaticObsIgnoreThreshold) return none;
+    m_X.clear(); m_Y.clear(); m_Magnitudes.clear();
+    for (double x = current.x() - c_StaticObsIgnoreThreshold; x <= current.x() + c_StaticObsIgnoreThreshold; x += resolution) {
+        for (double y = current.y() - c_StaticObsIgnoreThreshold; y <= current.y() + c_StaticObsIgnoreThreshold; y += resolution) {
+            if (map.isBlocked(x, y)) {
+                m_X.push_back(x);
+                m_Y.push_back(y);
+                m_Magnitudes.push_back(-getStaticObstacleMagnitude(current.distanceTo(x, y)));
+            }
+        }
+    }
+    return sumForces(current, m_X, m_Y, m_Magnitudes);
+}
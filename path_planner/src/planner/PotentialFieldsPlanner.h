@@ -2,8 +2,18 @@
 #define SRC_POTENTIALFIELDSPLANNER_H
 
 
+#include <vector>
 #include "Planner.h"
 
+/**
+ * Follows the sum of forces: pulled towards the ribbons, pushed away from the map and the dynamic obstacles. Not good
+ * at all, but quick, so it can stand in when the A* planner has nothing.
+ *
+ * The forces from each kind of thing get summed from flat arrays of where each one is and how hard it pushes, in
+ * loops without branches or trig so they vectorize. The map either gets scanned cell by cell around the boat or, with
+ * PlannerConfig::potentialFieldsUseDistanceField, the map's distance field gives the distance and direction to the
+ * nearest blocked area in one lookup.
+ */
 class PotentialFieldsPlanner : public Planner {
 public:
     ~PotentialFieldsPlanner() override = default;
@@ -57,6 +67,36 @@ private:
         return exp(-distance / 15);
     }
 
+    /**
+     * What the cell by cell scan adds up to for a straight shoreline at 1m cells, which is what the distance field
+     * version pushes with, so the two are about as strong as each other.
+     * @param distance to the shoreline
+     * @return
+     */
+    static double getStaticFieldMagnitude(double distance);
+
+    /**
+     * Sum forces pulling from (or, with negative magnitudes, pushing away from) a bunch of points.
+     * @param from where the forces act
+     * @param x points
+     * @param y
+     * @param magnitudes
+     * @return
+     */
+    static Force sumForces(const State& from, const std::vector<double>& x, const std::vector<double>& y,
+                           const std::vector<double>& magnitudes);
+
+    /**
+     * Push away from the map.
+     * @param current
+     * @param config
+     * @return
+     */
+    Force staticObstacleForce(const State& current, const PlannerConfig& config);
+
+    // scratch space for sumForces' inputs
+    std::vector<double> m_X, m_Y, m_Magnitudes;
+
     static constexpr int c_LookaheadSteps = 10;
 
     static constexpr double c_StaticObsIgnoreThreshold = 7.5;
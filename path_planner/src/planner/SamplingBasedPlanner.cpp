@@ -1,5 +1,8 @@
 #include "SamplingBasedPlanner.h"
+#include "../common/dynamic_obstacles/ObstacleCostRaster.h"
+#include <path_planner_common/DubinsBatch.h>
 #include <algorithm>
+#include <cmath>
 #include <utility>
 
 SamplingBasedPlanner::SamplingBasedPlanner() {}
@@ -7,22 +10,47 @@ SamplingBasedPlanner::SamplingBasedPlanner() {}
 void SamplingBasedPlanner::pushVertexQueue(Vertex::SharedPtr vertex) {
     if (!vertex->isRoot() && vertex->parentEdge()->infeasible()) return;
     vertex->approxToGo(); // make sure it is calculated
-    // prune vertices worse than the incumbent solution
-    if (m_BestVertex && m_BestVertex->f() < vertex->f()) return; // assumes heuristic is admissible and consistent
-    // make sure this isn't a goal with equal f to the incumbent
-    if (m_BestVertex && m_BestVertex->f() == vertex->f() && goalCondition(vertex)) return;
-    m_VertexQueue.push_back(vertex);
-    std::push_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
+    auto f = vertex->f();
+    if (m_BestVertex) {
+        auto bestF = m_BestVertex->f();
+        // prune vertices worse than the incumbent solution
+        if (bestF < f) return; // assumes heuristic is admissible and consistent
+        // make sure this isn't a goal with equal f to the incumbent
+        if (bestF == f && vertex->evaluated() && goalCondition(vertex)) return;
+    }
+    // someone else may have found something better
+    if (m_SharedIncumbent && m_SharedIncumbent->f() < f) return;
+    if (m_Config.closedList() && !closedListAdmits(vertex)) return;
+    // goal checks need the true (truncated) end time, which lazy vertices don't have yet
+    if (vertex->evaluated()) visualizeVertex(vertex, "vertex", false);
+    auto bytes = footprint(*vertex);
+    Profiler::Scope profile(Profiler::Heap);
+    if (m_UseOpenList) {
+        m_OpenList.push(f, std::move(vertex));
+    } else {
+        m_VertexQueue.push_back(std::move(vertex));
+        std::push_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
+    }
+    profile.stop();
 //    std::cerr << "Pushing to vertex queue: " << vertex->toString() << std::endl;
-    visualizeVertex(vertex, "vertex", false);
     m_Stats.Generated++;
+    countSearchMemory(bytes);
 }
 
 std::shared_ptr<Vertex> SamplingBasedPlanner::popVertexQueue() {
-    if (m_VertexQueue.empty()) throw std::out_of_range("Trying to pop an empty vertex queue");
-    std::pop_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
-    auto ret = m_VertexQueue.back();
-    m_VertexQueue.pop_back();
+    Profiler::Scope profile(Profiler::Heap);
+    Vertex::SharedPtr ret;
+    if (m_UseOpenList) {
+        ret = m_OpenList.pop();
+    } else {
+        if (m_VertexQueue.empty()) throw std::out_of_range("Trying to pop an empty vertex queue");
+        std::pop_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
+        ret = std::move(m_VertexQueue.back());
+        m_VertexQueue.pop_back();
+    }
+    profile.stop();
+    // it's counted again if it gets expanded
+    countSearchMemory(0, footprint(*ret));
     return ret;
 }
 
@@ -33,12 +61,6 @@ std::function<bool(std::shared_ptr<Vertex> v1,
     };
 }
 
-std::function<bool(const State& s1, const State& s2)> SamplingBasedPlanner::getStateComparator(const State& origin) {
-    return [&](const State& s1, const State& s2) {
-        return s1.distanceTo(origin) > s2.distanceTo(origin);
-    };
-}
-
 bool SamplingBasedPlanner::goalCondition(const std::shared_ptr<Vertex>& vertex) {
     auto coverageDoneTime = vertex->ribbonManager().coverageCompletedTime() + m_Config.timeMinimum();
     if (vertex->ribbonManager().coverageCompletedTime() == -1 && vertex->ribbonManager().done()) {
@@ -61,92 +83,267 @@ void SamplingBasedPlanner::expand(const std::shared_ptr<Vertex>& sourceVertex, c
     const double turningRadii[nTurningRadii] = {m_Config.turningRadius(),
                                 m_Config.coverageTurningRadius() == m_Config.turningRadius()?
                                 -1 : m_Config.coverageTurningRadius()};
-    // add nearest point to cover
-    if (!sourceVertex->done()) {
+    // if we've expanded this vertex before (incremental search) its children on the old samples are already out there
+    // (without incremental search the root gets expanded from scratch every iteration, so don't skip anything)
+    // (and if some of its children were dropped to save memory, those get made again, but only those)
+    const auto forgottenChildren = sourceVertex->takeForgottenChildren();
+    const bool forgotten = !forgottenChildren.empty();
+    const size_t firstNewSample = m_Config.incrementalSearch() || forgotten? sourceVertex->expandedSampleCount() : 0;
+    auto wanted = [&](int sample, int speedIndex, int radiusIndex) {
+        if (sample >= 0? (size_t)sample >= firstNewSample : firstNewSample == 0) return true;
+        if (std::find(forgottenChildren.begin(), forgottenChildren.end(),
+                      Vertex::ChildKey{sample, speedIndex, radiusIndex}) == forgottenChildren.end()) return false;
+        m_Stats.Regenerated++;
+        return true;
+    };
+    // expanded vertices stay in memory as long as their children do (forgotten ones stopped counting when they were)
+    if (sourceVertex->expandedSampleCount() == 0 || forgotten) countSearchMemory(footprint(*sourceVertex));
+    // Children are all connected first, then have their edges evaluated (possibly in parallel), then get pushed in the
+    // order they were made so the search doesn't depend on thread timing.
+    struct Child {
+        Vertex::SharedPtr V;
+        int Sample, SpeedIndex, RadiusIndex; // sample is -1 for children not made from samples
+    };
+    std::vector<Child> children;
+    // add nearest point to cover (if there's one here, rather than just a remainder left out of the manager)
+    if (!sourceVertex->ribbonManager().get().empty() && (firstNewSample == 0 || forgotten)) {
         auto s = sourceVertex->getNearestPointAsState();
         // TODO! -- get some set of near points
         if (sourceVertex->state().distanceTo(s) > m_Config.collisionCheckingIncrement()) {
+            int speedIndex = 0;
             for (const auto& speed : speeds) {
                 if (speed <= 0) continue;
-                for (const auto& turningRadius : turningRadii) {
-                    if (turningRadius <= 0) continue;
-                    bool coverageAllowed = turningRadius == m_Config.coverageTurningRadius();
+                for (int j = 0; j < nTurningRadii; j++) {
+                    if (turningRadii[j] <= 0 || !wanted(-1, speedIndex, j)) continue;
+                    bool coverageAllowed = turningRadii[j] == m_Config.coverageTurningRadius();
                     s.speed() = speed;
-                    auto destinationVertex = Vertex::connect(sourceVertex, s, turningRadius, coverageAllowed);
-                    destinationVertex->parentEdge()->computeTrueCost(m_Config);
-                    pushVertexQueue(destinationVertex);
+                    children.push_back({Vertex::connect(sourceVertex, s, turningRadii[j], coverageAllowed, m_Arena),
+                                        -1, speedIndex, j});
                 }
+                speedIndex++;
             }
         }
     }
-    auto comp = getStateComparator(sourceVertex->state());
-    auto dubinsComp = getDubinsComparator(sourceVertex->state());
-    // heapify first by Euclidean distance
-    std::make_heap(m_Samples.begin(), m_Samples.end(), comp);
-    // Use more heaps to sort by Dubins distance, skipping the samples which are farther away this time.
-    // Making all the vertices adds some allocation overhead but it lets us cache the dubins paths
-    std::vector<Vertex::SharedPtr> bestSamplesHeaps[nTurningRadii];
-    bool doneChecks[nTurningRadii] = {false, false};
-    // iterate through samples in closest (Euclidean distance) first order
-    for (uint64_t i = 0; i < m_Samples.size() && (!doneChecks[0] || !doneChecks[1]); i++) {
-        // get closest sample
-        auto sample = m_Samples.front();
-        std::pop_heap(m_Samples.begin(), m_Samples.end() - i, comp);
-        // iterate through turning radii
-        for (unsigned long j = 0; j < nTurningRadii; j++) {
-            // if we've filled up the heap for this radius we can skip
-            if (doneChecks[j]) continue;
-            const auto& turningRadius = turningRadii[j];
-            // if this radius isn't being used we can skip
-            if (turningRadius <= 0) {
-                doneChecks[j] = true;
-                continue;
+    // picking which samples to connect to, Dubins solutions and all
+    Profiler::Scope nearest(Profiler::Nearest);
+    const auto branchingFactor = (size_t)k();
+    if (m_Config.batchDubins()) {
+        // Same search as below, but the Dubins lengths to a batch of samples at a time get worked out together from
+        // the one start, and only the closest K get paths and vertices made for them
+        struct Candidate {
+            double Length;
+            int Sample, Word;
+            bool operator<(const Candidate& other) const { return Length < other.Length; }
+        };
+        std::vector<Candidate> bestSamplesHeaps[nTurningRadii];
+        bool doneChecks[nTurningRadii] = {false, false};
+        std::vector<DubinsBatch> solvers;
+        for (auto turningRadius : turningRadii) solvers.emplace_back(sourceVertex->state(), turningRadius);
+        std::vector<State> goals;
+        // the goals' yaws' trig, when the samples keep it
+        std::vector<double> goalCos, goalSin;
+        std::vector<int> indices;
+        std::vector<double> distances;
+        double lengths[c_DubinsBatchSize];
+        int words[c_DubinsBatchSize];
+        std::vector<size_t> solving;
+        State solvingGoals[c_DubinsBatchSize];
+        double solvingCos[c_DubinsBatchSize], solvingSin[c_DubinsBatchSize];
+        const bool trig = m_Samples.keepsTrig();
+        // go through the batch in (Euclidean) order, stopping at the same sample the one at a time search would
+        auto processBatch = [&] {
+            for (int j = 0; j < nTurningRadii; j++) {
+                if (turningRadii[j] <= 0) doneChecks[j] = true;
+                if (doneChecks[j]) continue;
+                auto& bestSamples = bestSamplesHeaps[j];
+                // only solve for the ones that could beat the worst of the K so far (which only gets better)
+                solving.clear();
+                for (size_t i = 0; i < goals.size(); i++) {
+                    if (distances[i] <= m_Config.collisionCheckingIncrement()) continue;
+                    if (bestSamples.size() >= branchingFactor && DubinsBatch::lowerBound(sourceVertex->state(), goals[i],
+                            turningRadii[j]) > bestSamples.front().Length) continue;
+                    solvingGoals[solving.size()] = goals[i];
+                    if (trig) {
+                        solvingCos[solving.size()] = goalCos[i];
+                        solvingSin[solving.size()] = goalSin[i];
+                    }
+                    solving.push_back(i);
+                }
+                {
+                    Profiler::Scope profile(Profiler::Dubins);
+                    solvers[j].solve(solvingGoals, trig? solvingCos : nullptr, trig? solvingSin : nullptr,
+                                     solving.size(), lengths, words);
+                }
+                size_t next = 0;
+                for (size_t i = 0; i < goals.size() && !doneChecks[j]; i++) {
+                    auto solved = next < solving.size() && solving[next] == i;
+                    if (solved) next++;
+                    if (bestSamples.size() < branchingFactor || bestSamples.front().Length > distances[i]) {
+                        if (solved && words[next - 1] >= 0) {
+                            bestSamples.push_back({lengths[next - 1], indices[i], words[next - 1]});
+                            std::push_heap(bestSamples.begin(), bestSamples.end());
+                            if (bestSamples.size() > branchingFactor) {
+                                std::pop_heap(bestSamples.begin(), bestSamples.end());
+                                bestSamples.pop_back();
+                            }
+                        }
+                    } else {
+                        doneChecks[j] = true;
+                    }
+                }
+            }
+            goals.clear();
+            goalCos.clear();
+            goalSin.clear();
+            indices.clear();
+            distances.clear();
+            return !doneChecks[0] || !doneChecks[1];
+        };
+        m_SampleIndex.visitByDistance(sourceVertex->state().x(), sourceVertex->state().y(), [&](int index, double distance) {
+            goals.push_back(m_Samples.state(index));
+            if (trig) {
+                // yaw is a quarter turn back from heading, so its cosine is the heading's sine and vice versa
+                double c, s;
+                m_Samples.trig(index, c, s);
+                goalCos.push_back(s);
+                goalSin.push_back(c);
+            }
+            indices.push_back(index);
+            distances.push_back(distance);
+            return goals.size() < c_DubinsBatchSize || processBatch();
+        });
+        if (!goals.empty()) processBatch();
+        for (int j = 0; j < nTurningRadii; j++) {
+            bool coverageAllowed = turningRadii[j] == m_Config.coverageTurningRadius();
+            for (const auto& candidate : bestSamplesHeaps[j]) {
+                if ((size_t)candidate.Sample < firstNewSample && !forgotten) continue;
+                DubinsPath path;
+                if (!solvers[j].path(m_Samples.state(candidate.Sample), candidate.Word, path)) continue;
+                DubinsWrapper wrapper;
+                wrapper.fill(path, m_Config.maxSpeed(), sourceVertex->state().time());
+                int speedIndex = 0;
+                for (const auto& speed : speeds) {
+                    if (speed <= 0) continue;
+                    if (wanted(candidate.Sample, speedIndex, j)) {
+                        wrapper.setSpeed(speed);
+                        children.push_back({Vertex::connect(sourceVertex, wrapper, coverageAllowed, m_Arena),
+                                            candidate.Sample, speedIndex, j});
+                    }
+                    speedIndex++;
+                }
+            }
+        }
+    } else {
+        auto vertexComp = getDubinsComparator(sourceVertex->state());
+        // remember which sample each candidate came from
+        typedef std::pair<Vertex::SharedPtr, int> Candidate;
+        auto dubinsComp = [&](const Candidate& c1, const Candidate& c2) { return vertexComp(c1.first, c2.first); };
+        // Use heaps to sort by Dubins distance, skipping the samples which are farther away this time.
+        // Making all the vertices adds some allocation overhead but it lets us cache the dubins paths
+        std::vector<Candidate> bestSamplesHeaps[nTurningRadii];
+        bool doneChecks[nTurningRadii] = {false, false};
+        // iterate through samples in closest (Euclidean distance) first order
+        m_SampleIndex.visitByDistance(sourceVertex->state().x(), sourceVertex->state().y(), [&](int index, double distance) {
+            auto sample = m_Samples.state(index);
+            // iterate through turning radii
+            for (unsigned long j = 0; j < nTurningRadii; j++) {
+                // if we've filled up the heap for this radius we can skip
+                if (doneChecks[j]) continue;
+                const auto& turningRadius = turningRadii[j];
+                // if this radius isn't being used we can skip
+                if (turningRadius <= 0) {
+                    doneChecks[j] = true;
+                    continue;
+                }
+                // grab the appropriate heap
+                auto& bestSamples = bestSamplesHeaps[j];
+                // if we haven't filled up the heap yet or this sample could possibly be better than the worst sample
+                // we've connected to so far, add it to the heap
+                if (bestSamples.size() < branchingFactor || bestSamples.front().first->parentEdge()->getPlan(m_Config).length() > distance) {
+                    // samples whose Dubins length can't possibly beat the worst one in the heap don't need a vertex
+                    auto hopeless = bestSamples.size() >= branchingFactor && DubinsBatch::lowerBound(sourceVertex->state(), sample,
+                            turningRadius) > bestSamples.front().first->parentEdge()->getPlan(m_Config).length();
+                    if (distance > m_Config.collisionCheckingIncrement() && !hopeless) {
+                        // set the speed to be the max speed for now - it could get changed later
+                        sample.speed() = m_Config.maxSpeed();
+                        // check whether to allow coverage
+                        bool coverageAllowed = turningRadius == m_Config.coverageTurningRadius();
+                        // connect to the sample and push it onto the heap
+                        bestSamples.emplace_back(Vertex::connect(sourceVertex, sample, turningRadius, coverageAllowed,
+                                                                 m_Arena), index);
+                        // make sure to compute the approx cost before fixing the heap
+                        bestSamples.back().first->parentEdge()->computeApproxCost(m_DubinsCache);
+                        // fix the heap
+                        std::push_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
+                        // if we've filled up the heap, pop the worst sample
+                        if (bestSamples.size() > branchingFactor) {
+                            std::pop_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
+                            bestSamples.pop_back();
+                        }
+                    }
+                } else {
+                    // otherwise we're done with this turning radius (and heap)
+                    doneChecks[j] = true;
+                }
             }
-            // grab the appropriate heap
+            // keep going until both heaps are done
+            return !doneChecks[0] || !doneChecks[1];
+        });
+        for (int j = 0; j < nTurningRadii; j++) {
             auto& bestSamples = bestSamplesHeaps[j];
-            // if we haven't filled up the heap yet or this sample could possibly be better than the worst sample
-            // we've connected to so far, add it to the heap
-            if (bestSamples.size() < k() || bestSamples.front()->parentEdge()->getPlan(m_Config).length() >
-                    sample.distanceTo(sourceVertex->state())){
-                if (sourceVertex->state().distanceTo(sample) > m_Config.collisionCheckingIncrement()) {
-                    // set the speed to be the max speed for now - it could get changed later
-                    sample.speed() = m_Config.maxSpeed();
-                    // check whether to allow coverage
-                    bool coverageAllowed = turningRadius == m_Config.coverageTurningRadius();
-                    // connect to the sample and push it onto the heap
-                    bestSamples.push_back(Vertex::connect(sourceVertex, sample, turningRadius, coverageAllowed));
-                    // make sure to compute the approx cost before fixing the heap
-                    bestSamples.back()->parentEdge()->computeApproxCost();
-                    // fix the heap
-                    std::push_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
-                    // if we've filled up the heap, pop the worst sample
-                    if (bestSamples.size() > k()) {
-                        std::pop_heap(bestSamples.begin(), bestSamples.end(), dubinsComp);
-                        bestSamples.pop_back();
+            // Push the closest K onto the open list
+            if (bestSamples.size() > branchingFactor) throw std::runtime_error("Somehow got too many samples in the heap");
+            for (auto& candidate : bestSamples) {
+                // Old samples still in the closest K were in the closest K last time too, so we've already connected them
+                // (unless they were dropped since)
+                if ((size_t)candidate.second < firstNewSample && !forgotten) continue;
+                auto& destinationVertex = candidate.first;
+                // use the wrapper from the vertex to save re-computing it but ditch the rest
+                auto wrapper = destinationVertex->parentEdge()->getPlan(m_Config);
+                int speedIndex = 0;
+                for (const auto& speed : speeds) {
+                    if (speed <= 0) continue;
+                    if (wanted(candidate.second, speedIndex, j)) {
+                        // Changing the end state's speed will cause recalculation of approx cost if necessary
+                        wrapper.setSpeed(speed);
+                        children.push_back({Vertex::connect(sourceVertex, wrapper, destinationVertex->coverageAllowed(),
+                                                            m_Arena), candidate.second, speedIndex, j});
                     }
+                    speedIndex++;
                 }
-            } else {
-                // otherwise we're done with this turning radius (and heap)
-                doneChecks[j] = true;
             }
         }
     }
-    for (auto& bestSamples : bestSamplesHeaps) {
-        // Push the closest K onto the open list
-        if (bestSamples.size() > k()) throw std::runtime_error("Somehow got too many samples in the heap");
-        for (auto& destinationVertex : bestSamples) {
-            // use the wrapper from the vertex to save re-computing it but ditch the rest
-            auto wrapper = destinationVertex->parentEdge()->getPlan(m_Config);
-            for (const auto& speed : speeds) {
-                if (speed <= 0) continue;
-                // Changing the end state's speed will cause recalculation of approx cost if necessary
-                wrapper.setSpeed(speed);
-                auto v = Vertex::connect(sourceVertex, wrapper, destinationVertex->coverageAllowed());
-                v->parentEdge()->computeTrueCost(m_Config);
-                pushVertexQueue(v);
-            }
+    nearest.stop();
+    // the sample children already have their curves but the rest don't
+    for (const auto& child : children) {
+        child.V->setChildKey({child.Sample, child.SpeedIndex, child.RadiusIndex});
+        if (child.Sample < 0) child.V->parentEdge()->computeApproxCost(m_DubinsCache);
+    }
+    if (m_Config.lazyEdgeEvaluation()) {
+        // queue on the Dubins lengths for now; the true costs get computed when (if) these come off the open list.
+        // Rewiring needs true costs so it isn't done here
+        for (const auto& child : children) {
+            child.V->setLazyCost(m_Config);
+            pushVertexQueue(child.V);
+        }
+    } else {
+        // each child has its own ribbon manager and edge, so the evaluations don't interfere with each other
+        auto evaluate = [&](size_t i) { children[i].V->parentEdge()->computeTrueCost(m_Config); };
+        // visualizations write to a shared stream from inside computeTrueCost, so those stay on this thread
+        if (m_Config.edgeEvaluationThreads() > 1 && !m_Config.visualizations()) {
+            workerPool().parallelFor(children.size(), evaluate);
+        } else {
+            for (size_t i = 0; i < children.size(); i++) evaluate(i);
+        }
+        m_Stats.EdgesEvaluated += children.size();
+        for (const auto& child : children) {
+            if (child.Sample >= 0 && m_Config.incrementalSearch() &&
+                !rewire(child.V, child.Sample, child.SpeedIndex, child.RadiusIndex)) continue;
+            pushVertexQueue(child.V);
         }
     }
+    sourceVertex->setExpandedSampleCount(m_Samples.size());
     m_Stats.Expanded++;
 }
 
@@ -156,19 +353,319 @@ int SamplingBasedPlanner::k() const {
 
 void SamplingBasedPlanner::addSamples(StateGenerator& generator, int n) {
     m_AttemptedSamples += n;
+    // generate and check the map in bulk, then keep the ones that aren't blocked
+    m_SampleBatch.clear();
+    {
+        Profiler::Scope profile(Profiler::Sampling);
+        generator.generate(n, m_SampleBatch);
+    }
+    m_Samples.reserve(m_Samples.size() + n);
+    if (m_NextPooledSample < m_PooledSamples.size()) {
+        // Where the last plan sampled, one of its samples stands in for each fresh one. They were drawn evenly over
+        // the same kind of window so the density stays even, and they've already been checked against the map.
+        auto& batch = m_SampleBatch;
+        size_t fresh = 0;
+        for (int i = 0; i < n; i++) {
+            if (m_NextPooledSample < m_PooledSamples.size() && m_PooledWindow.contains(batch.X[i], batch.Y[i])) {
+                const auto& s = m_PooledSamples[m_NextPooledSample++];
+                m_Samples.add(s.x(), s.y(), s.heading());
+                m_SampleIndex.add(m_Samples.x(m_Samples.size() - 1), m_Samples.y(m_Samples.size() - 1),
+                                  m_Samples.size() - 1);
+                m_Stats.ReusedSamples++;
+            } else {
+                batch.X[fresh] = batch.X[i];
+                batch.Y[fresh] = batch.Y[i];
+                batch.Heading[fresh] = batch.Heading[i];
+                batch.Speed[fresh] = batch.Speed[i];
+                fresh++;
+            }
+        }
+        batch.X.resize(fresh);
+        batch.Y.resize(fresh);
+        batch.Heading.resize(fresh);
+        batch.Speed.resize(fresh);
+        n = (int)fresh;
+    }
+    m_SampleBlocked.resize(n);
+    {
+        Profiler::Scope profile(Profiler::MapChecks);
+        m_Config.map()->checkBlocked(m_SampleBatch.X.data(), m_SampleBatch.Y.data(), n, m_SampleBlocked.data());
+    }
     for (int i = 0; i < n; i++) {
-        const auto s = generator.generate();
-        if (!m_Config.map()->isBlocked(s.x(), s.y()))
-            m_Samples.push_back(s);
+        if (!m_SampleBlocked[i]) {
+            m_Samples.add(m_SampleBatch.X[i], m_SampleBatch.Y[i], m_SampleBatch.Heading[i]);
+            // where the store put it, which is where it is from now on
+            m_SampleIndex.add(m_Samples.x(m_Samples.size() - 1), m_Samples.y(m_Samples.size() - 1),
+                              m_Samples.size() - 1);
+        }
     }
 }
 
+void SamplingBasedPlanner::clearSamples() {
+    m_Samples.clear();
+    // batched Dubins is the only thing that wants the trig
+    m_Samples.setKeepTrig(m_Config.batchDubins());
+    m_SampleIndex.clear();
+    m_SampleVertices.clear();
+}
+
+void SamplingBasedPlanner::takePooledSamples(const SamplePool::Window& window) {
+    m_PooledSamples.clear();
+    m_NextPooledSample = 0;
+    m_PooledWindow = SamplePool::Window();
+    const auto& pool = m_Config.samplePool();
+    if (pool) m_PooledWindow = pool->take(m_Config.map(), m_Config.maxSpeed(), window, m_PooledSamples);
+}
+
+void SamplingBasedPlanner::keepSamples(const SamplePool::Window& window) {
+    const auto& pool = m_Config.samplePool();
+    // ones we didn't get to are left out, since they'd only make the last plan's part of the window denser
+    if (pool) pool->keep(m_Config.map(), m_Config.maxSpeed(), window, m_Samples.states());
+    m_PooledSamples.clear();
+}
+
+bool SamplingBasedPlanner::rewire(const Vertex::SharedPtr& vertex, int sampleIndex, int speedIndex, int radiusIndex) {
+    if (vertex->parentEdge()->infeasible()) return false;
+    auto key = ((int64_t)sampleIndex * 2 + speedIndex) * 2 + radiusIndex;
+    auto& slot = m_SampleVertices[key];
+    auto existing = slot.lock();
+    if (existing && !existing->replaced() && existing->ribbonManager().sameRibbonsAs(vertex->ribbonManager())) {
+        // same place, same speed, same work left to do, so the cheaper one wins
+        if (existing->currentCost() <= vertex->currentCost()) return false;
+        existing->setReplaced();
+    }
+    slot = vertex;
+    return true;
+}
+
+bool SamplingBasedPlanner::closedListAdmits(const Vertex::SharedPtr& vertex) {
+    if (vertex->isRoot() || !vertex->evaluated()) return true;
+    const auto& s = vertex->state();
+    const auto resolution = m_Config.closedListResolution();
+    const auto headingResolution = m_Config.closedListHeadingResolution();
+    ClosedCell cell;
+    cell.X = (int64_t)floor(s.x() / resolution);
+    cell.Y = (int64_t)floor(s.y() / resolution);
+    auto heading = fmod(s.heading(), 2 * M_PI);
+    if (heading < 0) heading += 2 * M_PI;
+    // so the last cell wraps around to meet the first
+    cell.Heading = (int64_t)floor(heading / headingResolution) % (int64_t)ceil(2 * M_PI / headingResolution);
+    cell.Time = (int64_t)floor((s.time() - m_StartStateTime) * m_Config.maxSpeed() / resolution);
+    cell.Speed = s.speed();
+    cell.CoverageAllowed = vertex->coverageAllowed();
+    cell.Ribbons = vertex->ribbonManager().heuristicKey();
+    auto& slot = m_ClosedList[cell];
+    auto existing = slot.lock();
+    if (existing && !existing->replaced() && existing->ribbonManager().sameRibbonsAs(vertex->ribbonManager())) {
+        m_Stats.Dominated++;
+        if (existing->currentCost() <= vertex->currentCost()) return false;
+        existing->setReplaced();
+    }
+    slot = vertex;
+    return true;
+}
+
+size_t SamplingBasedPlanner::ClosedCellHash::operator()(const ClosedCell& c) const {
+    uint64_t h = c.Ribbons;
+    for (uint64_t v : {(uint64_t)c.X, (uint64_t)c.Y, (uint64_t)c.Heading, (uint64_t)c.Time}) {
+        h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    h ^= std::hash<double>()(c.Speed) + (c.CoverageAllowed? 1 : 0);
+    return h;
+}
+
+void SamplingBasedPlanner::requeueVertex(Vertex::SharedPtr vertex) {
+    auto f = vertex->f();
+    auto bytes = footprint(*vertex);
+    Profiler::Scope profile(Profiler::Heap);
+    if (m_UseOpenList) {
+        m_OpenList.push(f, std::move(vertex));
+    } else {
+        m_VertexQueue.push_back(std::move(vertex));
+        std::push_heap(m_VertexQueue.begin(), m_VertexQueue.end(), getVertexComparator());
+    }
+    profile.stop();
+    countSearchMemory(bytes);
+}
+
+void SamplingBasedPlanner::countSearchMemory(size_t added, size_t removed) {
+    m_SearchMemory += added;
+    m_SearchMemory -= std::min(removed, m_SearchMemory);
+    const auto budget = m_Config.searchMemoryBudget();
+    if (budget > 0 && m_SearchMemory > budget) forgetWorstVertices();
+    m_Stats.PeakSearchMemory = std::max(m_Stats.PeakSearchMemory, m_SearchMemory);
+}
+
+void SamplingBasedPlanner::forgetWorstVertices() {
+    // only the f-ordered open list knows which vertices are the worst
+    if (!m_UseOpenList) return;
+    // leave some room so this doesn't happen again on the very next push
+    const auto target = (size_t)(m_Config.searchMemoryBudget() * c_ForgetToFraction);
+    // vertices to put back on the open list and the f to put them back with, in the order they first came up (so the
+    // search doesn't depend on where things are in memory), whether they count towards the memory again, and whether
+    // they're going back on to make dropped children again
+    struct Requeue {
+        double F;
+        Vertex::SharedPtr V;
+        bool Counted, Parent;
+    };
+    std::vector<Requeue> requeue;
+    std::unordered_map<const Vertex*, size_t> requeueIndices;
+    auto putBack = [&](double f, const Vertex::SharedPtr& v, bool counted, bool parent) {
+        auto it = requeueIndices.find(v.get());
+        if (it == requeueIndices.end()) {
+            requeueIndices[v.get()] = requeue.size();
+            requeue.push_back({f, v, counted, parent});
+        } else {
+            auto& r = requeue[it->second];
+            r.F = std::min(r.F, f);
+            r.Counted |= counted;
+            r.Parent |= parent;
+        }
+    };
+    while (m_SearchMemory > target && m_OpenList.size() > 1) {
+        m_OpenList.dropWorst(std::max<size_t>(1, m_OpenList.size() / 8), [&](double f, Vertex::SharedPtr v) {
+            m_SearchMemory -= std::min(footprint(*v), m_SearchMemory);
+            // No plan gets anywhere without the root, so it goes straight back on. So does anything that's been
+            // expanded (parents waiting to make dropped children again, or ones incremental search requeued), since
+            // they can still have children in the tree, which making them again from scratch would duplicate
+            if (v->isRoot() || v->expandedSampleCount() > 0) {
+                putBack(f, v, true, false);
+                return;
+            }
+            m_Stats.Forgotten++;
+            const auto& parent = v->parent();
+            if (parent->replaced()) return;
+            parent->forgetChild(v->childKey());
+            // The parent goes back on the open list with the best f it lost (which is still a lower bound on everything
+            // through it, so nothing better than the incumbent gets pruned for good) and makes the dropped ones again
+            // if it comes back off. If it's on the list already from last time it stays where it is, since a second
+            // entry would come off after the first had made everything
+            if (parent->forgottenF() < 0 || requeueIndices.count(parent.get())) {
+                putBack(std::max(f, parent->f()), parent, false, true);
+            }
+        });
+    }
+    for (auto& r : requeue) {
+        if (r.Counted) m_SearchMemory += footprint(*r.V);
+        // (forgottenF is what marks it as being on the list for its dropped children)
+        if (r.Parent || r.V->forgottenF() >= 0) r.V->setForgottenF(r.F);
+        if (r.Parent) m_ForgottenParents.push_back(r.V);
+        m_OpenList.push(r.F, std::move(r.V));
+    }
+}
+
+size_t SamplingBasedPlanner::footprint(const Vertex& v) {
+    // shared pointer control blocks live alongside the objects (make_shared or the arena), give or take
+    auto bytes = sizeof(Vertex) + c_ControlBlockBytes;
+    if (v.isRoot()) return bytes;
+    bytes += sizeof(Edge) + c_ControlBlockBytes;
+    // vertices that covered something have their own copy of the ribbons
+    if (!v.ribbonManager().sharesRibbonsWith(v.parent()->ribbonManager())) bytes += v.ribbonManager().ribbonBytes();
+    return bytes;
+}
+
 void SamplingBasedPlanner::addSamples(StateGenerator& generator) {
     addSamples(generator, m_Samples.size());
 }
 
 void SamplingBasedPlanner::clearVertexQueue() {
     m_VertexQueue.clear();
+    m_OpenList.clear();
+    m_ClosedList.clear();
+    m_SearchMemory = 0;
+    // without their place on the open list, dropped children are as good as pruned (they were no better than what
+    // was left), so a fresh search expands their parents from scratch
+    for (const auto& p : m_ForgottenParents) {
+        auto parent = p.lock();
+        if (parent) parent->takeForgottenChildren();
+    }
+    m_ForgottenParents.clear();
+}
+
+void SamplingBasedPlanner::setUpDubinsCache() {
+    m_DubinsCache = nullptr;
+    if (!m_Config.useDubinsCache()) return;
+    if (m_Config.dubinsCache()) {
+        m_DubinsCache = m_Config.dubinsCache().get();
+    } else {
+        if (!m_OwnDubinsCache) m_OwnDubinsCache = std::make_shared<DubinsCache>();
+        else m_OwnDubinsCache->clear();
+        m_DubinsCache = m_OwnDubinsCache.get();
+    }
+    m_StartDubinsCacheHits = m_DubinsCache->hits();
+    m_StartDubinsCacheMisses = m_DubinsCache->misses();
+}
+
+void SamplingBasedPlanner::recordDubinsCacheStats() {
+    if (!m_DubinsCache) return;
+    m_Stats.DubinsCacheHits = m_DubinsCache->hits() - m_StartDubinsCacheHits;
+    m_Stats.DubinsCacheMisses = m_DubinsCache->misses() - m_StartDubinsCacheMisses;
+    auto lookups = m_Stats.DubinsCacheHits + m_Stats.DubinsCacheMisses;
+    m_Stats.DubinsCacheHitRate = lookups == 0? 0 : (double)m_Stats.DubinsCacheHits / lookups;
+}
+
+void SamplingBasedPlanner::setUpHeuristicCache() {
+    if (!m_Config.useHeuristicCache()) return;
+    if (!m_Config.heuristicCache()) {
+        // keyed by ribbons, so unlike the Dubins cache there's no need to clear our own between plans
+        if (!m_OwnHeuristicCache) m_OwnHeuristicCache = std::make_shared<HeuristicCache>();
+        m_Config.setHeuristicCache(m_OwnHeuristicCache);
+    }
+    m_StartHeuristicCacheHits = m_Config.heuristicCache()->hits();
+    m_StartHeuristicCacheMisses = m_Config.heuristicCache()->misses();
+}
+
+void SamplingBasedPlanner::recordHeuristicCacheStats() {
+    if (!m_Config.useHeuristicCache()) return;
+    // if it's shared with other planners these include their lookups too
+    m_Stats.HeuristicCacheHits = m_Config.heuristicCache()->hits() - m_StartHeuristicCacheHits;
+    m_Stats.HeuristicCacheMisses = m_Config.heuristicCache()->misses() - m_StartHeuristicCacheMisses;
+}
+
+void SamplingBasedPlanner::setUpObstacleProjection() {
+    if (!m_Config.precomputeObstacles()) return;
+    // the config is our own copy so this doesn't touch the caller's manager, which can keep getting updates
+    auto projection = m_Config.obstacleProjection();
+    if (!projection) {
+        projection = m_Config.obstaclesManager().precompute(m_Config.startStateTime(), m_Config.timeHorizon());
+        // how big it is is up to the manager, so just count it
+        if (projection) Profiler::countAllocation(Profiler::ObstacleSnapshots, 0);
+    }
+    if (projection) m_Config.setObstaclesManager(projection);
+}
+
+void SamplingBasedPlanner::setUpObstacleRaster(double minX, double maxX, double minY, double maxY) {
+    if (!m_Config.useObstacleRaster()) return;
+    auto& pool = workerPool();
+    auto raster = std::make_shared<ObstacleCostRaster>(m_Config.obstaclesManagerPtr(), minX, maxX,
+            minY, maxY, m_Config.startStateTime(), m_Config.timeHorizon(), m_Config.obstacleRasterCellSize(),
+            m_Config.obstacleRasterTimeStep(), m_Config.obstacleRasterMaxCells(),
+            [&pool](size_t n, const std::function<void(size_t)>& task) { pool.parallelFor(n, task); });
+    Profiler::countAllocation(Profiler::ObstacleSnapshots, sizeof(ObstacleCostRaster) + raster->cells() * sizeof(float));
+    m_Config.setObstaclesManager(raster);
+}
+
+WorkerPool& SamplingBasedPlanner::workerPool() {
+    // the config can change between plans, so remake the pool if the thread count did
+    if (!m_WorkerPool || m_WorkerPool->threads() != m_Config.edgeEvaluationThreads()) {
+        m_WorkerPool.reset(new WorkerPool(m_Config.edgeEvaluationThreads()));
+    }
+    return *m_WorkerPool;
+}
+
+SearchArena::SharedPtr SamplingBasedPlanner::acquireArena() {
+    // let go of the current one so it can be recycled if nothing else holds on to it
+    m_Arena = nullptr;
+    for (const auto& arena : m_ArenaPool) {
+        // the only reference left is the pool's, so nothing lives in the arena
+        if (arena.use_count() == 1) {
+            arena->reset();
+            return arena;
+        }
+    }
+    m_ArenaPool.push_back(std::make_shared<SearchArena>());
+    return m_ArenaPool.back();
 }
 
 std::function<bool(const std::shared_ptr<Vertex>& v1, const std::shared_ptr<Vertex>& v2)> SamplingBasedPlanner::getDubinsComparator(
@@ -184,8 +681,8 @@ Planner::Stats SamplingBasedPlanner::plan(const RibbonManager&, const State& sta
                                       double timeRemaining) {
     m_Config = config;
     m_StartStateTime = start.time();
-    m_Samples.clear();
-    m_VertexQueue.clear();
+    clearSamples();
+    clearVertexQueue();
     m_Stats = Stats();
     double minX, maxX, minY, maxY, minSpeed = m_Config.maxSpeed(), maxSpeed = m_Config.maxSpeed();
     double magnitude = m_Config.maxSpeed() * m_Config.timeHorizon();
@@ -199,7 +696,7 @@ Planner::Stats SamplingBasedPlanner::plan(const RibbonManager&, const State& sta
     std::shared_ptr<Vertex> vertex;
     for (vertex = Vertex::makeRoot(start, m_RibbonManager);
          !goalCondition(vertex); vertex = popVertexQueue()) {
-        expand(vertex, m_Config.obstaclesManager());
+        if (!vertex->replaced()) expand(vertex, m_Config.obstaclesManager());
     }
     m_Stats.Plan = std::move(tracePlan(vertex, false, m_Config.obstaclesManager()));
     m_Stats.Samples = m_Samples.size();
@@ -208,32 +705,32 @@ Planner::Stats SamplingBasedPlanner::plan(const RibbonManager&, const State& sta
 }
 
 void SamplingBasedPlanner::visualizeVertex(Vertex::SharedPtr v, const std::string& tag, bool expanded) {
-    if (m_Config.visualizations()) {
-        m_Config.visualizationStream() << (expanded? "Expanded " : "Generated ") <<
-        v->toString() << " " << tag << " " << v->getPointerTreeString() << std::endl;
+    if (m_Config.visualizations() && m_Config.visualizer().sample(Visualizer::Vertices)) {
+        // what getPointerTreeString spells out, without making any strings
+        m_VisualizationAncestry.clear();
+        for (const Vertex* a = v.get(); a; a = a->isRoot()? nullptr : a->parent().get()) {
+            m_VisualizationAncestry.push_back(reinterpret_cast<long>(a));
+        }
+        std::reverse(m_VisualizationAncestry.begin(), m_VisualizationAncestry.end());
+        auto h = v->approxToGoIfComputed();
+        m_Config.visualizer().vertex(v->state(), v->currentCost() + h, v->currentCost(), h, expanded, tag.c_str(),
+                                     m_VisualizationAncestry);
     }
 }
 
 bool SamplingBasedPlanner::vertexQueueEmpty() const {
-    return m_VertexQueue.empty();
+    return m_UseOpenList? m_OpenList.empty() : m_VertexQueue.empty();
 }
 
 void SamplingBasedPlanner::visualizeRibbons(const RibbonManager& ribbonManager) {
-    if (m_Config.visualizations()) {
-        m_Config.visualizationStream() << ribbonManager.dumpRibbons() << "\nEnd Ribbons" << std::endl;
+    if (m_Config.visualizations() && m_Config.visualizer().sample(Visualizer::Notes)) {
+        m_Config.visualizer().note(ribbonManager.dumpRibbons() + "\nEnd Ribbons");
     }
 }
 
 void SamplingBasedPlanner::visualizePlan(const DubinsPlan& plan) {
-    if (m_Config.visualizations()) {
-        State s;
-        s.time() = plan.getStartTime();
-        while (s.time() < plan.getEndTime()) {
-            plan.sample(s);
-            m_Config.visualizationStream() << "State: (" << s.toStringRad() << "), f: " << 0 << ", g: " << 0 << ", h: " <<
-                                           0 << " plan" << std::endl;
-            s.time() += 1;
-        }
+    if (m_Config.visualizations() && m_Config.visualizer().sample(Visualizer::Plans)) {
+        for (const auto& s : plan.getSamples(1)) m_Config.visualizer().state(s, 0, 0, 0, Visualizer::PlanState);
     }
 }
 
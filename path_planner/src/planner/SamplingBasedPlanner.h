@@ -3,7 +3,13 @@
 
 #include "Planner.h"
 #include "utilities/StateGenerator.h"
+#include "utilities/SampleIndex.h"
+#include "utilities/SampleStore.h"
+#include "utilities/WorkerPool.h"
+#include "utilities/SharedIncumbent.h"
+#include "search/OpenList.h"
 #include <functional>
+#include <unordered_map>
 
 /**
  * Class initially designed to represent a uniform cost search planner. That implementation didn't get updated when we
@@ -42,6 +48,19 @@ public:
      */
     virtual void expand(const std::shared_ptr<Vertex>& sourceVertex, const DynamicObstaclesManager& obstacles);
 
+    /**
+     * Incremental search rewiring. Each (sample, speed, turning radius) keeps track of the cheapest vertex that got
+     * there; if the new vertex has the same ribbons left as that one, only the cheaper of the two survives; if it's the
+     * old one that loses, it gets marked replaced so it's skipped when it comes off the open list. Its children that
+     * are already in the tree are left alone - they're valid, just more expensive.
+     * @param vertex the newly generated vertex
+     * @param sampleIndex
+     * @param speedIndex
+     * @param radiusIndex
+     * @return whether the new vertex should go on the open list
+     */
+    bool rewire(const Vertex::SharedPtr& vertex, int sampleIndex, int speedIndex, int radiusIndex);
+
     /**
      * Increase the number of samples.
      * @param generator
@@ -49,16 +68,105 @@ public:
     void addSamples(StateGenerator& generator);
     void addSamples(StateGenerator& generator, int n);
 
+    /**
+     * Remove all samples.
+     */
+    void clearSamples();
+
+    /**
+     * Take the samples the config's sample pool kept from the last plan that are in this plan's window, so
+     * addSamples() can use them in place of fresh ones in the part of the window the last plan already sampled.
+     * @param window this plan's window
+     */
+    void takePooledSamples(const SamplePool::Window& window);
+
+    /**
+     * Give this plan's samples to the config's sample pool for the next plan.
+     * @param window this plan's window
+     */
+    void keepSamples(const SamplePool::Window& window);
+
+    /**
+     * Prune against an incumbent shared with other planners as well as our own (null to stop).
+     * @param incumbent
+     */
+    void setSharedIncumbent(SharedIncumbent::SharedPtr incumbent) { m_SharedIncumbent = std::move(incumbent); }
+
 protected:
     double m_StartStateTime;
-    std::vector<State> m_Samples;
+    SampleStore m_Samples;
+    // scratch space for generating samples in bulk
+    StateGenerator::Batch m_SampleBatch;
+    std::vector<unsigned char> m_SampleBlocked;
+    // scratch space for a vertex's ancestry when it gets visualized
+    std::vector<long> m_VisualizationAncestry;
+    // spatial index over m_Samples for nearest-first walks during expansion
+    SampleIndex m_SampleIndex;
+    // samples from the last plan, used (in order) in place of fresh ones that land in the window they were drawn from
+    std::vector<State> m_PooledSamples;
+    size_t m_NextPooledSample = 0;
+    SamplePool::Window m_PooledWindow;
     unsigned long m_AttemptedSamples = 0;
     int m_ExpandedCount = 0;
 
     Vertex::SharedPtr m_BestVertex;
+    // best f found by any planner we're running alongside (may be null)
+    SharedIncumbent::SharedPtr m_SharedIncumbent;
 
     RibbonManager m_RibbonManager;
 
+    // Whether to use the f-ordered OpenList instead of the generic heap ordered by getVertexComparator(). Planners that
+    // order by f (A*) should turn this on; it's much cheaper per operation.
+    bool m_UseOpenList = false;
+
+    // Dubins cache for this plan (null means don't cache)
+    DubinsCache* m_DubinsCache = nullptr;
+
+    /**
+     * Pick the Dubins cache for this plan based on the config, and note where its counts started.
+     */
+    void setUpDubinsCache();
+
+    /**
+     * Put this plan's Dubins cache hits and misses into the stats.
+     */
+    void recordDubinsCacheStats();
+
+    /**
+     * Make sure the config has a heuristic cache if caching is on, and note where its counts started.
+     */
+    void setUpHeuristicCache();
+
+    /**
+     * Put this plan's heuristic cache hits and misses into the stats.
+     */
+    void recordHeuristicCacheStats();
+
+    /**
+     * If precomputing obstacles is on, swap the config's obstacles manager for a snapshot of it over the horizon.
+     */
+    void setUpObstacleProjection();
+
+    /**
+     * If the obstacle raster is on, swap the config's obstacles manager for its costs rasterized over the window.
+     * Goes after setUpObstacleProjection so the rasterizing gets to use the snapshot.
+     * @param minX
+     * @param maxX
+     * @param minY
+     * @param maxY
+     */
+    void setUpObstacleRaster(double minX, double maxX, double minY, double maxY);
+
+    // arena the current iteration's tree is allocated from (null means heap)
+    SearchArena::SharedPtr m_Arena;
+
+    /**
+     * Grab an arena nobody's using any more for the next iteration's tree, resetting it, or make a new one if they're
+     * all still referenced (by the incumbent, for instance).
+     * @return
+     */
+    SearchArena::SharedPtr acquireArena();
+
     /**
      * Retrieve a function that compares vertices. This orders the open list. Probably over-complicated but very general.
      * @return
@@ -93,6 +201,33 @@ protected:
      */
     void visualizeRibbons(const RibbonManager& ribbonManager);
 
+    /**
+     * Put a vertex that's already been through pushVertexQueue back on the open list, without pruning, stats or
+     * visualization. Used by incremental search to re-expand old vertices towards new samples.
+     * @param vertex
+     */
+    void requeueVertex(Vertex::SharedPtr vertex);
+
+    /**
+     * Keep track of roughly how much memory the search tree takes up: each vertex on the open list, plus each one
+     * that's been expanded (which its children keep around). If that goes over the config's budget, the open list's
+     * worst vertices get dropped until it's back under (see forgetWorstVertices()). The peak goes in the stats.
+     * @param added bytes
+     * @param removed bytes
+     */
+    void countSearchMemory(size_t added, size_t removed = 0);
+
+    /**
+     * Closed list check for a vertex about to go on the open list. Vertices in the same cell of (x, y, heading, time),
+     * at the same speed and allowed to cover the same way, with the same ribbons left, are taken to be the same state,
+     * and only the cheapest one survives: a new vertex that costs at least as much as the one already there is
+     * dropped, and an old one that costs more gets marked replaced like in rewire(). Only evaluated vertices take part,
+     * since lazy ones don't know where their edges really end.
+     * @param vertex
+     * @return whether the vertex should go on the open list
+     */
+    bool closedListAdmits(const Vertex::SharedPtr& vertex);
+
     /**
      * Check whether the open list is empty.
      * @return
@@ -101,13 +236,76 @@ protected:
 
 private:
     std::vector<std::shared_ptr<Vertex>> m_VertexQueue;
+    OpenList m_OpenList;
+    // rough size of the search tree, see countSearchMemory()
+    size_t m_SearchMemory = 0;
+    // vertices put back on the open list to make dropped children again, so starting the search over can forget that
+    std::vector<std::weak_ptr<Vertex>> m_ForgottenParents;
+
+    // when over the memory budget, how far under it to get to, so dropping vertices doesn't happen every push
+    static constexpr double c_ForgetToFraction = 0.9;
+    // rough size of a shared pointer's control block
+    static constexpr size_t c_ControlBlockBytes = 16;
 
     /**
-     * State comparison to order samples for Dubins path computation.
-     * @param origin
+     * SMA* style memory bounding: drop the vertices with the largest f from the open list (freeing them and anything
+     * hanging off them nobody else holds) until the search tree is back under budget. Each one's parent remembers
+     * which children it lost and the best f of them, and goes back on the open list with that, to make those children
+     * (and only those) again if they turn out to be worth it after all. Only leaves get dropped: vertices that have
+     * been expanded go straight back on. Only does anything with the f-ordered open list.
+     */
+    void forgetWorstVertices();
+
+    /**
+     * @param v
+     * @return roughly how much memory the vertex and its parent edge take up, counting its ribbons if they're its own
+     */
+    static size_t footprint(const Vertex& v);
+
+    std::vector<SearchArena::SharedPtr> m_ArenaPool;
+
+    // cache used when the config doesn't supply one, and the counts at the start of the plan
+    DubinsCache::SharedPtr m_OwnDubinsCache;
+    unsigned long m_StartDubinsCacheHits = 0, m_StartDubinsCacheMisses = 0;
+
+    // same deal for the heuristic cache
+    HeuristicCache::SharedPtr m_OwnHeuristicCache;
+    unsigned long m_StartHeuristicCacheHits = 0, m_StartHeuristicCacheMisses = 0;
+
+    // samples to find Dubins lengths for at once when batching them during expansion
+    static constexpr size_t c_DubinsBatchSize = 16;
+
+    // threads for evaluating child edges in parallel, made on first use
+    std::unique_ptr<WorkerPool> m_WorkerPool;
+
+    /**
+     * Get the worker pool, making it (or re-making it) with the configured number of threads if necessary.
      * @return
      */
-    std::function<bool(const State& s1, const State& s2)> getStateComparator(const State& origin);
+    WorkerPool& workerPool();
+
+    // incremental search: cheapest vertex at each (sample, speed, turning radius), see rewire()
+    std::unordered_map<int64_t, std::weak_ptr<Vertex>> m_SampleVertices;
+
+    // closed list cell, see closedListAdmits()
+    struct ClosedCell {
+        int64_t X, Y, Heading, Time;
+        double Speed;
+        bool CoverageAllowed;
+        uint64_t Ribbons;
+
+        bool operator==(const ClosedCell& other) const {
+            return X == other.X && Y == other.Y && Heading == other.Heading && Time == other.Time &&
+                   Speed == other.Speed && CoverageAllowed == other.CoverageAllowed && Ribbons == other.Ribbons;
+        }
+    };
+
+    struct ClosedCellHash {
+        size_t operator()(const ClosedCell& c) const;
+    };
+
+    // cheapest vertex in each closed list cell this tree, cleared along with the open list
+    std::unordered_map<ClosedCell, std::weak_ptr<Vertex>, ClosedCellHash> m_ClosedList;
 
     /**
      * Vertex comparison which uses Dubins distance to order expansion.
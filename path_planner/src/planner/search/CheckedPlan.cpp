@@ -0,0 +1,80 @@
+#include <algorithm>
+#include "CheckedPlan.h"
+
+CheckedPlan::CheckedPlan(const CheckedPlan& other) {
+    *this = other;
+}
+
+CheckedPlan& CheckedPlan::operator=(const CheckedPlan& other) {
+    if (&other == this) return *this;
+    std::lock(m_Mutex, other.m_Mutex);
+    std::lock_guard<std::mutex> lock(m_Mutex, std::adopt_lock), otherLock(other.m_Mutex, std::adopt_lock);
+    m_Vertices = other.m_Vertices;
+    m_Map = other.m_Map;
+    m_Obstacles = other.m_Obstacles;
+    return *this;
+}
+
+void CheckedPlan::record(const Vertex::SharedPtr& end, const PlannerConfig& config,
+                         DynamicObstaclesManager::ConstSharedPtr obstacles) {
+    std::vector<Vertex::SharedPtr> vertices;
+    for (auto v = end; v && !v->isRoot(); v = v->parent()) {
+        const auto& edge = *v->parentEdge();
+        if (!edge.trueCostComputed()) continue;
+        const auto& parent = *v->parent();
+        auto copy = Vertex::connect(Vertex::makeRoot(parent.state(), parent.ribbonManager()), edge.getPlan(config),
+                                    v->coverageAllowed());
+        copy->parentEdge()->adoptTrueCost(edge, config);
+        vertices.push_back(copy);
+    }
+    std::reverse(vertices.begin(), vertices.end());
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Vertices = std::move(vertices);
+    m_Map = config.map();
+    m_Obstacles = std::move(obstacles);
+}
+
+Vertex::SharedPtr CheckedPlan::find(const DubinsWrapper& path, const Vertex& parent, bool coverageAllowed,
+                                    const PlannerConfig& config,
+                                    const DynamicObstaclesManager::ConstSharedPtr& obstacles) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (config.map() != m_Map || !obstacles || !m_Obstacles) return nullptr;
+    for (const auto& v : m_Vertices) {
+        const auto& edge = *v->parentEdge();
+        if (!samePath(edge.getPlan(config), path)) continue;
+        if (v->coverageAllowed() != coverageAllowed) return nullptr;
+        const auto& oldRibbons = v->parent()->ribbonManager();
+        if (!oldRibbons.sameRibbonsAs(parent.ribbonManager()) ||
+            oldRibbons.coverageCompletedTime() != parent.ribbonManager().coverageCompletedTime()) return nullptr;
+        // the path can't get farther from its start than its length
+        State start;
+        start.time() = path.getStartTime();
+        path.sample(start);
+        auto reach = path.getSpeed() * path.getNetTime();
+        if (obstacles->changedNear(*m_Obstacles, start.x() - reach, start.y() - reach, start.x() + reach,
+                                   start.y() + reach, path.getStartTime(), path.getEndTime(), true)) return nullptr;
+        return v;
+    }
+    return nullptr;
+}
+
+void CheckedPlan::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Vertices.clear();
+    m_Map = nullptr;
+    m_Obstacles = nullptr;
+}
+
+size_t CheckedPlan::size() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Vertices.size();
+}
+
+bool CheckedPlan::samePath(const DubinsWrapper& a, const DubinsWrapper& b) {
+    if (a.getStartTime() != b.getStartTime() || a.getEndTime() != b.getEndTime() || a.getSpeed() != b.getSpeed() ||
+        a.getRho() != b.getRho()) return false;
+    const auto& p = a.unwrap(), & q = b.unwrap();
+    if (p.type != q.type) return false;
+    for (int i = 0; i < 3; i++) if (p.qi[i] != q.qi[i] || p.param[i] != q.param[i]) return false;
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef SRC_CHECKEDPLAN_H
+#define SRC_CHECKEDPLAN_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Vertex.h"
+
+/**
+ * The edges of the last plan, with their costs and the map and obstacles they were checked against. The next plan
+ * starts by checking what's left of the previous plan again, and an edge only needs sweeping if something it depends
+ * on has changed: the map, the ribbons at its start, or obstacles near it (see DynamicObstaclesManager::changedNear).
+ * Obstacle snapshots and maps are immutable, so the pointers are as good as version numbers to tell if they've
+ * changed at all.
+ *
+ * Thread-safe, although it only holds one plan, so planners running side by side should each have their own copy.
+ */
+class CheckedPlan {
+public:
+    typedef std::shared_ptr<CheckedPlan> SharedPtr;
+
+    CheckedPlan() = default;
+
+    /**
+     * Copies share the vertices, which don't change once they're recorded.
+     */
+    CheckedPlan(const CheckedPlan& other);
+    CheckedPlan& operator=(const CheckedPlan& other);
+
+    /**
+     * Remember the plan ending at a vertex. Each evaluated edge gets copied out on its own, so the search tree (and
+     * any arena it's in) can go.
+     * @param end
+     * @param config the config the plan was made with, for its map
+     * @param obstacles the snapshot the plan was checked against
+     */
+    void record(const Vertex::SharedPtr& end, const PlannerConfig& config,
+                DynamicObstaclesManager::ConstSharedPtr obstacles);
+
+    /**
+     * Find an edge along exactly the same path, from a vertex with the same ribbons, whose cost still holds for the
+     * config's map and the given obstacles.
+     * @param path
+     * @param parent the vertex the new edge starts from
+     * @param coverageAllowed
+     * @param config
+     * @param obstacles the snapshot, rather than any projection of it the config has
+     * @return the end of the edge, or null if the edge needs sweeping again
+     */
+    Vertex::SharedPtr find(const DubinsWrapper& path, const Vertex& parent, bool coverageAllowed,
+                           const PlannerConfig& config,
+                           const DynamicObstaclesManager::ConstSharedPtr& obstacles) const;
+
+    /**
+     * Forget the plan.
+     */
+    void clear();
+
+    /**
+     * @return how many edges are remembered
+     */
+    size_t size() const;
+
+    /**
+     * @param a
+     * @param b
+     * @return whether two paths are exactly the same, times included
+     */
+    static bool samePath(const DubinsWrapper& a, const DubinsWrapper& b);
+
+private:
+    mutable std::mutex m_Mutex;
+    // end vertices of copies of the plan's edges, in order
+    std::vector<Vertex::SharedPtr> m_Vertices;
+    Map::SharedPtr m_Map;
+    DynamicObstaclesManager::ConstSharedPtr m_Obstacles;
+};
+
+
+#endif //SRC_CHECKEDPLAN_H
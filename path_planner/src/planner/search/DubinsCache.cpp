@@ -0,0 +1,46 @@
+#include <cmath>
+#include "DubinsCache.h"
+
+DubinsCache::DubinsCache(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    m_Entries.resize(size);
+    m_Mask = size - 1;
+}
+
+void DubinsCache::set(DubinsWrapper& wrapper, const State& s1, const State& s2, double rho) {
+    // until we change State to use yaw internally...
+    double q1[3] = {s1.x(), s1.y(), s1.yaw()};
+    double q2[3] = {s2.x(), s2.y(), s2.yaw()};
+    int64_t key[c_KeySize] = {
+            llround(q1[0] / c_PositionQuantum), llround(q1[1] / c_PositionQuantum), llround(q1[2] / c_AngleQuantum),
+            llround(q2[0] / c_PositionQuantum), llround(q2[1] / c_PositionQuantum), llround(q2[2] / c_AngleQuantum),
+            llround(rho / c_RadiusQuantum)
+    };
+    uint64_t hash = 1469598103934665603ULL;
+    for (auto k : key) {
+        hash ^= (uint64_t)k;
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    auto& entry = m_Entries[hash & m_Mask];
+    bool hit = entry.Valid;
+    for (int i = 0; hit && i < c_KeySize; i++) hit = entry.Key[i] == key[i];
+    if (hit) {
+        m_Hits++;
+        auto path = entry.Path;
+        // move it to exactly where we asked for
+        for (int i = 0; i < 3; i++) path.qi[i] = q1[i];
+        wrapper.fill(path, s1.speed(), s1.time());
+        return;
+    }
+    m_Misses++;
+    dubins_shortest_path(&entry.Path, q1, q2, rho);
+    for (int i = 0; i < c_KeySize; i++) entry.Key[i] = key[i];
+    entry.Valid = true;
+    wrapper.fill(entry.Path, s1.speed(), s1.time());
+}
+
+void DubinsCache::clear() {
+    for (auto& e : m_Entries) e.Valid = false;
+}
@@ -0,0 +1,68 @@
+#ifndef SRC_DUBINSCACHE_H
+#define SRC_DUBINSCACHE_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <path_planner_common/State.h>
+#include <path_planner_common/DubinsWrapper.h>
+
+/**
+ * Bounded cache of Dubins solutions keyed by quantized start pose, end pose and turning radius. Each doubling pass
+ * connects the same vertices to the same samples over again, so most dubins_shortest_path calls are repeats.
+ *
+ * The table is direct-mapped: each key has one slot and a new entry just replaces whatever was there. That keeps it a
+ * fixed size with no allocation after construction, at the cost of the odd eviction of something still useful.
+ *
+ * Hits are for poses within the quantization of each other, not necessarily identical ones, so the cached path gets
+ * its start moved to the requested start pose. The quantization is fine enough that the rest doesn't matter. Not
+ * thread-safe.
+ */
+class DubinsCache {
+public:
+    typedef std::shared_ptr<DubinsCache> SharedPtr;
+
+    /**
+     * Construct a cache.
+     * @param capacity number of slots (rounded up to a power of two)
+     */
+    explicit DubinsCache(size_t capacity = c_DefaultCapacity);
+
+    /**
+     * Set the wrapper to the Dubins path between the states, computing it only if it isn't cached. Like
+     * DubinsWrapper::set, speed and start time come from the start state.
+     * @param wrapper
+     * @param s1
+     * @param s2
+     * @param rho
+     */
+    void set(DubinsWrapper& wrapper, const State& s1, const State& s2, double rho);
+
+    /**
+     * Remove everything (counts are kept).
+     */
+    void clear();
+
+    unsigned long hits() const { return m_Hits; }
+    unsigned long misses() const { return m_Misses; }
+
+private:
+    static constexpr int c_KeySize = 7;
+
+    struct Entry {
+        bool Valid = false;
+        int64_t Key[c_KeySize];
+        DubinsPath Path;
+    };
+
+    std::vector<Entry> m_Entries;
+    size_t m_Mask;
+    unsigned long m_Hits = 0, m_Misses = 0;
+
+    static constexpr size_t c_DefaultCapacity = 1 << 14;
+    // quantization of positions (m), angles (rad) and radii (m)
+    static constexpr double c_PositionQuantum = 1e-4, c_AngleQuantum = 1e-6, c_RadiusQuantum = 1e-6;
+};
+
+
+#endif //SRC_DUBINSCACHE_H
@@ -2,17 +2,133 @@
 #include <algorithm>
 #include <memory>
 #include "Edge.h"
+#include "../utilities/Profiler.h"
+#include "../../common/map/GridWorldMap.h"
+#include "../../common/map/GeoTiffMap.h"
+#include "../../common/dynamic_obstacles/BinaryDynamicObstaclesManager.h"
+#include "../../common/dynamic_obstacles/BinaryObstacleProjection.h"
+#include "../../common/dynamic_obstacles/GaussianDynamicObstaclesManager.h"
 #include <cfloat>
+#include <typeinfo>
+
+namespace {
+/*
+ * What the edge sweep asks the map and the obstacles, for the sweep to be compiled against. The exact versions call
+ * the concrete class's own functions (it has to be exactly that class), so there's no vtable and whatever's defined in
+ * the header gets inlined. The rest go through the vtable like before.
+ */
+template <class M>
+struct ExactMap {
+    const M& Map;
+    explicit ExactMap(const ::Map& map) : Map(static_cast<const M&>(map)) {}
+    bool isBlocked(double x, double y) const { return Map.M::isBlocked(x, y); }
+    void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+        Map.M::checkBlocked(x, y, n, blocked);
+    }
+    bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const {
+        return Map.M::possiblyBlocked(minX, minY, maxX, maxY);
+    }
+    double distanceToBlocked(double x, double y) const { return Map.M::distanceToBlocked(x, y); }
+};
+
+struct AnyMap {
+    const ::Map& Map;
+    explicit AnyMap(const ::Map& map) : Map(map) {}
+    bool isBlocked(double x, double y) const { return Map.isBlocked(x, y); }
+    void checkBlocked(const double* x, const double* y, size_t n, unsigned char* blocked) const {
+        Map.checkBlocked(x, y, n, blocked);
+    }
+    bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const {
+        return Map.possiblyBlocked(minX, minY, maxX, maxY);
+    }
+    double distanceToBlocked(double x, double y) const { return Map.distanceToBlocked(x, y); }
+};
+
+template <class O>
+struct ExactObstacles {
+    const O& Obstacles;
+    explicit ExactObstacles(const DynamicObstaclesManager& obstacles) : Obstacles(static_cast<const O&>(obstacles)) {}
+    double collisionExists(const State& s, bool strict) const {
+        return Obstacles.O::collisionExists(s.x(), s.y(), s.time(), strict);
+    }
+    double collisionExists(double x, double y, double time, bool strict) const {
+        return Obstacles.O::collisionExists(x, y, time, strict);
+    }
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const {
+        return Obstacles.O::distanceToNearestPossibleCollision(x, y, time, strict);
+    }
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const {
+        return Obstacles.O::possibleCollision(minX, minY, maxX, maxY, startTime, endTime, strict);
+    }
+    double maxObstacleSpeed() const { return Obstacles.O::maxObstacleSpeed(); }
+};
+
+struct AnyObstacles {
+    const DynamicObstaclesManager& Obstacles;
+    explicit AnyObstacles(const DynamicObstaclesManager& obstacles) : Obstacles(obstacles) {}
+    double collisionExists(const State& s, bool strict) const { return Obstacles.collisionExists(s, strict); }
+    double collisionExists(double x, double y, double time, bool strict) const {
+        return Obstacles.collisionExists(x, y, time, strict);
+    }
+    double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const {
+        return Obstacles.distanceToNearestPossibleCollision(x, y, time, strict);
+    }
+    bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                           bool strict) const {
+        return Obstacles.possibleCollision(minX, minY, maxX, maxY, startTime, endTime, strict);
+    }
+    double maxObstacleSpeed() const { return Obstacles.maxObstacleSpeed(); }
+};
+
+// with nothing to hit, the obstacle checks compile away
+struct NoObstacles {
+    explicit NoObstacles(const DynamicObstaclesManager&) {}
+    double collisionExists(const State&, bool) const { return 0; }
+    double collisionExists(double, double, double, bool) const { return 0; }
+    double distanceToNearestPossibleCollision(double, double, double, bool) const { return DBL_MAX; }
+    bool possibleCollision(double, double, double, double, double, double, bool) const { return false; }
+    double maxObstacleSpeed() const { return 0; }
+};
+
+// an edge's samples for the batched sweep, one array per field, kept per thread so they don't get reallocated for
+// every edge
+struct SweepSamples {
+    std::vector<double> X, Y, Heading, Time, Collision;
+    std::vector<unsigned char> Blocked;
+    // the time after the last sample
+    double EndTime = 0;
+
+    void clear() {
+        X.clear(); Y.clear(); Heading.clear(); Time.clear();
+    }
+
+    void push(const State& s) {
+        X.push_back(s.x()); Y.push_back(s.y()); Heading.push_back(s.heading()); Time.push_back(s.time());
+    }
+
+    size_t size() const { return X.size(); }
+
+    // put sample i back into a state
+    void get(size_t i, State& s) const {
+        s.x() = X[i]; s.y() = Y[i]; s.heading() = Heading[i]; s.time() = Time[i];
+    }
+};
+thread_local SweepSamples t_SweepSamples;
+}
 
 Edge::Edge(std::shared_ptr<Vertex> start) {
     this->m_Start = std::move(start);
+    Profiler::countAllocation(Profiler::Edges, sizeof(Edge));
 }
 
-double Edge::computeApproxCost(double maxSpeed, double turningRadius) {
+double Edge::computeApproxCost(double maxSpeed, double turningRadius, DubinsCache* cache) {
     if (start()->state().isCoLocated(end()->state())) {
         m_ApproxCost = 0;
     } else {
-        m_DubinsWrapper.set(start()->state(), end()->state(), turningRadius);
+        Profiler::Scope profile(Profiler::Dubins);
+        if (cache) cache->set(m_DubinsWrapper, start()->state(), end()->state(), turningRadius);
+        else m_DubinsWrapper.set(start()->state(), end()->state(), turningRadius);
 
         m_ApproxCost = m_DubinsWrapper.length() / maxSpeed * Edge::timePenaltyFactor();
     }
@@ -23,18 +139,32 @@ double Edge::netTime() {
     return end()->state().time() - start()->state().time();
 }
 
+void Edge::sweptBox(const State& from, double toTime, double box[4]) const {
+    State to(from);
+    to.time() = toTime;
+    m_DubinsWrapper.sample(to);
+    auto length = m_DubinsWrapper.getSpeed() * (toTime - from.time());
+    // a little extra for rounding in the samples
+    auto chord = from.distanceTo(to);
+    auto slack = sqrt(fmax(length * length - chord * chord, 0)) / 2 + 1e-6;
+    box[0] = fmin(from.x(), to.x()) - slack; box[1] = fmin(from.y(), to.y()) - slack;
+    box[2] = fmax(from.x(), to.x()) + slack; box[3] = fmax(from.y(), to.y()) + slack;
+}
+
 DubinsWrapper Edge::getPlan(const PlannerConfig& config) {
     approxCost(); // throw the error if not calculated
+    Profiler::countCopy(Profiler::DubinsWrappers, sizeof(DubinsWrapper));
     return m_DubinsWrapper;
 }
 
-std::shared_ptr<Vertex> Edge::setEnd(const State &state) {
-    auto ptr = std::make_shared<Vertex>(state, std::shared_ptr<Edge>(this));
+std::shared_ptr<Vertex> Edge::setEnd(const State &state, const SearchArena::SharedPtr& arena) {
+    auto ptr = arena? std::allocate_shared<Vertex>(ArenaAllocator<Vertex>(arena), state, shared_from_this()) :
+            std::make_shared<Vertex>(state, shared_from_this());
     m_End = ptr;
     return ptr;
 }
 
-std::shared_ptr<Vertex> Edge::start() const {
+const std::shared_ptr<Vertex>& Edge::start() const {
     return m_Start;
 }
 
@@ -61,157 +191,545 @@ bool Edge::infeasible() const {
     return m_Infeasible;
 }
 
-double Edge::computeApproxCost() {
-    return computeApproxCost(end()->state().speed(), end()->turningRadius());
+double Edge::computeApproxCost(DubinsCache* cache) {
+    return computeApproxCost(end()->state().speed(), end()->turningRadius(), cache);
 }
 
-double Edge::computeTrueCost(PlannerConfig& config) {
-    if (start()->state().isCoLocated(end()->state())) {
+Edge::SweepStart Edge::beginSweep(const PlannerConfig& config) {
+    const auto endVertex = end();
+    if (start()->state().isCoLocated(endVertex->state())) {
         std::cerr << "Computing cost of edge between two co-located states is likely an error" << std::endl;
     }
     // get speed from end state
-    double speed = end()->state().speed(), turningRadius = config.turningRadius();
+    double speed = endVertex->state().speed(), turningRadius = config.turningRadius();
     assert(speed > 0);
-    if (end()->coverageAllowed()) {
+    if (endVertex->coverageAllowed()) {
         turningRadius = config.coverageTurningRadius();
     }
     if (m_ApproxCost == -1 || (m_DubinsWrapper.getRho() != turningRadius))
-        // if the parameters are different now we need to re-calculate the curve
+        // if the parameters are different now we need to re-calculate the curve (no cache - this can run on the
+        // worker pool, so do the approximate cost ahead of time if caching matters)
         computeApproxCost(speed, turningRadius);
     if (m_DubinsWrapper.getSpeed() != speed) {
         // update the speed if it's different
         m_DubinsWrapper.setSpeed(speed);
     }
     if (m_ApproxCost < 0) throw std::runtime_error("Could not compute approximate cost");
-    double collisionPenalty = 0;
-    std::vector<std::pair<double, double>> result;
-    State intermediate(start()->state());
+    SweepStart sweepStart{start()->state()};
+    auto& intermediate = sweepStart.Intermediate;
     // truncate longer edges than 30 seconds
-    auto endTime = fmin(config.timeHorizon() + 1e-12 + config.startStateTime(),m_DubinsWrapper.getEndTime());
-    // time, relative to this edge, of when the ribbons are done (not super necessary but convenient)
-    auto ribbonsDoneTime = -1;
-    auto ribbonManagerStartedDone = end()->ribbonManager().done();
+    sweepStart.EndTime = fmin(config.timeHorizon() + 1e-12 + config.startStateTime(),m_DubinsWrapper.getEndTime());
+    sweepStart.RibbonsStartedDone = endVertex->ribbonManager().done();
 
-    double dynamicDistance = 0, toCoverDistance = 0;
-    std::vector<std::pair<double, double>> newlyCovered;
-    double lastHeading = start()->state().heading();
-    int visCount = int(1.0 / config.collisionCheckingIncrement()); // counter to reduce visualization frequency
-
-    auto startG = start()->currentCost();
-    auto startH = start()->approxToGo();
-
-    if (intermediate.time() >= endTime) {
-        if (intermediate.time() > endTime) std::cerr << "Negative length edge" << std::endl;
+    if (intermediate.time() >= sweepStart.EndTime) {
+        if (intermediate.time() > sweepStart.EndTime) std::cerr << "Negative length edge" << std::endl;
         else {
             std::cerr << "Zero length edge: " << std::endl;
             std::cerr << "\t" << start()->state().toString() << std::endl;
-            std::cerr << "\t" << end()->state().toString() << std::endl;
+            std::cerr << "\t" << endVertex->state().toString() << std::endl;
         }
         m_Infeasible = true;
     }
 
     // Collision check at max speed, even if we're going slower. This will make going slower in congested areas look
     // artificially better, because they'll accrue a smaller penalty per time
-    auto timeIncrement = config.collisionCheckingIncrement() / config.maxSpeed();
+    sweepStart.TimeIncrement = config.collisionCheckingIncrement() / config.maxSpeed();
 
     // nudge along a little so we check at an even amount of intervals from the start state
     auto timeSinceStart = intermediate.time() - config.startStateTime();
-    auto timeNudge = fmod(timeSinceStart, timeIncrement);
+    auto timeNudge = fmod(timeSinceStart, sweepStart.TimeIncrement);
     intermediate.time() += timeNudge;
+    return sweepStart;
+}
 
-    if (config.visualizations())
-        config.visualizationStream() << "Trajectory:" << std::endl;
-    // collision check along the curve (and watch out for newly covered points, too)
-    while (intermediate.time() < endTime) {
-        try {
-            m_DubinsWrapper.sample(intermediate);
+void Edge::coverAnalytically(const PlannerConfig& config, double fromTime, double& endTime, int& ribbonsDoneTime) {
+    Profiler::Scope profile(Profiler::Coverage);
+    const auto endVertex = end();
+    auto& ribbons = endVertex->ribbonManager();
+    auto finished = [&](double time) {
+        ribbons.setCoverageCompletedTime(time);
+        ribbonsDoneTime = time;
+        endTime = fmin(endTime, ribbons.coverageCompletedTime() + config.timeMinimum());
+    };
+    if (ribbons.done()) {
+        finished(fromTime);
+        return;
+    }
+    const bool coverageAllowed = endVertex->coverageAllowed();
+    const auto& path = m_DubinsWrapper.unwrap();
+    const auto speed = m_DubinsWrapper.getSpeed(), rho = m_DubinsWrapper.getRho();
+    auto segmentEnd = m_DubinsWrapper.getStartTime();
+    State a, b;
+    for (int i = 0; i < 3; i++) {
+        auto segmentStart = segmentEnd;
+        segmentEnd += path.param[i] * rho / speed;
+        auto from = fmax(segmentStart, fromTime), to = fmin(segmentEnd, endTime);
+        if (to <= from) continue;
+        // the heading stays the same along the straight segment, which counts even when covering while turning doesn't
+        const bool straight = i == 1 && path.type != RLR && path.type != LRL;
+        if (!straight && !coverageAllowed) continue;
+        // turns get chords short enough to stay within c_ArcCoverageSagitta of them
+        int chords = 1;
+        double margin = 0;
+        if (!straight) {
+            auto turn = (to - from) * speed / rho;
+            auto maxTurn = 2 * acos(1 - fmin(c_ArcCoverageSagitta / rho, 1));
+            chords = (int)ceil(turn / maxTurn);
+            margin = rho * (1 - cos(turn / chords / 2));
         }
-        catch (std::runtime_error& e) {
-            m_Infeasible = true;
-            *config.output() << "Encountered an error while collision checking: " << e.what() << std::endl;
-            break;
+        a.time() = from;
+        m_DubinsWrapper.sample(a);
+        for (int k = 1; k <= chords; k++) {
+            b.time() = k == chords? to : from + (to - from) * k / chords;
+            m_DubinsWrapper.sample(b);
+            auto along = ribbons.coverAlong(a.x(), a.y(), b.x(), b.y(), true, margin);
+            if (along >= 0 && ribbons.done()) {
+                finished(a.time() + along * (b.time() - a.time()));
+                return;
+            }
+            a = b;
+        }
+    }
+}
+
+double Edge::finishSweep(PlannerConfig& config, const State& last, double lastHeading, double endTime,
+                         int ribbonsDoneTime, bool ribbonsStartedDone, double collisionPenalty) {
+    const auto endVertex = end();
+    const bool coverageAllowed = endVertex->coverageAllowed();
+    auto& ribbons = endVertex->ribbonManager();
+    // set to the end of the edge (potentially truncated)
+    endVertex->state().time() = endTime;
+    m_DubinsWrapper.sample(endVertex->state());
+    m_DubinsWrapper.updateEndTime(endVertex->state().time()); // should just be truncating the path
+
+    // cover the last little bit
+    if (coverageAllowed || lastHeading == last.heading()) {
+        Profiler::Scope profile(Profiler::Coverage);
+        ribbons.cover(last.x(), last.y(), true);
+    }
+    if (ribbons.done()) {
+        // may need to set the time here too
+        if (ribbons.coverageCompletedTime() == -1) {
+            ribbons.setCoverageCompletedTime(last.time());
         }
+        ribbonsDoneTime = last.time();
+    }
+
+    assert(std::isfinite(netTime()));
+    assert(std::isfinite(collisionPenalty));
+    m_CollisionPenalty = collisionPenalty;
+    // time after ribbons covered doesn't count against you
+    auto t = fmax(netTime() - (ribbons.done()? (endTime - ribbonsDoneTime) : 0), 0);
+    if (ribbonsStartedDone) t = 0;
+    m_TrueCost = t * Edge::timePenaltyFactor() + collisionPenalty;
+
+    endVertex->setCurrentCost();
+
+    endVertex->computeApproxToGo(config);
+
+    return m_TrueCost;
+}
+
+template <class MapView, class ObstaclesView>
+double Edge::sweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles, bool adaptive) {
+    auto sweepStart = beginSweep(config);
+    // lock the end vertex once rather than on every sample
+    const auto endVertex = end();
+    double collisionPenalty = 0;
+    auto& intermediate = sweepStart.Intermediate;
+    auto endTime = sweepStart.EndTime;
+    const auto timeIncrement = sweepStart.TimeIncrement;
+    // time, relative to this edge, of when the ribbons are done (not super necessary but convenient)
+    auto ribbonsDoneTime = -1;
+
+    double toCoverDistance = 0;
+    double lastHeading = start()->state().heading();
+    int visCount = int(1.0 / config.collisionCheckingIncrement()); // counter to reduce visualization frequency
+
+    auto startG = start()->currentCost();
+    auto startH = start()->approxToGo();
+
+    if (config.analyticCoverage()) {
+        // the whole edge's coverage up front, so the samples don't need to do any
+        coverAnalytically(config, intermediate.time(), endTime, ribbonsDoneTime);
+        toCoverDistance = DBL_MAX;
+    }
+
+    // step along the curve rather than sampling from scratch every time
+    DubinsWrapper::Sampler sampler(m_DubinsWrapper, intermediate.time(), timeIncrement);
+
+    // adaptive checking: how many upcoming steps are known to be clear of the map and obstacles, and how long to wait
+    // before asking again when we're close to something
+    int clearSteps = 0, recheckIn = 0;
+    const auto maxObstacleSpeed = obstacles.maxObstacleSpeed();
+    // broad phase: stretches of the edge the obstacles can't get near don't need collisionExists at every step, and
+    // ones over open water don't need isBlocked either
+    double broadPhaseUntil = -DBL_MAX;
+    bool obstaclesPossible = true, mapPossible = true;
+
+    // the rest of what the loop needs, so it isn't going through the config or the end vertex every step
+    const auto increment = config.collisionCheckingIncrement();
+    const bool coverageAllowed = endVertex->coverageAllowed();
+    const auto timeMinimum = config.timeMinimum();
+    auto& ribbons = endVertex->ribbonManager();
+
+    // (a whole edge's states or none of them)
+    const bool visualize = config.visualizations() && config.visualizer().sample(Visualizer::Trajectories);
+    if (visualize) config.visualizer().trajectory();
+    // collision check along the curve (and watch out for newly covered points, too)
+    while (intermediate.time() < endTime) {
+        sampler.sample(intermediate);
         // visualize
-        if (config.visualizations() && visCount-- <= 0) {
-            visCount = int(1.0 / config.collisionCheckingIncrement());
+        if (visualize && visCount-- <= 0) {
+            visCount = int(1.0 / increment);
             auto timeSoFar = intermediate.time() - start()->state().time();
             auto gSoFar = startG + timeSoFar + collisionPenalty;
             // should really put visualizeVertex somewhere accessible
             // use start H because it isn't worth it to calculate current H
-            config.visualizationStream() << "State: (" << intermediate.toStringRad() << "), f: " << gSoFar + startH <<
-                ", g: " << gSoFar << ", h: " << startH << " trajectory" << std::endl;
-        }
-        if (config.map()->isBlocked(intermediate.x(), intermediate.y())) {
-            m_Infeasible = true;
-            break;
+            config.visualizer().state(intermediate, gSoFar + startH, gSoFar, startH, Visualizer::TrajectoryState);
         }
+        if (clearSteps > 0) {
+            // we already know there's nothing here
+            clearSteps--;
+        } else {
+            if (intermediate.time() > broadPhaseUntil) {
+                broadPhaseUntil = fmin(intermediate.time() + c_BroadPhaseSeconds, endTime);
+                double box[4];
+                sweptBox(intermediate, broadPhaseUntil, box);
+                obstaclesPossible = Profiler::measure(Profiler::ObstacleChecks, [&] {
+                    return obstacles.possibleCollision(box[0], box[1], box[2], box[3],
+                            intermediate.time(), broadPhaseUntil, true);
+                });
+                mapPossible = Profiler::measure(Profiler::MapChecks, [&] {
+                    return map.possiblyBlocked(box[0], box[1], box[2], box[3]);
+                });
+            }
 
-        // assess collision penalty
-        collisionPenalty +=
-                config.obstaclesManager().collisionExists(intermediate, true) * Edge::collisionPenaltyFactor();
+            if (mapPossible && Profiler::measure(Profiler::MapChecks, [&] {
+                    return map.isBlocked(intermediate.x(), intermediate.y());
+                })) {
+                m_Infeasible = true;
+                break;
+            }
+
+            // assess collision penalty
+            if (obstaclesPossible) {
+                Profiler::Scope profile(Profiler::ObstacleChecks);
+                collisionPenalty +=
+                        obstacles.collisionExists(intermediate, true) * Edge::collisionPenaltyFactor();
+            }
+
+            if (adaptive) {
+                if (recheckIn > 0) {
+                    recheckIn--;
+                } else {
+                    // We move at most one increment per step; obstacles close the gap by up to their speed times the
+                    // step duration. Minus one for the step we're on
+                    auto mapSteps = Profiler::measure(Profiler::MapChecks, [&] {
+                        return map.distanceToBlocked(intermediate.x(), intermediate.y());
+                    }) / increment;
+                    auto obstacleSteps = Profiler::measure(Profiler::ObstacleChecks, [&] {
+                        return obstacles.distanceToNearestPossibleCollision(
+                                intermediate.x(), intermediate.y(), intermediate.time(), true);
+                    }) / (increment + maxObstacleSpeed * timeIncrement);
+                    clearSteps = (int)fmin(fmin(mapSteps, obstacleSteps) - 1, c_MaxClearSteps);
+                    if (clearSteps <= 0) {
+                        // close to something, so don't bother asking for a bit
+                        clearSteps = 0;
+                        recheckIn = c_ClearanceRecheckSteps;
+                    }
+                }
+            }
+        }
 
-        if (toCoverDistance > config.collisionCheckingIncrement()) {
-            toCoverDistance -= config.collisionCheckingIncrement();
+        if (toCoverDistance > increment) {
+            toCoverDistance -= increment;
         } else {
+            Profiler::Scope profile(Profiler::Coverage);
             // do this first because cover splits ribbons so you'd never get one that "contains" the point so it
             // could be a bit more work
-            toCoverDistance = end()->ribbonManager().minDistanceFrom(intermediate.x(), intermediate.y());
-            if (end()->coverageAllowed() || lastHeading == intermediate.heading()) {
-                end()->ribbonManager().cover(intermediate.x(), intermediate.y(), true);
+            toCoverDistance = ribbons.minDistanceFrom(intermediate.x(), intermediate.y());
+            if (coverageAllowed || lastHeading == intermediate.heading()) {
+                ribbons.cover(intermediate.x(), intermediate.y(), true);
             }
-            if (end()->ribbonManager().done()) {
+            if (ribbons.done()) {
                 // if no prior edge has finished coverage yet, set the coverage completed time now
-                if (end()->ribbonManager().coverageCompletedTime() == -1) {
-                    end()->ribbonManager().setCoverageCompletedTime(intermediate.time());
+                if (ribbons.coverageCompletedTime() == -1) {
+                    ribbons.setCoverageCompletedTime(intermediate.time());
                 }
                 ribbonsDoneTime = intermediate.time();
                 // truncate only if we hit the time minimum *after coverage* - the adjusted end time
-                endTime = fmin(endTime, end()->ribbonManager().coverageCompletedTime() + config.timeMinimum());
+                endTime = fmin(endTime, ribbons.coverageCompletedTime() + timeMinimum);
             }
 
         }
-        intermediate.time() += timeIncrement;
+        // Take all the steps we know are clear at once, as long as the ribbon skip above would have skipped them too.
+        // Keeps to the same grid of times as stepping one at a time would
+        auto steps = 1;
+        if (clearSteps > 0) {
+            // (once the ribbons are done there's nothing left to cover, so that limit goes away)
+            steps = ribbons.done()? clearSteps :
+                    (int)fmin(clearSteps, toCoverDistance / increment);
+            if (steps < 1) steps = 1;
+        }
+        if (steps > 1) {
+            clearSteps -= steps - 1;
+            toCoverDistance -= (steps - 1) * increment;
+            visCount -= steps - 1;
+            sampler.advance(steps - 1);
+            // the heading from the step just before the next sample, as if we'd stepped there
+            if (sampler.time() < m_DubinsWrapper.getEndTime()) sampler.sample(intermediate);
+        }
+        sampler.advance();
+        intermediate.time() = sampler.time();
         lastHeading = intermediate.heading();
     }
-    // set to the end of the edge (potentially truncated)
-    end()->state().time() = endTime;
-    m_DubinsWrapper.sample(end()->state());
-    m_DubinsWrapper.updateEndTime(end()->state().time()); // should just be truncating the path
+    return finishSweep(config, intermediate, lastHeading, endTime, ribbonsDoneTime, sweepStart.RibbonsStartedDone,
+                       collisionPenalty);
+}
 
-    // cover the last little bit
-    if (end()->coverageAllowed() || lastHeading == intermediate.heading()) {
-        end()->ribbonManager().cover(intermediate.x(), intermediate.y(), true);
+template <class MapView, class ObstaclesView>
+double Edge::batchedSweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles) {
+    auto sweepStart = beginSweep(config);
+    const auto endVertex = end();
+    auto& intermediate = sweepStart.Intermediate;
+    auto endTime = sweepStart.EndTime;
+    const auto timeIncrement = sweepStart.TimeIncrement;
+    const auto increment = config.collisionCheckingIncrement();
+    const bool coverageAllowed = endVertex->coverageAllowed();
+    auto& ribbons = endVertex->ribbonManager();
+    auto ribbonsDoneTime = -1;
+    const bool analyticCoverage = config.analyticCoverage();
+    if (analyticCoverage) coverAnalytically(config, intermediate.time(), endTime, ribbonsDoneTime);
+    const auto sampledEndTime = endTime;
+
+    // stage one: sample everything up to the end (before any truncation for coverage), on the same grid of times the
+    // scalar sweep steps along
+    auto& samples = t_SweepSamples;
+    samples.clear();
+    {
+        DubinsWrapper::Sampler sampler(m_DubinsWrapper, intermediate.time(), timeIncrement);
+        State s(intermediate);
+        while (sampler.time() < endTime) {
+            sampler.sample(s);
+            samples.push(s);
+            sampler.advance();
+        }
+        samples.EndTime = sampler.time();
     }
-    if (end()->ribbonManager().done()) {
-        // may need to set the time here too
-        if (end()->ribbonManager().coverageCompletedTime() == -1) {
-            end()->ribbonManager().setCoverageCompletedTime(intermediate.time());
+    const auto n = samples.size();
+
+    // map pass: the first blocked sample, a broad phase's worth at a time so it can stop there
+    const auto chunk = (size_t)fmax(c_BroadPhaseSeconds / timeIncrement, 1);
+    auto blocked = n;
+    samples.Blocked.resize(n);
+    {
+        Profiler::Scope profile(Profiler::MapChecks);
+        for (size_t i = 0; i < n && blocked == n; i += chunk) {
+            auto m = std::min(chunk, n - i);
+            const double* x = samples.X.data() + i;
+            const double* y = samples.Y.data() + i;
+            auto xs = std::minmax_element(x, x + m), ys = std::minmax_element(y, y + m);
+            if (!map.possiblyBlocked(*xs.first, *ys.first, *xs.second, *ys.second)) continue;
+            map.checkBlocked(x, y, m, samples.Blocked.data() + i);
+            for (size_t j = 0; j < m; j++) {
+                if (samples.Blocked[i + j]) {
+                    blocked = i + j;
+                    break;
+                }
+            }
         }
-        ribbonsDoneTime = intermediate.time();
     }
 
-    assert(std::isfinite(netTime()));
-    assert(std::isfinite(collisionPenalty));
-    m_CollisionPenalty = collisionPenalty;
-    // time after ribbons covered doesn't count against you
-    auto t = fmax(netTime() - (end()->ribbonManager().done()? (endTime - ribbonsDoneTime) : 0), 0);
-    if (ribbonManagerStartedDone) t = 0;
-    m_TrueCost = t * Edge::timePenaltyFactor() + collisionPenalty;
+    // coverage pass: has to go in order, since covering changes the ribbons and finishing them truncates the edge.
+    // Goes until the first blocked sample or the truncated end, whichever's first
+    double toCoverDistance = analyticCoverage? DBL_MAX : 0;
+    double lastHeading = start()->state().heading();
+    // samples after this one have the truncated end time
+    auto truncatedAfter = n;
+    size_t reached = 0;
+    {
+        Profiler::Scope profile(Profiler::Coverage);
+        for (; reached < blocked && samples.Time[reached] < endTime; reached++) {
+            if (toCoverDistance > increment) {
+                toCoverDistance -= increment;
+            } else {
+                auto x = samples.X[reached], y = samples.Y[reached];
+                toCoverDistance = ribbons.minDistanceFrom(x, y);
+                if (coverageAllowed || lastHeading == samples.Heading[reached]) {
+                    ribbons.cover(x, y, true);
+                }
+                if (ribbons.done()) {
+                    if (ribbons.coverageCompletedTime() == -1) {
+                        ribbons.setCoverageCompletedTime(samples.Time[reached]);
+                    }
+                    ribbonsDoneTime = samples.Time[reached];
+                    if (truncatedAfter == n) truncatedAfter = reached;
+                    endTime = fmin(endTime, ribbons.coverageCompletedTime() + config.timeMinimum());
+                }
+            }
+            lastHeading = samples.Heading[reached];
+        }
+    }
+    // the scalar sweep only finds the blocked sample if it gets there before the end
+    const bool hitBlocked = reached == blocked && blocked < n && samples.Time[blocked] < endTime;
+    if (hitBlocked) m_Infeasible = true;
+
+    // obstacle pass over the samples the edge keeps, with the same broad phase as the scalar sweep so it's exactly
+    // the same samples asked about
+    samples.Collision.assign(reached, 0);
+    {
+        Profiler::Scope profile(Profiler::ObstacleChecks);
+        State from(intermediate);
+        for (size_t i = 0; i < reached;) {
+            samples.get(i, from);
+            auto until = fmin(samples.Time[i] + c_BroadPhaseSeconds, i > truncatedAfter? endTime : sampledEndTime);
+            double box[4];
+            sweptBox(from, until, box);
+            auto possible = obstacles.possibleCollision(box[0], box[1], box[2], box[3], samples.Time[i], until, true);
+            for (; i < reached && samples.Time[i] <= until; i++) {
+                if (possible) samples.Collision[i] = obstacles.collisionExists(samples.X[i], samples.Y[i],
+                                                                               samples.Time[i], true);
+            }
+        }
+    }
 
-    end()->setCurrentCost();
+    // add up in order (and visualize, including the blocked sample like the scalar sweep does)
+    const bool visualize = config.visualizations() && config.visualizer().sample(Visualizer::Trajectories);
+    if (visualize) config.visualizer().trajectory();
+    auto startG = start()->currentCost();
+    auto startH = start()->approxToGo();
+    int visCount = int(1.0 / increment);
+    double collisionPenalty = 0;
+    State last(intermediate);
+    const auto visited = hitBlocked? reached + 1 : reached;
+    for (size_t i = 0; i < visited; i++) {
+        if (visualize && visCount-- <= 0) {
+            visCount = int(1.0 / increment);
+            samples.get(i, last);
+            auto gSoFar = startG + (samples.Time[i] - start()->state().time()) + collisionPenalty;
+            config.visualizer().state(last, gSoFar + startH, gSoFar, startH, Visualizer::TrajectoryState);
+        }
+        if (i < reached) collisionPenalty += samples.Collision[i] * Edge::collisionPenaltyFactor();
+    }
 
-    end()->computeApproxToGo(config);
+    // where the scalar sweep would have left off
+    if (hitBlocked) {
+        // at the blocked sample
+        samples.get(blocked, last);
+    } else if (reached > 0) {
+        // at the last sample, with the time after it
+        samples.get(reached - 1, last);
+        last.time() = reached < n? samples.Time[reached] : samples.EndTime;
+    }
+    return finishSweep(config, last, lastHeading, endTime, ribbonsDoneTime, sweepStart.RibbonsStartedDone,
+                       collisionPenalty);
+}
 
-    return m_TrueCost;
+template <class MapView, class ObstaclesView>
+double Edge::validatedSweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles) {
+    const auto endVertex = end();
+    // everything a sweep changes, to put back in between
+    const auto dubinsWrapper = m_DubinsWrapper;
+    const auto approxCost = m_ApproxCost;
+    const auto infeasible = m_Infeasible;
+    const auto endState = endVertex->state();
+    const auto ribbons = endVertex->ribbonManager();
+
+    auto scalarCost = sweep(config, map, obstacles, false);
+    const auto scalarPenalty = m_CollisionPenalty;
+    const auto scalarInfeasible = m_Infeasible;
+    const auto scalarEndState = endVertex->state();
+    const auto scalarRibbons = endVertex->ribbonManager();
+    const auto scalarApproxToGo = endVertex->approxToGo();
+
+    m_DubinsWrapper = dubinsWrapper;
+    m_ApproxCost = approxCost;
+    m_Infeasible = infeasible;
+    endVertex->state() = endState;
+    endVertex->ribbonManager() = ribbons;
+
+    auto cost = batchedSweep(config, map, obstacles);
+    const auto& batchedRibbons = endVertex->ribbonManager();
+    if (cost != scalarCost || m_CollisionPenalty != scalarPenalty || m_Infeasible != scalarInfeasible ||
+        endVertex->state().time() != scalarEndState.time() || !endVertex->state().isCoLocated(scalarEndState) ||
+        batchedRibbons.coverageCompletedTime() != scalarRibbons.coverageCompletedTime() ||
+        !batchedRibbons.sameRibbonsAs(scalarRibbons) || endVertex->approxToGo() != scalarApproxToGo) {
+        throw std::logic_error("Batched edge sweep disagrees with the scalar one from " + start()->state().toString() +
+                               " to " + endState.toString());
+    }
+    return cost;
+}
+
+template <class MapView, class ObstaclesView>
+double Edge::sweepWith(Edge& edge, PlannerConfig& config) {
+    MapView map(*config.map());
+    ObstaclesView obstacles(config.obstaclesManager());
+    if (!config.batchedEdgeSweep()) return edge.sweep(config, map, obstacles, config.adaptiveCollisionChecking());
+    if (config.validateEdgeSweep()) return edge.validatedSweep(config, map, obstacles);
+    return edge.batchedSweep(config, map, obstacles);
+}
+
+template <class MapView>
+PlannerConfig::EdgeSweep Edge::pickSweep(const DynamicObstaclesManager& obstacles) {
+    const auto& type = typeid(obstacles);
+    if (type == typeid(DynamicObstaclesManager)) return &sweepWith<MapView, NoObstacles>;
+    if (type == typeid(BinaryObstacleProjection)) return &sweepWith<MapView, ExactObstacles<BinaryObstacleProjection>>;
+    if (type == typeid(BinaryDynamicObstaclesManager)) {
+        if (static_cast<const BinaryDynamicObstaclesManager&>(obstacles).get().empty()) {
+            return &sweepWith<MapView, NoObstacles>;
+        }
+        return &sweepWith<MapView, ExactObstacles<BinaryDynamicObstaclesManager>>;
+    }
+    if (type == typeid(GaussianDynamicObstaclesManager)) {
+        if (static_cast<const GaussianDynamicObstaclesManager&>(obstacles).get().empty()) {
+            return &sweepWith<MapView, NoObstacles>;
+        }
+        return &sweepWith<MapView, ExactObstacles<GaussianDynamicObstaclesManager>>;
+    }
+    return &sweepWith<MapView, AnyObstacles>;
+}
+
+PlannerConfig::EdgeSweep Edge::pickSweep(const PlannerConfig& config) {
+    const auto& map = *config.map();
+    const auto& type = typeid(map);
+    if (type == typeid(GridWorldMap)) return pickSweep<ExactMap<GridWorldMap>>(config.obstaclesManager());
+    if (type == typeid(GeoTiffMap)) return pickSweep<ExactMap<GeoTiffMap>>(config.obstaclesManager());
+    if (type == typeid(Map)) return pickSweep<ExactMap<Map>>(config.obstaclesManager());
+    return pickSweep<AnyMap>(config.obstaclesManager());
+}
+
+double Edge::computeTrueCost(PlannerConfig& config) {
+    // the planner picks once per plan, but anyone else gets it worked out on the spot
+    auto sweep = config.edgeSweep();
+    if (!sweep) sweep = pickSweep(config);
+    return sweep(*this, config);
+}
+
+void Edge::adoptTrueCost(const Edge& other, const PlannerConfig& config) {
+    if (!other.trueCostComputed()) throw std::logic_error("Adopting the cost of an unevaluated edge");
+    auto endVertex = end();
+    auto otherEnd = other.end();
+    m_DubinsWrapper = other.m_DubinsWrapper;
+    Profiler::countCopy(Profiler::DubinsWrappers, sizeof(DubinsWrapper));
+    m_Infeasible = other.m_Infeasible;
+    m_CollisionPenalty = other.m_CollisionPenalty;
+    m_TrueCost = other.m_TrueCost;
+    // including any truncation
+    endVertex->state() = otherEnd->state();
+    endVertex->ribbonManager() = otherEnd->ribbonManager();
+    endVertex->setCurrentCost();
+    endVertex->computeApproxToGo(config);
 }
 
-std::shared_ptr<Vertex> Edge::setEnd(const DubinsWrapper& path) {
+std::shared_ptr<Vertex> Edge::setEnd(const DubinsWrapper& path, const SearchArena::SharedPtr& arena) {
     m_DubinsWrapper = path;
+    Profiler::countCopy(Profiler::DubinsWrappers, sizeof(DubinsWrapper));
     State s;
     s.time() = path.getEndTime();
     path.sample(s);
     m_ApproxCost = (s.time() - start()->state().time()) * timePenaltyFactor();
-    return setEnd(s);
+    return setEnd(s, arena);
 }
 
 
@@ -8,6 +8,7 @@
 #include <path_planner_common/DubinsPlan.h>
 #include "../PlannerConfig.h"
 #include "../utilities/Ribbon.h"
+#include "SearchArena.h"
 
 extern "C" {
 #include "dubins.h"
@@ -28,7 +29,7 @@ class Vertex;
  *
  * See the Vertex header for resource management of edges and vertices.
  */
-class Edge {
+class Edge : public std::enable_shared_from_this<Edge> {
 public:
     typedef std::shared_ptr<Edge> SharedPtr;
 
@@ -47,19 +48,21 @@ public:
     double approxCost() const;
 
     /**
-     * Set the ending vertex of this edge with a state.
+     * Set the ending vertex of this edge with a state. The edge must already be owned by a shared pointer.
      * @param state
+     * @param arena arena to allocate the vertex from (heap if null)
      * @return
      */
-    std::shared_ptr<Vertex> setEnd(const State& state);
+    std::shared_ptr<Vertex> setEnd(const State& state, const SearchArena::SharedPtr& arena = nullptr);
 
     /**
      * Set the ending vertex of this edge with a pre-computed Dubins curve. The path is sampled to determine the ending
      * state.
      * @param path
+     * @param arena arena to allocate the vertex from (heap if null)
      * @return
      */
-    std::shared_ptr<Vertex> setEnd(const DubinsWrapper& path);
+    std::shared_ptr<Vertex> setEnd(const DubinsWrapper& path, const SearchArena::SharedPtr& arena = nullptr);
 
     /**
      * Collision check the edge, computing the true cost. This also updates the ribbon manager associated with the
@@ -69,21 +72,46 @@ public:
      */
     double computeTrueCost(PlannerConfig& config);
 
+    /**
+     * Pick the version of the collision and coverage sweep compiled for the config's kinds of map and obstacles
+     * (falling back on one that goes through their vtables). Planners should set it on their config once the map and
+     * obstacles are settled for the plan (see PlannerConfig::setEdgeSweep), so computeTrueCost doesn't have to work it
+     * out each time.
+     * @param config
+     * @return
+     */
+    static PlannerConfig::EdgeSweep pickSweep(const PlannerConfig& config);
+
+    /**
+     * Take the true cost (and the end vertex's ribbons) from an edge along the same path whose start had the same
+     * ribbons, evaluated against the same map and obstacles, instead of sweeping this one. That's the case for a lot of
+     * the edges carried over from one plan's tree to the next (see AStarPlanner).
+     * @param other an evaluated edge
+     * @param config
+     */
+    void adoptTrueCost(const Edge& other, const PlannerConfig& config);
+
     /**
      * Retrieve the cached true cost, computing it if necessary.
      * @return
      */
     double trueCost() const;
 
+    /**
+     * @return whether computeTrueCost has been run on this edge (lazy search leaves it until the end vertex is popped)
+     */
+    bool trueCostComputed() const { return m_TrueCost != -1; }
+
     /**
      * Compute the Dubins curve between the states at the start and end vertices. That length, divided by the max speed,
      * is the approximate cost.
      * @param maxSpeed
      * @param turningRadius
+     * @param cache where to look up the curve first (optional)
      * @return
      */
-    double computeApproxCost(double maxSpeed, double turningRadius);
-    double computeApproxCost();
+    double computeApproxCost(double maxSpeed, double turningRadius, DubinsCache* cache = nullptr);
+    double computeApproxCost(DubinsCache* cache = nullptr);
 
     /**
      * Fetch the Dubins path in this edge. Throws an exception if not computed yet.
@@ -96,7 +124,7 @@ public:
     /**
      * @return the start vertex.
      */
-    std::shared_ptr<Vertex> start() const;
+    const std::shared_ptr<Vertex>& start() const;
 
     /**
      * @return the end vertex.
@@ -148,8 +176,105 @@ private:
      */
     double netTime();
 
+    /**
+     * Box the stretch of this edge from a state to a later time stays inside, for the broad phases against the map
+     * and the dynamic obstacles. Going at constant speed the edge covers length L in that time, so it stays inside
+     * the ellipse with foci at its endpoints p and q and major axis L, which sticks out of the box around p and q by
+     * at most its semi-minor axis sqrt(L^2 - |pq|^2) / 2, so that's the box.
+     * @param from state on the edge (already sampled)
+     * @param toTime
+     * @param box output (minX, minY, maxX, maxY)
+     */
+    void sweptBox(const State& from, double toTime, double box[4]) const;
+
+    // where a sweep starts from, worked out the same way whichever kind of sweep it is
+    struct SweepStart {
+        // the start state, nudged onto the grid of sample times
+        State Intermediate;
+        double EndTime, TimeIncrement;
+        bool RibbonsStartedDone;
+    };
+
+    /**
+     * Get the Dubins curve ready for a sweep and work out where it starts and ends.
+     * @param config
+     * @return
+     */
+    SweepStart beginSweep(const PlannerConfig& config);
+
+    /**
+     * Truncate the edge, cover the last little bit and set the costs, once a sweep's done.
+     * @param config
+     * @param last the last sample the sweep got to (with the time after it unless it was blocked)
+     * @param lastHeading heading at the sample before that
+     * @param endTime the (possibly truncated) end time
+     * @param ribbonsDoneTime when the sweep saw the ribbons done, or -1
+     * @param ribbonsStartedDone
+     * @param collisionPenalty
+     * @return the true cost
+     */
+    double finishSweep(PlannerConfig& config, const State& last, double lastHeading, double endTime,
+                       int ribbonsDoneTime, bool ribbonsStartedDone, double collisionPenalty);
+
+    /**
+     * Cover the ribbons along the edge straight from its segments (see PlannerConfig::setAnalyticCoverage), and
+     * truncate it if that finishes them.
+     * @param config
+     * @param fromTime
+     * @param endTime the end of the edge, which gets truncated
+     * @param ribbonsDoneTime set to when the ribbons were done, if they are
+     */
+    void coverAnalytically(const PlannerConfig& config, double fromTime, double& endTime, int& ribbonsDoneTime);
+
+    /**
+     * What computeTrueCost does, compiled for particular kinds of map and obstacles (see Edge.cpp for the views).
+     * @param config
+     * @param map
+     * @param obstacles
+     * @param adaptive whether to skip checks along stretches known to be clear
+     * @return the true cost
+     */
+    template <class MapView, class ObstaclesView>
+    double sweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles, bool adaptive);
+
+    /**
+     * The same sweep in two stages: sample the whole edge into arrays first, then check the map, the coverage and
+     * the obstacles in separate passes over them (see PlannerConfig::setBatchedEdgeSweep). Gets exactly what sweep()
+     * does without adaptive checking.
+     * @param config
+     * @param map
+     * @param obstacles
+     * @return the true cost
+     */
+    template <class MapView, class ObstaclesView>
+    double batchedSweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles);
+
+    /**
+     * Do the sweep both ways and throw if they disagree about anything.
+     * @param config
+     * @param map
+     * @param obstacles
+     * @return the true cost
+     * @throws std::logic_error
+     */
+    template <class MapView, class ObstaclesView>
+    double validatedSweep(PlannerConfig& config, const MapView& map, const ObstaclesView& obstacles);
+
+    template <class MapView, class ObstaclesView>
+    static double sweepWith(Edge& edge, PlannerConfig& config);
+
+    template <class MapView>
+    static PlannerConfig::EdgeSweep pickSweep(const DynamicObstaclesManager& obstacles);
+
     static constexpr double c_CollisionPenaltyFactor = 600; // no idea how to set this but this is probably too low (try 600)
     static constexpr double c_TimePenaltyFactor = 1;
+    // adaptive collision checking: most steps to skip at once, and how many steps to wait after finding no clearance
+    static constexpr int c_MaxClearSteps = 1000;
+    static constexpr int c_ClearanceRecheckSteps = 10;
+    // length of the stretches of edge checked against the obstacles' swept volumes at once (s)
+    static constexpr double c_BroadPhaseSeconds = 2;
+    // analytic coverage: furthest the chords standing in for a turn can be from it (m)
+    static constexpr double c_ArcCoverageSagitta = 0.05;
 };
 
 
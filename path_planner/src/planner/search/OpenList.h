@@ -0,0 +1,126 @@
+#ifndef SRC_OPENLIST_H
+#define SRC_OPENLIST_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "Vertex.h"
+
+/**
+ * Open list for A* ordered by f value. Entries are (f, vertex) pairs stored contiguously in a 4-ary min-heap, so
+ * comparisons are a plain double comparison on the cached f rather than a call through a std::function that goes and
+ * asks each vertex for its f. Wider nodes mean a shallower heap and fewer cache misses on pop than a binary heap.
+ *
+ * The f value is captured when the vertex is pushed. If a vertex's f changes after that, push it again.
+ */
+class OpenList {
+public:
+    /**
+     * Push a vertex with its f value.
+     * @param f
+     * @param vertex
+     */
+    void push(double f, Vertex::SharedPtr vertex) {
+        m_Heap.push_back(Entry{f, std::move(vertex)});
+        siftUp(m_Heap.size() - 1);
+    }
+
+    /**
+     * Remove and return the vertex with the smallest f.
+     * @return
+     */
+    Vertex::SharedPtr pop() {
+        if (m_Heap.empty()) throw std::out_of_range("Trying to pop an empty vertex queue");
+        auto top = std::move(m_Heap.front().V);
+        if (m_Heap.size() > 1) {
+            m_Heap.front() = std::move(m_Heap.back());
+            m_Heap.pop_back();
+            siftDown(0);
+        } else {
+            m_Heap.pop_back();
+        }
+        return top;
+    }
+
+    /**
+     * @return the smallest f value in the list
+     */
+    double topF() const {
+        if (m_Heap.empty()) throw std::out_of_range("Trying to peek at an empty vertex queue");
+        return m_Heap.front().F;
+    }
+
+    bool empty() const { return m_Heap.empty(); }
+
+    size_t size() const { return m_Heap.size(); }
+
+    /**
+     * Take out the vertices with the largest f values, in no particular order, for when the list has to shrink.
+     * @param n how many to take out (all of them if there are fewer)
+     * @param dropped gets each one's f and vertex, after the list is back in order (so it can push more)
+     */
+    template<typename Function>
+    void dropWorst(size_t n, Function&& dropped) {
+        n = std::min(n, m_Heap.size());
+        if (n == 0) return;
+        auto keep = m_Heap.size() - n;
+        std::nth_element(m_Heap.begin(), m_Heap.begin() + keep, m_Heap.end(),
+                         [](const Entry& e1, const Entry& e2) { return e1.F < e2.F; });
+        std::vector<Entry> worst(std::make_move_iterator(m_Heap.begin() + keep),
+                                 std::make_move_iterator(m_Heap.end()));
+        m_Heap.resize(keep);
+        // what's left is all out of place, so heapify it again from the last parent up
+        if (keep > 1) {
+            for (auto i = (keep - 2) / c_Arity + 1; i-- > 0;) siftDown(i);
+        }
+        for (auto& e : worst) dropped(e.F, std::move(e.V));
+    }
+
+    /**
+     * Clear the list, keeping its capacity.
+     */
+    void clear() { m_Heap.clear(); }
+
+private:
+    struct Entry {
+        double F;
+        Vertex::SharedPtr V;
+    };
+
+    std::vector<Entry> m_Heap;
+
+    static constexpr size_t c_Arity = 4;
+
+    void siftUp(size_t i) {
+        auto e = std::move(m_Heap[i]);
+        while (i > 0) {
+            auto parent = (i - 1) / c_Arity;
+            if (!(e.F < m_Heap[parent].F)) break;
+            m_Heap[i] = std::move(m_Heap[parent]);
+            i = parent;
+        }
+        m_Heap[i] = std::move(e);
+    }
+
+    void siftDown(size_t i) {
+        auto n = m_Heap.size();
+        auto e = std::move(m_Heap[i]);
+        while (true) {
+            auto first = i * c_Arity + 1;
+            if (first >= n) break;
+            auto last = std::min(first + c_Arity, n);
+            auto best = first;
+            for (auto c = first + 1; c < last; c++) {
+                if (m_Heap[c].F < m_Heap[best].F) best = c;
+            }
+            if (!(m_Heap[best].F < e.F)) break;
+            m_Heap[i] = std::move(m_Heap[best]);
+            i = best;
+        }
+        m_Heap[i] = std::move(e);
+    }
+};
+
+
+#endif //SRC_OPENLIST_H
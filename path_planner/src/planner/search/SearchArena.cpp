@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <cstdint>
+#include "SearchArena.h"
+
+SearchArena::SearchArena(size_t blockSize) : m_BlockSize(blockSize) {
+    addBlock(m_BlockSize);
+}
+
+void* SearchArena::allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        auto base = reinterpret_cast<uintptr_t>(m_Blocks[m_CurrentBlock].get());
+        // round up to the requested alignment
+        auto aligned = (base + m_Offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        auto newOffset = aligned - base + bytes;
+        if (newOffset <= m_BlockSizes[m_CurrentBlock]) {
+            m_BytesUsed += newOffset - m_Offset;
+            m_Offset = newOffset;
+            return reinterpret_cast<void*>(aligned);
+        }
+        // move on to the next block, making one if we've run out (or the next one's too small)
+        m_CurrentBlock++;
+        m_Offset = 0;
+        if (m_CurrentBlock == m_Blocks.size()) {
+            addBlock(std::max(m_BlockSize, bytes + alignment));
+        } else if (m_BlockSizes[m_CurrentBlock] < bytes + alignment) {
+            m_Blocks.insert(m_Blocks.begin() + m_CurrentBlock, std::unique_ptr<char[]>(new char[bytes + alignment]));
+            m_BlockSizes.insert(m_BlockSizes.begin() + m_CurrentBlock, bytes + alignment);
+        }
+    }
+}
+
+void SearchArena::reset() {
+    m_CurrentBlock = 0;
+    m_Offset = 0;
+    m_BytesUsed = 0;
+}
+
+size_t SearchArena::capacity() const {
+    size_t total = 0;
+    for (auto s : m_BlockSizes) total += s;
+    return total;
+}
+
+void SearchArena::addBlock(size_t size) {
+    m_Blocks.emplace_back(new char[size]);
+    m_BlockSizes.push_back(size);
+}
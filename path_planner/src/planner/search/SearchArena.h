@@ -0,0 +1,98 @@
+#ifndef SRC_SEARCHARENA_H
+#define SRC_SEARCHARENA_H
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/**
+ * Bump allocator for the search tree. Vertices and edges (and their shared_ptr control blocks) are carved out of big
+ * blocks, deallocation is a no-op, and the whole thing is released at once with reset(), which just rewinds to the first
+ * block so the memory is reused next iteration.
+ *
+ * Resetting while anything still lives in the arena would be very bad, so the allocator below keeps the arena alive
+ * through a shared pointer. That way an arena is only recycled once nothing in the tree points into it any more (see
+ * SamplingBasedPlanner::acquireArena).
+ */
+class SearchArena {
+public:
+    typedef std::shared_ptr<SearchArena> SharedPtr;
+
+    /**
+     * Construct an arena.
+     * @param blockSize size in bytes of each block
+     */
+    explicit SearchArena(size_t blockSize = c_DefaultBlockSize);
+
+    /**
+     * Grab some memory. Allocations bigger than the block size get a block to themselves.
+     * @param bytes
+     * @param alignment
+     * @return
+     */
+    void* allocate(size_t bytes, size_t alignment);
+
+    /**
+     * Release everything in O(1). Blocks are kept around for re-use. Only call this if nothing lives in the arena.
+     */
+    void reset();
+
+    /**
+     * @return bytes handed out since the last reset.
+     */
+    size_t bytesUsed() const { return m_BytesUsed; }
+
+    /**
+     * @return total bytes of blocks owned by the arena.
+     */
+    size_t capacity() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_Blocks;
+    std::vector<size_t> m_BlockSizes;
+    size_t m_BlockSize;
+    size_t m_CurrentBlock = 0;
+    size_t m_Offset = 0;
+    size_t m_BytesUsed = 0;
+
+    void addBlock(size_t size);
+
+    static constexpr size_t c_DefaultBlockSize = 1 << 20;
+};
+
+/**
+ * STL-style allocator on top of a SearchArena, meant for std::allocate_shared. Each control block holds a copy of this,
+ * which keeps the arena alive as long as the object is.
+ * @tparam T
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(SearchArena::SharedPtr arena) : m_Arena(std::move(arena)) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_Arena(other.arena()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(m_Arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {
+        // nothing to do - everything goes away when the arena is reset
+    }
+
+    const SearchArena::SharedPtr& arena() const { return m_Arena; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_Arena == other.arena(); }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_Arena != other.arena(); }
+
+private:
+    SearchArena::SharedPtr m_Arena;
+};
+
+#endif //SRC_SEARCHARENA_H
@@ -1,15 +1,17 @@
 #include <sstream>
 #include "Vertex.h"
+#include "../utilities/Profiler.h"
 
 Vertex::Vertex(State state) {
     this->m_State = state;
+    Profiler::countAllocation(Profiler::Vertices, sizeof(Vertex));
 }
 
 Vertex::Vertex(State state, const std::shared_ptr<Edge>& parent) : Vertex(state) {
     this->m_ParentEdge = parent;
 }
 
-std::shared_ptr<Vertex> Vertex::parent() const {
+const std::shared_ptr<Vertex>& Vertex::parent() const {
     return this->m_ParentEdge->start();
 }
 
@@ -18,17 +20,26 @@ bool Vertex::isRoot() const {
     else return true;
 }
 
-std::shared_ptr<Vertex> Vertex::connect(const std::shared_ptr<Vertex> &start, const State &next) {
-    auto e = new Edge(start);
-    auto v = e->setEnd(next);
+/**
+ * Make a new edge, from the arena if we have one.
+ */
+static Edge::SharedPtr makeEdge(const Vertex::SharedPtr& start, const SearchArena::SharedPtr& arena) {
+    if (arena) return std::allocate_shared<Edge>(ArenaAllocator<Edge>(arena), start);
+    return std::make_shared<Edge>(start);
+}
+
+std::shared_ptr<Vertex> Vertex::connect(const std::shared_ptr<Vertex> &start, const State &next,
+                                        const SearchArena::SharedPtr& arena) {
+    auto e = makeEdge(start, arena);
+    auto v = e->setEnd(next, arena);
     v->m_RibbonManager = start->m_RibbonManager;
     return v;
 }
 
 Vertex::SharedPtr Vertex::connect(const Vertex::SharedPtr& start, const DubinsWrapper& wrapper,
-                                  bool coverageAllowed) {
-    auto e = new Edge(start);
-    auto v = e->setEnd(wrapper);
+                                  bool coverageAllowed, const SearchArena::SharedPtr& arena) {
+    auto e = makeEdge(start, arena);
+    auto v = e->setEnd(wrapper, arena);
     v->m_RibbonManager = start->m_RibbonManager;
     v->m_CoverageIsAllowed = coverageAllowed;
     v->m_TurningRadius = wrapper.getRho();
@@ -47,8 +58,14 @@ double Vertex::estimateApproxToGo(const State &destination) {
 }
 
 double Vertex::computeApproxToGo(const PlannerConfig& config) {
+    Profiler::Scope profile(Profiler::Heuristic);
     double max;
-    max = m_RibbonManager.approximateDistanceUntilDone(state().x(), state().y(), state().heading());
+    if (config.useHeuristicCache() && config.heuristicCache()) {
+        max = config.heuristicCache()->approximateDistanceUntilDone(m_RibbonManager, state().x(), state().y(),
+                                                                    state().heading());
+    } else {
+        max = m_RibbonManager.approximateDistanceUntilDone(state().x(), state().y(), state().heading());
+    }
     // use max speed because we need a lower bound - we could go at max speed the rest of the way
     m_ApproxToGo = max / config.maxSpeed() * Edge::timePenaltyFactor();
 
@@ -90,7 +107,7 @@ int Vertex::getDepth() const {
 }
 
 State Vertex::getNearestPointAsState() const {
-    if (m_RibbonManager.done()) throw std::logic_error("Getting nearest point with empty path");
+    if (m_RibbonManager.get().empty()) throw std::logic_error("Getting nearest point with empty path");
     return m_RibbonManager.getNearestEndpointAsState(state());
 }
 
@@ -99,6 +116,15 @@ double Vertex::f() {
     return currentCost() + approxToGo();
 }
 
+void Vertex::setLazyCost(const PlannerConfig& config) {
+    m_CurrentCost = parent()->currentCost() + parentEdge()->approxCost();
+    computeApproxToGo(config);
+}
+
+bool Vertex::evaluated() const {
+    return isRoot() || m_ParentEdge->trueCostComputed();
+}
+
 void Vertex::setCurrentCost() {
     m_CurrentCost = parent()->currentCost() + parentEdge()->trueCost();
 }
@@ -122,8 +148,9 @@ double Vertex::turningRadius() const {
     return m_TurningRadius;
 }
 
-std::shared_ptr<Vertex> Vertex::connect(const std::shared_ptr<Vertex>& start, const State& next, double turningRadius, bool coverageAllowed) {
-    auto v = connect(start, next);
+std::shared_ptr<Vertex> Vertex::connect(const std::shared_ptr<Vertex>& start, const State& next, double turningRadius,
+                                        bool coverageAllowed, const SearchArena::SharedPtr& arena) {
+    auto v = connect(start, next, arena);
     v->m_TurningRadius = turningRadius;
     v->m_CoverageIsAllowed = coverageAllowed;
     return v;
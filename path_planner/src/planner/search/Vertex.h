@@ -2,11 +2,13 @@
 #define SRC_VERTEX_H
 
 #include <memory>
+#include <vector>
 #include <path_planner_common/State.h>
 #include "Edge.h"
 #include "../utilities/RibbonManager.h"
 #include "path_planner_common/DubinsWrapper.h"
 #include "../PlannerConfig.h"
+#include "SearchArena.h"
 
 // forward declaration to resolve circular dependency
 class Edge;
@@ -22,6 +24,9 @@ class Edge;
  * Pointer ownership structure:
  * A vertex owns the pointer to its parent edge. The root vertex owns nothing. Edges own pointers to their parent vertex
  * but hold only a weak pointer to their child vertex.
+ *
+ * The connect functions optionally take a SearchArena, in which case the new edge and vertex (control blocks and all)
+ * are bump allocated from it instead of the heap. The ownership structure is the same either way.
  */
 class Vertex {
 public:
@@ -47,12 +52,15 @@ public:
      * Use this instead of any constructors for non-root vertices.
      * @param start the starting vertex
      * @param next the ending state
+     * @param arena arena to allocate the edge and vertex from (heap if null)
      * @return a vertex connected by a new edge to @start
      */
-    static std::shared_ptr<Vertex> connect(const std::shared_ptr<Vertex>& start, const State& next);
-    static std::shared_ptr<Vertex> connect(const std::shared_ptr<Vertex>& start, const State& next, double turningRadius, bool coverageAllowed);
+    static std::shared_ptr<Vertex> connect(const std::shared_ptr<Vertex>& start, const State& next,
+                                           const SearchArena::SharedPtr& arena = nullptr);
+    static std::shared_ptr<Vertex> connect(const std::shared_ptr<Vertex>& start, const State& next, double turningRadius,
+                                           bool coverageAllowed, const SearchArena::SharedPtr& arena = nullptr);
     static Vertex::SharedPtr connect(const Vertex::SharedPtr& start, const DubinsWrapper& wrapper,
-                                     bool coverageAllowed);
+                                     bool coverageAllowed, const SearchArena::SharedPtr& arena = nullptr);
 
     /**
      * Construct a root vertex.
@@ -68,7 +76,7 @@ public:
      * Get the parent of this vertex.
      * @return
      */
-    std::shared_ptr<Vertex> parent() const;
+    const std::shared_ptr<Vertex>& parent() const;
 
     /**
      * @return true iff this is the root.
@@ -114,12 +122,30 @@ public:
      */
     void setCurrentCost();
 
+    /**
+     * Lazy search: set g from the parent edge's approximate cost instead of its true cost, and h from the parent's
+     * ribbons (this vertex's ribbons are still a copy of the parent's since the edge hasn't been swept yet). The edge's
+     * approximate cost needs to be computed already. The real values get set by Edge::computeTrueCost later.
+     * @param config
+     */
+    void setLazyCost(const PlannerConfig& config);
+
+    /**
+     * @return whether the true cost of the edge into this vertex has been computed (always true for the root)
+     */
+    bool evaluated() const;
+
     /**
      * Retrieve the approx cost to go (h). Calculates if not cached.
      * @return
      */
     double approxToGo();
 
+    /**
+     * @return h if it's been computed, otherwise -1 (unlike approxToGo, which throws). For reporting on vertices.
+     */
+    double approxToGoIfComputed() const { return m_ApproxToGo; }
+
     /**
      * Retrieve the f value (g + h). Calculates components if they aren't cached.
      * @return
@@ -175,6 +201,62 @@ public:
      */
     bool coverageAllowed() const;
 
+    /**
+     * Incremental search bookkeeping: the number of samples there were when this vertex was last expanded. Expanding
+     * it again only has to look at samples added since then. Zero means it has never been expanded.
+     * @return
+     */
+    size_t expandedSampleCount() const { return m_ExpandedSampleCount; }
+    void setExpandedSampleCount(size_t count) { m_ExpandedSampleCount = count; }
+
+    /**
+     * Whether a cheaper vertex has been found at the same sample with the same ribbons (incremental search rewiring),
+     * or in the same closed list cell.
+     * Replaced vertices are skipped rather than expanded.
+     * @return
+     */
+    bool replaced() const { return m_Replaced; }
+    void setReplaced() { m_Replaced = true; }
+
+    /**
+     * Which of its parent's children this is: the sample it goes to (-1 for the nearest point on the ribbons) and
+     * which of the speeds and turning radii it uses. Vertices that weren't made by expanding their parent have -1s.
+     */
+    struct ChildKey {
+        int Sample, SpeedIndex, RadiusIndex;
+        bool operator==(const ChildKey& other) const {
+            return Sample == other.Sample && SpeedIndex == other.SpeedIndex && RadiusIndex == other.RadiusIndex;
+        }
+    };
+    const ChildKey& childKey() const { return m_ChildKey; }
+    void setChildKey(const ChildKey& key) { m_ChildKey = key; }
+
+    /**
+     * Memory bounded search: the smallest f of this vertex's children that got dropped from the open list to stay
+     * under the memory budget. The vertex goes back on the open list with that f so they get made again if they turn
+     * out to be worth it after all. -1 when nothing has been dropped since it was last expanded.
+     * @return
+     */
+    double forgottenF() const { return m_ForgottenF; }
+    void setForgottenF(double f) { m_ForgottenF = f; }
+
+    /**
+     * Remember that a child got dropped, so expanding this again only makes that one (and its siblings that got
+     * dropped too) again rather than duplicating the ones still in the tree.
+     * @param key the dropped child's
+     */
+    void forgetChild(const ChildKey& key) { m_ForgottenChildren.push_back(key); }
+
+    /**
+     * @return the children dropped since this was last expanded, which it forgets about (along with forgottenF)
+     */
+    std::vector<ChildKey> takeForgottenChildren() {
+        std::vector<ChildKey> taken;
+        taken.swap(m_ForgottenChildren);
+        m_ForgottenF = -1;
+        return taken;
+    }
+
 private:
 
     State m_State;
@@ -185,6 +267,11 @@ private:
     double m_ApproxToGo = -1;
     double m_TurningRadius;
     bool m_CoverageIsAllowed = false;
+    size_t m_ExpandedSampleCount = 0;
+    bool m_Replaced = false;
+    ChildKey m_ChildKey{-1, -1, -1};
+    double m_ForgottenF = -1;
+    std::vector<ChildKey> m_ForgottenChildren;
 };
 
 
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include "BinaryVisualizer.h"
+
+constexpr char BinaryVisualizer::c_Magic[8];
+constexpr size_t BinaryVisualizer::c_RingRecords;
+constexpr int BinaryVisualizer::c_WriteIntervalMs;
+
+namespace {
+std::atomic<unsigned long> g_NextVisualizerId{1};
+}
+
+BinaryVisualizer::BinaryVisualizer(const std::string& path) : m_Id(g_NextVisualizerId++) {
+    // fastest compression; the writer needs to keep up more than the files need to be small
+    m_File = gzopen(path.c_str(), "wb1");
+    if (!m_File) throw std::runtime_error("Could not open visualization file " + path);
+    gzwrite((gzFile)m_File, c_Magic, sizeof(c_Magic));
+    m_Writer = std::thread(&BinaryVisualizer::writeLoop, this);
+}
+
+BinaryVisualizer::~BinaryVisualizer() {
+    {
+        std::lock_guard<std::mutex> lock(m_WriterMutex);
+        m_Stop = true;
+    }
+    m_WriterCV.notify_all();
+    m_Writer.join();
+    drain();
+    Record dropped{};
+    dropped.Type = Dropped;
+    dropped.Values[0] = (double)m_Dropped.load();
+    gzwrite((gzFile)m_File, &dropped, sizeof(dropped));
+    gzclose((gzFile)m_File);
+}
+
+BinaryVisualizer::Ring& BinaryVisualizer::ring() {
+    struct Cache {
+        unsigned long Id;
+        Ring* R;
+    };
+    static thread_local Cache cache{0, nullptr};
+    if (cache.Id == m_Id) return *cache.R;
+    std::lock_guard<std::mutex> lock(m_RingsMutex);
+    auto& r = m_Rings[std::this_thread::get_id()];
+    if (!r) r.reset(new Ring(c_RingRecords));
+    cache = {m_Id, r.get()};
+    return *r;
+}
+
+std::vector<BinaryVisualizer::Record>& BinaryVisualizer::scratch() {
+    static thread_local std::vector<Record> records;
+    return records;
+}
+
+void BinaryVisualizer::push(const Record* records, size_t n) {
+    if (!ring().push(records, n)) m_Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BinaryVisualizer::vertex(const State& state, double f, double g, double h, bool expanded, const char* tag,
+                              const std::vector<long>& ancestry) {
+    constexpr size_t perRecord = sizeof(Record) / sizeof(long);
+    auto& records = scratch();
+    records.resize(1 + (ancestry.size() + perRecord - 1) / perRecord);
+    auto& r = records[0];
+    r.Type = Vertex;
+    r.Flags = expanded;
+    r.Extra = (uint16_t)(records.size() - 1);
+    // truncated to leave room for a terminator, and zero filled after it
+    auto tagLength = strnlen(tag, sizeof(r.Tag) - 1);
+    memcpy(r.Tag, tag, tagLength);
+    memset(r.Tag + tagLength, 0, sizeof(r.Tag) - tagLength);
+    double values[8] = {state.x(), state.y(), state.heading(), state.speed(), state.time(), f, g, h};
+    memcpy(r.Values, values, sizeof(values));
+    if (!ancestry.empty()) {
+        // zero fill the tail of the last one so it's clear where the ids stop
+        memset(&records[1], 0, (records.size() - 1) * sizeof(Record));
+        memcpy(&records[1], ancestry.data(), ancestry.size() * sizeof(long));
+    }
+    push(records.data(), records.size());
+}
+
+void BinaryVisualizer::trajectory() {
+    Record r{};
+    r.Type = Trajectory;
+    push(&r, 1);
+}
+
+void BinaryVisualizer::state(const State& state, double f, double g, double h, StateKind kind) {
+    Record r;
+    r.Type = StateEvent;
+    r.Flags = kind;
+    r.Extra = 0;
+    double values[8] = {state.x(), state.y(), state.heading(), state.speed(), state.time(), f, g, h};
+    memcpy(r.Values, values, sizeof(values));
+    push(&r, 1);
+}
+
+void BinaryVisualizer::note(const std::string& text) {
+    auto& records = scratch();
+    records.resize(1 + (text.size() + sizeof(Record) - 1) / sizeof(Record));
+    memset(&records[0], 0, records.size() * sizeof(Record));
+    records[0].Type = Note;
+    records[0].Extra = (uint16_t)(records.size() - 1);
+    memcpy(&records[1], text.data(), text.size());
+    push(records.data(), records.size());
+}
+
+void BinaryVisualizer::drain() {
+    std::vector<Record> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_RingsMutex);
+        for (auto& r : m_Rings) r.second->drain([&](const Record& record) { buffer.push_back(record); });
+    }
+    if (!buffer.empty()) gzwrite((gzFile)m_File, buffer.data(), (unsigned)(buffer.size() * sizeof(Record)));
+}
+
+void BinaryVisualizer::writeLoop() {
+    std::unique_lock<std::mutex> lock(m_WriterMutex);
+    while (!m_Stop) {
+        m_WriterCV.wait_for(lock, std::chrono::milliseconds(c_WriteIntervalMs));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+unsigned long BinaryVisualizer::convert(const std::string& path, Visualizer& into) {
+    auto file = gzopen(path.c_str(), "rb");
+    if (!file) throw std::runtime_error("Could not open visualization file " + path);
+    // close it whichever way we leave
+    std::unique_ptr<gzFile_s, int(*)(gzFile)> closer(file, gzclose);
+    char magic[sizeof(c_Magic)];
+    if (gzread(file, magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, c_Magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(path + " is not a binary visualization file");
+    }
+    unsigned long dropped = 0;
+    std::vector<Record> extra;
+    std::vector<long> ancestry;
+    Record r;
+    while (gzread(file, &r, sizeof(r)) == sizeof(r)) {
+        extra.resize(r.Extra);
+        if (r.Extra > 0 && gzread(file, extra.data(), (unsigned)(r.Extra * sizeof(Record))) !=
+                           (int)(r.Extra * sizeof(Record))) break;
+        State state(r.Values[0], r.Values[1], r.Values[2], r.Values[3], r.Values[4]);
+        switch (r.Type) {
+            case Vertex: {
+                ancestry.assign((const long*)extra.data(), (const long*)(extra.data() + extra.size()));
+                while (!ancestry.empty() && ancestry.back() == 0) ancestry.pop_back();
+                char tag[sizeof(r.Tag) + 1] = {};
+                memcpy(tag, r.Tag, sizeof(r.Tag));
+                into.vertex(state, r.Values[5], r.Values[6], r.Values[7], r.Flags != 0, tag, ancestry);
+                break;
+            }
+            case Trajectory: into.trajectory(); break;
+            case StateEvent: into.state(state, r.Values[5], r.Values[6], r.Values[7], (StateKind)r.Flags); break;
+            case Note: {
+                std::string text((const char*)extra.data(), extra.size() * sizeof(Record));
+                text.resize(strnlen(text.data(), text.size()));
+                into.note(text);
+                break;
+            }
+            case Dropped: dropped += (unsigned long)r.Values[0]; break;
+            default: break;
+        }
+    }
+    return dropped;
+}
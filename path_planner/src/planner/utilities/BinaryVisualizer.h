@@ -0,0 +1,118 @@
+#ifndef SRC_BINARYVISUALIZER_H
+#define SRC_BINARYVISUALIZER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "Visualizer.h"
+#include "SpscRing.h"
+
+/**
+ * Records visualization events without slowing the search down much. Each event is a few fixed size binary records
+ * (no formatting, no allocation once things get going) pushed onto a lock-free ring belonging to the thread reporting
+ * it, and a background thread empties the rings every so often, compressing everything into the file with zlib. When
+ * a ring's full the event gets dropped rather than making the planner wait, and the file says how many were.
+ *
+ * Use convert() (or the visualization_to_text tool) to turn a file into the text format the visualization tools read.
+ * Events from different threads (like the planners in a portfolio) come out in the order the writer happened to get
+ * to them, but each thread's stay in order.
+ */
+class BinaryVisualizer : public Visualizer {
+public:
+    explicit BinaryVisualizer(const std::string& path);
+
+    /**
+     * Writes out whatever's left and closes the file.
+     */
+    ~BinaryVisualizer() override;
+
+    void vertex(const State& state, double f, double g, double h, bool expanded, const char* tag,
+                const std::vector<long>& ancestry) override;
+
+    void trajectory() override;
+
+    void state(const State& state, double f, double g, double h, StateKind kind) override;
+
+    void note(const std::string& text) override;
+
+    /**
+     * @return events dropped so far because a ring was full
+     */
+    unsigned long dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * Replay a recording into another visualizer (like a text one).
+     * @param path
+     * @param into
+     * @return number of events that had been dropped while recording
+     * @throws std::runtime_error if the file can't be read or isn't a recording
+     */
+    static unsigned long convert(const std::string& path, Visualizer& into);
+
+    static constexpr size_t c_RingRecords = 1 << 15;
+    static constexpr char c_Magic[8] = {'P', 'P', 'V', 'I', 'S', 'B', 'I', '1'};
+
+private:
+    enum Kind : uint8_t {
+        Vertex,
+        Trajectory,
+        StateEvent,
+        Note,
+        Dropped,
+    };
+
+    // Events are one of these, followed by Extra more holding the vertex's ancestry or the note's text
+    struct Record {
+        Kind Type;
+        uint8_t Flags; // expanded, or the kind of state
+        uint16_t Extra;
+        char Tag[12];
+        double Values[8]; // state (x, y, heading, speed, time), f, g, h
+    };
+    static_assert(sizeof(Record) == 80, "visualization records are meant to be packed");
+
+    typedef SpscRing<Record> Ring;
+
+    std::mutex m_RingsMutex;
+    std::map<std::thread::id, std::unique_ptr<Ring>> m_Rings;
+    // so a thread can tell its cached ring is from this visualizer and not one that used to be in the same place
+    const unsigned long m_Id;
+
+    std::atomic<unsigned long> m_Dropped{0};
+
+    std::mutex m_WriterMutex;
+    std::condition_variable m_WriterCV;
+    bool m_Stop = false;
+    void* m_File; // gzFile
+    std::thread m_Writer;
+
+    static constexpr int c_WriteIntervalMs = 20;
+
+    /**
+     * @return the calling thread's ring (making it the first time)
+     */
+    Ring& ring();
+
+    /**
+     * Push an event onto this thread's ring, or count it as dropped.
+     * @param records
+     * @param n
+     */
+    void push(const Record* records, size_t n);
+
+    /**
+     * @return the calling thread's scratch space for putting events together
+     */
+    static std::vector<Record>& scratch();
+
+    /**
+     * Write everything that's in the rings right now.
+     */
+    void drain();
+
+    void writeLoop();
+};
+
+
+#endif //SRC_BINARYVISUALIZER_H
@@ -0,0 +1,50 @@
+#include <cmath>
+#include <sstream>
+#include "CycleScheduler.h"
+
+CycleScheduler::CycleScheduler(double period, double smoothing, double margin)
+        : m_Period(period), m_Smoothing(smoothing), m_Margin(margin) {}
+
+void CycleScheduler::record(Phase phase, double seconds) {
+    if (!std::isfinite(seconds)) return;
+    seconds = fmax(seconds, 0);
+    if (!m_Measured[phase]) {
+        m_Estimates[phase] = seconds;
+        m_Measured[phase] = true;
+    } else {
+        m_Estimates[phase] += m_Smoothing * (seconds - m_Estimates[phase]);
+    }
+}
+
+double CycleScheduler::planningBudget(double cycleStart, double now) const {
+    // the phases before planning are already in the past by now, so only the ones after it count
+    auto budget = deadline(cycleStart) - now - m_Estimates[PlanOverrun] - m_Estimates[Publish] - m_Margin;
+    return fmax(budget, 0);
+}
+
+double CycleScheduler::finishCycle(double cycleStart, double end) {
+    m_Cycles++;
+    auto late = end - deadline(cycleStart);
+    if (late <= 0) return 0;
+    m_Missed++;
+    return late;
+}
+
+std::string CycleScheduler::summary() const {
+    std::stringstream stream;
+    for (int p = 0; p < PhaseCount; p++) {
+        if (p != 0) stream << ", ";
+        stream << phaseName((Phase)p) << " " << std::lround(m_Estimates[p] * 1000) << "ms";
+    }
+    return stream.str();
+}
+
+const char* CycleScheduler::phaseName(Phase phase) {
+    switch (phase) {
+        case RibbonCopy: return "ribbon copy";
+        case Cover: return "cover";
+        case PlanOverrun: return "plan overrun";
+        case Publish: return "publish";
+        default: return "?";
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef SRC_CYCLESCHEDULER_H
+#define SRC_CYCLESCHEDULER_H
+
+#include <string>
+
+/**
+ * Keeps track of how long each part of a planning cycle takes so the planner can be given whatever's actually left
+ * before the cycle's deadline, instead of assuming everything but planning is free. Each phase gets an exponentially
+ * weighted moving average, so a few slow controller calls push the estimate up quickly and it drifts back down when
+ * the network calms down.
+ *
+ * The deadline is the cycle start plus the period, which is when the start state the cycle plans from is predicted
+ * for, so the plan should be in the controller's hands by then. Not thread-safe; it belongs to the plan loop.
+ */
+class CycleScheduler {
+public:
+    enum Phase {
+        RibbonCopy, // copying the ribbon manager
+        Cover, // covering up to the start state and focusing the map
+        PlanOverrun, // how much longer than its budget the planner takes to return
+        Publish, // from planning being done to the plan being handed off (including display)
+        PhaseCount
+    };
+
+    /**
+     * Construct a scheduler.
+     * @param period cycle length (s)
+     * @param smoothing EWMA weight for the newest measurement, in (0, 1]
+     * @param margin extra slack to leave on top of the estimates (s)
+     */
+    explicit CycleScheduler(double period, double smoothing = 0.2, double margin = 0.02);
+
+    /**
+     * Fold a measurement into a phase's estimate. The first one for a phase is taken as is.
+     * @param phase
+     * @param seconds
+     */
+    void record(Phase phase, double seconds);
+
+    /**
+     * @param phase
+     * @return the smoothed duration of the phase (0 before any measurements)
+     */
+    double estimate(Phase phase) const { return m_Estimates[phase]; }
+
+    /**
+     * @param cycleStart
+     * @return when the cycle starting at cycleStart should be done
+     */
+    double deadline(double cycleStart) const { return cycleStart + m_Period; }
+
+    /**
+     * Work out how long the planner can run for if it starts now and everything after it takes as long as usual.
+     * @param cycleStart
+     * @param now
+     * @return the planning time budget (s), never negative
+     */
+    double planningBudget(double cycleStart, double now) const;
+
+    /**
+     * @param cycleStart
+     * @return when to stop waiting and start handing off the plan so it gets there by the deadline
+     */
+    double handoffTime(double cycleStart) const { return deadline(cycleStart) - m_Estimates[Publish]; }
+
+    /**
+     * Close out a cycle.
+     * @param cycleStart
+     * @param end when the plan was handed off
+     * @return how late the cycle was (s), or 0 if it made the deadline
+     */
+    double finishCycle(double cycleStart, double end);
+
+    /**
+     * @return number of cycles finished
+     */
+    int cycles() const { return m_Cycles; }
+
+    /**
+     * @return number of cycles that missed their deadline
+     */
+    int missedDeadlines() const { return m_Missed; }
+
+    /**
+     * @return the phase estimates in ms, for logging
+     */
+    std::string summary() const;
+
+    static const char* phaseName(Phase phase);
+
+private:
+    double m_Period;
+    double m_Smoothing;
+    double m_Margin;
+    double m_Estimates[PhaseCount] = {};
+    bool m_Measured[PhaseCount] = {};
+    int m_Cycles = 0;
+    int m_Missed = 0;
+};
+
+
+#endif //SRC_CYCLESCHEDULER_H
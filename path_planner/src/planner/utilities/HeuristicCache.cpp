@@ -0,0 +1,49 @@
+#include <cmath>
+#include "HeuristicCache.h"
+
+HeuristicCache::HeuristicCache(size_t capacity, double positionQuantum, double angleQuantum)
+    : m_PositionQuantum(positionQuantum), m_AngleQuantum(angleQuantum) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    m_Entries.resize(size);
+    m_Mask = size - 1;
+}
+
+double HeuristicCache::approximateDistanceUntilDone(const RibbonManager& ribbonManager, double x, double y, double yaw) {
+    // no point caching the trivial case
+    if (ribbonManager.done()) return 0;
+    int64_t key[c_KeySize] = {
+            (int64_t)ribbonManager.heuristicKey(),
+            llround(x / m_PositionQuantum), llround(y / m_PositionQuantum), llround(yaw / m_AngleQuantum)
+    };
+    uint64_t hash = 1469598103934665603ULL;
+    for (auto k : key) {
+        hash ^= (uint64_t)k;
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        const auto& entry = m_Entries[hash & m_Mask];
+        bool hit = entry.Valid;
+        for (int i = 0; hit && i < c_KeySize; i++) hit = entry.Key[i] == key[i];
+        if (hit) {
+            m_Hits++;
+            return entry.Value;
+        }
+    }
+    m_Misses++;
+    // the heuristic is the expensive bit so don't hold the lock for it
+    auto value = ribbonManager.approximateDistanceUntilDone(x, y, yaw);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto& entry = m_Entries[hash & m_Mask];
+    for (int i = 0; i < c_KeySize; i++) entry.Key[i] = key[i];
+    entry.Value = value;
+    entry.Valid = true;
+    return value;
+}
+
+void HeuristicCache::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto& e : m_Entries) e.Valid = false;
+}
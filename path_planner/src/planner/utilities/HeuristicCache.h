@@ -0,0 +1,74 @@
+#ifndef SRC_HEURISTICCACHE_H
+#define SRC_HEURISTICCACHE_H
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "RibbonManager.h"
+
+/**
+ * Bounded cache of ribbon heuristic values keyed by the remaining ribbons (RibbonManager::heuristicKey()) and the
+ * quantized pose. Lots of vertices have the same ribbons left because their edges didn't touch any, and every parent
+ * connecting to a sample ends up at the same pose, so the TSP heuristics keep getting asked the same question.
+ *
+ * Covering part of a ribbon changes the manager's key, so entries for ribbon sets that no longer exist are never hit
+ * again and just get overwritten. Like the Dubins cache it's direct-mapped, so it stays a fixed size.
+ *
+ * With the default quantization hits are for essentially identical poses. Coarser quantization gets more hits but
+ * hands back a value computed for a pose up to half a quantum away, which can make the heuristic slightly
+ * inadmissible. Thread-safe, so parallel edge evaluation and the planner portfolio can share one.
+ */
+class HeuristicCache {
+public:
+    typedef std::shared_ptr<HeuristicCache> SharedPtr;
+
+    /**
+     * Construct a cache.
+     * @param capacity number of slots (rounded up to a power of two)
+     * @param positionQuantum quantization of x and y (m)
+     * @param angleQuantum quantization of yaw (rad)
+     */
+    explicit HeuristicCache(size_t capacity = c_DefaultCapacity, double positionQuantum = c_DefaultPositionQuantum,
+            double angleQuantum = c_DefaultAngleQuantum);
+
+    /**
+     * Get ribbonManager.approximateDistanceUntilDone(x, y, yaw), computing it only if it isn't cached.
+     * @param ribbonManager
+     * @param x
+     * @param y
+     * @param yaw
+     * @return
+     */
+    double approximateDistanceUntilDone(const RibbonManager& ribbonManager, double x, double y, double yaw);
+
+    /**
+     * Remove everything (counts are kept).
+     */
+    void clear();
+
+    unsigned long hits() const { return m_Hits; }
+    unsigned long misses() const { return m_Misses; }
+
+private:
+    static constexpr int c_KeySize = 4;
+
+    struct Entry {
+        bool Valid = false;
+        int64_t Key[c_KeySize];
+        double Value;
+    };
+
+    std::vector<Entry> m_Entries;
+    size_t m_Mask;
+    double m_PositionQuantum, m_AngleQuantum;
+    std::mutex m_Mutex;
+    std::atomic<unsigned long> m_Hits{0}, m_Misses{0};
+
+    static constexpr size_t c_DefaultCapacity = 1 << 14;
+    static constexpr double c_DefaultPositionQuantum = 1e-4, c_DefaultAngleQuantum = 1e-6;
+};
+
+
+#endif //SRC_HEURISTICCACHE_H
@@ -0,0 +1,57 @@
+#include "LatestTaskWorker.h"
+
+LatestTaskWorker::LatestTaskWorker() : m_Thread(&LatestTaskWorker::workerLoop, this) {}
+
+LatestTaskWorker::~LatestTaskWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+        m_Pending = nullptr;
+        if (m_Cancelled) *m_Cancelled = true;
+    }
+    m_Changed.notify_all();
+    m_Thread.join();
+}
+
+void LatestTaskWorker::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Pending) m_Superseded++;
+        m_Pending = std::move(task);
+        if (m_Cancelled) *m_Cancelled = true;
+    }
+    m_Changed.notify_all();
+}
+
+void LatestTaskWorker::wait() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Changed.wait(lock, [this] { return !m_Running && !m_Pending; });
+}
+
+size_t LatestTaskWorker::superseded() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Superseded;
+}
+
+void LatestTaskWorker::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Changed.wait(lock, [this] { return m_Stop || m_Pending; });
+        if (m_Stop) return;
+        auto task = std::move(m_Pending);
+        m_Pending = nullptr;
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        m_Cancelled = cancelled;
+        m_Running = true;
+        lock.unlock();
+        try {
+            task(*cancelled);
+        } catch (...) {
+            // nowhere to send it
+        }
+        lock.lock();
+        m_Running = false;
+        m_Cancelled = nullptr;
+        m_Changed.notify_all();
+    }
+}
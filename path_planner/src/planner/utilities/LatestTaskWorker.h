@@ -0,0 +1,61 @@
+#ifndef SRC_LATESTTASKWORKER_H
+#define SRC_LATESTTASKWORKER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * One background thread for jobs where only the latest request matters, like loading the map whenever a reconfigure
+ * comes in. Submitting a task replaces whatever's waiting to run (which never does) and asks the one that's running to
+ * stop, so a burst of requests ends up as at most one wasted partial run plus the one that was asked for last.
+ *
+ * Stopping is cooperative: tasks get a flag to check every so often, and it's up to them what to do when it's set.
+ * Exceptions from tasks are swallowed, so tasks should report their own errors.
+ */
+class LatestTaskWorker {
+public:
+    typedef std::function<void(const std::atomic<bool>& cancelled)> Task;
+
+    LatestTaskWorker();
+
+    /**
+     * Cancels the running task and waits for it, dropping anything pending.
+     */
+    ~LatestTaskWorker();
+
+    /**
+     * Run a task after the current one (which gets cancelled), instead of anything else that was waiting.
+     * @param task
+     */
+    void submit(Task task);
+
+    /**
+     * Wait until there's nothing running or waiting to run.
+     */
+    void wait();
+
+    /**
+     * @return number of tasks that were replaced before they started
+     */
+    size_t superseded() const;
+
+private:
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    Task m_Pending;
+    bool m_Running = false;
+    bool m_Stop = false;
+    size_t m_Superseded = 0;
+    // each run gets its own flag so cancelling one can't leak into the next
+    std::shared_ptr<std::atomic<bool>> m_Cancelled;
+    std::thread m_Thread;
+
+    void workerLoop();
+};
+
+
+#endif //SRC_LATESTTASKWORKER_H
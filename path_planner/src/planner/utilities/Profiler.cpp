@@ -0,0 +1,105 @@
+#include <ctime>
+#include "Profiler.h"
+
+#ifdef PATH_PLANNER_PROFILING
+thread_local Profiler* Profiler::t_Current = nullptr;
+thread_local unsigned Profiler::t_Scopes = 0;
+#endif
+
+void Profiler::add(Phase phase, int64_t wallNanoseconds, int64_t cpuNanoseconds) {
+    m_Wall[phase].fetch_add(wallNanoseconds, std::memory_order_relaxed);
+    m_Calls[phase].fetch_add(1, std::memory_order_relaxed);
+    if (cpuNanoseconds < 0) return;
+    m_Cpu[phase].fetch_add(cpuNanoseconds, std::memory_order_relaxed);
+    m_CpuSamples[phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::addObjects(Object object, unsigned long allocations, unsigned long copies, size_t bytes) {
+    if (allocations) m_Allocations[object].fetch_add(allocations, std::memory_order_relaxed);
+    if (copies) m_Copies[object].fetch_add(copies, std::memory_order_relaxed);
+    m_Bytes[object].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+Profiler::Report Profiler::report() const {
+    Report report;
+    for (int p = 0; p < PhaseCount; p++) {
+        report[p].WallTime = m_Wall[p].load(std::memory_order_relaxed) * 1e-9;
+        report[p].Calls = m_Calls[p].load(std::memory_order_relaxed);
+        // the samples stand in for all the calls
+        auto samples = m_CpuSamples[p].load(std::memory_order_relaxed);
+        if (samples == 0) continue;
+        report[p].CpuTime = m_Cpu[p].load(std::memory_order_relaxed) * 1e-9 * report[p].Calls / samples;
+    }
+    return report;
+}
+
+Profiler::Allocations Profiler::allocations() const {
+    Allocations allocations;
+    for (int o = 0; o < ObjectCount; o++) {
+        allocations[o].Allocations = m_Allocations[o].load(std::memory_order_relaxed);
+        allocations[o].Copies = m_Copies[o].load(std::memory_order_relaxed);
+        allocations[o].Bytes = m_Bytes[o].load(std::memory_order_relaxed);
+    }
+    return allocations;
+}
+
+Profiler* Profiler::current() {
+#ifdef PATH_PLANNER_PROFILING
+    return t_Current;
+#else
+    return nullptr;
+#endif
+}
+
+double Profiler::threadCpuTime() {
+    return threadCpuNanoseconds() * 1e-9;
+}
+
+void Profiler::accumulate(Report& into, const Report& from) {
+    for (int p = 0; p < PhaseCount; p++) {
+        into[p].WallTime += from[p].WallTime;
+        into[p].CpuTime += from[p].CpuTime;
+        into[p].Calls += from[p].Calls;
+    }
+}
+
+void Profiler::accumulate(Allocations& into, const Allocations& from) {
+    for (int o = 0; o < ObjectCount; o++) {
+        into[o].Allocations += from[o].Allocations;
+        into[o].Copies += from[o].Copies;
+        into[o].Bytes += from[o].Bytes;
+    }
+}
+
+const char* Profiler::phaseName(Phase phase) {
+    switch (phase) {
+        case Sampling: return "sampling";
+        case Nearest: return "nearest";
+        case Dubins: return "dubins";
+        case MapChecks: return "map checks";
+        case ObstacleChecks: return "obstacle checks";
+        case Coverage: return "coverage";
+        case Heuristic: return "heuristic";
+        case Heap: return "heap";
+        default: return "?";
+    }
+}
+
+const char* Profiler::objectName(Object object) {
+    switch (object) {
+        case Vertices: return "vertices";
+        case Edges: return "edges";
+        case RibbonManagers: return "ribbon managers";
+        case RibbonStores: return "ribbon stores";
+        case RibbonLists: return "ribbon list nodes";
+        case DubinsWrappers: return "dubins wrappers";
+        case ObstacleSnapshots: return "obstacle snapshots";
+        default: return "?";
+    }
+}
+
+int64_t Profiler::threadCpuNanoseconds() {
+    struct timespec t{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
@@ -0,0 +1,248 @@
+#ifndef SRC_PROFILER_H
+#define SRC_PROFILER_H
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Where the planner's time goes. Each plan gets a profiler, attached to the planning thread (and the worker pool's
+ * threads while they work for it), and the hot spots open a Scope for their phase, which adds the wall time, thread
+ * CPU time and a call to that phase's totals.
+ *
+ * This only does anything when built with PATH_PLANNER_PROFILING (cmake -DPATH_PLANNER_PROFILING=ON). Otherwise
+ * scopes and attaching are empty inline functions and the totals stay zero, so leaving the scopes in the hot paths
+ * costs nothing. When it's on, every scope reads the wall clock, but the thread CPU clock is a system call (a few
+ * hundred ns, more than a map lookup) so only one scope in c_CpuSampleInterval reads it and each phase's CPU time is
+ * scaled up from its samples. The cheapest phases still come out somewhat inflated; the call counts are exact.
+ *
+ * Phases nest (map checks happen inside edge evaluation, for instance) and each one counts everything inside it.
+ *
+ * It also counts the objects the search makes and copies the most (vertices, edges, ribbon managers and so on), with
+ * roughly how many bytes that took, so we can tell whether the arena and copy-on-write are doing their jobs. Those are
+ * just a few relaxed atomic adds and are compiled out the same way.
+ */
+class Profiler {
+public:
+    enum Phase {
+        Sampling, // generating samples
+        Nearest, // picking the k nearest samples to expand to
+        Dubins, // solving Dubins curves
+        MapChecks, // asking the map whether things are blocked
+        ObstacleChecks, // asking the obstacles manager about collisions
+        Coverage, // covering ribbons along edges
+        Heuristic, // computing h values
+        Heap, // pushing and popping the open list
+        PhaseCount
+    };
+
+    struct PhaseTotals {
+        double WallTime = 0; // (s)
+        double CpuTime = 0; // (s)
+        unsigned long Calls = 0;
+    };
+
+    typedef std::array<PhaseTotals, PhaseCount> Report;
+
+    enum Object {
+        Vertices,
+        Edges,
+        RibbonManagers, // copies, mostly of the parent's into a new vertex
+        RibbonStores, // the ribbons themselves, copied when a copy-on-write manager changes them
+        RibbonLists, // std::list<Ribbon> nodes the K-ribbon TSP heuristics make (counted per node)
+        DubinsWrappers, // copies of edges' paths
+        ObstacleSnapshots, // precomputed projections and rasters of the obstacles
+        ObjectCount
+    };
+
+    struct ObjectTotals {
+        unsigned long Allocations = 0; // made from scratch
+        unsigned long Copies = 0;
+        unsigned long Bytes = 0; // for both (not counting any allocator overhead)
+    };
+
+    typedef std::array<ObjectTotals, ObjectCount> Allocations;
+
+#ifdef PATH_PLANNER_PROFILING
+    static constexpr bool c_Enabled = true;
+#else
+    static constexpr bool c_Enabled = false;
+#endif
+
+    static constexpr unsigned c_CpuSampleInterval = 16;
+
+    /**
+     * Make a profiler the one this thread's scopes count towards, until this goes out of scope.
+     */
+    class Attach {
+    public:
+#ifdef PATH_PLANNER_PROFILING
+        explicit Attach(Profiler* profiler) : m_Previous(t_Current) { t_Current = profiler; }
+        ~Attach() { t_Current = m_Previous; }
+    private:
+        Profiler* m_Previous;
+#else
+        explicit Attach(Profiler*) {}
+#endif
+    };
+
+    /**
+     * Time a phase, from here to the end of the enclosing block. Does nothing if the thread has no profiler.
+     */
+    class Scope {
+    public:
+#ifdef PATH_PLANNER_PROFILING
+        explicit Scope(Phase phase) : m_Profiler(t_Current), m_Phase(phase) {
+            if (!m_Profiler) return;
+            m_Wall = std::chrono::steady_clock::now();
+            if (t_Scopes++ % c_CpuSampleInterval == 0) m_Cpu = threadCpuNanoseconds();
+        }
+
+        ~Scope() { stop(); }
+
+        /**
+         * Stop timing before the end of the block.
+         */
+        void stop() {
+            if (!m_Profiler) return;
+            m_Profiler->add(m_Phase, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_Wall).count(),
+                    m_Cpu < 0 ? -1 : threadCpuNanoseconds() - m_Cpu);
+            m_Profiler = nullptr;
+        }
+
+    private:
+        Profiler* m_Profiler;
+        Phase m_Phase;
+        std::chrono::steady_clock::time_point m_Wall;
+        int64_t m_Cpu = -1; // not sampled
+#else
+        explicit Scope(Phase) {}
+
+        void stop() {}
+#endif
+    };
+
+    /**
+     * Count objects made from scratch for the attached profiler (if any).
+     * @param object
+     * @param bytes total size of them
+     * @param count
+     */
+    static void countAllocation(Object object, size_t bytes, unsigned long count = 1) {
+#ifdef PATH_PLANNER_PROFILING
+        if (t_Current) t_Current->addObjects(object, count, 0, bytes);
+#endif
+    }
+
+    /**
+     * Count a copy of an object for the attached profiler (if any).
+     * @param object
+     * @param bytes
+     */
+    static void countCopy(Object object, size_t bytes) {
+#ifdef PATH_PLANNER_PROFILING
+        if (t_Current) t_Current->addObjects(object, 0, 1, bytes);
+#endif
+    }
+
+    /**
+     * A member that counts copies of the class it's in, for classes that would otherwise need a hand written copy
+     * constructor just to do that. Moves don't count.
+     * @tparam Owner the class it's in
+     * @tparam O what to count it as
+     */
+    template <class Owner, Object O>
+    struct CopyCounted {
+        CopyCounted() = default;
+        CopyCounted(const CopyCounted&) { countCopy(O, sizeof(Owner)); }
+        CopyCounted(CopyCounted&&) noexcept {}
+        CopyCounted& operator=(const CopyCounted&) {
+            countCopy(O, sizeof(Owner));
+            return *this;
+        }
+        CopyCounted& operator=(CopyCounted&&) noexcept { return *this; }
+    };
+
+    /**
+     * Time a phase around one expression.
+     * @tparam F
+     * @param phase
+     * @param f
+     * @return f()
+     */
+    template <class F>
+    static auto measure(Phase phase, F f) -> decltype(f()) {
+        Scope scope(phase);
+        return f();
+    }
+
+    /**
+     * Add a call to a phase directly.
+     * @param phase
+     * @param wallNanoseconds
+     * @param cpuNanoseconds negative if the CPU time wasn't measured this time
+     */
+    void add(Phase phase, int64_t wallNanoseconds, int64_t cpuNanoseconds);
+
+    /**
+     * Add objects directly.
+     * @param object
+     * @param allocations
+     * @param copies
+     * @param bytes
+     */
+    void addObjects(Object object, unsigned long allocations, unsigned long copies, size_t bytes);
+
+    /**
+     * @return the totals so far
+     */
+    Report report() const;
+
+    /**
+     * @return the object counts so far
+     */
+    Allocations allocations() const;
+
+    /**
+     * @return the profiler attached to this thread (always null when profiling is compiled out)
+     */
+    static Profiler* current();
+
+    /**
+     * @return CPU time used by the calling thread so far (s). Works whether or not profiling is on.
+     */
+    static double threadCpuTime();
+
+    /**
+     * Add one report to another, like for the planners in a portfolio.
+     * @param into
+     * @param from
+     */
+    static void accumulate(Report& into, const Report& from);
+    static void accumulate(Allocations& into, const Allocations& from);
+
+    static const char* phaseName(Phase phase);
+    static const char* objectName(Object object);
+
+private:
+    std::atomic<int64_t> m_Wall[PhaseCount] = {};
+    std::atomic<int64_t> m_Cpu[PhaseCount] = {};
+    std::atomic<unsigned long> m_Calls[PhaseCount] = {};
+    std::atomic<unsigned long> m_CpuSamples[PhaseCount] = {};
+    std::atomic<unsigned long> m_Allocations[ObjectCount] = {};
+    std::atomic<unsigned long> m_Copies[ObjectCount] = {};
+    std::atomic<unsigned long> m_Bytes[ObjectCount] = {};
+
+    static int64_t threadCpuNanoseconds();
+
+#ifdef PATH_PLANNER_PROFILING
+    static thread_local Profiler* t_Current;
+    static thread_local unsigned t_Scopes;
+#endif
+};
+
+
+#endif //SRC_PROFILER_H
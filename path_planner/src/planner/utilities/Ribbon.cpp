@@ -1,5 +1,10 @@
 #include <sstream>
 #include "Ribbon.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 double Ribbon::RibbonWidth = 1.5;
 
@@ -16,6 +21,46 @@ Ribbon Ribbon::split(double x, double y, bool strict) {
     return r;
 }
 
+namespace {
+// narrow [low, high] to where a + (b - a) s is between lo and hi, and say whether anything's left
+bool clip(double a, double b, double lo, double hi, double& low, double& high) {
+    auto slope = b - a;
+    if (slope == 0) return a >= lo && a <= hi && low <= high;
+    auto s1 = (lo - a) / slope, s2 = (hi - a) / slope;
+    if (s1 > s2) std::swap(s1, s2);
+    low = fmax(low, s1);
+    high = fmin(high, s2);
+    return low <= high;
+}
+}
+
+Ribbon Ribbon::splitAlong(double x1, double y1, double x2, double y2, bool strict, double margin, double& along) {
+    along = -1;
+    const auto length = sqrt(squaredLength());
+    if (length == 0) return Ribbon::empty();
+    const auto ux = (m_EndX - m_StartX) / length, uy = (m_EndY - m_StartY) / length;
+    // distance along the ribbon and off to the side of it, at each end of the line
+    const auto t1 = (x1 - m_StartX) * ux + (y1 - m_StartY) * uy, t2 = (x2 - m_StartX) * ux + (y2 - m_StartY) * uy;
+    const auto h1 = (y1 - m_StartY) * ux - (x1 - m_StartX) * uy, h2 = (y2 - m_StartY) * ux - (x2 - m_StartX) * uy;
+    const auto width = (strict? RibbonWidth / c_StrictModifier : RibbonWidth) - margin;
+    // the part of the line inside the ribbon
+    double low = 0, high = 1;
+    if (!clip(h1, h2, -width, width, low, high) || !clip(t1, t2, 0, length, low, high)) return Ribbon::empty();
+    auto from = t1 + low * (t2 - t1), to = t1 + high * (t2 - t1);
+    if (from > to) std::swap(from, to);
+    from = fmax(from + margin, 0);
+    to = fmin(to - margin, length);
+    if (from > to) return Ribbon::empty();
+    along = high;
+    // the ribbon counts as covered a little before the line gets to the end of it
+    const auto minimum = minLength() / (strict? c_StrictModifier : 1);
+    if (t2 > t1 && length - to < minimum) along = fmax(low, fmin(high, (length - minimum + margin - t1) / (t2 - t1)));
+    else if (t2 < t1 && from < minimum) along = fmax(low, fmin(high, (t1 - minimum + margin) / (t1 - t2)));
+    Ribbon r(m_StartX, m_StartY, m_StartX + ux * from, m_StartY + uy * from);
+    m_StartX += ux * to; m_StartY += uy * to;
+    return r;
+}
+
 Ribbon Ribbon::empty() {
     return Ribbon(0, 0, 0, 0);
 }
@@ -42,6 +87,54 @@ bool Ribbon::contains(double x, double y, const std::pair<double, double>& proje
     return d < (strict? RibbonWidth / c_StrictModifier : RibbonWidth);
 }
 
+void Ribbon::flagPossiblyContained(const double* xs, const double* ys, size_t n, bool strict,
+                                   unsigned char* flags) const {
+    // In terms of the offset p from the start and the direction d = end - start, contains() needs the perpendicular
+    // distance |d x p| / |d| within the width and the projection inside the endpoints' bounding box (give or take
+    // c_Tolerance on each axis), which means d . p in [0, |d|^2] give or take less than 2 * c_Tolerance * |d|. Any
+    // piece lies along the same segment so the same bounds cover it too.
+    const double dx = m_EndX - m_StartX, dy = m_EndY - m_StartY;
+    const double length = sqrt(squaredLength());
+    const double slack = (2 * c_Tolerance + c_FlagSlack) * length;
+    const double low = -slack, high = squaredLength() + slack;
+    const double reach = ((strict? RibbonWidth / c_StrictModifier : RibbonWidth) + c_FlagSlack) * length;
+    const double reachSquared = reach * reach;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const auto vsx = _mm256_set1_pd(m_StartX), vsy = _mm256_set1_pd(m_StartY);
+    const auto vdx = _mm256_set1_pd(dx), vdy = _mm256_set1_pd(dy);
+    const auto vlow = _mm256_set1_pd(low), vhigh = _mm256_set1_pd(high), vreach = _mm256_set1_pd(reachSquared);
+    for (; i + 4 <= n; i += 4) {
+        auto px = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vsx), py = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vsy);
+        auto dot = _mm256_add_pd(_mm256_mul_pd(px, vdx), _mm256_mul_pd(py, vdy));
+        auto cross = _mm256_sub_pd(_mm256_mul_pd(vdx, py), _mm256_mul_pd(vdy, px));
+        auto in = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(dot, vlow, _CMP_GE_OQ), _mm256_cmp_pd(dot, vhigh, _CMP_LE_OQ)),
+                                _mm256_cmp_pd(_mm256_mul_pd(cross, cross), vreach, _CMP_LE_OQ));
+        auto mask = _mm256_movemask_pd(in);
+        for (int k = 0; k < 4; k++) flags[i + k] |= (unsigned char)((mask >> k) & 1);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const auto vsx = vdupq_n_f64(m_StartX), vsy = vdupq_n_f64(m_StartY);
+    const auto vdx = vdupq_n_f64(dx), vdy = vdupq_n_f64(dy);
+    const auto vlow = vdupq_n_f64(low), vhigh = vdupq_n_f64(high), vreach = vdupq_n_f64(reachSquared);
+    for (; i + 2 <= n; i += 2) {
+        auto px = vsubq_f64(vld1q_f64(xs + i), vsx), py = vsubq_f64(vld1q_f64(ys + i), vsy);
+        auto dot = vaddq_f64(vmulq_f64(px, vdx), vmulq_f64(py, vdy));
+        auto cross = vsubq_f64(vmulq_f64(vdx, py), vmulq_f64(vdy, px));
+        auto in = vandq_u64(vandq_u64(vcgeq_f64(dot, vlow), vcleq_f64(dot, vhigh)),
+                            vcleq_f64(vmulq_f64(cross, cross), vreach));
+        flags[i] |= (unsigned char)(vgetq_lane_u64(in, 0) & 1);
+        flags[i + 1] |= (unsigned char)(vgetq_lane_u64(in, 1) & 1);
+    }
+#endif
+    // the rest (or everything, without SIMD), written without branches so the compiler can vectorize it itself
+    for (; i < n; i++) {
+        const double px = xs[i] - m_StartX, py = ys[i] - m_StartY;
+        const double dot = px * dx + py * dy, cross = dx * py - dy * px;
+        flags[i] |= (unsigned char)((dot >= low) & (dot <= high) & (cross * cross <= reachSquared));
+    }
+}
+
 std::string Ribbon::toString() const {
     std::stringstream stream;
     stream << "(" << m_StartX << ", " << m_StartY << ") -> (" << m_EndX << ", " << m_EndY << ")"
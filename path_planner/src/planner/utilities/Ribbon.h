@@ -32,6 +32,24 @@ public:
      */
     Ribbon split(double x, double y, bool strict);
 
+    /**
+     * Cover whatever part of the ribbon a straight line from (x1, y1) to (x2, y2) runs through, all at once. That's
+     * what covering the points along the line one at a time with split() would do when they're closer together than
+     * the minimum length, just without the thousands of splits in between: this becomes the part after the covered
+     * stretch and the part before it gets returned.
+     * @param x1
+     * @param y1
+     * @param x2
+     * @param y2
+     * @param strict
+     * @param margin how much closer than the width the line has to come, and how far to pull in the ends of the
+     * covered stretch, for when the line stands in for a curve that's within that much of it
+     * @param along set to how far along the line (0 to 1) it's done with the ribbon, which is where it leaves it or
+     * where what's left at the end it's heading for gets below the minimum length, or -1 if it never touches it
+     * @return the part before the covered stretch (empty if the line doesn't touch the ribbon)
+     */
+    Ribbon splitAlong(double x1, double y1, double x2, double y2, bool strict, double margin, double& along);
+
     /**
      * @return true iff the ribbon is below the minimum length (all covered).
      */
@@ -114,6 +132,19 @@ public:
      */
     State getProjectionAsState(double x, double y) const;
 
+    /**
+     * Flag the points that this ribbon might contain (see contains()), for covering a batch of points at once. It's
+     * conservative: it never misses a point this ribbon or any piece split off it contains, but can flag a few more
+     * right at the edges, so flagged points still need checking properly. Vectorized across points with AVX2 or NEON
+     * when the compiler targets them.
+     * @param xs
+     * @param ys
+     * @param n number of points
+     * @param strict
+     * @param flags output, set to 1 for flagged points and left alone otherwise
+     */
+    void flagPossiblyContained(const double* xs, const double* ys, size_t n, bool strict, unsigned char* flags) const;
+
     // perpendicular distance to line through (startX, startY), (endX, endY)
     double distance(double x, double y) const {
         return (fabs((m_EndY - m_StartY) * x - (m_EndX - m_StartX) * y + m_EndX*m_StartY - m_EndY*m_StartX)) /
@@ -130,6 +161,9 @@ private:
 
     static constexpr double c_StrictModifier = 2;
 
+    // slack for flagPossiblyContained() so rounding in split pieces can't put a point outside what it flags
+    static constexpr double c_FlagSlack = 1e-4;
+
     double squaredLength() const {
         return (m_EndX - m_StartX) * (m_EndX - m_StartX) + (m_EndY - m_StartY) * (m_EndY - m_StartY);
     }
@@ -0,0 +1,59 @@
+#include <cmath>
+#include <cstring>
+#include "RibbonDistanceTable.h"
+extern "C" {
+#include <dubins.h>
+}
+
+RibbonDistanceTable::RibbonDistanceTable(const std::vector<Ribbon>& ribbons, bool dubins, double turningRadius)
+    : m_Ribbons(ribbons), m_Endpoints(2 * ribbons.size()), m_TurningRadius(turningRadius) {
+    std::vector<State> poses;
+    poses.reserve(m_Endpoints);
+    for (size_t i = 0; i < m_Ribbons.size(); i++) {
+        poses.push_back(m_Ribbons[i].startAsState());
+        poses.push_back(m_Ribbons[i].endAsState());
+        // duplicate ribbons have the same distances anyway so either one will do
+        m_Lookup.emplace(key(m_Ribbons[i]), (int)i);
+    }
+    // Same expressions as RibbonManager uses so values from the table are exactly what it would have computed
+    m_Euclidean.resize(m_Endpoints * m_Endpoints);
+    for (size_t i = 0; i < m_Endpoints; i++) {
+        for (size_t j = 0; j < m_Endpoints; j++) {
+            auto dx = poses[i].x() - poses[j].x(), dy = poses[i].y() - poses[j].y();
+            m_Euclidean[i * m_Endpoints + j] = sqrt(dx * dx + dy * dy);
+        }
+    }
+    if (!dubins) return;
+    if (turningRadius <= 0) throw std::logic_error("Cannot compute ribbon dubins distances with unset turning radius");
+    m_Dubins.resize(m_Endpoints * m_Endpoints);
+    for (size_t i = 0; i < m_Endpoints; i++) {
+        for (size_t j = 0; j < m_Endpoints; j++) {
+            DubinsPath path;
+            double q1[] = {poses[i].x(), poses[i].y(), poses[i].yaw()}, q2[] = {poses[j].x(), poses[j].y(), poses[j].yaw()};
+            dubins_shortest_path(&path, q1, q2, turningRadius);
+            m_Dubins[i * m_Endpoints + j] = dubins_path_length(&path);
+        }
+    }
+}
+
+int RibbonDistanceTable::find(const Ribbon& r) const {
+    auto it = m_Lookup.find(key(r));
+    if (it == m_Lookup.end()) return -1;
+    const auto& found = m_Ribbons[it->second];
+    // hash collisions are unlikely but a wrong distance would be bad
+    if (found.start() != r.start() || found.end() != r.end()) return -1;
+    return it->second;
+}
+
+uint64_t RibbonDistanceTable::key(const Ribbon& r) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (double d : {r.start().first, r.start().second, r.end().first, r.end().second}) {
+        if (d == 0) d = 0; // -0 == 0, so they have to hash the same
+        uint64_t b;
+        memcpy(&b, &d, sizeof(b));
+        hash ^= b;
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
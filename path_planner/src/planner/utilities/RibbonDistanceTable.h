@@ -0,0 +1,83 @@
+#ifndef SRC_RIBBONDISTANCETABLE_H
+#define SRC_RIBBONDISTANCETABLE_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Ribbon.h"
+
+/**
+ * Distances between the endpoints of a set of ribbons, computed once at the start of planning so the TSP and spanning
+ * tree heuristics don't redo them at every vertex. All they really have to compute per vertex is the distance from the
+ * vertex to each ribbon.
+ *
+ * Endpoint 2i is the start of ribbon i and 2i + 1 is its end. The pose at an endpoint is the one the heuristics already
+ * use for it (Ribbon::startAsState() or Ribbon::endAsState()), so the Dubins distances are between those.
+ *
+ * It's immutable once built, so every vertex's manager can share it. Covering part of a ribbon moves its endpoints, so
+ * only ribbons that are still exactly as they were are found; the heuristics compute the rest themselves as before.
+ */
+class RibbonDistanceTable {
+public:
+    typedef std::shared_ptr<const RibbonDistanceTable> SharedPtr;
+
+    /**
+     * Build the table.
+     * @param ribbons
+     * @param dubins whether to compute Dubins distances too (n^2 Dubins paths, so only when a heuristic needs them)
+     * @param turningRadius turning radius for the Dubins distances
+     */
+    RibbonDistanceTable(const std::vector<Ribbon>& ribbons, bool dubins, double turningRadius);
+
+    /**
+     * Look up a ribbon.
+     * @param r
+     * @return its index in the table, or -1 if it isn't there (including when it has been partially covered)
+     */
+    int find(const Ribbon& r) const;
+
+    /**
+     * @param from endpoint
+     * @param to endpoint
+     * @return Euclidean distance between the endpoints
+     */
+    double euclidean(int from, int to) const { return m_Euclidean[from * m_Endpoints + to]; }
+
+    /**
+     * @param from endpoint
+     * @param to endpoint
+     * @return Dubins distance from the pose at one endpoint to the pose at the other
+     */
+    double dubins(int from, int to) const { return m_Dubins[from * m_Endpoints + to]; }
+
+    /**
+     * @return whether Dubins distances were computed
+     */
+    bool hasDubins() const { return !m_Dubins.empty(); }
+
+    /**
+     * @return the turning radius used for the Dubins distances
+     */
+    double turningRadius() const { return m_TurningRadius; }
+
+    /**
+     * @return number of ribbons in the table
+     */
+    size_t size() const { return m_Ribbons.size(); }
+
+    // Euclidean table for 256 ribbons is 2MB, which is about as much as I want to build every iteration
+    static constexpr size_t c_MaxRibbons = 256;
+
+private:
+    std::vector<Ribbon> m_Ribbons;
+    size_t m_Endpoints;
+    double m_TurningRadius;
+    std::vector<double> m_Euclidean, m_Dubins;
+    std::unordered_map<uint64_t, int> m_Lookup;
+
+    static uint64_t key(const Ribbon& r);
+};
+
+
+#endif //SRC_RIBBONDISTANCETABLE_H
@@ -1,74 +1,305 @@
 #include <cfloat>
+#include <cstring>
 #include <algorithm>
 #include <sstream>
 #include <vector>
 #include "RibbonManager.h"
 
+namespace {
+// the lists the K-ribbon heuristics pass down (by value) as they recurse
+void countListNodes(size_t n) {
+    Profiler::countAllocation(Profiler::RibbonLists, n * (sizeof(Ribbon) + 2 * sizeof(void*)), n);
+}
+}
+
 void RibbonManager::add(double x1, double y1, double x2, double y2) {
-    if (m_Ribbons.size() > c_RibbonCountDangerThreshold)
+    if (m_Ribbons->size() > c_HeldKarpRibbonLimit)
         std::cerr << "Warning: adding more ribbons than can be used for TSP heuristics" << std::endl;
     Ribbon r(x1, y1, x2, y2);
-    add(r, m_Ribbons.end(), false);
+    if (r.covered(false)) return;
+    // TODO! -- determine whether to split any of the prior ribbons based on this new one
+    mutableRibbons().add(r);
+    rehashRibbons();
 }
 
 void RibbonManager::cover(double x, double y, bool strict) {
-    auto i = m_Ribbons.begin();
-    while (i != m_Ribbons.end()) {
-        auto r = i->split(x, y, strict);
-        add(r, i, strict);
-        if (i->covered(strict)) i = m_Ribbons.erase(i);
-        else ++i;
+    // Most points don't touch any ribbon, so check first without modifying anything. That way children in the search
+    // tree keep sharing their parent's ribbons until they actually cover something.
+    if (!wouldCover(x, y, strict)) return;
+    // scratch space, because this happens at every step along an edge that's driving down a ribbon
+    static thread_local std::vector<int> candidates;
+    static thread_local std::vector<Ribbon> pieces;
+    bool all = !m_Ribbons->indexed() || !findCoverCandidates(x, y, strict, candidates);
+    auto& ribbons = mutableRibbons();
+    auto n = all? ribbons.origins() : (int)candidates.size();
+    for (int j = 0; j < n; j++) {
+        auto origin = all? j : candidates[j];
+        size_t first, count;
+        ribbons.pieces(origin, first, count);
+        pieces.clear();
+        bool sameCount = true;
+        // each piece that contains the point gets split there, with the part before it going in front
+        for (size_t i = first; i < first + count; i++) {
+            auto piece = ribbons.ribbons()[i];
+            auto r = piece.split(x, y, strict);
+            auto keepSplit = !r.covered(strict), keepPiece = !piece.covered(strict);
+            if (keepSplit) pieces.push_back(r);
+            if (keepPiece) pieces.push_back(piece);
+            sameCount &= !keepSplit && keepPiece;
+        }
+        // usually we've just nibbled the start off a ribbon we're driving along
+        if (sameCount) for (size_t i = 0; i < count; i++) ribbons.shrink(first + i, pieces[i]);
+        else ribbons.replacePieces(origin, pieces);
+    }
+    rehashRibbons();
+}
+
+void RibbonManager::cover(const std::vector<double>& xs, const std::vector<double>& ys, bool strict) {
+    const auto n = std::min(xs.size(), ys.size());
+    if (n == 0 || done()) return;
+    size_t first = 0;
+    // Covering a point also erases any ribbon that's already too short, whether or not the point touches it, so let
+    // the first point do that. Covering never leaves one behind, so after that only points on a ribbon do anything.
+    auto shortest = m_Ribbons->shortestLength();
+    if (shortest * shortest <
+        Ribbon::minLength() * Ribbon::minLength() / (strict? Ribbon::strictModifier() * Ribbon::strictModifier() : 1)) {
+        cover(xs[0], ys[0], strict);
+        first = 1;
+    }
+    if (first == n || done()) return;
+    // Pieces only ever shrink along their original segments, so whatever the ribbons as they are now don't flag can't
+    // be touched by any of the pieces covering the flagged points leaves behind either
+    static thread_local std::vector<unsigned char> flags;
+    static thread_local std::vector<int> candidates;
+    flags.assign(n, 0);
+    const auto count = n - first;
+    auto flag = [&](const Ribbon& r) { r.flagPossiblyContained(&xs[first], &ys[first], count, strict, &flags[first]); };
+    if (m_Ribbons->indexed()) {
+        auto minX = *std::min_element(xs.begin() + first, xs.begin() + n);
+        auto maxX = *std::max_element(xs.begin() + first, xs.begin() + n);
+        auto minY = *std::min_element(ys.begin() + first, ys.begin() + n);
+        auto maxY = *std::max_element(ys.begin() + first, ys.begin() + n);
+        m_Ribbons->near((minX + maxX) / 2, (minY + maxY) / 2,
+                        distance(minX, minY, maxX, maxY) / 2 + Ribbon::RibbonWidth + 1e-4, candidates);
+        for (auto origin : candidates) {
+            size_t firstPiece, pieceCount;
+            m_Ribbons->pieces(origin, firstPiece, pieceCount);
+            for (size_t i = firstPiece; i < firstPiece + pieceCount; i++) flag(m_Ribbons->ribbons()[i]);
+        }
+    } else {
+        for (const auto& r : *m_Ribbons) flag(r);
+    }
+    for (size_t i = first; i < n; i++) if (flags[i]) cover(xs[i], ys[i], strict);
+}
+
+bool RibbonManager::findCoverCandidates(double x, double y, bool strict, std::vector<int>& candidates) const {
+    auto shortest = m_Ribbons->shortestLength();
+    if (!m_Ribbons->indexed() || shortest * shortest <
+        Ribbon::minLength() * Ribbon::minLength() / (strict? Ribbon::strictModifier() * Ribbon::strictModifier() : 1)) {
+        return false;
+    }
+    // contains() allows a little past the ends
+    m_Ribbons->near(x, y, Ribbon::RibbonWidth + 1e-4, candidates);
+    return true;
+}
+
+bool RibbonManager::wouldCover(double x, double y, bool strict) const {
+    static thread_local std::vector<int> candidates;
+    if (!m_Ribbons->indexed() || !findCoverCandidates(x, y, strict, candidates)) {
+        for (const auto& r : *m_Ribbons) {
+            // covered ribbons get erased, contained points get split
+            if (r.covered(strict) || r.contains(x, y, r.getProjection(x, y), strict)) return true;
+        }
+        return false;
+    }
+    for (auto origin : candidates) {
+        size_t first, count;
+        m_Ribbons->pieces(origin, first, count);
+        for (size_t i = first; i < first + count; i++) {
+            const auto& r = m_Ribbons->ribbons()[i];
+            if (r.contains(x, y, r.getProjection(x, y), strict)) return true;
+        }
+    }
+    return false;
+}
+
+RibbonStore& RibbonManager::mutableRibbons() {
+    // copy on write
+    if (m_Ribbons.use_count() > 1) {
+        m_Ribbons = std::make_shared<RibbonStore>(*m_Ribbons);
+        Profiler::countAllocation(Profiler::RibbonStores, sizeof(RibbonStore) + m_Ribbons->size() * sizeof(Ribbon));
     }
+    return *m_Ribbons;
 }
 
 bool RibbonManager::done() const {
-    return m_Ribbons.empty();
+    return m_Ribbons->empty() && m_RemainderCost <= 0;
 }
 
 double RibbonManager::approximateDistanceUntilDone(double x, double y, double yaw) const {
-   if (done()) return 0;
+    if (m_RemainderCost <= 0) return ribbonsDistanceUntilDone(x, y, yaw);
+    if (m_Ribbons->empty()) return distance(x, y, m_RemainderX, m_RemainderY) + m_RemainderCost;
+    // our ribbons, then on to the rest from whichever end of them is closest
+    auto link = DBL_MAX;
+    for (const auto& r : *m_Ribbons) {
+        link = fmin(link, fmin(distance(r.start(), m_RemainderX, m_RemainderY),
+                               distance(r.end(), m_RemainderX, m_RemainderY)));
+    }
+    return ribbonsDistanceUntilDone(x, y, yaw) + link + m_RemainderCost;
+}
+
+double RibbonManager::ribbonsDistanceUntilDone(double x, double y, double yaw) const {
+    if (m_Ribbons->empty()) return 0;
     // if we're above the danger threshold just give max distance
-//    if (m_Ribbons.size() > c_RibbonCountDangerThreshold) return maxDistance(x, y);
+//    if (m_Ribbons->size() > c_RibbonCountDangerThreshold) return maxDistance(x, y);
     switch (m_Heuristic) {
         // Modified max distance heuristic
         case MaxDistance: {
             return maxDistance(x, y);
         }
         case TspPointRobotNoSplitAllRibbons: {
-            return tspPointRobotNoSplitAllRibbons(m_Ribbons, 0, std::make_pair(x, y));
+            return tspNoSplitAllRibbons(x, y, yaw, false);
         }
         case TspDubinsNoSplitAllRibbons: {
-            return tspDubinsNoSplitAllRibbons(m_Ribbons, 0, x, y, yaw);
+            return tspNoSplitAllRibbons(x, y, yaw, true);
         }
         case TspPointRobotNoSplitKRibbons: {
-            return tspPointRobotNoSplitKRibbons(m_Ribbons, 0, std::make_pair(x, y));
+            return tspPointRobotNoSplitKRibbons(std::list<Ribbon>(m_Ribbons->begin(), m_Ribbons->end()), 0,
+                                                std::make_pair(x, y));
         }
         case TspDubinsNoSplitKRibbons: {
-            return tspDubinsNoSplitKRibbons(m_Ribbons, 0, x, y, yaw);
+            return tspDubinsNoSplitKRibbons(std::list<Ribbon>(m_Ribbons->begin(), m_Ribbons->end()), 0,
+                                            x, y, yaw);
+        }
+        case MinimumSpanningTree: {
+            return minimumSpanningTree(x, y);
         }
         default: return 0;
     }
 }
 
-double RibbonManager::tspPointRobotNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, std::pair<double, double> point) {
-    // Depth-first TSP solution
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        const Ribbon r = *it;
-        it = ribbonsLeft.erase(it);
-        min = fmin(min, tspPointRobotNoSplitAllRibbons(ribbonsLeft, fmax(distanceSoFar + r.length() -
-            2 * Ribbon::RibbonWidth + distance(point, r.start()), 0), r.end()));
-        min = fmin(min, tspPointRobotNoSplitAllRibbons(ribbonsLeft, fmax(distanceSoFar + r.length() -
-            2 * Ribbon::RibbonWidth + distance(point, r.end()), 0), r.start()));
-        it = ribbonsLeft.insert(it, r);
+double RibbonManager::tspNoSplitAllRibbons(double x, double y, double yaw, bool dubins) const {
+    // Node 2i means covering ribbon i from its start to its end, 2i + 1 means covering it the other way. Each node has
+    // the pose we arrive at (one end) and the pose we leave from (the other end).
+    const auto n = m_Ribbons->size();
+    if (n > c_HeldKarpRibbonLimit) return minimumSpanningTree(x, y); // table would be enormous
+    const size_t nodes = 2 * n;
+    std::vector<State> entries, exits;
+    std::vector<double> lengths;
+    std::vector<int> inTable;
+    entries.reserve(nodes); exits.reserve(nodes); lengths.reserve(n); inTable.reserve(n);
+    const auto distances = m_DistanceTable && (!dubins || (m_DistanceTable->hasDubins() &&
+        m_DistanceTable->turningRadius() == m_TurningRadius))? m_DistanceTable.get() : nullptr;
+    for (const auto& r : *m_Ribbons) {
+        auto start = r.startAsState(), end = r.endAsState();
+        entries.push_back(start); exits.push_back(end);
+        entries.push_back(end); exits.push_back(start);
+        lengths.push_back(r.length());
+        inTable.push_back(distances? distances->find(r) : -1);
     }
-    return min;
+    auto transit = [&](double x1, double y1, double yaw1, const State& s) {
+        return dubins? dubinsDistance(x1, y1, yaw1, s) : distance(x1, y1, s.x(), s.y());
+    };
+
+    // per thread so parallel edge evaluation doesn't fight over it, and only ever grown so we don't allocate per call
+    static thread_local std::vector<double> between, table;
+    between.resize(nodes * nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        for (size_t j = 0; j < nodes; j++) {
+            if (i / 2 == j / 2) continue; // never used
+            const auto from = inTable[i / 2], to = inTable[j / 2];
+            if (from != -1 && to != -1) {
+                // node 2i leaves from ribbon i's end (endpoint 2i + 1) and 2i + 1 from its start; entries are opposite
+                const int exit = 2 * from + (i % 2 == 0), entry = 2 * to + (j % 2 == 1);
+                between[i * nodes + j] = dubins? distances->dubins(exit, entry) : distances->euclidean(exit, entry);
+            } else {
+                between[i * nodes + j] = transit(exits[i].x(), exits[i].y(), exits[i].yaw(), entries[j]);
+            }
+        }
+    }
+
+    // table[mask * nodes + k] is the cheapest way to cover the ribbons in mask, finishing with node k.
+    // Clamping at zero like the recursive version did is fine here because it's monotonic, so the DP is still exact.
+    const size_t full = ((size_t)1 << n) - 1;
+    table.assign((full + 1) * nodes, DBL_MAX);
+    for (size_t k = 0; k < nodes; k++) {
+        table[((size_t)1 << (k / 2)) * nodes + k] = fmax(lengths[k / 2] - 2 * Ribbon::RibbonWidth +
+            transit(x, y, yaw, entries[k]), 0);
+    }
+    for (size_t mask = 1; mask < full; mask++) {
+        const auto row = &table[mask * nodes];
+        for (size_t k = 0; k < nodes; k++) {
+            const auto soFar = row[k];
+            if (soFar == DBL_MAX) continue; // unreachable, including k not being in mask
+            const auto from = &between[k * nodes];
+            for (size_t j = 0; j < n; j++) {
+                const auto bit = (size_t)1 << j;
+                if (mask & bit) continue;
+                const auto next = &table[(mask | bit) * nodes + 2 * j];
+                const auto partial = soFar + lengths[j] - 2 * Ribbon::RibbonWidth;
+                next[0] = fmin(next[0], fmax(partial + from[2 * j], 0));
+                next[1] = fmin(next[1], fmax(partial + from[2 * j + 1], 0));
+            }
+        }
+    }
+    const auto last = &table[full * nodes];
+    return *std::min_element(last, last + nodes);
+}
+
+double RibbonManager::minimumSpanningTree(double x, double y) const {
+    const auto n = m_Ribbons->size();
+    static thread_local std::vector<std::pair<double, double>> starts, ends;
+    static thread_local std::vector<double> closest;
+    static thread_local std::vector<char> inTree;
+    static thread_local std::vector<int> inTable;
+    starts.clear(); ends.clear(); inTable.clear();
+    double sumLength = 0, toNearest = DBL_MAX;
+    const auto distances = m_DistanceTable.get();
+    for (const auto& r : *m_Ribbons) {
+        starts.push_back(r.start());
+        ends.push_back(r.end());
+        inTable.push_back(distances? distances->find(r) : -1);
+        sumLength += r.length() - 2 * Ribbon::RibbonWidth;
+        toNearest = fmin(toNearest, fmin(distance(r.start(), x, y), distance(r.end(), x, y)));
+    }
+    auto hop = [&](size_t i, size_t j) {
+        const auto a = inTable[i], b = inTable[j];
+        if (a != -1 && b != -1) {
+            return fmin(fmin(distances->euclidean(2 * a, 2 * b), distances->euclidean(2 * a, 2 * b + 1)),
+                        fmin(distances->euclidean(2 * a + 1, 2 * b), distances->euclidean(2 * a + 1, 2 * b + 1)));
+        }
+        return fmin(fmin(distance(starts[i], starts[j]), distance(starts[i], ends[j])),
+                    fmin(distance(ends[i], starts[j]), distance(ends[i], ends[j])));
+    };
+
+    // Prim's, growing from ribbon 0
+    closest.assign(n, DBL_MAX);
+    inTree.assign(n, 0);
+    double treeLength = 0;
+    size_t current = 0;
+    inTree[0] = 1;
+    for (size_t added = 1; added < n; added++) {
+        size_t next = 0;
+        auto min = DBL_MAX;
+        for (size_t j = 0; j < n; j++) {
+            if (inTree[j]) continue;
+            closest[j] = fmin(closest[j], hop(current, j));
+            if (closest[j] < min) {
+                min = closest[j];
+                next = j;
+            }
+        }
+        treeLength += min;
+        inTree[next] = 1;
+        current = next;
+    }
+    return fmax(sumLength + toNearest + treeLength, 0);
 }
 
 double RibbonManager::tspPointRobotNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar,
                                                    std::pair<double, double> point) const {
     if (ribbonsLeft.empty()) return distanceSoFar;
+    countListNodes(ribbonsLeft.size());
     auto min = DBL_MAX;
     auto comp = [&] (const Ribbon& r1, const Ribbon& r2) {
         double min1 = fmin(distance(point, r1.start()), distance(point, r1.end()));
@@ -94,28 +325,10 @@ double RibbonManager::tspPointRobotNoSplitKRibbons(std::list<Ribbon> ribbonsLeft
 }
 
 
-double RibbonManager::tspDubinsNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
-                                                 double y, double yaw) const{
-    // Depth-first TSP solution
-    if (ribbonsLeft.empty()) return distanceSoFar;
-    auto min = DBL_MAX;
-    for (auto it = ribbonsLeft.begin(); it != ribbonsLeft.end(); it++) {
-        const auto r = *it;
-        it = ribbonsLeft.erase(it);
-        auto start = r.startAsState();
-        auto end = r.endAsState();
-        min  = fmin(min, tspDubinsNoSplitAllRibbons(ribbonsLeft, fmax(distanceSoFar + r.length() - 2 * Ribbon::RibbonWidth +
-            dubinsDistance(x, y, yaw, start), 0), end.x(), end.y(), end.yaw()));
-        min  = fmin(min, tspDubinsNoSplitAllRibbons(ribbonsLeft, fmax(distanceSoFar + r.length() - 2 * Ribbon::RibbonWidth +
-            dubinsDistance(x, y, yaw, end), 0), start.x(), start.y(), start.yaw()));
-        it = ribbonsLeft.insert(it, r);
-    }
-    return min;
-}
-
 double RibbonManager::tspDubinsNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x, double y,
                                                double yaw) const {
     if (ribbonsLeft.empty()) return distanceSoFar;
+    countListNodes(ribbonsLeft.size());
     auto min = DBL_MAX;
     auto comp = [&] (const Ribbon& r1, const Ribbon& r2) {
         double min1 = fmin(dubinsDistance(x, y, yaw, r1.startAsState()), dubinsDistance(x, y, yaw, r1.endAsState()));
@@ -140,29 +353,35 @@ double RibbonManager::tspDubinsNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, do
 }
 
 double RibbonManager::minDistanceFrom(double x, double y) const {
-    if (m_Ribbons.empty()) return 0;
-    auto min = DBL_MAX;
-    for (const auto& r : m_Ribbons) {
-        if (r.contains(x, y, r.getProjection(x, y), false)) return 0;
-        auto dStart = distance(r.start(), x, y);
-        auto dEnd = distance(r.end(), x, y);
-        min = fmin(fmin(min, dEnd), dStart);
+    if (m_Ribbons->empty()) return 0;
+    if (!m_Ribbons->indexed()) {
+        auto min = DBL_MAX;
+        for (const auto& r : *m_Ribbons) {
+            if (r.contains(x, y, r.getProjection(x, y), false)) return 0;
+            auto dStart = distance(r.start(), x, y);
+            auto dEnd = distance(r.end(), x, y);
+            min = fmin(fmin(min, dEnd), dStart);
+        }
+        return min;
     }
-    return min;
-}
-
-void RibbonManager::add(const Ribbon& r, std::list<Ribbon>::iterator i, bool strict) {
-    if (r.covered(strict)) return;
-    // TODO! -- issue warning about large numbers of ribbons
-    // TODO! -- determine whether to split any of the prior ribbons based on this new one
-    m_Ribbons.insert(i, r);
+    static thread_local std::vector<int> near;
+    m_Ribbons->near(x, y, Ribbon::RibbonWidth + 1e-4, near);
+    for (auto origin : near) {
+        size_t first, count;
+        m_Ribbons->pieces(origin, first, count);
+        for (size_t i = first; i < first + count; i++) {
+            const auto& r = m_Ribbons->ribbons()[i];
+            if (r.contains(x, y, r.getProjection(x, y), false)) return 0;
+        }
+    }
+    return m_Ribbons->nearestEndpointDistance(x, y);
 }
 
 State RibbonManager::getNearestEndpointAsState(const State& state) const {
-    if (done()) throw std::logic_error("Attempting to get nearest endpoint when there are no ribbons");
+    if (m_Ribbons->empty()) throw std::logic_error("Attempting to get nearest endpoint when there are no ribbons");
     auto min = DBL_MAX;
     State ret;
-    for (const auto& r : m_Ribbons) {
+    for (const auto& r : *m_Ribbons) {
         auto s = r.startAsState();
         s.move(Ribbon::minLength() / Ribbon::strictModifier() + 1e-5);
         auto d = state.distanceTo(s);
@@ -195,7 +414,16 @@ State RibbonManager::getNearestEndpointAsState(const State& state) const {
     return ret;
 }
 
-RibbonManager::RibbonManager(RibbonManager::Heuristic heuristic) : m_Heuristic(heuristic) {}
+RibbonManager::RibbonManager(RibbonManager::Heuristic heuristic)
+    : m_Heuristic(heuristic), m_Ribbons(emptyRibbons()) {
+    rehashRibbons();
+}
+
+const std::shared_ptr<RibbonStore>& RibbonManager::emptyRibbons() {
+    // everybody starts off sharing this one, so constructing a manager (like every vertex does) doesn't allocate
+    static const auto empty = std::make_shared<RibbonStore>();
+    return empty;
+}
 
 RibbonManager::RibbonManager() : RibbonManager(MaxDistance) {}
 
@@ -204,8 +432,8 @@ RibbonManager::RibbonManager() : RibbonManager(MaxDistance) {}
 std::string RibbonManager::dumpRibbons() const {
     std::stringstream stream;
     stream << "Ribbons: \n";
-    if (m_Ribbons.empty()) stream << "None\n";
-    else for (const auto& r : m_Ribbons) stream << r.toString() << "\n";
+    if (m_Ribbons->empty()) stream << "None\n";
+    else for (const auto& r : *m_Ribbons) stream << r.toString() << "\n";
     return stream.str();
 }
 
@@ -219,10 +447,10 @@ RibbonManager::RibbonManager(RibbonManager::Heuristic heuristic, double turningR
 }
 
 void RibbonManager::projectOntoNearestRibbon(State& state) const {
-    if (m_Ribbons.empty()) return;
+    if (m_Ribbons->empty()) return;
     auto min = DBL_MAX;
     auto ribbon = Ribbon::empty();
-    for (const auto& r : m_Ribbons) {
+    for (const auto& r : *m_Ribbons) {
         auto d = r.distance(state.x(), state.y());
         if (d < min) {
             min = d;
@@ -238,7 +466,7 @@ double RibbonManager::maxDistance(double x, double y) const {
     // Whichever is larger is returned.
     // Both are technically inadmissible due to the "done" action but that's not implemented yet anywhere
     double sumLength = 0, min = DBL_MAX, max = 0;
-    for (const auto& r : m_Ribbons) {
+    for (const auto& r : *m_Ribbons) {
         sumLength += r.length() - 2 * Ribbon::RibbonWidth; // can technically shortcut the ribbon on both ends
         auto dStart = distance(r.start(), x, y);
         auto dEnd = distance(r.end(), x, y);
@@ -248,13 +476,13 @@ double RibbonManager::maxDistance(double x, double y) const {
     return fmax(sumLength + min, max);
 }
 
-const std::list<Ribbon>& RibbonManager::get() const {
-    return m_Ribbons;
+const std::vector<Ribbon>& RibbonManager::get() const {
+    return m_Ribbons->ribbons();
 }
 
 std::vector<State> RibbonManager::findStatesOnRibbonsOnCircle(const State& center, double radius) const {
     std::vector<State> states;
-    for (const auto& r : m_Ribbons) {
+    for (const auto& r : *m_Ribbons) {
         // circle line intersection from mathworld.wolfram.com
         auto dx = r.end().first - r.start().first;
         auto dy = r.end().second - r.start().second;
@@ -304,7 +532,7 @@ std::vector<State> RibbonManager::findNearStatesOnRibbons(const State& start, do
     auto y1 = start.y() + sin(h) * radius;
     auto y2 = start.y() - sin(h) * radius;
 
-    for (const Ribbon& r : m_Ribbons) {
+    for (const Ribbon& r : *m_Ribbons) {
 
         // check if ribbon is anywhere near current state (within 2*r)
         auto startProj = r.getProjection(start.x(), start.y());
@@ -381,8 +609,34 @@ std::vector<State> RibbonManager::findNearStatesOnRibbons(const State& start, do
 }
 
 void RibbonManager::changeHeuristicIfTooManyRibbons() {
-    if (m_Ribbons.size() > c_RibbonCountDangerThreshold) {
-        m_Heuristic = MaxDistance;
+    switch (m_Heuristic) {
+        case TspPointRobotNoSplitAllRibbons:
+        case TspDubinsNoSplitAllRibbons:
+            if (m_Ribbons->size() > c_HeldKarpRibbonLimit) m_Heuristic = MinimumSpanningTree;
+            break;
+        case TspPointRobotNoSplitKRibbons:
+        case TspDubinsNoSplitKRibbons:
+            if (m_Ribbons->size() > c_RibbonCountDangerThreshold) m_Heuristic = MinimumSpanningTree;
+            break;
+        default: break;
+    }
+}
+
+void RibbonManager::precomputeDistances() {
+    m_DistanceTable = nullptr;
+    if (m_Ribbons->size() < 2 || m_Ribbons->size() > RibbonDistanceTable::c_MaxRibbons) return;
+    switch (m_Heuristic) {
+        case TspPointRobotNoSplitAllRibbons:
+        case MinimumSpanningTree:
+            m_DistanceTable = std::make_shared<const RibbonDistanceTable>(m_Ribbons->ribbons(), false, m_TurningRadius);
+            break;
+        case TspDubinsNoSplitAllRibbons:
+            // leave complaining about the unset turning radius to the heuristic itself
+            if (m_TurningRadius <= 0) break;
+            m_DistanceTable = std::make_shared<const RibbonDistanceTable>(m_Ribbons->ribbons(), true, m_TurningRadius);
+            break;
+        // the k-limited ones re-sort by distance from wherever they are at every level, so there's not much to save
+        default: break;
     }
 }
 
@@ -393,15 +647,63 @@ void RibbonManager::setHeuristic(Heuristic heuristic) {
 void RibbonManager::coverBetween(double x1, double y1, double x2, double y2, bool strict) {
     double theta = atan((y2 - y1) / (x2 - x1));
     double d = distance(x1, y1, x2, y2);
+    // collect the points and cover them all at once
+    static thread_local std::vector<double> xs, ys;
+    xs.clear(); ys.clear();
     do {
         auto d1 = distance(x1, y1, x2, y2);
         if (d1 > d) break; // ensure distance to go is decreasing
         else d = d1;
-        cover(x1, y1, strict);
+        xs.push_back(x1); ys.push_back(y1);
         x1 += Ribbon::minLength() * cos(theta) / 2; // so we don't overshoot
         y1 += Ribbon::minLength() * sin(theta) / 2;
     } while (d > Ribbon::minLength());
-    cover(x2, y2, strict);
+    xs.push_back(x2); ys.push_back(y2);
+    cover(xs, ys, strict);
+}
+
+double RibbonManager::coverAlong(double x1, double y1, double x2, double y2, bool strict, double margin) {
+    static thread_local std::vector<int> candidates;
+    static thread_local std::vector<Ribbon> pieces;
+    // short ribbons go whether the line touches them or not, so then all of them need a look
+    auto shortest = m_Ribbons->shortestLength();
+    bool all = !m_Ribbons->indexed() || shortest * shortest <
+        Ribbon::minLength() * Ribbon::minLength() / (strict? Ribbon::strictModifier() * Ribbon::strictModifier() : 1);
+    if (!all) {
+        m_Ribbons->near((x1 + x2) / 2, (y1 + y2) / 2, distance(x1, y1, x2, y2) / 2 + Ribbon::RibbonWidth + 1e-4,
+                        candidates);
+    }
+    double along = -1;
+    auto n = all? m_Ribbons->origins() : (int)candidates.size();
+    for (int j = 0; j < n; j++) {
+        auto origin = all? j : candidates[j];
+        size_t first, count;
+        m_Ribbons->pieces(origin, first, count);
+        pieces.clear();
+        bool changed = false;
+        // work out the new pieces before touching anything, so the ribbons stay shared unless something changes
+        for (size_t i = first; i < first + count; i++) {
+            auto piece = m_Ribbons->ribbons()[i];
+            if (piece.covered(strict)) {
+                changed = true;
+                along = fmax(along, 0);
+                continue;
+            }
+            double pieceAlong;
+            auto r = piece.splitAlong(x1, y1, x2, y2, strict, margin, pieceAlong);
+            if (pieceAlong < 0) {
+                pieces.push_back(piece);
+                continue;
+            }
+            changed = true;
+            along = fmax(along, pieceAlong);
+            if (!r.covered(strict)) pieces.push_back(r);
+            if (!piece.covered(strict)) pieces.push_back(piece);
+        }
+        if (changed) mutableRibbons().replacePieces(origin, pieces);
+    }
+    if (along >= 0) rehashRibbons();
+    return along;
 }
 
 double RibbonManager::coverageCompletedTime() const {
@@ -415,7 +717,81 @@ void RibbonManager::setCoverageCompletedTime(double coverageCompletedTime) {
 
 double RibbonManager::getTotalUncoveredLength() const {
     auto sum = 0;
-    for (const auto& r : m_Ribbons) sum += r.length();
+    for (const auto& r : *m_Ribbons) sum += r.length();
     return sum;
 }
 
+
+bool RibbonManager::sameRibbonsAs(const RibbonManager& other) const {
+    if (m_RemainderCost != other.m_RemainderCost || m_RemainderX != other.m_RemainderX ||
+        m_RemainderY != other.m_RemainderY) return false;
+    if (m_Ribbons == other.m_Ribbons) return true;
+    if (m_RibbonsHash != other.m_RibbonsHash || m_Ribbons->size() != other.m_Ribbons->size()) return false;
+    auto j = other.m_Ribbons->begin();
+    for (const auto& r : *m_Ribbons) {
+        if (r.start() != j->start() || r.end() != j->end()) return false;
+        ++j;
+    }
+    return true;
+}
+
+namespace {
+inline void hashCombine(uint64_t& hash, uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ULL;
+    hash ^= hash >> 29;
+}
+
+inline uint64_t bits(double d) {
+    if (d == 0) d = 0; // -0 and 0 should hash the same
+    uint64_t b;
+    memcpy(&b, &d, sizeof(b));
+    return b;
+}
+}
+
+void RibbonManager::rehashRibbons() {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const auto& r : *m_Ribbons) {
+        hashCombine(hash, bits(r.start().first));
+        hashCombine(hash, bits(r.start().second));
+        hashCombine(hash, bits(r.end().first));
+        hashCombine(hash, bits(r.end().second));
+    }
+    m_RibbonsHash = hash;
+}
+
+uint64_t RibbonManager::heuristicKey() const {
+    auto hash = m_RibbonsHash;
+    hashCombine(hash, (uint64_t)m_Heuristic);
+    hashCombine(hash, bits(Ribbon::RibbonWidth));
+    if (m_Heuristic == TspDubinsNoSplitAllRibbons || m_Heuristic == TspDubinsNoSplitKRibbons)
+        hashCombine(hash, bits(m_TurningRadius));
+    // k is only set for the heuristics that use it
+    if (m_Heuristic == TspPointRobotNoSplitKRibbons || m_Heuristic == TspDubinsNoSplitKRibbons)
+        hashCombine(hash, (uint64_t)m_K);
+    if (m_RemainderCost > 0) {
+        hashCombine(hash, bits(m_RemainderCost));
+        hashCombine(hash, bits(m_RemainderX));
+        hashCombine(hash, bits(m_RemainderY));
+    }
+    return hash;
+}
+
+RibbonManager RibbonManager::subset(const std::vector<int>& indices) const {
+    auto subset = *this;
+    subset.m_Ribbons = emptyRibbons();
+    subset.m_DistanceTable = nullptr;
+    if (!indices.empty()) {
+        auto& ribbons = subset.mutableRibbons();
+        for (auto i : indices) ribbons.add(m_Ribbons->ribbons()[i]);
+    }
+    subset.rehashRibbons();
+    return subset;
+}
+
+void RibbonManager::setRemainder(double cost, double x, double y) {
+    m_RemainderCost = fmax(cost, 0);
+    m_RemainderX = x;
+    m_RemainderY = y;
+}
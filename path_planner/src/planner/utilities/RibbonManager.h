@@ -2,15 +2,24 @@
 #define SRC_RIBBONMANAGER_H
 
 #include <list>
+#include <memory>
 #include <vector>
+#include <cstdint>
 #include <path_planner_common/State.h>
 #include "Ribbon.h"
+#include "RibbonStore.h"
+#include "RibbonDistanceTable.h"
+#include "Profiler.h"
 extern "C" {
 #include <dubins.h>
 }
 
 /**
  * Class that holds ribbons (survey lines).
+ *
+ * Every vertex in the search tree has its own ribbon manager, so copies need to be cheap. The ribbons themselves are
+ * copy-on-write: copies share one list until one of them actually changes it (adding a ribbon or covering part of one).
+ * Sharing isn't thread safe, so don't copy a manager on one thread while another is changing it.
  */
 class RibbonManager {
 public:
@@ -23,6 +32,7 @@ public:
         TspPointRobotNoSplitKRibbons,
         TspDubinsNoSplitAllRibbons,
         TspDubinsNoSplitKRibbons,
+        MinimumSpanningTree,
     };
 
     /**
@@ -67,6 +77,16 @@ public:
      */
     void cover(double x, double y, bool strict);
 
+    /**
+     * Update the ribbons by covering each point in turn, like calling cover(xs[i], ys[i], strict) for each one, but
+     * quicker: all the points are checked against each ribbon at once and only the ones that might touch a ribbon get
+     * covered one by one.
+     * @param xs
+     * @param ys
+     * @param strict
+     */
+    void cover(const std::vector<double>& xs, const std::vector<double>& ys, bool strict);
+
     /**
      * Update the ribbons by covering between (x1, y1) and (x2, y2)
      * @param x1
@@ -77,7 +97,21 @@ public:
     void coverBetween(double x1, double y1, double x2, double y2, bool strict);
 
     /**
-     * @return whether the ribbons are all covered
+     * Update the ribbons by covering everything a straight line from (x1, y1) to (x2, y2) runs through, worked out
+     * from the geometry once per ribbon (see Ribbon::splitAlong) instead of point by point. Like cover(), any ribbon
+     * already short enough to count as covered goes too.
+     * @param x1
+     * @param y1
+     * @param x2
+     * @param y2
+     * @param strict
+     * @param margin how far the line might be from the path it stands in for (0 for the path itself)
+     * @return how far along the line (0 to 1) the last change was, or -1 if nothing changed
+     */
+    double coverAlong(double x1, double y1, double x2, double y2, bool strict, double margin = 0);
+
+    /**
+     * @return whether the ribbons are all covered (along with any left out, see setRemainder())
      */
     bool done() const;
 
@@ -91,10 +125,20 @@ public:
     double approximateDistanceUntilDone(double x, double y, double yaw) const;
 
     /**
-     * If there are too many ribbons TSP solving is intractable so switch to max distance heuristic.
+     * If there are too many ribbons TSP solving is intractable so switch to the minimum spanning tree heuristic. The
+     * exact TSP heuristics are good up to c_HeldKarpRibbonLimit ribbons, the k-limited ones up to
+     * c_RibbonCountDangerThreshold.
      */
     void changeHeuristicIfTooManyRibbons();
 
+    /**
+     * Precompute the distances between the current ribbons' endpoints for the heuristic, so copies of this manager
+     * (like every vertex in a search) only have to work out the distances from themselves to the ribbons. Ribbons
+     * added or split afterwards still work, they just aren't in the table. Does nothing for heuristics that don't look
+     * at distances between ribbons or when there are too many ribbons for the table.
+     */
+    void precomputeDistances();
+
     /**
      * Find the smallest distance to a ribbon from (x, y).
      * @param x
@@ -126,10 +170,10 @@ public:
     void projectOntoNearestRibbon(State& state) const;
 
     /**
-     * Access the underlying list of ribbons
+     * Access the underlying ribbons, in order
      * @return
      */
-    const std::list<Ribbon>& get() const;
+    const std::vector<Ribbon>& get() const;
 
     /**
      * Find states on nearby ribbons radius distance away from the state
@@ -165,6 +209,54 @@ public:
 
     double getTotalUncoveredLength() const;
 
+    /**
+     * Make a manager with only some of these ribbons, and everything else (heuristic and so on) the same. The one made
+     * has to work out its own distance table if it wants one.
+     * @param indices which of get() to keep
+     * @return
+     */
+    RibbonManager subset(const std::vector<int>& indices) const;
+
+    /**
+     * Stand in for ribbons left out of this manager (see SurveyOrder) with a summary of them: what it'll cost to cover
+     * them all once we get to (x, y), where the first of them starts. The heuristic adds that on, along with the trip
+     * over there, and the manager isn't done until they're all covered too, which it can't do by itself, so once its
+     * own ribbons are covered it just heads for (x, y).
+     * @param cost distance to cover the rest of the survey, from (x, y) (0 if there isn't any)
+     * @param x
+     * @param y
+     */
+    void setRemainder(double cost, double x, double y);
+
+    double remainderCost() const { return m_RemainderCost; }
+
+    /**
+     * Check whether another manager has exactly the same ribbons left. Cheap when they're still sharing ribbons.
+     * @param other
+     * @return
+     */
+    bool sameRibbonsAs(const RibbonManager& other) const;
+
+    /**
+     * Check whether another manager is still sharing this one's ribbons, rather than having its own copy.
+     * @param other
+     * @return
+     */
+    bool sharesRibbonsWith(const RibbonManager& other) const { return m_Ribbons == other.m_Ribbons; }
+
+    /**
+     * @return roughly how much memory the ribbons take up (whoever else shares them)
+     */
+    size_t ribbonBytes() const { return m_Ribbons->bytes(); }
+
+    /**
+     * Get a hash of everything the heuristic value depends on besides the pose: the remaining ribbons, the heuristic,
+     * and its parameters. Managers with the same key give the same heuristic values (barring the odd hash collision).
+     * Cheap; the ribbon part is only recomputed when the ribbons change.
+     * @return
+     */
+    uint64_t heuristicKey() const;
+
 private:
     Heuristic m_Heuristic;
     double m_TurningRadius = -1;
@@ -173,7 +265,54 @@ private:
     // record when coverage is done so we know when to stop afterwards
     double m_CoverageCompletedTime = -1;
 
-    std::list<Ribbon> m_Ribbons;
+    // what it takes to cover the ribbons this manager leaves out, and where they start (see setRemainder)
+    double m_RemainderCost = 0;
+    double m_RemainderX = 0, m_RemainderY = 0;
+
+    // shared between copies until one of them modifies it
+    std::shared_ptr<RibbonStore> m_Ribbons;
+    // hash of the ribbons' endpoints, kept up to date whenever they change
+    uint64_t m_RibbonsHash;
+    // endpoint distances from precomputeDistances(), shared by copies
+    RibbonDistanceTable::SharedPtr m_DistanceTable;
+    // (copies are counted when profiling)
+    Profiler::CopyCounted<RibbonManager, Profiler::RibbonManagers> m_CopyCounted;
+
+    /**
+     * Recompute the hash of the ribbons after changing them.
+     */
+    void rehashRibbons();
+
+    /**
+     * Get the ribbons for modification, making our own copy first if they're shared.
+     * @return
+     */
+    RibbonStore& mutableRibbons();
+
+    /**
+     * Check whether covering (x, y) would change any ribbons.
+     * @param x
+     * @param y
+     * @param strict
+     * @return
+     */
+    bool wouldCover(double x, double y, bool strict) const;
+
+    /**
+     * @return the empty ribbons new managers share.
+     */
+    static const std::shared_ptr<RibbonStore>& emptyRibbons();
+
+    /**
+     * Find the origins of ribbons that might contain (x, y). Every ribbon is a candidate if there are only a few of them
+     * or if any is short enough to count as covered (those get removed by any coverage at all).
+     * @param x
+     * @param y
+     * @param strict
+     * @param candidates output
+     * @return false if every ribbon is a candidate (and candidates wasn't filled in)
+     */
+    bool findCoverCandidates(double x, double y, bool strict, std::vector<int>& candidates) const;
 
     /**
      * Calculate the Dubins distance between (x, y, h) and the state s.
@@ -191,8 +330,6 @@ private:
         return dubins_path_length(&dubinsPath);
     }
 
-    void add(const Ribbon& r, std::list<Ribbon>::iterator i, bool strict);
-
     /**
      * Calculate the max distance heuristic.
      * @param x
@@ -202,17 +339,38 @@ private:
     double maxDistance(double x, double y) const;
 
     /**
-     * Calculate the TSPDubinsNoSplitAllRibbons heuristic. As the name suggests, this uses Dubins distance between
-     * ribbons, does not split ribbons, and does not limit the branching factor in the TSP.
-     * @param ribbonsLeft
-     * @param distanceSoFar
+     * The heuristic for just the ribbons in this manager, without the remainder.
+     * @param x
+     * @param y
+     * @param yaw
+     * @return
+     */
+    double ribbonsDistanceUntilDone(double x, double y, double yaw) const;
+
+    /**
+     * Calculate the TSPPointRobotNoSplitAllRibbons or TSPDubinsNoSplitAllRibbons heuristic, which is an exact TSP over
+     * the ribbons that doesn't split them and doesn't limit the branching factor. Instead of searching every ordering
+     * this is Held-Karp dynamic programming over (set of ribbons done, last ribbon, which end we left from), so it's
+     * O(2^n n^2) instead of O(2^n n!). The table is flat and kept around between calls (one per thread).
      * @param x
      * @param y
      * @param yaw
+     * @param dubins whether to use Dubins distance between ribbons instead of Euclidean distance
+     * @return
+     */
+    double tspNoSplitAllRibbons(double x, double y, double yaw, bool dubins) const;
+
+    /**
+     * Calculate the MinimumSpanningTree heuristic. Any tour that covers the ribbons drives the length of each one
+     * (minus the shortcut at each end), gets from (x, y) to the first ribbon, and then makes a path through the rest.
+     * That path is a spanning tree over the ribbons where each hop costs at least the closest pair of endpoints, so the
+     * minimum spanning tree plus the distance to the nearest ribbon is a lower bound. It's O(n^2) (Prim's on the dense
+     * endpoint graph) so it's fine for real surveys with hundreds of lines, where TSP is out of the question.
+     * @param x
+     * @param y
      * @return
      */
-    double tspDubinsNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
-                                      double y, double yaw) const;
+    double minimumSpanningTree(double x, double y) const;
 
     /**
      * Calculate the TSPPointRobotNoSplitKRibbons heuristic. As the name suggests, this uses Euclidean distance between
@@ -237,7 +395,12 @@ private:
     double tspDubinsNoSplitKRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, double x,
                                     double y, double yaw) const;
 
+    // the k-limited heuristics still search orderings recursively so they get impractical quickly
     static constexpr int c_RibbonCountDangerThreshold = 5;
+    // Held-Karp is O(2^n * n^2) per call: benchmark_planner's BM_Heuristic has it at ~0.15ms (point robot) and ~0.25ms
+    // (Dubins) at 8 ribbons, roughly doubling per ribbon after that (~1ms at 10, ~5ms at 12), and it runs for every
+    // vertex
+    static constexpr int c_HeldKarpRibbonLimit = 8;
     static double distance(std::pair<double, double> p1, std::pair<double, double> p2) {
         return distance(p1.first, p1.second, p2.first, p2.second);
     }
@@ -248,15 +411,6 @@ private:
         return sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2));
     }
 
-    /**
-     * Calculate the TSPPointRobotNoSplitAllRibbons heuristic. As the name suggests, this uses Euclidean distance between
-     * ribbons, does not split ribbons, and does not limit the TSP branching factor.
-     * @param ribbonsLeft
-     * @param distanceSoFar
-     * @param point
-     * @return
-     */
-    static double tspPointRobotNoSplitAllRibbons(std::list<Ribbon> ribbonsLeft, double distanceSoFar, std::pair<double, double> point);
 };
 
 
@@ -0,0 +1,141 @@
+#include <cfloat>
+#include <algorithm>
+#include "RibbonStore.h"
+
+void RibbonStore::add(const Ribbon& r) {
+    // copy on write for the index too
+    if (!m_Index) m_Index = std::make_shared<Index>();
+    else if (m_Index.use_count() > 1) m_Index = std::make_shared<Index>(*m_Index);
+    m_Index->insert((int)m_Origins.size(), r);
+    m_Origins.push_back({m_Ribbons.size(), 1});
+    m_Ribbons.push_back(r);
+    updateShortestLength();
+}
+
+void RibbonStore::near(double x, double y, double radius, std::vector<int>& origins) const {
+    origins.clear();
+    if (!m_Index) return;
+    auto minX = cellCoordinate(x - radius), maxX = cellCoordinate(x + radius);
+    auto minY = cellCoordinate(y - radius), maxY = cellCoordinate(y + radius);
+    for (auto i = std::max(minX, m_Index->MinX); i <= std::min(maxX, m_Index->MaxX); i++) {
+        for (auto j = std::max(minY, m_Index->MinY); j <= std::min(maxY, m_Index->MaxY); j++) {
+            auto cell = m_Index->cell(i, j);
+            if (!cell) continue;
+            for (auto origin : *cell) if (m_Origins[origin].Count > 0) origins.push_back(origin);
+        }
+    }
+    std::sort(origins.begin(), origins.end());
+    origins.erase(std::unique(origins.begin(), origins.end()), origins.end());
+}
+
+void RibbonStore::replacePieces(int origin, const std::vector<Ribbon>& pieces) {
+    auto& span = m_Origins[origin];
+    auto first = m_Ribbons.begin() + span.First;
+    // overwrite what we can in place, then insert or erase the difference
+    auto common = std::min(span.Count, pieces.size());
+    std::copy(pieces.begin(), pieces.begin() + common, first);
+    if (pieces.size() > span.Count) {
+        m_Ribbons.insert(first + common, pieces.begin() + common, pieces.end());
+    } else {
+        m_Ribbons.erase(first + common, first + span.Count);
+    }
+    auto shift = (long)pieces.size() - (long)span.Count;
+    span.Count = pieces.size();
+    if (shift != 0) for (size_t i = origin + 1; i < m_Origins.size(); i++) m_Origins[i].First += shift;
+    updateShortestLength();
+}
+
+double RibbonStore::nearestEndpointDistance(double x, double y) const {
+    if (empty()) return DBL_MAX;
+    auto min = DBL_MAX;
+    auto distanceToEnds = [&](const Ribbon& r) {
+        auto dx = r.start().first - x, dy = r.start().second - y;
+        min = fmin(min, sqrt(dx * dx + dy * dy));
+        dx = r.end().first - x; dy = r.end().second - y;
+        min = fmin(min, sqrt(dx * dx + dy * dy));
+    };
+    if (!indexed()) {
+        for (const auto& r : m_Ribbons) distanceToEnds(r);
+        return min;
+    }
+    // Search rings of cells outwards. Every endpoint is on its origin's segment, which is indexed in the cell the
+    // endpoint is in, so once we've done ring r anything we haven't seen is at least r cells away.
+    auto cx = cellCoordinate(x), cy = cellCoordinate(y);
+    const auto& index = *m_Index;
+    auto start = std::max(std::max(index.MinX - cx, cx - index.MaxX), std::max(index.MinY - cy, cy - index.MaxY));
+    auto end = std::max(std::max(index.MaxX - cx, cx - index.MinX), std::max(index.MaxY - cy, cy - index.MinY));
+    // stamp origins as seen rather than clearing flags every call
+    static thread_local std::vector<unsigned long> seen;
+    static thread_local unsigned long stamp = 0;
+    if (seen.size() < m_Origins.size()) seen.resize(m_Origins.size(), 0);
+    stamp++;
+    auto visit = [&](int64_t i, int64_t j) {
+        if (i < index.MinX || i > index.MaxX || j < index.MinY || j > index.MaxY) return;
+        auto cell = index.cell(i, j);
+        if (!cell) return;
+        for (auto origin : *cell) {
+            if (seen[origin] == stamp) continue;
+            seen[origin] = stamp;
+            const auto& span = m_Origins[origin];
+            for (size_t k = span.First; k < span.First + span.Count; k++) distanceToEnds(m_Ribbons[k]);
+        }
+    };
+    for (auto r = std::max(start, (int64_t)0); r <= end; r++) {
+        if (r == 0) {
+            visit(cx, cy);
+        } else {
+            for (auto i = cx - r; i <= cx + r; i++) {
+                visit(i, cy - r);
+                visit(i, cy + r);
+            }
+            for (auto j = cy - r + 1; j < cy + r; j++) {
+                visit(cx - r, j);
+                visit(cx + r, j);
+            }
+        }
+        if (min <= r * c_CellSize) break;
+    }
+    return min;
+}
+
+void RibbonStore::updateShortestLength() {
+    m_ShortestLength = DBL_MAX;
+    for (const auto& r : m_Ribbons) m_ShortestLength = fmin(m_ShortestLength, r.length());
+}
+
+void RibbonStore::Index::insert(int origin, const Ribbon& r) {
+    // walk the cells along the segment (Amanatides and Woo)
+    double x1 = r.start().first, y1 = r.start().second, x2 = r.end().first, y2 = r.end().second;
+    auto x = cellCoordinate(x1), y = cellCoordinate(y1);
+    auto endX = cellCoordinate(x2), endY = cellCoordinate(y2);
+    auto dx = x2 - x1, dy = y2 - y1;
+    int64_t stepX = dx > 0? 1 : -1, stepY = dy > 0? 1 : -1;
+    auto deltaX = dx != 0? c_CellSize / fabs(dx) : DBL_MAX;
+    auto deltaY = dy != 0? c_CellSize / fabs(dy) : DBL_MAX;
+    auto nextX = dx != 0? (dx > 0? (x + 1) * c_CellSize - x1 : x1 - x * c_CellSize) / fabs(dx) : DBL_MAX;
+    auto nextY = dy != 0? (dy > 0? (y + 1) * c_CellSize - y1 : y1 - y * c_CellSize) / fabs(dy) : DBL_MAX;
+    auto add = [&](int64_t i, int64_t j) {
+        auto& cell = Cells[key(i, j)];
+        if (cell.empty() || cell.back() != origin) cell.push_back(origin);
+        MinX = std::min(MinX, i); MaxX = std::max(MaxX, i);
+        MinY = std::min(MinY, j); MaxY = std::max(MaxY, j);
+    };
+    add(x, y);
+    // the t check stops rounding error from walking past the end forever
+    while ((x != endX || y != endY) && fmin(nextX, nextY) <= 1) {
+        if (nextX < nextY) {
+            nextX += deltaX;
+            x += stepX;
+        } else {
+            nextY += deltaY;
+            y += stepY;
+        }
+        add(x, y);
+    }
+    add(endX, endY);
+}
+
+const std::vector<int>* RibbonStore::Index::cell(int64_t x, int64_t y) const {
+    auto it = Cells.find(key(x, y));
+    return it == Cells.end()? nullptr : &it->second;
+}
@@ -0,0 +1,142 @@
+#ifndef SRC_RIBBONSTORE_H
+#define SRC_RIBBONSTORE_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cfloat>
+#include "Ribbon.h"
+
+/**
+ * Flat storage for a ribbon manager's ribbons with a uniform grid index, so covering a point or finding the nearest
+ * ribbon only looks at ribbons nearby instead of all of them.
+ *
+ * Every ribbon descends from one that was added (its origin). Covering only ever splits a ribbon into pieces along the
+ * same line segment, so the grid just indexes the segments of the origins and never has to change after they're added.
+ * That also means copies (which happen whenever a vertex covers something) can share the index. The pieces of an origin
+ * stay next to each other in the same order the old list had them, so anything iterating over the ribbons sees exactly
+ * what it used to.
+ *
+ * The index only kicks in with more than a handful of ribbons; below that it's cheaper to look at all of them.
+ */
+class RibbonStore {
+public:
+    /**
+     * @return the ribbons, in order
+     */
+    const std::vector<Ribbon>& ribbons() const { return m_Ribbons; }
+
+    std::vector<Ribbon>::const_iterator begin() const { return m_Ribbons.begin(); }
+    std::vector<Ribbon>::const_iterator end() const { return m_Ribbons.end(); }
+
+    size_t size() const { return m_Ribbons.size(); }
+
+    bool empty() const { return m_Ribbons.empty(); }
+
+    /**
+     * @return roughly how much memory the store takes up, not counting the index (which copies share)
+     */
+    size_t bytes() const {
+        return sizeof(RibbonStore) + m_Ribbons.capacity() * sizeof(Ribbon) + m_Origins.capacity() * sizeof(Span);
+    }
+
+    /**
+     * With only a few ribbons just looking at all of them is quicker than going through the grid, so callers should
+     * only bother with near() when this is true. It's still right either way.
+     * @return whether there are enough ribbons for the index to be worth using
+     */
+    bool indexed() const { return m_Origins.size() >= c_IndexedOrigins; }
+
+    /**
+     * Add a ribbon at the end, as a new origin.
+     * @param r
+     */
+    void add(const Ribbon& r);
+
+    /**
+     * Find the origins whose segments pass within (roughly) radius of (x, y). This can include a few farther away, but
+     * never misses one. Results are sorted and only include origins with pieces left.
+     * @param x
+     * @param y
+     * @param radius
+     * @param origins output
+     */
+    void near(double x, double y, double radius, std::vector<int>& origins) const;
+
+    /**
+     * @return number of origins (including ones that have been completely covered)
+     */
+    int origins() const { return (int)m_Origins.size(); }
+
+    /**
+     * Get where an origin's pieces are in ribbons().
+     * @param origin
+     * @param first index of the first piece
+     * @param count number of pieces
+     */
+    void pieces(int origin, size_t& first, size_t& count) const {
+        first = m_Origins[origin].First;
+        count = m_Origins[origin].Count;
+    }
+
+    /**
+     * Replace an origin's pieces (which have to lie along its segment).
+     * @param origin
+     * @param pieces
+     */
+    void replacePieces(int origin, const std::vector<Ribbon>& pieces);
+
+    /**
+     * Replace a ribbon with a piece of itself.
+     * @param i
+     * @param r
+     */
+    void shrink(size_t i, const Ribbon& r) {
+        m_Ribbons[i] = r;
+        m_ShortestLength = fmin(m_ShortestLength, r.length());
+    }
+
+    /**
+     * @return the length of the shortest ribbon, for quickly checking whether any are covered
+     */
+    double shortestLength() const { return m_ShortestLength; }
+
+    /**
+     * Find the distance from (x, y) to the nearest ribbon endpoint.
+     * @param x
+     * @param y
+     * @return the distance, or DBL_MAX if there are no ribbons
+     */
+    double nearestEndpointDistance(double x, double y) const;
+
+private:
+    struct Span {
+        size_t First, Count;
+    };
+
+    struct Index {
+        std::unordered_map<int64_t, std::vector<int>> Cells;
+        int64_t MinX = INT32_MAX, MaxX = INT32_MIN, MinY = INT32_MAX, MaxY = INT32_MIN;
+
+        void insert(int origin, const Ribbon& r);
+        const std::vector<int>* cell(int64_t x, int64_t y) const;
+        static int64_t key(int64_t x, int64_t y) { return (int64_t)(((uint64_t)x << 32) ^ ((uint64_t)y & 0xffffffff)); }
+    };
+
+    std::vector<Ribbon> m_Ribbons;
+    std::vector<Span> m_Origins;
+    // shared between copies, only changes when a ribbon is added
+    std::shared_ptr<Index> m_Index;
+    double m_ShortestLength = DBL_MAX;
+
+    void updateShortestLength();
+
+    static int64_t cellCoordinate(double d) { return (int64_t)floor(d / c_CellSize); }
+
+    static constexpr double c_CellSize = 10;
+    static constexpr size_t c_IndexedOrigins = 8;
+};
+
+
+#endif //SRC_RIBBONSTORE_H
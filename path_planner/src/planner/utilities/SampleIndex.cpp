@@ -0,0 +1,89 @@
+#include <cmath>
+#include <queue>
+#include <algorithm>
+#include "SampleIndex.h"
+
+SampleIndex::SampleIndex(double cellSize) : m_CellSize(cellSize), m_InitialCellSize(cellSize) {}
+
+void SampleIndex::add(double x, double y, int index) {
+    m_Points.push_back({x, y, index});
+    insert(m_Points.size() - 1);
+    // refine if cells are getting crowded
+    if (m_CellSize > c_MinCellSize && m_Points.size() > c_MaxAveragePerCell * m_Cells.size()) {
+        m_CellSize /= 2;
+        rebuild();
+    }
+}
+
+void SampleIndex::clear() {
+    m_Points.clear();
+    m_Cells.clear();
+    // the cells only got smaller to keep up with the samples that are gone now
+    m_CellSize = m_InitialCellSize;
+}
+
+int SampleIndex::cellCoordinate(double v) const {
+    return (int)floor(v / m_CellSize);
+}
+
+void SampleIndex::insert(int position) {
+    const auto& p = m_Points[position];
+    auto cx = cellCoordinate(p.X), cy = cellCoordinate(p.Y);
+    if (m_Cells.empty()) {
+        m_MinCellX = m_MaxCellX = cx;
+        m_MinCellY = m_MaxCellY = cy;
+    } else {
+        m_MinCellX = std::min(m_MinCellX, cx); m_MaxCellX = std::max(m_MaxCellX, cx);
+        m_MinCellY = std::min(m_MinCellY, cy); m_MaxCellY = std::max(m_MaxCellY, cy);
+    }
+    m_Cells[key(cx, cy)].push_back(position);
+}
+
+void SampleIndex::rebuild() {
+    m_Cells.clear();
+    for (size_t i = 0; i < m_Points.size(); i++) insert((int)i);
+}
+
+void SampleIndex::visitByDistance(double x, double y,
+                                  const std::function<bool(int index, double distance)>& visitor) const {
+    if (m_Points.empty()) return;
+    typedef std::pair<double, int> Entry; // distance, position
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pending;
+    auto cx = cellCoordinate(x), cy = cellCoordinate(y);
+    auto maxRing = std::max(std::max(cx - m_MinCellX, m_MaxCellX - cx), std::max(cy - m_MinCellY, m_MaxCellY - cy));
+    auto pushCell = [&](int i, int j) {
+        auto it = m_Cells.find(key(i, j));
+        if (it == m_Cells.end()) return;
+        for (auto position : it->second) {
+            const auto& p = m_Points[position];
+            pending.emplace(sqrt((p.X - x) * (p.X - x) + (p.Y - y) * (p.Y - y)), position);
+        }
+    };
+    for (int r = 0; r <= maxRing; r++) {
+        // push the ring of cells r away (Chebyshev distance in cells)
+        if (r == 0) {
+            pushCell(cx, cy);
+        } else {
+            for (int i = cx - r; i <= cx + r; i++) {
+                pushCell(i, cy - r);
+                pushCell(i, cy + r);
+            }
+            for (int j = cy - r + 1; j <= cy + r - 1; j++) {
+                pushCell(cx - r, j);
+                pushCell(cx + r, j);
+            }
+        }
+        // anything in the next ring out is at least this far away, so everything closer is safe to hand out
+        auto bound = r * m_CellSize;
+        while (!pending.empty() && pending.top().first <= bound) {
+            auto e = pending.top();
+            pending.pop();
+            if (!visitor(m_Points[e.second].Index, e.first)) return;
+        }
+    }
+    while (!pending.empty()) {
+        auto e = pending.top();
+        pending.pop();
+        if (!visitor(m_Points[e.second].Index, e.first)) return;
+    }
+}
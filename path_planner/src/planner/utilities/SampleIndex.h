@@ -0,0 +1,80 @@
+#ifndef SRC_SAMPLEINDEX_H
+#define SRC_SAMPLEINDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Uniform grid over sample positions so expansion can walk samples nearest-first without touching all of them. Samples
+ * are identified by their index in whatever container the caller keeps them in, and they're added incrementally.
+ *
+ * The grid refines itself (halving the cell size and rebuilding) when cells get too crowded, which should happen about
+ * as often as the sample count doubles, so adding stays amortized constant time.
+ */
+class SampleIndex {
+public:
+    /**
+     * Construct an empty index.
+     * @param cellSize initial cell size (m)
+     */
+    explicit SampleIndex(double cellSize = c_DefaultCellSize);
+
+    /**
+     * Add a sample.
+     * @param x
+     * @param y
+     * @param index the sample's index in the caller's container
+     */
+    void add(double x, double y, int index);
+
+    /**
+     * Remove everything, going back to the initial cell size.
+     */
+    void clear();
+
+    /**
+     * Visit samples in order of increasing Euclidean distance from (x, y) until the visitor returns false. Cost is
+     * proportional to the cells searched plus log of the samples visited, rather than the total number of samples.
+     * @param x
+     * @param y
+     * @param visitor called with the sample index and its distance from (x, y)
+     */
+    void visitByDistance(double x, double y, const std::function<bool(int index, double distance)>& visitor) const;
+
+    /**
+     * @return the number of samples in the index
+     */
+    size_t size() const { return m_Points.size(); }
+
+    /**
+     * @return the current cell size
+     */
+    double cellSize() const { return m_CellSize; }
+
+private:
+    struct Point {
+        double X, Y;
+        int Index;
+    };
+
+    double m_CellSize;
+    // what it started out as, before any refining
+    double m_InitialCellSize;
+    std::vector<Point> m_Points;
+    std::unordered_map<int64_t, std::vector<int>> m_Cells; // cell key -> positions in m_Points
+    int m_MinCellX = 0, m_MaxCellX = 0, m_MinCellY = 0, m_MaxCellY = 0;
+
+    int cellCoordinate(double v) const;
+    static int64_t key(int cx, int cy) { return ((int64_t)cx << 32) ^ (uint32_t)cy; }
+    void insert(int position);
+    void rebuild();
+
+    static constexpr double c_DefaultCellSize = 16;
+    static constexpr double c_MinCellSize = 0.5;
+    static constexpr int c_MaxAveragePerCell = 8;
+};
+
+
+#endif //SRC_SAMPLEINDEX_H
@@ -0,0 +1,37 @@
+#include <algorithm>
+#include <iterator>
+#include "SamplePool.h"
+
+SamplePool::Window SamplePool::take(const Map::SharedPtr& map, double speed, const Window& window,
+                                    std::vector<State>& samples) {
+    samples.clear();
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Window previous;
+    if (map == m_Map && speed == m_Speed && !m_Samples.empty()) {
+        std::copy_if(m_Samples.begin(), m_Samples.end(), std::back_inserter(samples),
+                     [&](const State& s) { return window.contains(s.x(), s.y()); });
+        previous = m_Window;
+    }
+    m_Samples.clear();
+    m_Map = nullptr;
+    return previous;
+}
+
+void SamplePool::keep(const Map::SharedPtr& map, double speed, const Window& window, std::vector<State> samples) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Samples = std::move(samples);
+    m_Window = window;
+    m_Map = map;
+    m_Speed = speed;
+}
+
+void SamplePool::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Samples.clear();
+    m_Map = nullptr;
+}
+
+size_t SamplePool::size() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Samples.size();
+}
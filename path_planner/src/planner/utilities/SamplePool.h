@@ -0,0 +1,75 @@
+#ifndef SRC_SAMPLEPOOL_H
+#define SRC_SAMPLEPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <path_planner_common/State.h>
+#include "../../common/map/Map.h"
+
+/**
+ * Samples kept from one plan for the next. Consecutive plans sample windows around the boat that mostly overlap, so
+ * rather than generating and map checking all of them again the planner can take the last plan's samples that are
+ * still in its window and only make fresh ones for the part of the window that's new.
+ *
+ * Samples are only good for the map and speed they were made with, so a pool forgets everything when either changes.
+ * Thread-safe, although only one planner should be taking from it at a time (the rest would come up empty).
+ */
+class SamplePool {
+public:
+    typedef std::shared_ptr<SamplePool> SharedPtr;
+
+    /**
+     * The area samples were drawn from.
+     */
+    struct Window {
+        double MinX = 0, MaxX = -1, MinY = 0, MaxY = -1;
+
+        Window() = default;
+        Window(double minX, double maxX, double minY, double maxY) : MinX(minX), MaxX(maxX), MinY(minY), MaxY(maxY) {}
+
+        bool contains(double x, double y) const { return x >= MinX && x <= MaxX && y >= MinY && y <= MaxY; }
+
+        bool empty() const { return MaxX < MinX || MaxY < MinY; }
+    };
+
+    /**
+     * Take the kept samples that are inside a new window, in the order they were made. The rest are dropped. The pool
+     * is empty afterwards until keep() is called.
+     * @param map map the new plan is using
+     * @param speed speed the new plan samples at
+     * @param window the new plan's window
+     * @param samples gets the samples
+     * @return the window the samples were drawn from, which is empty if there weren't any
+     */
+    Window take(const Map::SharedPtr& map, double speed, const Window& window, std::vector<State>& samples);
+
+    /**
+     * Keep a plan's samples for the next one.
+     * @param map
+     * @param speed
+     * @param window the window they were drawn from (evenly)
+     * @param samples
+     */
+    void keep(const Map::SharedPtr& map, double speed, const Window& window, std::vector<State> samples);
+
+    /**
+     * Forget everything.
+     */
+    void clear();
+
+    /**
+     * @return the number of samples kept
+     */
+    size_t size() const;
+
+private:
+    mutable std::mutex m_Mutex;
+    std::vector<State> m_Samples;
+    Window m_Window;
+    Map::SharedPtr m_Map;
+    double m_Speed = 0;
+};
+
+
+#endif //SRC_SAMPLEPOOL_H
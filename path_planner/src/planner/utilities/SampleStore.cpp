@@ -0,0 +1,55 @@
+#include <cmath>
+#include "SampleStore.h"
+
+void SampleStore::clear() {
+    m_X.clear();
+    m_Y.clear();
+    m_Heading.clear();
+    m_Cos.clear();
+    m_Sin.clear();
+    m_OriginX = m_OriginY = 0;
+}
+
+void SampleStore::reserve(size_t n) {
+    m_X.reserve(n);
+    m_Y.reserve(n);
+    m_Heading.reserve(n);
+    if (m_KeepTrig) {
+        m_Cos.reserve(n);
+        m_Sin.reserve(n);
+    }
+}
+
+void SampleStore::add(double x, double y, double heading) {
+    if (m_X.empty()) {
+        m_OriginX = x;
+        m_OriginY = y;
+    }
+    m_X.push_back((float)(x - m_OriginX));
+    m_Y.push_back((float)(y - m_OriginY));
+    m_Heading.push_back((float)heading);
+    // (only if they've been kept for all the samples so far, so they line up)
+    if (m_KeepTrig && m_Cos.size() + 1 == m_X.size()) {
+        // of the rounded heading, so they agree with what comes back out
+        const double rounded = m_Heading.back();
+        m_Cos.push_back((float)cos(rounded));
+        m_Sin.push_back((float)sin(rounded));
+    }
+}
+
+void SampleStore::trig(size_t i, double& c, double& s) const {
+    if (m_Cos.size() == m_X.size()) {
+        c = m_Cos[i];
+        s = m_Sin[i];
+    } else {
+        c = cos(heading(i));
+        s = sin(heading(i));
+    }
+}
+
+std::vector<State> SampleStore::states() const {
+    std::vector<State> states;
+    states.reserve(size());
+    for (size_t i = 0; i < size(); i++) states.push_back(state(i));
+    return states;
+}
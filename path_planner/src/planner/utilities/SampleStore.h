@@ -0,0 +1,81 @@
+#ifndef SRC_SAMPLESTORE_H
+#define SRC_SAMPLESTORE_H
+
+#include <vector>
+#include <path_planner_common/State.h>
+
+/**
+ * The planner's samples, packed tight. Expansion walks through thousands of them per vertex and only looks at where
+ * they are and which way they point (speed and time get filled in when one becomes a vertex), so instead of whole
+ * States this keeps just x, y and heading as floats in separate arrays, a quarter of the memory or less. Positions are
+ * relative to the first sample added so single precision still gets them to well under a millimetre anywhere in a
+ * planning window; they come back out as doubles, and those are the samples from then on.
+ *
+ * It can also keep the cosine and sine of each heading for DubinsBatch, which would otherwise work them out every
+ * time a sample is a candidate goal.
+ */
+class SampleStore {
+public:
+    /**
+     * Forget all the samples (and where they're relative to).
+     */
+    void clear();
+
+    void reserve(size_t n);
+
+    /**
+     * Add a sample, rounding it to what the store can hold.
+     * @param x
+     * @param y
+     * @param heading
+     */
+    void add(double x, double y, double heading);
+
+    size_t size() const { return m_X.size(); }
+
+    bool empty() const { return m_X.empty(); }
+
+    double x(size_t i) const { return m_OriginX + m_X[i]; }
+
+    double y(size_t i) const { return m_OriginY + m_Y[i]; }
+
+    double heading(size_t i) const { return m_Heading[i]; }
+
+    /**
+     * Get the cosine and sine of a sample's heading, from the ones kept if there are any.
+     * @param i
+     * @param c
+     * @param s
+     */
+    void trig(size_t i, double& c, double& s) const;
+
+    /**
+     * @param i
+     * @param speed
+     * @return the ith sample as a state (time zero)
+     */
+    State state(size_t i, double speed = 0) const { return State(x(i), y(i), heading(i), speed, 0); }
+
+    /**
+     * @return all the samples as states, in order
+     */
+    std::vector<State> states() const;
+
+    /**
+     * Whether to keep the cosine and sine of each heading. Only affects samples added afterwards, so set it while
+     * the store is empty.
+     * @param keepTrig
+     */
+    void setKeepTrig(bool keepTrig) { m_KeepTrig = keepTrig; }
+
+    bool keepsTrig() const { return m_KeepTrig; }
+
+private:
+    double m_OriginX = 0, m_OriginY = 0;
+    std::vector<float> m_X, m_Y, m_Heading;
+    std::vector<float> m_Cos, m_Sin;
+    bool m_KeepTrig = false;
+};
+
+
+#endif //SRC_SAMPLESTORE_H
@@ -0,0 +1,36 @@
+#ifndef SRC_SHAREDINCUMBENT_H
+#define SRC_SHAREDINCUMBENT_H
+
+#include <atomic>
+#include <memory>
+#include <cfloat>
+
+/**
+ * Best f-value found so far by any of a group of planners searching the same problem at once (see PortfolioPlanner).
+ * Each planner prunes against it like it does against its own incumbent, so one instance finding a good plan speeds
+ * up the rest. Lock-free.
+ */
+class SharedIncumbent {
+public:
+    typedef std::shared_ptr<SharedIncumbent> SharedPtr;
+
+    /**
+     * @return the best f-value offered so far (DBL_MAX if none)
+     */
+    double f() const { return m_F.load(std::memory_order_relaxed); }
+
+    /**
+     * Offer a new incumbent f-value. Only kept if it's better than what's there.
+     * @param f
+     */
+    void offer(double f) {
+        auto current = m_F.load(std::memory_order_relaxed);
+        while (f < current && !m_F.compare_exchange_weak(current, f, std::memory_order_relaxed)) {}
+    }
+
+private:
+    std::atomic<double> m_F{DBL_MAX};
+};
+
+
+#endif //SRC_SHAREDINCUMBENT_H
@@ -0,0 +1,107 @@
+#ifndef SRC_SPSCRING_H
+#define SRC_SPSCRING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+ * Fixed size lock-free queue for exactly one thread putting things in and one taking them out, like position
+ * callbacks handing points to the planning thread. Neither side ever waits on the other: push() just fails when the
+ * ring is full and pop() when it's empty.
+ *
+ * "One thread" really means one at a time. The consumer side can move between threads as long as something (like a
+ * mutex) makes sure two of them never pop at once, and the producer is allowed to drain the queue itself that way.
+ * @tparam T copyable
+ */
+template <class T>
+class SpscRing {
+public:
+    /**
+     * Construct a ring.
+     * @param capacity number of slots (rounded up to a power of two)
+     */
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_Slots.resize(size);
+        m_Mask = size - 1;
+    }
+
+    /**
+     * Producer only.
+     * @param t
+     * @return false if the ring was full (and t wasn't added)
+     */
+    bool push(const T& t) {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) > m_Mask) return false;
+        m_Slots[tail & m_Mask] = t;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Producer only. Add several items at once: either they all go in or none do, and the consumer never sees some of
+     * them without the rest.
+     * @param ts
+     * @param n
+     * @return false if there wasn't room for all of them
+     */
+    bool push(const T* ts, size_t n) {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail + n - m_Head.load(std::memory_order_acquire) > m_Slots.size()) return false;
+        for (size_t i = 0; i < n; i++) m_Slots[(tail + i) & m_Mask] = ts[i];
+        m_Tail.store(tail + n, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only.
+     * @param t set to the oldest item, if there is one
+     * @return false if the ring was empty
+     */
+    bool pop(T& t) {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire)) return false;
+        t = m_Slots[head & m_Mask];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only. Hand everything that's in the ring right now to f, oldest first.
+     * @tparam F callable with a const T&
+     * @param f
+     * @return number of items drained
+     */
+    template <class F>
+    size_t drain(F f) {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        auto tail = m_Tail.load(std::memory_order_acquire);
+        for (auto i = head; i != tail; i++) f(m_Slots[i & m_Mask]);
+        m_Head.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    /**
+     * @return number of slots
+     */
+    size_t capacity() const { return m_Slots.size(); }
+
+private:
+    static constexpr size_t c_CacheLine = 64;
+
+    std::vector<T> m_Slots;
+    size_t m_Mask;
+    // indices only ever go up and get masked on the way in; keep them on separate cache lines. Padded by hand rather
+    // than with alignas, which plain new (say, of whatever has a ring in it) doesn't honour before C++17
+    char m_HeadPadding[c_CacheLine];
+    std::atomic<size_t> m_Head{0};
+    char m_TailPadding[c_CacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_Tail{0};
+    char m_EndPadding[c_CacheLine - sizeof(std::atomic<size_t>)];
+};
+
+
+#endif //SRC_SPSCRING_H
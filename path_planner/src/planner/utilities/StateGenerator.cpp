@@ -10,26 +10,76 @@ StateGenerator::StateGenerator(double minX, double maxX, double minY, double max
     m_SpeedDistribution = std::uniform_real_distribution<>(minSpeed, maxSpeed);
 
     m_RandomEngine.seed(seed);
+    // Draw the Halton shifts from a separate engine so the random sequence is the same as it always was
+    std::default_random_engine shiftEngine(seed);
+    std::uniform_real_distribution<double> unit(0, 1);
+    for (auto& shift : m_HaltonShift) shift = unit(shiftEngine);
 }
 
-State StateGenerator::generate() {
+double StateGenerator::radicalInverse(unsigned long index, unsigned int base) {
+    double result = 0, scale = 1.0 / base;
+    while (index > 0) {
+        result += (index % base) * scale;
+        index /= base;
+        scale /= base;
+    }
+    return result;
+}
+
+void StateGenerator::draw(double& x, double& y, double& heading, double& speed) {
+    if (m_Sequence == Sequence::Halton) {
+        static const unsigned int bases[4] = {2, 3, 5, 7};
+        double u[4];
+        for (int d = 0; d < 4; d++) {
+            u[d] = radicalInverse(m_HaltonIndex, bases[d]) + m_HaltonShift[d];
+            if (u[d] >= 1) u[d] -= 1;
+        }
+        m_HaltonIndex++;
+        x = m_XDistribution.a() + u[0] * (m_XDistribution.b() - m_XDistribution.a());
+        y = m_YDistribution.a() + u[1] * (m_YDistribution.b() - m_YDistribution.a());
+        heading = u[2] * 2 * M_PI;
+        speed = m_SpeedDistribution.a() + u[3] * (m_SpeedDistribution.b() - m_SpeedDistribution.a());
+    } else {
+        x = m_XDistribution(m_RandomEngine);
+        y = m_YDistribution(m_RandomEngine);
+        heading = m_HeadingDistribution(m_RandomEngine);
+        speed = m_SpeedDistribution(m_RandomEngine);
+    }
+}
 
-    State s = State(m_XDistribution(m_RandomEngine),
-                           m_YDistribution(m_RandomEngine),
-                           m_HeadingDistribution(m_RandomEngine),
-                           m_SpeedDistribution(m_RandomEngine),
-                           0);
+void StateGenerator::generate(size_t n, Batch& batch) {
+    auto start = batch.size();
+    batch.X.resize(start + n); batch.Y.resize(start + n); batch.Heading.resize(start + n); batch.Speed.resize(start + n);
+    for (size_t i = start; i < start + n; i++) {
+        draw(batch.X[i], batch.Y[i], batch.Heading[i], batch.Speed[i]);
+        if (m_SampleOnRibbons && m_HeadingDistribution(m_RandomEngine) < M_PI / 50) { // one in 100 chance
+            // rare enough to go through a state
+            auto s = batch.state(i);
+            projectOntoRibbon(s);
+            batch.X[i] = s.x(); batch.Y[i] = s.y(); batch.Heading[i] = s.heading(); batch.Speed[i] = s.speed();
+        }
+    }
+}
+
+State StateGenerator::generate() {
+    double x, y, heading, speed;
+    draw(x, y, heading, speed);
+    State s = State(x, y, heading, speed, 0);
     if (m_SampleOnRibbons) {
         if (m_HeadingDistribution(m_RandomEngine) < M_PI / 50) { // one in 100 chance
-            m_RibbonManager.projectOntoNearestRibbon(s);
-            if (m_HeadingDistribution(m_RandomEngine) < M_PI) { // one in two chance
-                s.heading() += M_PI; // flip the heading (point to the start of the ribbon instead of the end)
-            }
+            projectOntoRibbon(s);
         }
     }
     return s;
 }
 
+void StateGenerator::projectOntoRibbon(State& s) {
+    m_RibbonManager.projectOntoNearestRibbon(s);
+    if (m_HeadingDistribution(m_RandomEngine) < M_PI) { // one in two chance
+        s.heading() += M_PI; // flip the heading (point to the start of the ribbon instead of the end)
+    }
+}
+
 StateGenerator::StateGenerator(double minX, double maxX, double minY, double maxY, double minSpeed, double maxSpeed,
                                unsigned long seed, RibbonManager ribbonManager) 
                                : StateGenerator(minX, maxX, minY, maxY, minSpeed, maxSpeed, seed){
@@ -21,13 +21,77 @@ public:
                    unsigned long seed,
                    RibbonManager ribbonManager);
 
+    /**
+     * How to spread samples over the bounds. Halton is a low-discrepancy sequence (bases 2, 3, 5 and 7 for x, y,
+     * heading and speed) shifted by an offset drawn from the seed, so it covers the space more evenly than random
+     * samples do but is still reproducible for a given seed.
+     */
+    enum class Sequence {
+        Random, Halton
+    };
+
+    /**
+     * Samples in structure-of-arrays form, for generating and filtering in bulk.
+     */
+    struct Batch {
+        std::vector<double> X, Y, Heading, Speed;
+
+        size_t size() const { return X.size(); }
+
+        void clear() {
+            X.clear(); Y.clear(); Heading.clear(); Speed.clear();
+        }
+
+        /**
+         * @param i
+         * @return the ith sample as a state (time zero)
+         */
+        State state(size_t i) const { return State(X[i], Y[i], Heading[i], Speed[i], 0); }
+    };
+
     State generate();
 
+    /**
+     * Generate n samples, appending them to the batch. Gives the same samples as calling generate() n times.
+     * @param n
+     * @param batch
+     */
+    void generate(size_t n, Batch& batch);
+
+    void setSequence(Sequence sequence) { m_Sequence = sequence; }
+
 private:
     std::uniform_real_distribution<double> m_XDistribution, m_YDistribution, m_HeadingDistribution, m_SpeedDistribution;
     std::default_random_engine m_RandomEngine;
     RibbonManager m_RibbonManager;
     bool m_SampleOnRibbons = false;
+    Sequence m_Sequence = Sequence::Random;
+    // Halton state: how far along the sequence we are and the random shift for each dimension
+    unsigned long m_HaltonIndex = 1;
+    double m_HaltonShift[4];
+
+    /**
+     * Draw one sample's x, y, heading and speed from the current sequence.
+     * @param x
+     * @param y
+     * @param heading
+     * @param speed
+     */
+    void draw(double& x, double& y, double& heading, double& speed);
+
+    /**
+     * Move a sample onto the nearest ribbon, pointing either way along it.
+     * @param s
+     */
+    void projectOntoRibbon(State& s);
+
+    /**
+     * Radical inverse of the index in the given base (the Halton sequence).
+     * @param index
+     * @param base
+     * @return value in [0, 1)
+     */
+    static double radicalInverse(unsigned long index, unsigned int base);
 };
 
 
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "SurveyOrder.h"
+
+namespace {
+double distanceToSegment(double x, double y, double x1, double y1, double x2, double y2) {
+    const auto dx = x2 - x1, dy = y2 - y1;
+    const auto squaredLength = dx * dx + dy * dy;
+    auto t = squaredLength == 0? 0 : ((x - x1) * dx + (y - y1) * dy) / squaredLength;
+    t = fmax(0, fmin(1, t));
+    return hypot(x - (x1 + t * dx), y - (y1 + t * dy));
+}
+}
+
+SurveyOrder::SurveyOrder(const RibbonManager& ribbons, double x, double y) {
+    const auto& all = ribbons.get();
+    std::vector<bool> ordered(all.size(), false);
+    m_Entries.reserve(all.size());
+    for (size_t n = 0; n < all.size(); n++) {
+        auto best = DBL_MAX;
+        size_t next = 0;
+        bool reversed = false;
+        for (size_t i = 0; i < all.size(); i++) {
+            if (ordered[i]) continue;
+            auto toStart = hypot(all[i].start().first - x, all[i].start().second - y);
+            auto toEnd = hypot(all[i].end().first - x, all[i].end().second - y);
+            if (toStart < best) {
+                best = toStart;
+                next = i;
+                reversed = false;
+            }
+            if (toEnd < best) {
+                best = toEnd;
+                next = i;
+                reversed = true;
+            }
+        }
+        ordered[next] = true;
+        auto start = all[next].start(), end = all[next].end();
+        if (reversed) std::swap(start, end);
+        m_Entries.push_back({start.first, start.second, end.first, end.second});
+        x = end.first;
+        y = end.second;
+    }
+}
+
+RibbonManager SurveyOrder::localView(const RibbonManager& ribbons, size_t localRibbons) const {
+    const auto& pieces = ribbons.get();
+    // which ordered ribbon each piece belongs to, and how much of each is left
+    std::vector<int> entries(pieces.size());
+    std::vector<double> left(m_Entries.size(), 0);
+    for (size_t i = 0; i < pieces.size(); i++) {
+        entries[i] = find(pieces[i]);
+        if (entries[i] >= 0) left[entries[i]] += pieces[i].length();
+    }
+    // the first few that still have something left are local
+    std::vector<bool> local(m_Entries.size(), false);
+    size_t count = 0;
+    size_t next = 0;
+    for (; next < m_Entries.size() && count < localRibbons; next++) {
+        if (left[next] <= 0) continue;
+        local[next] = true;
+        count++;
+    }
+    std::vector<int> indices;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        if (entries[i] < 0 || local[entries[i]]) indices.push_back((int)i);
+    }
+    auto view = ribbons.subset(indices);
+    // and the rest, in order
+    double cost = 0;
+    const Entry* first = nullptr;
+    const Entry* previous = nullptr;
+    for (; next < m_Entries.size(); next++) {
+        if (left[next] <= 0) continue;
+        const auto& e = m_Entries[next];
+        if (previous) cost += hypot(e.StartX - previous->EndX, e.StartY - previous->EndY);
+        else first = &e;
+        cost += left[next];
+        previous = &e;
+    }
+    if (first) view.setRemainder(cost, first->StartX, first->StartY);
+    return view;
+}
+
+Ribbon SurveyOrder::operator[](size_t i) const {
+    const auto& e = m_Entries[i];
+    return Ribbon(e.StartX, e.StartY, e.EndX, e.EndY);
+}
+
+int SurveyOrder::find(const Ribbon& piece) const {
+    for (size_t i = 0; i < m_Entries.size(); i++) {
+        const auto& e = m_Entries[i];
+        if (distanceToSegment(piece.start().first, piece.start().second, e.StartX, e.StartY, e.EndX, e.EndY) <
+                    c_Tolerance &&
+            distanceToSegment(piece.end().first, piece.end().second, e.StartX, e.StartY, e.EndX, e.EndY) <
+                    c_Tolerance) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
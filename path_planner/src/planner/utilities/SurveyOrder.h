@@ -0,0 +1,69 @@
+#ifndef SRC_SURVEYORDER_H
+#define SRC_SURVEYORDER_H
+
+#include <memory>
+#include <vector>
+#include "RibbonManager.h"
+
+/**
+ * A rough order to cover a whole survey's ribbons in, for when there are far more of them than one plan could ever
+ * get to. Each plan then only gets the first few ribbons in the order (its local view) and a summary of what the rest
+ * will cost, so the search tree's ribbon managers and the heuristic stay small however big the survey is.
+ *
+ * The order is greedy nearest neighbour from where the vessel is, going into each ribbon from its nearer end. That's
+ * quadratic in the number of ribbons, so it's for working out in the background now and then as coverage goes on,
+ * not every plan. In between, local views work from the ribbons as covered since, which are all pieces of the ones
+ * it ordered (any that aren't, like ones added since, go in the local view whatever their place).
+ *
+ * Immutable once made, so plans on any thread can share one.
+ */
+class SurveyOrder {
+public:
+    typedef std::shared_ptr<const SurveyOrder> ConstSharedPtr;
+
+    /**
+     * @param ribbons the survey
+     * @param x where to start from
+     * @param y
+     */
+    SurveyOrder(const RibbonManager& ribbons, double x, double y);
+
+    /**
+     * Cut a survey down to what one plan needs: the ribbons that are left of the first few in the order, and a
+     * remainder standing in for covering the rest of them in order (their uncovered length and the trips between them,
+     * see RibbonManager::setRemainder).
+     * @param ribbons the survey, as covered so far
+     * @param localRibbons how many of the ordered ribbons to keep
+     * @return
+     */
+    RibbonManager localView(const RibbonManager& ribbons, size_t localRibbons) const;
+
+    /**
+     * @return number of ribbons in the order
+     */
+    size_t size() const { return m_Entries.size(); }
+
+    /**
+     * @param i
+     * @return the ith ribbon in the order, pointing the way it gets covered
+     */
+    Ribbon operator[](size_t i) const;
+
+private:
+    struct Entry {
+        double StartX, StartY, EndX, EndY;
+    };
+    std::vector<Entry> m_Entries;
+
+    /**
+     * Find the ordered ribbon a piece of one lies along.
+     * @param piece
+     * @return its place in the order, or -1 if it isn't part of any
+     */
+    int find(const Ribbon& piece) const;
+
+    static constexpr double c_Tolerance = 1e-6;
+};
+
+
+#endif //SRC_SURVEYORDER_H
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <stdexcept>
+#include "Tracer.h"
+
+std::atomic<bool> Tracer::s_Enabled{false};
+
+namespace {
+std::mutex g_CurrentMutex;
+Tracer::SharedPtr g_Current;
+std::atomic<unsigned long> g_NextTracerId{1};
+
+struct ThreadInfo {
+    const char* Name = nullptr;
+    unsigned long TracerId = 0;
+    int Id = 0;
+    bool Introduced = false;
+};
+thread_local ThreadInfo t_Thread;
+}
+
+Tracer::Tracer(const std::string& path)
+        : m_Epoch(std::chrono::steady_clock::now()), m_Id(g_NextTracerId++) {
+    m_File.open(path, std::ios::trunc | std::ios::out);
+    if (!m_File) throw std::runtime_error("Could not open trace file " + path);
+    m_File << "[";
+}
+
+Tracer::~Tracer() {
+    flush();
+    m_File << "\n]\n";
+}
+
+void Tracer::install(SharedPtr tracer) {
+    std::lock_guard<std::mutex> lock(g_CurrentMutex);
+    g_Current = std::move(tracer);
+    s_Enabled.store(g_Current != nullptr, std::memory_order_relaxed);
+}
+
+Tracer::SharedPtr Tracer::current() {
+    std::lock_guard<std::mutex> lock(g_CurrentMutex);
+    return g_Current;
+}
+
+void Tracer::nameThread(const char* name) {
+    t_Thread.Name = name;
+    // introduce it again under the new name
+    t_Thread.Introduced = false;
+}
+
+void Tracer::flush() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_File << m_Buffer;
+    m_File.flush();
+    m_Buffer.clear();
+}
+
+void Tracer::complete(const char* name, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end, const char* argName, double arg) {
+    auto ts = std::chrono::duration<double, std::micro>(start - m_Epoch).count();
+    auto dur = std::chrono::duration<double, std::micro>(end - start).count();
+    char args[96] = "";
+    if (argName) snprintf(args, sizeof(args), ",\"args\":{\"%s\":%g}", argName, arg);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    char event[256];
+    snprintf(event, sizeof(event), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,\"pid\":1,\"tid\":%d%s}",
+             name, ts, dur, threadId(), args);
+    append(event);
+}
+
+int Tracer::threadId() {
+    if (t_Thread.TracerId != m_Id) {
+        t_Thread.TracerId = m_Id;
+        t_Thread.Id = m_NextThread++;
+        t_Thread.Introduced = false;
+    }
+    if (t_Thread.Introduced) return t_Thread.Id;
+    t_Thread.Introduced = true;
+    char event[160];
+    if (t_Thread.Name) {
+        snprintf(event, sizeof(event), R"({"name":"thread_name","ph":"M","pid":1,"tid":%d,"args":{"name":"%s"}})",
+                 t_Thread.Id, t_Thread.Name);
+    } else {
+        snprintf(event, sizeof(event), R"({"name":"thread_name","ph":"M","pid":1,"tid":%d,"args":{"name":"thread %d"}})",
+                 t_Thread.Id, t_Thread.Id);
+    }
+    append(event);
+    return t_Thread.Id;
+}
+
+void Tracer::append(const char* event) {
+    if (!m_First) m_Buffer += ",";
+    m_First = false;
+    m_Buffer += "\n";
+    m_Buffer += event;
+}
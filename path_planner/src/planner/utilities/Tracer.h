@@ -0,0 +1,139 @@
+#ifndef SRC_TRACER_H
+#define SRC_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * A timeline of what the planner's threads were doing, for when the aggregate stats say a cycle was late but not why.
+ * Spans get written in the Chrome trace event format, so a file can be opened in chrome://tracing or Perfetto's UI,
+ * with a row for each thread.
+ *
+ * There's one tracer for the whole process (install() one to start tracing). Without one, a span is an atomic load
+ * and a branch, so they can stay in the code. With one, each span reads the clock twice and formats a line under a
+ * mutex when it finishes, so they're for things that happen at most a few hundred times a cycle, not per edge.
+ *
+ * Events are kept in memory until flush() (the executive does that once a cycle) or the tracer goes away. The file
+ * is still readable if the process dies before the end since the closing bracket is optional in the format.
+ */
+class Tracer {
+public:
+    typedef std::shared_ptr<Tracer> SharedPtr;
+
+    /**
+     * @param path
+     * @throws std::runtime_error if the file can't be opened
+     */
+    explicit Tracer(const std::string& path);
+
+    /**
+     * Writes everything out and finishes the file.
+     */
+    ~Tracer();
+
+    /**
+     * Time something from here to the end of the enclosing block.
+     */
+    class Span {
+    public:
+        /**
+         * @param name what's happening; has to outlive the span (use a literal)
+         */
+        explicit Span(const char* name) : m_Name(name) {
+            if (!s_Enabled.load(std::memory_order_relaxed)) return;
+            m_Tracer = current();
+            if (m_Tracer) m_Start = std::chrono::steady_clock::now();
+        }
+
+        ~Span() { stop(); }
+
+        /**
+         * Attach a number to the span (like how many samples an iteration had). Only the last one set is kept.
+         * @param name has to outlive the span (use a literal)
+         * @param value
+         */
+        void setArg(const char* name, double value) {
+            m_ArgName = name;
+            m_Arg = value;
+        }
+
+        /**
+         * Finish before the end of the block.
+         */
+        void stop() {
+            if (!m_Tracer) return;
+            m_Tracer->complete(m_Name, m_Start, std::chrono::steady_clock::now(), m_ArgName, m_Arg);
+            m_Tracer = nullptr;
+        }
+
+    private:
+        const char* m_Name;
+        SharedPtr m_Tracer;
+        std::chrono::steady_clock::time_point m_Start;
+        const char* m_ArgName = nullptr;
+        double m_Arg = 0;
+    };
+
+    /**
+     * Make a tracer the one spans go to, or stop tracing with null. The old one gets finished once the spans that had
+     * already started on it are done.
+     * @param tracer
+     */
+    static void install(SharedPtr tracer);
+
+    /**
+     * @return the installed tracer, if any
+     */
+    static SharedPtr current();
+
+    /**
+     * Name the calling thread's row in the timeline. Cheap enough to call whether or not anything's tracing, and it
+     * sticks for tracers installed later too.
+     * @param name has to outlive the thread (use a literal)
+     */
+    static void nameThread(const char* name);
+
+    /**
+     * Write out the events so far.
+     */
+    void flush();
+
+    /**
+     * Add a finished span directly.
+     * @param name
+     * @param start
+     * @param end
+     * @param argName null for no argument
+     * @param arg
+     */
+    void complete(const char* name, std::chrono::steady_clock::time_point start,
+                  std::chrono::steady_clock::time_point end, const char* argName = nullptr, double arg = 0);
+
+private:
+    std::mutex m_Mutex;
+    std::ofstream m_File;
+    std::string m_Buffer;
+    bool m_First = true;
+    const std::chrono::steady_clock::time_point m_Epoch;
+    // so a thread can tell whether it's introduced itself to this tracer, and not one that used to be in the same place
+    const unsigned long m_Id;
+    int m_NextThread = 1;
+
+    /**
+     * Get the calling thread's id in this trace, telling the trace its name the first time.
+     * Call with the mutex held.
+     * @return
+     */
+    int threadId();
+
+    void append(const char* event);
+
+    static std::atomic<bool> s_Enabled;
+};
+
+
+#endif //SRC_TRACER_H
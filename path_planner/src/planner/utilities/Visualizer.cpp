@@ -0,0 +1,57 @@
+#include "Visualizer.h"
+
+Visualizer::Visualizer() : m_Stream(&m_File) {
+    for (int c = 0; c < CategoryCount; c++) {
+        m_SampleRates[c] = 1;
+        m_Counts[c] = 0;
+    }
+}
+
+Visualizer::Visualizer(const std::string& path) : Visualizer() {
+    m_File.open(path, std::ios::trunc | std::ios::out);
+}
+
+Visualizer::Visualizer(std::ostream& stream) : Visualizer() {
+    m_Stream = &stream;
+}
+
+void Visualizer::setSampleRate(Category category, unsigned everyNth) {
+    m_SampleRates[category].store(everyNth, std::memory_order_relaxed);
+}
+
+bool Visualizer::sample(Category category) {
+    auto rate = m_SampleRates[category].load(std::memory_order_relaxed);
+    if (rate <= 1) return true;
+    return m_Counts[category].fetch_add(1, std::memory_order_relaxed) % rate == 0;
+}
+
+void Visualizer::vertex(const State& state, double f, double g, double h, bool expanded, const char* tag,
+                        const std::vector<long>& ancestry) {
+    auto& os = stream();
+    os << (expanded? "Expanded " : "Generated ") << "State: (" << state.toStringRad() << "), f: " << f << ", g: " << g
+        << ", h: " << h << " " << tag << " ";
+    for (auto id : ancestry) os << id << " ";
+    os << std::endl;
+}
+
+void Visualizer::trajectory() {
+    stream() << "Trajectory:" << std::endl;
+}
+
+void Visualizer::state(const State& state, double f, double g, double h, StateKind kind) {
+    stream() << "State: (" << state.toStringRad() << "), f: " << f << ", g: " << g << ", h: " << h << " "
+        << stateKindName(kind) << std::endl;
+}
+
+void Visualizer::note(const std::string& text) {
+    stream() << text << std::endl;
+}
+
+const char* Visualizer::stateKindName(StateKind kind) {
+    switch (kind) {
+        case TrajectoryState: return "trajectory";
+        case SampleState: return "sample";
+        case PlanState: return "plan";
+        default: return "?";
+    }
+}
@@ -1,25 +1,115 @@
 #ifndef SRC_VISUALIZER_H
 #define SRC_VISUALIZER_H
 
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <path_planner_common/State.h>
 
 /**
- * Encapsulate IO for visualization.
+ * Encapsulate IO for visualization. The planner reports what it's doing as events (vertices, states along edges,
+ * samples, plans, and notes like the ribbons) and this writes them out in the text format the visualization tools
+ * read. Subclasses can record them some other way (see BinaryVisualizer).
+ *
+ * Each category can be sampled, keeping one event in so many, for when everything is too much. The planner asks
+ * sample() before it goes to the trouble of putting an event together.
  */
 class Visualizer {
 public:
     typedef std::shared_ptr<Visualizer> SharedPtr;
     typedef std::unique_ptr<Visualizer> UniquePtr;
-    explicit Visualizer(const std::string& path) {
-        m_Stream.open(path, std::ios::trunc | std::ios::out);
-    }
 
-    std::ofstream& stream() {
-        return m_Stream;
+    enum Category {
+        Vertices,
+        Trajectories,
+        Samples,
+        Plans,
+        Notes,
+        CategoryCount
+    };
+
+    enum StateKind : uint8_t {
+        TrajectoryState,
+        SampleState,
+        PlanState,
+    };
+
+    /**
+     * Write text to a file.
+     * @param path
+     */
+    explicit Visualizer(const std::string& path);
+
+    /**
+     * Write text to a stream, which has to outlive this.
+     * @param stream
+     */
+    explicit Visualizer(std::ostream& stream);
+
+    virtual ~Visualizer() = default;
+
+    /**
+     * The text output, for anything there isn't an event for. Subclasses that don't write text don't have one.
+     * @return
+     */
+    std::ostream& stream() {
+        return *m_Stream;
     }
 
+    /**
+     * Keep one in so many of a category's events.
+     * @param category
+     * @param everyNth 1 (or 0) for all of them
+     */
+    void setSampleRate(Category category, unsigned everyNth);
+
+    /**
+     * @param category
+     * @return whether to report the next event in this category
+     */
+    bool sample(Category category);
+
+    /**
+     * A vertex was generated or expanded.
+     * @param state
+     * @param f
+     * @param g
+     * @param h
+     * @param expanded
+     * @param tag what kind of vertex (start, goal, and so on)
+     * @param ancestry ids of the vertices from the root down to this one
+     */
+    virtual void vertex(const State& state, double f, double g, double h, bool expanded, const char* tag,
+                        const std::vector<long>& ancestry);
+
+    /**
+     * The states that follow are along a new edge.
+     */
+    virtual void trajectory();
+
+    virtual void state(const State& state, double f, double g, double h, StateKind kind);
+
+    /**
+     * Anything else, a line (or a few) at a time.
+     * @param text
+     */
+    virtual void note(const std::string& text);
+
+protected:
+    /**
+     * For subclasses that don't write text.
+     */
+    Visualizer();
+
 private:
-    std::ofstream m_Stream;
+    std::ofstream m_File;
+    std::ostream* m_Stream;
+    std::atomic<unsigned> m_SampleRates[CategoryCount];
+    std::atomic<unsigned> m_Counts[CategoryCount];
+
+    static const char* stateKindName(StateKind kind);
 };
 
 
@@ -0,0 +1,73 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads) {
+    for (int i = 1; i < threads; i++) m_Workers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkReady.notify_all();
+    for (auto& t : m_Workers) t.join();
+}
+
+void WorkerPool::parallelFor(size_t n, const std::function<void(size_t)>& task) {
+    if (n == 0) return;
+    if (m_Workers.empty() || n == 1) {
+        // not worth waking anybody up
+        for (size_t i = 0; i < n; i++) task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Task = &task;
+        m_Profiler = Profiler::current();
+        m_Count = n;
+        m_Next = 0;
+        m_Error = nullptr;
+        m_Busy = (int)m_Workers.size();
+        m_Generation++;
+    }
+    m_WorkReady.notify_all();
+    runTasks();
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WorkDone.wait(lock, [this] { return m_Busy == 0; });
+    m_Task = nullptr;
+    if (m_Error) {
+        auto error = m_Error;
+        m_Error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::workerLoop() {
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_WorkReady.wait(lock, [&] { return m_Stop || m_Generation != seen; });
+        if (m_Stop) return;
+        seen = m_Generation;
+        auto profiler = m_Profiler;
+        lock.unlock();
+        {
+            Profiler::Attach attach(profiler);
+            runTasks();
+        }
+        lock.lock();
+        if (--m_Busy == 0) m_WorkDone.notify_one();
+    }
+}
+
+void WorkerPool::runTasks() {
+    size_t i;
+    while ((i = m_Next++) < m_Count) {
+        try {
+            (*m_Task)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!m_Error) m_Error = std::current_exception();
+        }
+    }
+}
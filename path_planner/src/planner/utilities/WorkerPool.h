@@ -0,0 +1,63 @@
+#ifndef SRC_WORKERPOOL_H
+#define SRC_WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include "Profiler.h"
+
+/**
+ * Persistent pool of threads for running a batch of independent tasks, like evaluating the child edges during an
+ * expansion. Threads are started once and sleep between batches so there's no thread creation cost per expansion.
+ *
+ * Tasks are handed out by bumping a shared index, so whichever thread is free grabs the next one. The calling thread
+ * pitches in too rather than just waiting around. Workers count their time towards the caller's profiler.
+ */
+class WorkerPool {
+public:
+    /**
+     * Construct a pool.
+     * @param threads total number of threads to run tasks on, including the one calling parallelFor
+     */
+    explicit WorkerPool(int threads);
+
+    ~WorkerPool();
+
+    /**
+     * Run task(0) ... task(n - 1), returning once they're all done. If any tasks throw, the first exception is
+     * re-thrown here after the rest have finished. Not re-entrant.
+     * @param n
+     * @param task
+     */
+    void parallelFor(size_t n, const std::function<void(size_t)>& task);
+
+    /**
+     * @return the number of threads, including the caller
+     */
+    int threads() const { return (int)m_Workers.size() + 1; }
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkReady, m_WorkDone;
+
+    const std::function<void(size_t)>* m_Task = nullptr;
+    // the caller's profiler, so work done on its behalf shows up there
+    Profiler* m_Profiler = nullptr;
+    size_t m_Count = 0;
+    std::atomic<size_t> m_Next{0};
+    unsigned long m_Generation = 0;
+    int m_Busy = 0;
+    bool m_Stop = false;
+    std::exception_ptr m_Error;
+
+    void workerLoop();
+    void runTasks();
+};
+
+
+#endif //SRC_WORKERPOOL_H
@@ -4,6 +4,11 @@
 #include "planner/utilities/RibbonManager.h"
 #include "planner/Planner.h"
 #include <path_planner_common/DubinsPlan.h>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+class GridWorldMap;
 
 /**
  * Interface to expose trajectory publishing to the Executive
@@ -43,7 +48,12 @@ public:
     virtual void publishTaskLevelStats(double wallClockTime, double cumulativeCollisionPenalty, double cumulativeGValue,
                                        double uncoveredLength) = 0;
 
-    virtual void displayMap(std::string path) = 0;
+    /**
+     * Display a grid world map, or clear the display if map is null. Showing the same map again should just
+     * republish whatever was built for it the first time.
+     * @param map
+     */
+    virtual void displayMap(std::shared_ptr<const GridWorldMap> map) = 0;
 
     /**
      * Alert the system that the planner has finished this iteration. This might deserve its own interface.
@@ -56,6 +66,16 @@ public:
      */
     virtual double getTime() const = 0;
 
+    /**
+     * Wait until a time, by the clock getTime reads. Anything with a clock of its own (like a replay) can make this
+     * take as long as it wants.
+     * @param time
+     */
+    virtual void sleepUntil(double time) {
+        auto remaining = time - getTime();
+        if (remaining > 0) std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+    }
+
     /**
      * Display the contents of the ribbon manager to /project11/display.
      * @param ribbonManager
@@ -0,0 +1,27 @@
+#include <iostream>
+#include "planner/utilities/BinaryVisualizer.h"
+
+/*
+ * Turn a binary visualization file (binary_visualization on) into the text the visualization tools read:
+ *
+ *     visualization_to_text <binary file> [<text file>]
+ *
+ * Writes to stdout without a text file.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: visualization_to_text <binary file> [<text file>]" << std::endl;
+        return 1;
+    }
+    try {
+        Visualizer::UniquePtr text(argc == 3 ? new Visualizer(argv[2]) : new Visualizer(std::cout));
+        auto dropped = BinaryVisualizer::convert(argv[1], *text);
+        if (dropped > 0) {
+            std::cerr << dropped << " events were dropped while recording because the writer fell behind" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
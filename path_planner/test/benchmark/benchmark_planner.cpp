@@ -0,0 +1,349 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <random>
+#include <unistd.h>
+#include "../../src/planner/AStarPlanner.h"
+#include "../../src/planner/search/Edge.h"
+#include "../../src/common/map/GridWorldMap.h"
+#include "../../src/common/dynamic_obstacles/BinaryDynamicObstaclesManager.h"
+#include "../../src/common/dynamic_obstacles/BinaryObstacleProjection.h"
+#include "../../src/common/dynamic_obstacles/GaussianDynamicObstaclesManager.h"
+#include "../../src/common/dynamic_obstacles/ObstacleCostRaster.h"
+
+/*
+ * Microbenchmarks for the planner's hot paths, plus whole plans on fixed scenarios. Everything is seeded so runs are
+ * comparable with each other; to keep a record, run with
+ *
+ *     benchmark_planner --benchmark_format=json --benchmark_out=results.json
+ *
+ * and diff the results with Google Benchmark's compare.py. The scenario maps come from the test scenario runner
+ * package, found the same way the unit tests find them unless PATH_PLANNER_SCENARIOS says where they are; the
+ * benchmarks that need them are skipped without them.
+ */
+
+namespace {
+
+PlannerConfig benchmarkConfig() {
+    PlannerConfig config(nullptr);
+    config.setNowFunction([] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    });
+    // same samples every run
+    config.setUseHaltonSamples(true);
+    return config;
+}
+
+std::string scenarioPath(const std::string& name) {
+    auto directory = std::getenv("PATH_PLANNER_SCENARIOS");
+    return std::string(directory ? directory : "../../../src/test_scenario_runner/scenarios") + "/" + name;
+}
+
+/**
+ * A 1km square map with a few dozen round islands, so there's something to hit without needing any files.
+ */
+std::shared_ptr<GridWorldMap> syntheticMap() {
+    static std::shared_ptr<GridWorldMap> map;
+    if (map) return map;
+    const size_t cells = 500;
+    const double resolution = 2;
+    OccupancyGrid grid(cells, cells);
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> centre(0, cells), radius(3, 25);
+    for (int i = 0; i < 40; i++) {
+        auto cx = centre(generator), cy = centre(generator), r = radius(generator);
+        for (size_t row = 0; row < cells; row++) {
+            for (size_t col = 0; col < cells; col++) {
+                if (hypot(col - cx, row - cy) <= r) grid.setBlocked(col, row, true);
+            }
+        }
+    }
+    DistanceField distances(grid);
+    map = std::make_shared<GridWorldMap>(resolution, std::move(grid), std::move(distances));
+    return map;
+}
+
+/**
+ * Contacts moving about the middle of the synthetic map.
+ * @param n
+ */
+template <class F>
+void addContacts(int n, F update) {
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<double> position(200, 800), heading(0, 2 * M_PI), speed(0.5, 5);
+    for (int i = 0; i < n; i++) update((uint32_t)i, position(generator), position(generator), heading(generator),
+                                       speed(generator));
+}
+
+RibbonManager surveyLines(int n, RibbonManager::Heuristic heuristic, double turningRadius) {
+    RibbonManager ribbonManager(heuristic, turningRadius, 2);
+    for (int i = 0; i < n; i++) ribbonManager.add(300 + 10 * i, 300, 300 + 10 * i, 700);
+    return ribbonManager;
+}
+
+void randomPositions(std::vector<State>& states, size_t n) {
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> position(0, 1000), heading(0, 2 * M_PI);
+    states.clear();
+    for (size_t i = 0; i < n; i++) states.emplace_back(position(generator), position(generator), heading(generator), 2, 1);
+}
+
+}
+
+static void BM_ComputeTrueCost(benchmark::State& state) {
+    auto config = benchmarkConfig();
+    config.setMap(syntheticMap());
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    addContacts((int)state.range(1), [&](uint32_t mmsi, double x, double y, double heading, double speed) {
+        obstacles->update(mmsi, x, y, heading, speed, 1, 10, 30);
+    });
+    config.setObstaclesManager(obstacles);
+    State start(100, 100, M_PI / 4, config.maxSpeed(), 1);
+    config.setStartStateTime(start.time());
+    auto ribbonManager = surveyLines(4, RibbonManager::TspPointRobotNoSplitAllRibbons, config.coverageTurningRadius());
+    // edges of roughly the given length, heading off in a few directions
+    std::vector<State> ends;
+    for (int i = 0; i < 8; i++) {
+        auto angle = i * M_PI / 4;
+        ends.emplace_back(start.x() + state.range(0) * cos(angle), start.y() + state.range(0) * sin(angle), angle,
+                          config.maxSpeed(), 0);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto root = Vertex::makeRoot(start, ribbonManager);
+        root->computeApproxToGo(config);
+        auto v = Vertex::connect(root, ends[i++ % ends.size()], config.turningRadius(), true);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(v->parentEdge()->computeTrueCost(config));
+    }
+}
+BENCHMARK(BM_ComputeTrueCost)->ArgNames({"length", "contacts"})->Args({20, 0})->Args({100, 0})->Args({100, 10});
+
+static void BM_Expand(benchmark::State& state) {
+    auto config = benchmarkConfig();
+    config.setMap(syntheticMap());
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    config.setObstaclesManager(obstacles);
+    State start(500, 250, 0, config.maxSpeed(), 1);
+    config.setStartStateTime(start.time());
+    auto ribbonManager = surveyLines(4, RibbonManager::TspPointRobotNoSplitAllRibbons, config.coverageTurningRadius());
+    AStarPlanner planner;
+    planner.setConfig(config);
+    StateGenerator generator(0, 1000, 0, 1000, config.maxSpeed(), config.maxSpeed(), 7);
+    generator.setSequence(StateGenerator::Sequence::Halton);
+    planner.addSamples(generator, (int)state.range(0));
+    auto root = Vertex::makeRoot(start, ribbonManager);
+    root->computeApproxToGo(config);
+    for (auto _ : state) {
+        planner.expand(root, *obstacles);
+        state.PauseTiming();
+        planner.clearVertexQueue();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_Expand)->ArgName("samples")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+static void BM_Heuristic(benchmark::State& state) {
+    auto heuristic = (RibbonManager::Heuristic)state.range(0);
+    auto ribbonManager = surveyLines((int)state.range(1), heuristic, 8);
+    std::vector<State> points;
+    randomPositions(points, 256);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& p = points[i++ % points.size()];
+        benchmark::DoNotOptimize(ribbonManager.approximateDistanceUntilDone(p.x(), p.y(), p.heading()));
+    }
+}
+BENCHMARK(BM_Heuristic)->ArgNames({"heuristic", "ribbons"})->ArgsProduct({
+    {RibbonManager::MaxDistance, RibbonManager::TspPointRobotNoSplitAllRibbons,
+     RibbonManager::TspPointRobotNoSplitKRibbons, RibbonManager::TspDubinsNoSplitAllRibbons,
+     RibbonManager::TspDubinsNoSplitKRibbons, RibbonManager::MinimumSpanningTree},
+    {1, 2, 5, 10, 20}});
+// where the exact (Held-Karp) heuristics stop fitting the per-vertex budget, which sets c_HeldKarpRibbonLimit (they
+// switch to the spanning tree past that, so go only as far as the limit could sensibly be)
+BENCHMARK(BM_Heuristic)->ArgNames({"heuristic", "ribbons"})->ArgsProduct({
+    {RibbonManager::TspPointRobotNoSplitAllRibbons, RibbonManager::TspDubinsNoSplitAllRibbons},
+    benchmark::CreateDenseRange(6, 12, 1)})->Unit(benchmark::kMicrosecond);
+
+/**
+ * collisionExists for one kind of obstacles manager, at several numbers of contacts.
+ * @tparam F makes the manager from a Binary one (or from scratch) with the given number of contacts
+ */
+template <class F>
+static void collisionExistsBenchmark(benchmark::State& state, F makeManager) {
+    DynamicObstaclesManager::ConstSharedPtr manager = makeManager((int)state.range(0));
+    std::vector<State> points;
+    randomPositions(points, 1024);
+    // along the next 30s, like an edge would
+    for (size_t i = 0; i < points.size(); i++) points[i].time() = 1 + 30.0 * i / points.size();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager->collisionExists(points[i++ % points.size()], true));
+    }
+}
+
+static std::shared_ptr<BinaryDynamicObstaclesManager> binaryContacts(int n) {
+    auto manager = std::make_shared<BinaryDynamicObstaclesManager>();
+    addContacts(n, [&](uint32_t mmsi, double x, double y, double heading, double speed) {
+        manager->update(mmsi, x, y, heading, speed, 1, 10, 30);
+    });
+    return manager;
+}
+
+static void BM_CollisionExistsBinary(benchmark::State& state) {
+    collisionExistsBenchmark(state, binaryContacts);
+}
+
+static void BM_CollisionExistsProjection(benchmark::State& state) {
+    collisionExistsBenchmark(state, [](int n) {
+        return std::make_shared<BinaryObstacleProjection>(*binaryContacts(n), 1, 30);
+    });
+}
+
+static void BM_CollisionExistsGaussian(benchmark::State& state) {
+    collisionExistsBenchmark(state, [](int n) {
+        auto manager = std::make_shared<GaussianDynamicObstaclesManager>();
+        addContacts(n, [&](uint32_t mmsi, double x, double y, double heading, double speed) {
+            manager->update(mmsi, x, y, heading, speed, 1);
+        });
+        return manager;
+    });
+}
+
+static void BM_CollisionExistsRaster(benchmark::State& state) {
+    collisionExistsBenchmark(state, [](int n) {
+        return std::make_shared<ObstacleCostRaster>(binaryContacts(n), 0, 1000, 0, 1000, 1, 30, 5, 1, 1 << 24);
+    });
+}
+
+BENCHMARK(BM_CollisionExistsBinary)->ArgName("contacts")->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK(BM_CollisionExistsProjection)->ArgName("contacts")->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK(BM_CollisionExistsGaussian)->ArgName("contacts")->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK(BM_CollisionExistsRaster)->ArgName("contacts")->Arg(1)->Arg(10)->Arg(100);
+
+static void BM_MapIsBlocked(benchmark::State& state) {
+    auto map = syntheticMap();
+    std::vector<State> points;
+    randomPositions(points, 1024);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& p = points[i++ % points.size()];
+        benchmark::DoNotOptimize(map->isBlocked(p.x(), p.y()));
+    }
+}
+BENCHMARK(BM_MapIsBlocked);
+
+static void BM_MapDistanceToBlocked(benchmark::State& state) {
+    auto map = syntheticMap();
+    std::vector<State> points;
+    randomPositions(points, 1024);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& p = points[i++ % points.size()];
+        benchmark::DoNotOptimize(map->distanceToBlocked(p.x(), p.y()));
+    }
+}
+BENCHMARK(BM_MapDistanceToBlocked);
+
+static void BM_MapPossiblyBlocked(benchmark::State& state) {
+    auto map = syntheticMap();
+    std::vector<State> points;
+    randomPositions(points, 1024);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& p = points[i++ % points.size()];
+        benchmark::DoNotOptimize(map->possiblyBlocked(p.x(), p.y(), p.x() + state.range(0), p.y() + state.range(0)));
+    }
+}
+BENCHMARK(BM_MapPossiblyBlocked)->ArgName("box")->Arg(10)->Arg(100);
+
+static void BM_MapCheckBlocked(benchmark::State& state) {
+    auto map = syntheticMap();
+    std::vector<State> points;
+    randomPositions(points, 1024);
+    std::vector<double> xs, ys;
+    for (const auto& p : points) {
+        xs.push_back(p.x());
+        ys.push_back(p.y());
+    }
+    std::vector<unsigned char> blocked(points.size());
+    for (auto _ : state) {
+        map->checkBlocked(xs.data(), ys.data(), xs.size(), blocked.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * xs.size());
+}
+BENCHMARK(BM_MapCheckBlocked);
+
+/**
+ * Whole plans. They always take the time they're given, so what's worth tracking is how much search fits into it
+ * and how good a plan comes out, which go in the counters.
+ * @param map
+ * @param ribbonManager
+ * @param start
+ */
+static void planBenchmark(benchmark::State& state, const Map::SharedPtr& map, const RibbonManager& ribbonManager,
+                          const State& start) {
+    auto config = benchmarkConfig();
+    config.setMap(map);
+    config.setObstaclesManager(std::make_shared<BinaryDynamicObstaclesManager>());
+    double expanded = 0, iterations = 0, f = 0, found = 0;
+    Profiler::Allocations allocations;
+    for (auto _ : state) {
+        AStarPlanner planner;
+        auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+        Profiler::accumulate(allocations, stats.Allocations);
+        expanded += stats.Expanded;
+        iterations += stats.Iterations;
+        if (!stats.Plan.empty()) {
+            f += stats.PlanFValue;
+            found++;
+        }
+    }
+    state.counters["expanded"] = benchmark::Counter(expanded, benchmark::Counter::kAvgIterations);
+    state.counters["iterations"] = benchmark::Counter(iterations, benchmark::Counter::kAvgIterations);
+    state.counters["found"] = benchmark::Counter(found, benchmark::Counter::kAvgIterations);
+    state.counters["f"] = found > 0 ? f / found : 0;
+    // per plan, and only with profiling built in; divide by expanded for per vertex costs
+    if (!Profiler::c_Enabled) return;
+    for (int o = 0; o < Profiler::ObjectCount; o++) {
+        std::string name = Profiler::objectName((Profiler::Object)o);
+        state.counters[name + " allocs"] = benchmark::Counter(allocations[o].Allocations,
+                                                             benchmark::Counter::kAvgIterations);
+        state.counters[name + " copies"] = benchmark::Counter(allocations[o].Copies, benchmark::Counter::kAvgIterations);
+        state.counters[name + " bytes"] = benchmark::Counter(allocations[o].Bytes, benchmark::Counter::kAvgIterations);
+    }
+}
+
+static void BM_PlanSynthetic(benchmark::State& state) {
+    auto ribbonManager = surveyLines(4, RibbonManager::TspPointRobotNoSplitKRibbons, 8);
+    planBenchmark(state, syntheticMap(), ribbonManager, State(250, 250, 0, 2.5, 1));
+}
+BENCHMARK(BM_PlanSynthetic)->Unit(benchmark::kMillisecond)->Iterations(5);
+
+static void scenarioPlanBenchmark(benchmark::State& state, const std::string& file, const RibbonManager& ribbonManager,
+                                  const State& start) {
+    auto path = scenarioPath(file);
+    if (access(path.c_str(), R_OK) != 0) {
+        state.SkipWithError(("can't find " + path + " (set PATH_PLANNER_SCENARIOS)").c_str());
+        return;
+    }
+    planBenchmark(state, std::make_shared<GridWorldMap>(path), ribbonManager, start);
+}
+
+static void BM_PlanPepperrellCove(benchmark::State& state) {
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(600, 550, 600, 700);
+    ribbonManager.add(620, 550, 620, 700);
+    scenarioPlanBenchmark(state, "pepperrell_cove_6.map", ribbonManager, State(593, 592.76, 0, 2.5, 1));
+}
+BENCHMARK(BM_PlanPepperrellCove)->Unit(benchmark::kMillisecond)->Iterations(5);
+
+static void BM_PlanGridWorld(benchmark::State& state) {
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    ribbonManager.add(495, 450, 495, 550);
+    scenarioPlanBenchmark(state, "test1.map", ribbonManager, State(495, 400, 0, 2.5, 1));
+}
+BENCHMARK(BM_PlanGridWorld)->Unit(benchmark::kMillisecond)->Iterations(5);
+
+BENCHMARK_MAIN();
@@ -6,11 +6,36 @@
 #include "../../src/planner/search/Edge.h"
 #include "../../src/planner/SamplingBasedPlanner.h"
 #include "../../src/planner/AStarPlanner.h"
+#include "../../src/planner/PortfolioPlanner.h"
+#include "../../src/planner/PotentialFieldsPlanner.h"
+#include "../../src/planner/utilities/SampleIndex.h"
+#include "../../src/planner/utilities/SamplePool.h"
+#include "../../src/planner/utilities/SampleStore.h"
+#include "../../src/planner/utilities/SurveyOrder.h"
+#include "../../src/planner/search/CheckedPlan.h"
+#include "../../src/planner/utilities/WorkerPool.h"
+#include "../../src/planner/utilities/CycleScheduler.h"
+#include "../../src/planner/utilities/SpscRing.h"
+#include "../../src/planner/utilities/LatestTaskWorker.h"
+#include "../../src/planner/utilities/Profiler.h"
+#include "../../src/planner/utilities/BinaryVisualizer.h"
+#include "../../src/planner/utilities/Tracer.h"
+#include "../../src/planner/search/DubinsCache.h"
+#include <path_planner_common/DubinsBatch.h>
+#include "../../src/planner/utilities/HeuristicCache.h"
 #include "../../src/common/map/GeoTiffMap.h"
 #include "../../src/common/map/GridWorldMap.h"
+#include "../../src/common/map/OccupancyGrid.h"
+#include "../../src/common/map/TileCache.h"
+#include "../../src/common/map/DistanceField.h"
+#include "../../src/common/map/OccupancyPyramid.h"
+#include "../../src/common/map/MapCache.h"
 #include "../../src/common/dynamic_obstacles/BinaryDynamicObstaclesManager.h"
+#include "../../src/common/dynamic_obstacles/SnapshotBuffer.h"
+#include "../../src/common/dynamic_obstacles/ObstacleCostRaster.h"
 #include "../../src/common/dynamic_obstacles/GaussianDynamicObstaclesManager.h"
 #include <thread>
+#include <future>
 #include <path_planner_common/Plan.h>
 
 using std::vector;
@@ -199,6 +224,36 @@ TEST(UnitTests, DynamicObstacleTest1) {
     EXPECT_NEAR(p1, p, 0.00001);
 }
 
+TEST(UnitTests, DynamicObstacleBatchTest) {
+    DynamicObstaclesManager1 obstaclesManager;
+    double sigma[2][2] = {{2, 0.3}, {0.3, 1}};
+    std::vector<Distribution> distributions;
+    for (int i = 0; i < 5; i++) {
+        double mean[2] = {i * 3.0, i * 1.5};
+        distributions.emplace_back(mean, sigma, 5, 3, 0.2 * i, 2 + 2 * i);
+    }
+    obstaclesManager.update(1, distributions);
+    distributions.clear();
+    double single[2] = {4, 4};
+    distributions.emplace_back(single, sigma, 4, 4, 0, 5);
+    distributions.emplace_back(single, sigma, 4, 4, 0.5, 6);
+    obstaclesManager.update(2, distributions);
+    std::vector<State> samples;
+    // before, through and past the distributions, with one step backwards in time
+    for (int i = 0; i < 40; i++) samples.emplace_back(i * 0.3, i * 0.2, 0, 0, i * 0.35);
+    samples.emplace_back(2, 2, 0, 0, 3);
+    samples.emplace_back(3, 3, 0, 0, 7);
+    std::vector<double> result;
+    obstaclesManager.collisionExists(samples, result);
+    ASSERT_EQ(result.size(), samples.size());
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        EXPECT_EQ(result[i], obstaclesManager.collisionExists(samples[i]));
+        total += result[i];
+    }
+    EXPECT_LT(0, total);
+}
+
 TEST(UnitTests, BinaryDynamicObstaclesTest1) {
     BinaryDynamicObstaclesManager manager;
     manager.update(1, 42, 42, 0, 1, 1, 5, 15);
@@ -215,6 +270,483 @@ TEST(UnitTests, BinaryDynamicObstaclesTest1) {
     EXPECT_DOUBLE_EQ(manager.collisionExists(45, 52, 11, false), 0);
 }
 
+TEST(UnitTests, BinaryDynamicObstaclesClearanceTest) {
+    BinaryDynamicObstaclesManager manager;
+    manager.update(1, 42, 42, 0, 1, 1, 5, 15);
+    EXPECT_DOUBLE_EQ(manager.distanceToNearestPossibleCollision(42, 42, 1, false), 0);
+    // 7.5 m half length north of center
+    EXPECT_NEAR(manager.distanceToNearestPossibleCollision(42, 60, 1, false), 10.5, 1e-9);
+    EXPECT_NEAR(manager.distanceToNearestPossibleCollision(42, 60, 1, true), 9.5, 1e-9);
+    // moving north at 1 m/s
+    EXPECT_NEAR(manager.distanceToNearestPossibleCollision(42, 60, 11, false), 0.5, 1e-9);
+    EXPECT_DOUBLE_EQ(manager.maxObstacleSpeed(), 1);
+}
+
+TEST(UnitTests, BinaryObstacleProjectionTest) {
+    // the bucketed snapshot has to agree exactly with the manager, inside the horizon and out
+    BinaryDynamicObstaclesManager manager;
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<> coordinate(-200, 200), heading(0, 2 * M_PI), speed(0, 8), size(2, 40);
+    for (uint32_t i = 0; i < 60; i++) {
+        manager.update(i, coordinate(generator), coordinate(generator), heading(generator), speed(generator), 3,
+                       size(generator), size(generator));
+    }
+    auto projection = manager.precompute(5, 30);
+    ASSERT_TRUE(projection);
+    EXPECT_DOUBLE_EQ(projection->maxObstacleSpeed(), manager.maxObstacleSpeed());
+    std::uniform_real_distribution<> time(0, 40);
+    int collisions = 0;
+    for (int i = 0; i < 20000; i++) {
+        double x = coordinate(generator), y = coordinate(generator), t = time(generator);
+        bool strict = i % 2 == 0;
+        auto expected = manager.collisionExists(x, y, t, strict);
+        collisions += expected > 0;
+        EXPECT_EQ(projection->collisionExists(x, y, t, strict), expected);
+        if (i % 10 == 0) {
+            EXPECT_EQ(projection->distanceToNearestPossibleCollision(x, y, t, strict),
+                      manager.distanceToNearestPossibleCollision(x, y, t, strict));
+        }
+    }
+    EXPECT_GT(collisions, 100); // make sure we actually tested something
+    EXPECT_FALSE(BinaryDynamicObstaclesManager().precompute(5, 30));
+}
+
+TEST(UnitTests, SnapshotBufferTest) {
+    SnapshotBuffer<BinaryDynamicObstaclesManager> buffer;
+    buffer.modify([](BinaryDynamicObstaclesManager& m) { m.update(1, 42, 42, 0, 1, 1, 5, 15); });
+    // nothing until it's published
+    EXPECT_DOUBLE_EQ(buffer.current()->collisionExists(42, 42, 1, false), 0);
+    EXPECT_EQ(buffer.version(), 0);
+    buffer.publish();
+    auto snapshot = buffer.current();
+    EXPECT_DOUBLE_EQ(snapshot->collisionExists(42, 42, 1, false), 1);
+    EXPECT_EQ(buffer.version(), 1);
+    // no changes, no new version
+    buffer.publish();
+    EXPECT_EQ(buffer.version(), 1);
+    // and a snapshot never changes after that
+    buffer.modify([](BinaryDynamicObstaclesManager& m) { m.forget(1); });
+    buffer.publish();
+    EXPECT_DOUBLE_EQ(snapshot->collisionExists(42, 42, 1, false), 1);
+    EXPECT_DOUBLE_EQ(buffer.current()->collisionExists(42, 42, 1, false), 0);
+
+    // contacts coming in on one thread while another publishes and reads
+    std::atomic<bool> stop(false);
+    std::thread writer([&] {
+        for (uint32_t i = 0; !stop; i++) {
+            buffer.modify([&](BinaryDynamicObstaclesManager& m) {
+                // always a whole fleet of ten, in the same place
+                for (uint32_t j = 0; j < 10; j++) m.update(j, j * 100, 0, 0, 0, 0, 5, 15);
+                if (i % 2) m.forget(10 + i % 7); else m.update(10 + i % 7, 1000, 1000, 0, 0, 0, 5, 15);
+            });
+        }
+    });
+    for (int i = 0; i < 200; i++) {
+        buffer.publish();
+        auto current = buffer.current();
+        double sum = 0;
+        for (uint32_t j = 0; j < 10; j++) sum += current->collisionExists(j * 100, 0, 0, false);
+        if (current->get().size() >= 10) {
+            EXPECT_DOUBLE_EQ(sum, 10);
+        }
+    }
+    stop = true;
+    writer.join();
+}
+
+TEST(UnitTests, SpscRingTest) {
+    SpscRing<int> ring(5);
+    EXPECT_EQ(ring.capacity(), 8);
+    int i = 0;
+    EXPECT_FALSE(ring.pop(i));
+    for (int j = 0; j < 8; j++) EXPECT_TRUE(ring.push(j));
+    EXPECT_FALSE(ring.push(8));
+    EXPECT_TRUE(ring.pop(i));
+    EXPECT_EQ(i, 0);
+    EXPECT_TRUE(ring.push(8));
+    std::vector<int> drained;
+    EXPECT_EQ(ring.drain([&](int j) { drained.push_back(j); }), 8);
+    for (int j = 0; j < 8; j++) EXPECT_EQ(drained[j], j + 1);
+    EXPECT_FALSE(ring.pop(i));
+
+    // everything comes out once, in order, with the two sides going at once
+    SpscRing<int> shared(64);
+    const int count = 20000;
+    std::thread producer([&] {
+        for (int j = 0; j < count; j++) while (!shared.push(j)) std::this_thread::yield();
+    });
+    int expected = 0;
+    bool ordered = true;
+    while (expected < count) {
+        if (shared.drain([&](int j) { ordered &= j == expected++; }) == 0) std::this_thread::yield();
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(expected, count);
+}
+
+TEST(UnitTests, AdaptiveCollisionCheckingTest) {
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    // sitting across the path
+    obstacles->update(1, 0, 40, M_PI_2, 0, 1, 5, 10);
+    auto config = plannerConfig;
+    config.setStartStateTime(1);
+    config.setObstaclesManager(obstacles);
+    RibbonManager ribbonManager;
+    ribbonManager.add(100, 0, 100, 80);
+    State start(0, 0, 0, config.maxSpeed(), 1), end(0, 70, 0, config.maxSpeed(), 0);
+    auto fixedRoot = Vertex::makeRoot(start, ribbonManager);
+    fixedRoot->computeApproxToGo(config);
+    auto fixed = Vertex::connect(fixedRoot, end);
+    fixed->parentEdge()->computeTrueCost(config);
+    config.setAdaptiveCollisionChecking(true);
+    auto adaptiveRoot = Vertex::makeRoot(start, ribbonManager);
+    adaptiveRoot->computeApproxToGo(config);
+    auto adaptive = Vertex::connect(adaptiveRoot, end);
+    adaptive->parentEdge()->computeTrueCost(config);
+    EXPECT_GT(fixed->parentEdge()->getSavedCollisionPenalty(), 0);
+    // skipping the clear parts shouldn't change anything
+    EXPECT_DOUBLE_EQ(adaptive->parentEdge()->getSavedCollisionPenalty(),
+            fixed->parentEdge()->getSavedCollisionPenalty());
+    EXPECT_DOUBLE_EQ(adaptive->parentEdge()->trueCost(), fixed->parentEdge()->trueCost());
+    EXPECT_DOUBLE_EQ(adaptive->state().time(), fixed->state().time());
+}
+
+TEST(UnitTests, EdgeSweepTest) {
+    // the sweeps compiled for particular kinds of map and obstacles give the same answers as going through the vtables
+    struct AnyMap : public Map {
+        explicit AnyMap(Map::SharedPtr m) : Inner(std::move(m)) {}
+        bool isBlocked(double x, double y) const override { return Inner->isBlocked(x, y); }
+        double distanceToBlocked(double x, double y) const override { return Inner->distanceToBlocked(x, y); }
+        bool possiblyBlocked(double minX, double minY, double maxX, double maxY) const override {
+            return Inner->possiblyBlocked(minX, minY, maxX, maxY);
+        }
+        Map::SharedPtr Inner;
+    };
+    struct AnyObstacles : public DynamicObstaclesManager {
+        explicit AnyObstacles(DynamicObstaclesManager::SharedPtr m) : Inner(std::move(m)) {}
+        double collisionExists(double x, double y, double time, bool strict) const override {
+            return Inner->collisionExists(x, y, time, strict);
+        }
+        double distanceToNearestPossibleCollision(double x, double y, double time, bool strict) const override {
+            return Inner->distanceToNearestPossibleCollision(x, y, time, strict);
+        }
+        bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                               bool strict) const override {
+            return Inner->possibleCollision(minX, minY, maxX, maxY, startTime, endTime, strict);
+        }
+        double maxObstacleSpeed() const override { return Inner->maxObstacleSpeed(); }
+        DynamicObstaclesManager::SharedPtr Inner;
+    };
+    // an island in the middle and some boats going past it
+    OccupancyGrid grid(100, 100);
+    for (size_t r = 40; r < 60; r++) for (size_t c = 45; c < 55; c++) grid.setBlocked(c, r, true);
+    auto map = std::make_shared<GridWorldMap>(1, grid, DistanceField(grid, 2));
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    obstacles->update(1, 20, 20, M_PI_4, 2, 0, 5, 10);
+    obstacles->update(2, 80, 30, -M_PI_2, 1, 0, 5, 10);
+    auto exact = plannerConfig, any = plannerConfig;
+    exact.setStartStateTime(0);
+    exact.setMap(map);
+    exact.setObstaclesManager(obstacles);
+    any.setStartStateTime(0);
+    any.setMap(std::make_shared<AnyMap>(map));
+    any.setObstaclesManager(std::make_shared<AnyObstacles>(obstacles));
+    EXPECT_NE(Edge::pickSweep(exact), Edge::pickSweep(any));
+    RibbonManager ribbonManager;
+    ribbonManager.add(10, 70, 90, 70);
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<> coordinate(0, 100), heading(0, 2 * M_PI);
+    int blocked = 0, colliding = 0;
+    for (int i = 0; i < 40; i++) {
+        exact.setAdaptiveCollisionChecking(i % 2 == 1);
+        any.setAdaptiveCollisionChecking(i % 2 == 1);
+        State start(coordinate(generator), coordinate(generator), heading(generator), exact.maxSpeed(), 0),
+                end(coordinate(generator), coordinate(generator), heading(generator), exact.maxSpeed(), 0);
+        Vertex::SharedPtr ends[2];
+        for (int j = 0; j < 2; j++) {
+            auto& config = j == 0? exact : any;
+            auto root = Vertex::makeRoot(start, ribbonManager);
+            root->computeApproxToGo(config);
+            ends[j] = Vertex::connect(root, end);
+            ends[j]->parentEdge()->computeTrueCost(config);
+        }
+        EXPECT_EQ(ends[0]->parentEdge()->infeasible(), ends[1]->parentEdge()->infeasible());
+        EXPECT_DOUBLE_EQ(ends[0]->parentEdge()->getSavedCollisionPenalty(),
+                         ends[1]->parentEdge()->getSavedCollisionPenalty());
+        EXPECT_DOUBLE_EQ(ends[0]->currentCost(), ends[1]->currentCost());
+        EXPECT_TRUE(ends[0]->ribbonManager().sameRibbonsAs(ends[1]->ribbonManager()));
+        blocked += ends[0]->parentEdge()->infeasible();
+        colliding += ends[0]->parentEdge()->getSavedCollisionPenalty() > 0;
+    }
+    EXPECT_GT(blocked, 0);
+    EXPECT_GT(colliding, 0);
+    // picked once and kept until the map or obstacles change
+    exact.setEdgeSweep(Edge::pickSweep(exact));
+    EXPECT_NE(exact.edgeSweep(), nullptr);
+    exact.setObstaclesManager(std::make_shared<BinaryDynamicObstaclesManager>());
+    EXPECT_EQ(exact.edgeSweep(), nullptr);
+    // nothing to hit is the same as no obstacles at all
+    any.setObstaclesManager(std::make_shared<DynamicObstaclesManager>());
+    any.setMap(map);
+    EXPECT_EQ(Edge::pickSweep(exact), Edge::pickSweep(any));
+}
+
+TEST(UnitTests, BatchedEdgeSweepTest) {
+    // sampling the edge into arrays first and checking them in passes gets exactly what stepping along it does
+    OccupancyGrid grid(100, 100);
+    for (size_t r = 40; r < 60; r++) for (size_t c = 45; c < 55; c++) grid.setBlocked(c, r, true);
+    auto map = std::make_shared<GridWorldMap>(1, grid, DistanceField(grid, 2));
+    auto binary = std::make_shared<BinaryDynamicObstaclesManager>();
+    binary->update(1, 20, 20, M_PI_4, 2, 0, 5, 10);
+    binary->update(2, 80, 30, -M_PI_2, 1, 0, 5, 10);
+    auto gaussian = std::make_shared<GaussianDynamicObstaclesManager>();
+    gaussian->update(1, 20, 20, M_PI_4, 2, 0);
+    auto batched = plannerConfig;
+    batched.setStartStateTime(0);
+    batched.setMap(map);
+    batched.setBatchedEdgeSweep(true);
+    batched.setValidateEdgeSweep(true);
+    // short enough that some edges finish the ribbons and get truncated
+    batched.setTimeMinimum(2);
+    // one the adaptive checking is on for, which the batched sweep ignores
+    auto scalar = batched;
+    scalar.setBatchedEdgeSweep(false);
+    scalar.setAdaptiveCollisionChecking(true);
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<> coordinate(0, 100), heading(0, 2 * M_PI);
+    int blocked = 0, colliding = 0, truncated = 0;
+    for (int i = 0; i < 60; i++) {
+        DynamicObstaclesManager::SharedPtr obstacles = binary;
+        if (i % 2 == 1) obstacles = gaussian;
+        batched.setObstaclesManager(obstacles);
+        scalar.setObstaclesManager(obstacles);
+        batched.setAnalyticCoverage(i % 4 >= 2);
+        scalar.setAnalyticCoverage(i % 4 >= 2);
+        State start(coordinate(generator), coordinate(generator), heading(generator), batched.maxSpeed(), 0),
+                end(coordinate(generator), coordinate(generator), heading(generator), batched.maxSpeed(), 0);
+        RibbonManager ribbonManager;
+        if (i % 3 == 0) {
+            // a short one right at the start, to be done with straight away
+            ribbonManager.add(start.x() - 1, start.y(), start.x() + 1, start.y());
+        } else {
+            ribbonManager.add(coordinate(generator), coordinate(generator), coordinate(generator), coordinate(generator));
+        }
+        Vertex::SharedPtr ends[2];
+        for (int j = 0; j < 2; j++) {
+            auto& config = j == 0? batched : scalar;
+            auto root = Vertex::makeRoot(start, ribbonManager);
+            root->computeApproxToGo(config);
+            ends[j] = Vertex::connect(root, end);
+            // (validation throws if the two ways disagree)
+            EXPECT_NO_THROW(ends[j]->parentEdge()->computeTrueCost(config));
+        }
+        EXPECT_EQ(ends[0]->parentEdge()->infeasible(), ends[1]->parentEdge()->infeasible());
+        EXPECT_NEAR(ends[0]->parentEdge()->getSavedCollisionPenalty(),
+                    ends[1]->parentEdge()->getSavedCollisionPenalty(), 1e-6);
+        blocked += ends[0]->parentEdge()->infeasible();
+        colliding += ends[0]->parentEdge()->getSavedCollisionPenalty() > 0;
+        truncated += ends[0]->ribbonManager().done() && ends[0]->state().time() <
+                fmin(ends[0]->parentEdge()->approxCost(), batched.timeHorizon()) - 1e-6;
+    }
+    EXPECT_GT(blocked, 0);
+    EXPECT_GT(colliding, 0);
+    EXPECT_GT(truncated, 0);
+}
+
+TEST(UnitTests, AnalyticCoverageTest) {
+    // covering an edge's segments at once instead of at samples along them gets the same coverage along straight
+    // lines, and never more on turns
+    RibbonManager::setRibbonWidth(1.5);
+    OccupancyGrid grid(100, 100);
+    auto map = std::make_shared<GridWorldMap>(1, grid, DistanceField(grid, 2));
+    auto sampled = plannerConfig;
+    sampled.setStartStateTime(0);
+    sampled.setMap(map);
+    sampled.setObstaclesManager(std::make_shared<DynamicObstaclesManager>());
+    auto analytic = sampled;
+    analytic.setAnalyticCoverage(true);
+    RibbonManager ribbonManager;
+    ribbonManager.add(10, 10, 10, 50);
+    auto sweep = [&](PlannerConfig& config, const State& start, const State& end, bool coverageAllowed) {
+        auto root = Vertex::makeRoot(start, ribbonManager);
+        root->computeApproxToGo(config);
+        auto v = Vertex::connect(root, end, config.coverageTurningRadius(), coverageAllowed);
+        v->parentEdge()->computeTrueCost(config);
+        return v;
+    };
+    // straight down the ribbon, finishing it and getting truncated
+    State start(10, 5, 0, sampled.maxSpeed(), 0), end(10, 90, 0, sampled.maxSpeed(), 0);
+    auto a = sweep(analytic, start, end, false), s = sweep(sampled, start, end, false);
+    EXPECT_TRUE(a->ribbonManager().done());
+    EXPECT_TRUE(s->ribbonManager().done());
+    EXPECT_NEAR(s->ribbonManager().coverageCompletedTime(), a->ribbonManager().coverageCompletedTime(),
+                2 * sampled.collisionCheckingIncrement() / sampled.maxSpeed());
+    EXPECT_NEAR(s->state().time(), a->state().time(), 2 * sampled.collisionCheckingIncrement() / sampled.maxSpeed());
+    EXPECT_LT(a->state().time(), end.time() + 85 / sampled.maxSpeed());
+    // turning across it, against covering points much closer together than the samples
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<> coordinate(0, 60), heading(0, 2 * M_PI);
+    for (int i = 0; i < 30; i++) {
+        State from(coordinate(generator), coordinate(generator), heading(generator), sampled.maxSpeed(), 0),
+                to(coordinate(generator), coordinate(generator), heading(generator), sampled.maxSpeed(), 0);
+        a = sweep(analytic, from, to, true);
+        auto reference = ribbonManager;
+        const auto& plan = a->parentEdge()->getPlan(analytic);
+        for (double t = plan.getStartTime(); t <= a->state().time(); t += 0.001) {
+            State state;
+            state.time() = t;
+            plan.sample(state);
+            reference.cover(state.x(), state.y(), true);
+        }
+        EXPECT_GE(a->ribbonManager().getTotalUncoveredLength(), reference.getTotalUncoveredLength() - 0.01);
+    }
+}
+
+TEST(UnitTests, ObstacleBroadPhaseTest) {
+    // the broad phase can only skip checks that would have found nothing
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    std::mt19937 generator(23);
+    std::uniform_real_distribution<> coordinate(-150, 150), heading(0, 2 * M_PI), speed(0, 4), size(2, 30);
+    for (uint32_t i = 0; i < 15; i++) {
+        obstacles->update(i, coordinate(generator), coordinate(generator), heading(generator), speed(generator), 0,
+                size(generator), size(generator));
+    }
+    // same obstacles, but with the default (always possible) broad phase
+    struct Unfiltered : public DynamicObstaclesManager {
+        explicit Unfiltered(DynamicObstaclesManager::SharedPtr m) : Manager(std::move(m)) {}
+        double collisionExists(double x, double y, double time, bool strict) const override {
+            return Manager->collisionExists(x, y, time, strict);
+        }
+        DynamicObstaclesManager::SharedPtr Manager;
+    };
+    auto config = plannerConfig;
+    config.setStartStateTime(0);
+    RibbonManager ribbonManager;
+    ribbonManager.add(1000, 0, 1000, 80);
+    int colliding = 0;
+    for (int i = 0; i < 20; i++) {
+        State start(coordinate(generator), coordinate(generator), heading(generator), config.maxSpeed(), 0),
+            end(coordinate(generator), coordinate(generator), heading(generator), config.maxSpeed(), 0);
+        double penalties[2];
+        for (int j = 0; j < 2; j++) {
+            if (j == 0) config.setObstaclesManager(obstacles);
+            else config.setObstaclesManager(std::make_shared<Unfiltered>(obstacles));
+            auto root = Vertex::makeRoot(start, ribbonManager);
+            root->computeApproxToGo(config);
+            auto v = Vertex::connect(root, end);
+            v->parentEdge()->computeTrueCost(config);
+            penalties[j] = v->parentEdge()->getSavedCollisionPenalty();
+        }
+        EXPECT_DOUBLE_EQ(penalties[0], penalties[1]);
+        colliding += penalties[0] > 0;
+    }
+    EXPECT_GT(colliding, 0);
+    // and it does actually rule things out
+    EXPECT_FALSE(obstacles->possibleCollision(5000, 5000, 5010, 5010, 0, 10, true));
+    EXPECT_TRUE(obstacles->possibleCollision(-150, -150, 150, 150, 0, 10, true));
+}
+
+TEST(UnitTests, ObstacleBroadPhaseArcTest) {
+    // a turn bulges out past the box around its chord, by more than the old straight-line slack allowed for
+    struct Wall : public DynamicObstaclesManager {
+        double collisionExists(double x, double y, double time, bool strict) const override {
+            return x < -0.2;
+        }
+        bool possibleCollision(double minX, double minY, double maxX, double maxY, double startTime, double endTime,
+                               bool strict) const override {
+            return minX < -0.2;
+        }
+    };
+    auto config = plannerConfig;
+    config.setStartStateTime(0);
+    config.setObstaclesManager(std::make_shared<Wall>());
+    RibbonManager ribbonManager;
+    ribbonManager.add(1000, 0, 1000, 80);
+    // one broad phase's worth of arc (two seconds), turning right from a bit west of north to a bit east of it, so the
+    // chord runs up x = 0 and the middle of the arc is about 0.39m west of it (the chord's a hair longer than the arc's
+    // so rounding can't make it go the whole way around)
+    auto angle = 2 * config.maxSpeed() / config.turningRadius();
+    auto chord = 2 * config.turningRadius() * sin(angle / 2) + 1e-3;
+    State start(0, 0, 2 * M_PI - angle / 2, config.maxSpeed(), 0), end(0, chord, angle / 2, config.maxSpeed(), 0);
+    auto root = Vertex::makeRoot(start, ribbonManager);
+    root->computeApproxToGo(config);
+    auto v = Vertex::connect(root, end);
+    v->parentEdge()->computeTrueCost(config);
+    EXPECT_NEAR(v->parentEdge()->getPlan(config).length(), angle * config.turningRadius(), 1e-2);
+    EXPECT_GT(v->parentEdge()->getSavedCollisionPenalty(), 0);
+}
+
+TEST(UnitTests, ObstacleChangedNearTest) {
+    BinaryDynamicObstaclesManager before;
+    before.update(1, 0, 0, 0, 0, 0, 5, 5);
+    before.update(2, 500, 0, 0, 0, 0, 5, 5);
+    auto after = before;
+    EXPECT_FALSE(after.changedNear(before, -10, -10, 10, 10, 0, 10, true));
+    // one moves a bit but stays near where it was
+    after.update(1, 5, 0, 0, 0, 0, 5, 5);
+    EXPECT_TRUE(after.changedNear(before, -10, -10, 10, 10, 0, 10, true));
+    EXPECT_FALSE(after.changedNear(before, 400, -10, 600, 10, 0, 10, true));
+    // one appears, one goes away; where it used to be counts
+    after = before;
+    after.update(3, 1000, 0, 0, 0, 0, 5, 5);
+    after.forget(2);
+    EXPECT_FALSE(after.changedNear(before, -10, -10, 10, 10, 0, 10, true));
+    EXPECT_TRUE(after.changedNear(before, 990, -10, 1010, 10, 0, 10, true));
+    EXPECT_TRUE(after.changedNear(before, 490, -10, 510, 10, 0, 10, true));
+    // (moving obstacles count where they get to during the interval)
+    after = before;
+    after.update(3, 1000, 0, 0, 10, 0, 5, 5);
+    EXPECT_TRUE(after.changedNear(before, 990, 90, 1010, 110, 9, 11, true));
+    EXPECT_FALSE(after.changedNear(before, 990, 90, 1010, 110, 0, 1, true));
+    // a different kind of manager could be anything
+    DynamicObstaclesManager nothing;
+    EXPECT_TRUE(after.changedNear(nothing, 5000, 5000, 5010, 5010, 0, 10, true));
+    EXPECT_FALSE(nothing.changedNear(nothing, 0, 0, 10, 10, 0, 10, true));
+
+    GaussianDynamicObstaclesManager gaussianBefore;
+    gaussianBefore.update(1, 0, 0, 0, 0, 0);
+    auto gaussianAfter = gaussianBefore;
+    EXPECT_FALSE(gaussianAfter.changedNear(gaussianBefore, -10, -10, 10, 10, 0, 10, true));
+    gaussianAfter.update(1, 5, 0, 0, 0, 0);
+    EXPECT_TRUE(gaussianAfter.changedNear(gaussianBefore, -10, -10, 10, 10, 0, 10, true));
+    EXPECT_FALSE(gaussianAfter.changedNear(gaussianBefore, 1000, 1000, 1010, 1010, 0, 10, true));
+    gaussianAfter = gaussianBefore;
+    gaussianAfter.update(2, 1000, 1000, 0, 0, 0);
+    EXPECT_FALSE(gaussianAfter.changedNear(gaussianBefore, -10, -10, 10, 10, 0, 10, true));
+    EXPECT_TRUE(gaussianAfter.changedNear(gaussianBefore, 1000, 1000, 1010, 1010, 0, 10, true));
+}
+
+TEST(UnitTests, ObstacleCostRasterTest) {
+    auto obstacles = std::make_shared<GaussianDynamicObstaclesManager>();
+    obstacles->update(1, 0, 0, 0, 2, 0);
+    obstacles->update(2, 40, 20, M_PI / 2, 1, 0);
+    ObstacleCostRaster raster(obstacles, -50, 50, -50, 50, 0, 10, 5, 1, 1u << 20);
+    EXPECT_DOUBLE_EQ(raster.cellSize(), 5);
+    // grid vertices are just the source's values, and in between is somewhere between the corners
+    EXPECT_FLOAT_EQ(raster.collisionExists(0, 0, 0, false), obstacles->collisionExists(0, 0, 0, false));
+    EXPECT_FLOAT_EQ(raster.collisionExists(40, 25, 3, true), obstacles->collisionExists(40, 25, 3, true));
+    auto between = raster.collisionExists(2.5, 0, 0, false);
+    EXPECT_GE(between, fmin(obstacles->collisionExists(0, 0, 0, false), obstacles->collisionExists(5, 0, 0, false)) - 1e-6);
+    EXPECT_LE(between, fmax(obstacles->collisionExists(0, 0, 0, false), obstacles->collisionExists(5, 0, 0, false)) + 1e-6);
+    // outside the window goes to the source
+    EXPECT_DOUBLE_EQ(raster.collisionExists(0, 0, 20, false), obstacles->collisionExists(0, 0, 20, false));
+    EXPECT_DOUBLE_EQ(raster.collisionExists(100, 0, 1, false), obstacles->collisionExists(100, 0, 1, false));
+    // the bounds still hold for the smeared costs
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<> coordinate(-50, 50), time(0, 10);
+    for (int i = 0; i < 500; i++) {
+        auto x = coordinate(generator), y = coordinate(generator), t = time(generator);
+        if (raster.collisionExists(x, y, t, false) <= 0) continue;
+        EXPECT_DOUBLE_EQ(raster.distanceToNearestPossibleCollision(x, y, t, false), 0);
+        EXPECT_TRUE(raster.possibleCollision(x, y, x, y, t, t, false));
+    }
+    // and memory is bounded by coarsening the grid
+    ObstacleCostRaster coarse(obstacles, -50, 50, -50, 50, 0, 10, 1, 1, 20000);
+    EXPECT_LE(coarse.cells(), 20000);
+    EXPECT_GT(coarse.cellSize(), 1);
+}
+
 TEST(UnitTests, DerivedDynamicObstaclesTest) {
     BinaryDynamicObstaclesManager::SharedPtr b = std::make_shared<BinaryDynamicObstaclesManager>();
     b->update(1, 42, 42, 0, 1, 1, 5, 15);
@@ -237,6 +769,52 @@ TEST(UnitTests, GaussianDynamicObstacleTest1) {
     }
 }
 
+TEST(UnitTests, GaussianDynamicObstaclesCutoffTest) {
+    // the cutoff and precomputed kernels shouldn't change anything above the floor
+    GaussianDynamicObstaclesManager manager;
+    std::mt19937 generator(19);
+    std::uniform_real_distribution<> coordinate(-300, 300), heading(0, 2 * M_PI), speed(0, 5), spread(5, 60);
+    for (uint32_t i = 0; i < 50; i++) {
+        Eigen::Matrix<double, 2, 2> covariance;
+        auto a = spread(generator), b = spread(generator);
+        covariance << a, sqrt(a * b) / 3, sqrt(a * b) / 3, b;
+        manager.update(i, coordinate(generator), coordinate(generator), heading(generator), speed(generator), 0,
+                covariance);
+    }
+    EXPECT_DOUBLE_EQ(manager.maxObstacleSpeed(), std::max_element(manager.get().begin(), manager.get().end(),
+            [](const std::pair<const uint32_t, GaussianDynamicObstaclesManager::Obstacle>& o1,
+               const std::pair<const uint32_t, GaussianDynamicObstaclesManager::Obstacle>& o2) {
+        return o1.second.Speed < o2.second.Speed; })->second.Speed);
+    std::uniform_real_distribution<> time(0, 30);
+    int nonZero = 0;
+    for (int i = 0; i < 5000; i++) {
+        double x = coordinate(generator), y = coordinate(generator), t = time(generator);
+        double expected = 0;
+        for (auto o : manager.get()) {
+            o.second.project(t);
+            auto covariance = o.second.covariance;
+            double quadform = (Eigen::Vector2d(x, y) - o.second.mean).transpose() * covariance.inverse() *
+                    (Eigen::Vector2d(x, y) - o.second.mean);
+            expected += exp(-0.5 * quadform) / (2 * M_PI) / sqrt(covariance.determinant());
+        }
+        if (expected < 1e-5) expected = 0;
+        auto actual = manager.collisionExists(x, y, t, true);
+        nonZero += actual > 0;
+        EXPECT_NEAR(actual, expected, 1e-5);
+        if (actual > 0) {
+            EXPECT_NEAR(actual, expected, 1e-6);
+        }
+        // nothing can be closer than the bound says
+        auto bound = manager.distanceToNearestPossibleCollision(x, y, t, true);
+        if (actual > 0) {
+            EXPECT_DOUBLE_EQ(bound, 0);
+        }
+        EXPECT_GE(bound, 0);
+    }
+    EXPECT_GT(nonZero, 100);
+    EXPECT_DOUBLE_EQ(GaussianDynamicObstaclesManager().distanceToNearestPossibleCollision(0, 0, 0, true), DBL_MAX);
+}
+
 TEST(UnitTests, GeoTiffMapTest1) {
     GeoTiffMap map("../../../src/mbes_sim/data/US5NH02M.tiff", -70.71054174878898, 43.073397415457535);
 }
@@ -282,6 +860,341 @@ TEST(UnitTests, PepperrellCoveTest) {
     std::cout << endl;
 }
 
+TEST(UnitTests, OccupancyGridTest) {
+    // big enough that rows straddle bitset words
+    const size_t cols = 37, rows = 11;
+    std::vector<float> depths(cols * rows);
+    for (size_t i = 0; i < depths.size(); i++) depths[i] = (float)((i * 7) % 5) - 1;
+    OccupancyGrid grid(depths, cols, rows, 0);
+    size_t expectedBlocked = 0;
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < cols; col++) {
+            auto depth = depths[row * cols + col];
+            expectedBlocked += depth <= 0;
+            EXPECT_EQ(grid.cellBlocked(col, row), depth <= 0);
+            EXPECT_EQ(grid.blockedAt(col + 0.5, row + 0.99), depth <= 0);
+            EXPECT_EQ(grid.valueAt(col + 0.5, row, 42), depth);
+        }
+    }
+    EXPECT_EQ(grid.blockedCount(), expectedBlocked);
+    // off the grid is blocked, NaN included
+    EXPECT_TRUE(grid.blockedAt(-0.01, 1));
+    EXPECT_TRUE(grid.blockedAt(1, rows));
+    EXPECT_TRUE(grid.blockedAt(cols, 1));
+    EXPECT_TRUE(grid.blockedAt(NAN, 1));
+    EXPECT_EQ(grid.valueAt(-1, 1, 42), 42);
+    // and cells can be set by hand
+    OccupancyGrid bits(cols, rows);
+    EXPECT_EQ(bits.blockedCount(), 0);
+    bits.setBlocked(36, 1, true);
+    EXPECT_TRUE(bits.blockedAt(36.5, 1.5));
+    EXPECT_FALSE(bits.blockedAt(0, 2));
+    bits.setBlocked(36, 1, false);
+    EXPECT_EQ(bits.blockedCount(), 0);
+}
+
+TEST(UnitTests, BlockedRectanglesTest) {
+    std::mt19937 generator(12);
+    for (size_t cols : {1, 9, 70}) {
+        for (size_t rows : {1, 11, 40}) {
+            // a few blobs so there's something to merge
+            OccupancyGrid grid(cols, rows);
+            std::uniform_int_distribution<size_t> col(0, cols - 1), row(0, rows - 1), size(1, 8);
+            for (int i = 0; i < 4; i++) {
+                auto c = col(generator), r = row(generator), w = size(generator), h = size(generator);
+                for (auto y = r; y < std::min(rows, r + h); y++) for (auto x = c; x < std::min(cols, c + w); x++) grid.setBlocked(x, y, true);
+            }
+            std::vector<int> covered(cols * rows, 0);
+            auto rectangles = grid.blockedRectangles();
+            for (const auto& rectangle : rectangles) {
+                ASSERT_LE(rectangle.Col + rectangle.Cols, cols);
+                ASSERT_LE(rectangle.Row + rectangle.Rows, rows);
+                for (auto y = rectangle.Row; y < rectangle.Row + rectangle.Rows; y++) {
+                    for (auto x = rectangle.Col; x < rectangle.Col + rectangle.Cols; x++) covered[y * cols + x]++;
+                }
+            }
+            for (size_t y = 0; y < rows; y++) {
+                for (size_t x = 0; x < cols; x++) EXPECT_EQ(covered[y * cols + x], grid.cellBlocked(x, y) ? 1 : 0);
+            }
+            EXPECT_LE(rectangles.size(), grid.blockedCount());
+        }
+    }
+    // a solid block is one rectangle
+    OccupancyGrid grid(10, 10);
+    for (size_t y = 2; y < 7; y++) for (size_t x = 3; x < 9; x++) grid.setBlocked(x, y, true);
+    auto rectangles = grid.blockedRectangles();
+    ASSERT_EQ(rectangles.size(), 1);
+    EXPECT_EQ(rectangles[0].Col, 3);
+    EXPECT_EQ(rectangles[0].Row, 2);
+    EXPECT_EQ(rectangles[0].Cols, 6);
+    EXPECT_EQ(rectangles[0].Rows, 5);
+}
+
+TEST(UnitTests, DistanceFieldTest) {
+    const size_t cols = 41, rows = 23;
+    OccupancyGrid grid(cols, rows);
+    std::mt19937 generator(5);
+    std::uniform_int_distribution<size_t> col(0, cols - 1), row(0, rows - 1);
+    std::vector<std::pair<size_t, size_t>> blocked;
+    for (int i = 0; i < 12; i++) {
+        blocked.emplace_back(col(generator), row(generator));
+        grid.setBlocked(blocked.back().first, blocked.back().second, true);
+    }
+    DistanceField field(grid, 3);
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            double best = INFINITY;
+            for (const auto& b : blocked) best = fmin(best, hypot((double)c - b.first, (double)r - b.second));
+            EXPECT_NEAR(field.cellDistance(c, r), best, 1e-4);
+        }
+    }
+    // lower bounds on the distance to the nearest blocked cell or the edge
+    std::uniform_real_distribution<> x(0, cols), y(0, rows);
+    for (int i = 0; i < 1000; i++) {
+        auto px = x(generator), py = y(generator);
+        auto best = fmin(fmin(px, cols - px), fmin(py, rows - py));
+        for (const auto& b : blocked) {
+            auto dx = fmax(fmax(b.first - px, px - (b.first + 1.0)), 0);
+            auto dy = fmax(fmax(b.second - py, py - (b.second + 1.0)), 0);
+            best = fmin(best, sqrt(dx * dx + dy * dy));
+        }
+        EXPECT_LE(field.distanceToBlocked(px, py), best + 1e-9);
+    }
+    EXPECT_EQ(field.distanceToBlocked(-1, 2), 0);
+    EXPECT_EQ(field.distanceToBlocked(blocked[0].first + 0.5, blocked[0].second + 0.5), 0);
+    // and with nothing blocked it's just the edges
+    DistanceField open(OccupancyGrid(cols, rows), 2);
+    EXPECT_TRUE(std::isinf(open.cellDistance(3, 3)));
+    EXPECT_DOUBLE_EQ(open.distanceToBlocked(10, 5), 5);
+}
+
+TEST(UnitTests, MapClearanceTest) {
+    // a wall down the middle of a 1m grid
+    const size_t cols = 60, rows = 40;
+    OccupancyGrid grid(cols, rows);
+    for (size_t r = 0; r < rows; r++) for (size_t c = 30; c < 34; c++) grid.setBlocked(c, r, true);
+    DistanceField field(grid, 2);
+    GridWorldMap map(1, grid, field);
+    double d, gx, gy;
+    ASSERT_TRUE(map.clearance(24.5, 20.5, d, gx, gy));
+    // between cell centres it's in between, and it gets bigger away from the wall
+    EXPECT_NEAR(d, 6, 1e-9);
+    EXPECT_NEAR(gx, -1, 1e-9);
+    EXPECT_NEAR(gy, 0, 1e-9);
+    ASSERT_TRUE(map.clearance(24, 20, d, gx, gy));
+    EXPECT_NEAR(d, 6.5, 1e-9);
+    ASSERT_TRUE(map.clearance(40, 20, d, gx, gy));
+    EXPECT_NEAR(d, 6.5, 1e-9);
+    EXPECT_NEAR(gx, 1, 1e-9);
+    // off the map there's nothing to go on
+    ASSERT_TRUE(map.clearance(-3, 20, d, gx, gy));
+    EXPECT_EQ(d, 0);
+    EXPECT_EQ(gx, 0);
+    // maps without a field can't say, and the empty map is clear everywhere
+    EXPECT_FALSE(GridWorldMap(1, grid, DistanceField()).clearance(24, 20, d, gx, gy));
+    EXPECT_TRUE(Map().clearance(24, 20, d, gx, gy));
+    EXPECT_EQ(d, DBL_MAX);
+}
+
+TEST(UnitTests, PotentialFieldsDistanceFieldTest) {
+    // heading up a line that runs alongside a wall, a couple of metres from it
+    const size_t cols = 60, rows = 120;
+    OccupancyGrid grid(cols, rows);
+    for (size_t r = 0; r < rows; r++) for (size_t c = 30; c < 34; c++) grid.setBlocked(c, r, true);
+    auto map = std::make_shared<GridWorldMap>(0.5, grid, DistanceField(grid, 2));
+    RibbonManager ribbonManager;
+    ribbonManager.add(13, 10, 13, 55);
+    auto config = plannerConfig;
+    config.setVisualizations(false);
+    config.setMap(map);
+    config.setObstaclesManager(std::make_shared<BinaryDynamicObstaclesManager>());
+    State start(13, 5, 0, 2.5, 1);
+    for (bool useField : {false, true}) {
+        config.setPotentialFieldsUseDistanceField(useField);
+        PotentialFieldsPlanner planner;
+        auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 1).Plan;
+        ASSERT_FALSE(plan.empty()) << useField;
+        for (auto s : plan.getHalfSecondSamples()) {
+            EXPECT_FALSE(map->isBlocked(s.x(), s.y())) << useField;
+            EXPECT_LT(s.x(), 15) << useField;
+        }
+        // both ways the wall pushes it away first
+        State next;
+        next.time() = start.time() + 1;
+        plan.sample(next);
+        EXPECT_LT(next.x(), start.x() - 1) << useField;
+    }
+}
+
+TEST(UnitTests, PotentialFieldsScanTest) {
+    // scanning the map cell by cell, the wall's push adds to the line's pull rather than replacing it
+    const size_t cols = 60, rows = 120;
+    OccupancyGrid grid(cols, rows);
+    // a thin wall a few metres off the line, so the two are about as strong as each other
+    for (size_t r = 0; r < rows; r++) grid.setBlocked(30, r, true);
+    auto map = std::make_shared<GridWorldMap>(0.5, grid, DistanceField(grid, 2));
+    RibbonManager ribbonManager;
+    ribbonManager.add(10, 40, 10, 55);
+    auto config = plannerConfig;
+    config.setVisualizations(false);
+    config.setMap(map);
+    config.setObstaclesManager(std::make_shared<BinaryDynamicObstaclesManager>());
+    config.setPotentialFieldsUseDistanceField(false);
+    // (right by the start of the line, so it pulls as hard as it can, and far enough from the map's edges that off
+    // it, which counts as blocked, doesn't push too)
+    State start(10, 39.5, 0, 2.5, 1);
+    PotentialFieldsPlanner planner;
+    auto plan = planner.plan(ribbonManager, start, config, DubinsPlan(), 1).Plan;
+    ASSERT_FALSE(plan.empty());
+    // up the line (towards its far end) and away from the wall at once
+    State next;
+    next.time() = start.time() + 1;
+    plan.sample(next);
+    EXPECT_GT(next.y(), start.y() + 0.5);
+    EXPECT_LT(next.x(), start.x() - 0.5);
+}
+
+TEST(UnitTests, OccupancyPyramidTest) {
+    std::mt19937 generator(9);
+    for (size_t cols : {1, 7, 64, 101}) {
+        for (size_t rows : {1, 13, 70}) {
+            OccupancyGrid grid(cols, rows);
+            std::uniform_int_distribution<size_t> col(0, cols - 1), row(0, rows - 1);
+            for (int i = 0; i < 3; i++) grid.setBlocked(col(generator), row(generator), true);
+            OccupancyPyramid pyramid(grid);
+            for (int i = 0; i < 200; i++) {
+                auto c1 = col(generator), c2 = col(generator), r1 = row(generator), r2 = row(generator);
+                if (c1 > c2) std::swap(c1, c2);
+                if (r1 > r2) std::swap(r1, r2);
+                bool expected = false;
+                for (auto r = r1; r <= r2; r++) for (auto c = c1; c <= c2; c++) expected |= grid.cellBlocked(c, r);
+                EXPECT_EQ(pyramid.anyBlocked(c1, r1, c2, r2), expected);
+            }
+        }
+    }
+    // and through a map, where off the map counts as blocked
+    const std::string path = "/tmp/occupancy_pyramid_test.map";
+    {
+        std::ofstream file(path);
+        file << "2\n";
+        for (int i = 0; i < 20; i++) file << (i == 3 ? "_____#______________\n" : "____________________\n");
+    }
+    GridWorldMap map(path);
+    // rows are flipped so the line with the # is 16 cells up
+    EXPECT_TRUE(map.possiblyBlocked(8, 30, 14, 36));
+    EXPECT_TRUE(map.isBlocked(11, 33));
+    EXPECT_FALSE(map.possiblyBlocked(14, 0, 39, 39));
+    EXPECT_FALSE(map.possiblyBlocked(0, 0, 39, 29));
+    EXPECT_TRUE(map.possiblyBlocked(30, 30, 45, 35));
+    EXPECT_TRUE(map.possiblyBlocked(-1, 0, 5, 5));
+}
+
+TEST(UnitTests, MapBroadPhaseArcTest) {
+    // the map's broad phase uses the same swept box as the obstacles', so a turn that bulges out over land a little way
+    // off its chord still gets caught
+    OccupancyGrid grid(200, 200);
+    for (size_t r = 0; r < 200; r++) for (size_t c = 0; c < 97; c++) grid.setBlocked(c, r, true);
+    auto map = std::make_shared<GridWorldMap>(0.1, grid, DistanceField(grid, 2));
+    auto config = plannerConfig;
+    config.setStartStateTime(0);
+    config.setMap(map);
+    config.setObstaclesManager(std::make_shared<BinaryDynamicObstaclesManager>());
+    RibbonManager ribbonManager;
+    ribbonManager.add(1000, 0, 1000, 80);
+    // two seconds of turn with its chord up x = 10, 0.3m from the land, and the middle about 0.39m west of the chord
+    auto angle = 2 * config.maxSpeed() / config.turningRadius();
+    auto chord = 2 * config.turningRadius() * sin(angle / 2) + 1e-3;
+    State start(10, 5, 2 * M_PI - angle / 2, config.maxSpeed(), 0), end(10, 5 + chord, angle / 2, config.maxSpeed(), 0);
+    EXPECT_FALSE(map->possiblyBlocked(9.99, 5, 10, 5 + chord));
+    for (bool batched : {false, true}) {
+        config.setBatchedEdgeSweep(batched);
+        auto root = Vertex::makeRoot(start, ribbonManager);
+        root->computeApproxToGo(config);
+        auto v = Vertex::connect(root, end);
+        v->parentEdge()->computeTrueCost(config);
+        EXPECT_TRUE(v->parentEdge()->infeasible()) << batched;
+    }
+}
+
+TEST(UnitTests, MapCacheTest) {
+    const std::string path = "/tmp/map_cache_test.map";
+    auto writeMap = [&](int blockedRow) {
+        std::ofstream file(path);
+        file << "3\n";
+        for (int i = 0; i < 30; i++) file << (i == blockedRow ? "__________#########___________\n" : "______________________________\n");
+    };
+    writeMap(5);
+    MapCache cache("/tmp/map_cache_test");
+    GridWorldMap original(path);
+    cache.store(path, original);
+    auto cached = cache.load(path);
+    ASSERT_NE(cached, nullptr);
+    std::mt19937 generator(4);
+    std::uniform_real_distribution<double> coordinate(-5, 95);
+    for (int i = 0; i < 500; i++) {
+        auto x = coordinate(generator), y = coordinate(generator);
+        EXPECT_EQ(cached->isBlocked(x, y), original.isBlocked(x, y));
+        EXPECT_EQ(cached->distanceToBlocked(x, y), original.distanceToBlocked(x, y));
+        EXPECT_EQ(cached->possiblyBlocked(x, y, x + 10, y + 10), original.possiblyBlocked(x, y, x + 10, y + 10));
+    }
+    // changing the source makes the entry stale
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    writeMap(20);
+    EXPECT_EQ(cache.load(path), nullptr);
+    EXPECT_EQ(cache.load("/tmp/map_cache_test_missing.map"), nullptr);
+}
+
+TEST(UnitTests, TileCacheTest) {
+    std::vector<std::pair<size_t, size_t>> loaded;
+    TileCache cache(2, [&](size_t tileCol, size_t tileRow) {
+        loaded.emplace_back(tileCol, tileRow);
+        // a tile that remembers where it came from in its values
+        return OccupancyGrid(std::vector<float>(4, (float)(tileCol * 10 + tileRow)), 2, 2, 0);
+    });
+    EXPECT_EQ(cache.get(1, 2)->valueAt(0, 0, -1), 12);
+    EXPECT_EQ(cache.get(1, 2)->valueAt(1, 1, -1), 12);
+    EXPECT_EQ(cache.loads(), 1);
+    auto held = cache.get(3, 0);
+    EXPECT_EQ(cache.residentCount(), 2);
+    // (1, 2) was used longest ago, so it's the one to go
+    cache.get(1, 2);
+    cache.get(0, 0);
+    EXPECT_TRUE(cache.resident(1, 2));
+    EXPECT_FALSE(cache.resident(3, 0));
+    EXPECT_EQ(cache.residentCount(), 2);
+    // but anyone still holding it can keep using it
+    EXPECT_EQ(held->valueAt(0, 1, -1), 30);
+    cache.get(3, 0);
+    EXPECT_EQ(cache.loads(), 4);
+    EXPECT_EQ(loaded.back(), std::make_pair((size_t)3, (size_t)0));
+    // shrinking it drops the ones used longest ago
+    cache.setCapacity(1);
+    EXPECT_EQ(cache.residentCount(), 1);
+    EXPECT_TRUE(cache.resident(3, 0));
+    EXPECT_THROW(cache.setCapacity(0), std::invalid_argument);
+
+    // a slow load doesn't hold up lookups of tiles that are already there
+    std::promise<void> loading, release;
+    auto released = release.get_future().share();
+    TileCache slow(4, [&](size_t tileCol, size_t tileRow) {
+        if (tileCol == 9) {
+            loading.set_value();
+            released.wait();
+        }
+        return OccupancyGrid(std::vector<float>(4, (float)tileCol), 2, 2, 0);
+    });
+    slow.get(0, 0);
+    slow.get(1, 0);
+    std::thread loader([&] { slow.get(9, 0); });
+    loading.get_future().wait();
+    auto lookup = std::async(std::launch::async, [&] { return slow.get(0, 0)->valueAt(0, 0, -1); });
+    EXPECT_EQ(lookup.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    release.set_value();
+    loader.join();
+    EXPECT_EQ(lookup.get(), 0);
+    EXPECT_EQ(slow.loads(), 3);
+}
+
 void visualizePath(const State& s1, const State& s2, const State& s3, double turningRadius) {
     RibbonManager ribbonManager;
     ribbonManager.add(0, 0, 1000, 0);
@@ -448,6 +1361,171 @@ TEST(UnitTests, SimpleDubinsTest) {
     EXPECT_NEAR(plan.getEndTime(), s2.time(), 1e-5);
 }
 
+TEST(UnitTests, DubinsSamplerTest) {
+    std::mt19937 generator(30);
+    std::uniform_real_distribution<double> coordinate(-100, 100), heading(0, 2 * M_PI), radius(2, 20);
+    for (int i = 0; i < 200; i++) {
+        State s1(coordinate(generator), coordinate(generator), heading(generator), 2.5, 3);
+        State s2(coordinate(generator), coordinate(generator), heading(generator), 2.5, 0);
+        DubinsWrapper wrapper(s1, s2, radius(generator));
+        auto timeStep = 0.05 + i % 7 * 0.11;
+        DubinsWrapper::Sampler sampler(wrapper, wrapper.getStartTime(), timeStep);
+        State expected, actual;
+        size_t steps = 0, skip = 1;
+        while (sampler.time() < wrapper.getEndTime()) {
+            expected.time() = sampler.time();
+            wrapper.sample(expected);
+            sampler.sample(actual);
+            EXPECT_EQ(actual.time(), expected.time());
+            EXPECT_NEAR(actual.x(), expected.x(), 1e-6);
+            EXPECT_NEAR(actual.y(), expected.y(), 1e-6);
+            EXPECT_NEAR(fabs(actual.headingDifference(expected)), 0, 1e-6);
+            EXPECT_EQ(actual.speed(), expected.speed());
+            // mostly single steps, with a skip every so often
+            skip = ++steps % 10 == 0 ? 1 + steps % 13 : 1;
+            sampler.advance(skip);
+        }
+        // and in bulk
+        auto samples = wrapper.getSamples(timeStep, 0);
+        ASSERT_EQ(samples.size(), (size_t)ceil(wrapper.getNetTime() / timeStep));
+        for (const auto& s : samples) {
+            expected.time() = s.time();
+            wrapper.sample(expected);
+            EXPECT_NEAR(s.distanceTo(expected), 0, 1e-6);
+        }
+    }
+    // plans step through each of their paths
+    DubinsPlan plan;
+    State s1(0, 0, 0, 2, 1), s2(30, 40, M_PI, 2, 0), s3(-20, 10, M_PI_2, 2, 0);
+    plan.append(DubinsWrapper(s1, s2, 8));
+    s2.time() = plan.getEndTime();
+    plan.append(DubinsWrapper(s2, s3, 8));
+    auto samples = plan.getHalfSecondSamples();
+    ASSERT_EQ(samples.size(), (size_t)ceil(plan.totalTime() / DubinsPlan::planTimeDensity()));
+    for (size_t i = 0; i < samples.size(); i++) {
+        State expected;
+        expected.time() = plan.getStartTime() + i * DubinsPlan::planTimeDensity();
+        plan.sample(expected);
+        EXPECT_NEAR(samples[i].time(), expected.time(), 1e-9);
+        EXPECT_NEAR(samples[i].distanceTo(expected), 0, 1e-6);
+    }
+}
+
+TEST(UnitTests, DubinsPlanLookupTest) {
+    std::mt19937 generator(31);
+    std::uniform_real_distribution<double> coordinate(-100, 100), heading(0, 2 * M_PI);
+    // a long chain of paths, sampled the old way by scanning for the first one with the time
+    DubinsPlan plan;
+    State s(0, 0, 0, 2, 10);
+    for (int i = 0; i < 100; i++) {
+        State next(coordinate(generator), coordinate(generator), heading(generator), 2, 0);
+        DubinsWrapper wrapper(s, next, 8);
+        plan.append(wrapper);
+        s = next;
+        s.time() = wrapper.getEndTime();
+    }
+    auto scan = [&](State& state) {
+        for (const auto& p : plan.get()) {
+            if (p.containsTime(state.time())) {
+                p.sample(state);
+                return true;
+            }
+        }
+        return false;
+    };
+    DubinsPlan::Cursor cursor(plan);
+    std::uniform_real_distribution<double> time(plan.getStartTime() - 5, plan.getEndTime() + 5);
+    std::vector<double> times;
+    for (const auto& p : plan.get()) times.push_back(p.getStartTime());
+    for (int i = 0; i < 500; i++) times.push_back(time(generator));
+    // mostly forwards, but with some jumps back for the cursor
+    std::sort(times.begin(), times.begin() + times.size() * 3 / 4);
+    for (auto t : times) {
+        State expected, actual, fromCursor;
+        expected.time() = actual.time() = fromCursor.time() = t;
+        auto contained = scan(expected);
+        EXPECT_EQ(plan.containsTime(t), contained);
+        EXPECT_EQ(cursor.containsTime(t), contained);
+        if (contained) {
+            plan.sample(actual);
+            cursor.sample(fromCursor);
+            EXPECT_EQ(actual.x(), expected.x());
+            EXPECT_EQ(actual.heading(), expected.heading());
+            EXPECT_NEAR(fromCursor.distanceTo(expected), 0, 1e-9);
+        } else {
+            EXPECT_THROW(plan.sample(actual), std::runtime_error);
+            EXPECT_THROW(cursor.sample(fromCursor), std::runtime_error);
+        }
+    }
+    // dropping the past keeps the lookups working
+    auto middle = plan.get()[50].getStartTime() + 0.1;
+    plan.changeIntoSuffix(middle);
+    EXPECT_EQ(plan.get().size(), 50);
+    EXPECT_FALSE(plan.containsTime(middle - 1));
+    State state;
+    state.time() = middle;
+    State expected = state;
+    plan.sample(state);
+    scan(expected);
+    EXPECT_EQ(state.x(), expected.x());
+}
+
+TEST(UnitTests, DubinsBatchTest) {
+    std::mt19937 generator(32);
+    std::uniform_real_distribution<double> coordinate(-60, 60), heading(0, 2 * M_PI);
+    for (double rho : {4.0, 8.0, 25.0}) {
+        State start(coordinate(generator), coordinate(generator), heading(generator), 2, 0);
+        std::vector<State> goals;
+        for (int i = 0; i < 150; i++) goals.emplace_back(coordinate(generator), coordinate(generator), heading(generator), 2, 0);
+        // on top of the start, straight ahead and straight behind, too
+        goals.push_back(start);
+        goals.emplace_back(start.x() + 10 * sin(start.heading()), start.y() + 10 * cos(start.heading()), start.heading(), 2, 0);
+        goals.emplace_back(start.x() - 10 * sin(start.heading()), start.y() - 10 * cos(start.heading()), start.heading(), 2, 0);
+        DubinsBatch batch(start, rho);
+        std::vector<double> lengths(goals.size());
+        std::vector<int> words(goals.size());
+        batch.solve(goals.data(), goals.size(), lengths.data(), words.data());
+        for (size_t i = 0; i < goals.size(); i++) {
+            DubinsWrapper expected(start, goals[i], rho);
+            EXPECT_NEAR(lengths[i], expected.length(), 1e-6);
+            DubinsPath path;
+            ASSERT_TRUE(batch.path(goals[i], words[i], path));
+            EXPECT_NEAR(dubins_path_length(&path), lengths[i], 1e-6);
+        }
+        // handing it the trig gets the same answers
+        std::vector<double> goalCos, goalSin, trigLengths(goals.size());
+        std::vector<int> trigWords(goals.size());
+        for (const auto& g : goals) {
+            goalCos.push_back(cos(g.yaw()));
+            goalSin.push_back(sin(g.yaw()));
+        }
+        batch.solve(goals.data(), goalCos.data(), goalSin.data(), goals.size(), trigLengths.data(), trigWords.data());
+        EXPECT_EQ(trigLengths, lengths);
+        EXPECT_EQ(trigWords, words);
+    }
+}
+
+TEST(UnitTests, DubinsLowerBoundTest) {
+    std::mt19937 generator(33);
+    std::uniform_real_distribution<double> coordinate(-50, 50), heading(0, 2 * M_PI), radius(1, 30);
+    int tight = 0;
+    for (int i = 0; i < 2000; i++) {
+        State s1(coordinate(generator), coordinate(generator), heading(generator), 2, 0);
+        State s2(coordinate(generator), coordinate(generator), heading(generator), 2, 0);
+        auto rho = radius(generator);
+        auto bound = DubinsBatch::lowerBound(s1, s2, rho);
+        auto length = DubinsWrapper(s1, s2, rho).length();
+        EXPECT_LE(bound, length + 1e-9);
+        EXPECT_GE(bound, s1.distanceTo(s2));
+        if (bound > 0.9 * length) tight++;
+    }
+    // it's no use if it's never close
+    EXPECT_GT(tight, 200);
+    // turning around on the spot takes half a circle
+    State s(0, 0, 0, 2, 0), back(0, 0, M_PI, 2, 0);
+    EXPECT_NEAR(DubinsBatch::lowerBound(s, back, 5), 5 * M_PI, 1e-9);
+}
+
 TEST(UnitTests, DubinsReverseTest) {
 
 }
@@ -741,6 +1819,102 @@ TEST(UnitTests, RibbonManagerCoverBetweenTest) {
     ribbonManager.coverBetween(134.778, 62.1946, 133.708, 61.8953, false);
 }
 
+TEST(UnitTests, RibbonManagerCoverAlongTest) {
+    // covering a whole line at once does what covering closely spaced points along it would
+    RibbonManager::setRibbonWidth(1.5);
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 0, 100, 0);
+    EXPECT_DOUBLE_EQ(1, ribbonManager.coverAlong(-5, 0.1, 40, 0.1, true));
+    ASSERT_EQ(1, ribbonManager.get().size());
+    EXPECT_NEAR(40, ribbonManager.get()[0].start().first, 1e-9);
+    // straight across it just cuts it in two
+    ribbonManager.coverAlong(50, -10, 50, 10, true);
+    ASSERT_EQ(2, ribbonManager.get().size());
+    EXPECT_NEAR(50, ribbonManager.get()[0].end().first, 1e-9);
+    EXPECT_NEAR(50, ribbonManager.get()[1].start().first, 1e-9);
+    // alongside but too far off doesn't change anything, and leaves the ribbons shared
+    auto copy = ribbonManager;
+    EXPECT_EQ(-1, copy.coverAlong(0, 1, 100, 1, true));
+    EXPECT_TRUE(copy.sameRibbonsAs(ribbonManager));
+    // off the end of the ribbon part way along the line, which it's done with once there's less than the minimum left
+    EXPECT_NEAR((100 - Ribbon::minLength() / 2 - 60) / 100, ribbonManager.coverAlong(60, 0, 160, 0, true), 1e-9);
+    ASSERT_EQ(2, ribbonManager.get().size());
+    EXPECT_NEAR(60, ribbonManager.get()[1].end().first, 1e-9);
+    // leaving less than the minimum length counts as covering it
+    ribbonManager.coverAlong(41, 0, 59, 0, true);
+    EXPECT_TRUE(ribbonManager.done());
+}
+
+TEST(UnitTests, SurveyOrderTest) {
+    RibbonManager::setRibbonWidth(1.5);
+    // a lawnmower survey, ordered from near the bottom of the first line
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    for (int i = 0; i < 50; i++) ribbonManager.add(i * 10, 0, i * 10, 100);
+    SurveyOrder order(ribbonManager, -5, -5);
+    ASSERT_EQ(50, order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        EXPECT_DOUBLE_EQ(order[i].start().first, i * 10);
+        // back and forth
+        EXPECT_DOUBLE_EQ(order[i].start().second, i % 2 == 0? 0 : 100);
+    }
+    // part way along the first line
+    ribbonManager.coverBetween(0, 0, 0, 40, false);
+    auto view = order.localView(ribbonManager, 3);
+    ASSERT_EQ(3, view.get().size());
+    EXPECT_NEAR(60, view.get()[0].length(), 1e-9);
+    EXPECT_DOUBLE_EQ(20, view.get()[2].start().first);
+    // the other 47 lines, and the 47 hops between them (the first one is from the end of the last local one)
+    EXPECT_NEAR(47 * 100 + 46 * 10, view.remainderCost(), 1e-9);
+    EXPECT_FALSE(view.done());
+    // the heuristic goes over to the rest once it's done with the local ones
+    auto local = view.subset({0, 1, 2});
+    local.setRemainder(0, 0, 0);
+    EXPECT_NEAR(view.approximateDistanceUntilDone(0, 40, 0),
+                local.approximateDistanceUntilDone(0, 40, 0) + 10 + view.remainderCost(), 1e-9);
+    auto finished = view.subset({});
+    EXPECT_TRUE(finished.get().empty());
+    EXPECT_FALSE(finished.done());
+    EXPECT_NEAR(finished.approximateDistanceUntilDone(30, 50, 0), 50 + view.remainderCost(), 1e-9);
+    EXPECT_NE(finished.heuristicKey(), RibbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2).heuristicKey());
+    // the first line's gone now, and a ribbon added since gets in whatever its place
+    ribbonManager.coverBetween(0, 40, 0, 110, false);
+    ribbonManager.add(1000, 1000, 1000, 1100);
+    view = order.localView(ribbonManager, 3);
+    ASSERT_EQ(4, view.get().size());
+    EXPECT_DOUBLE_EQ(10, view.get()[0].start().first);
+    EXPECT_DOUBLE_EQ(1000, view.get()[3].start().first);
+    // all of it when there's no more than that
+    view = order.localView(ribbonManager, 100);
+    EXPECT_EQ(ribbonManager.get().size(), view.get().size());
+    EXPECT_EQ(0, view.remainderCost());
+}
+
+TEST(UnitTests, RibbonManagerCopyOnWriteTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 0, 0, 50);
+    ribbonManager.add(10, 0, 10, 50);
+    auto copy = ribbonManager;
+    // copies share ribbons until one of them changes
+    EXPECT_EQ(&ribbonManager.get(), &copy.get());
+    copy.cover(100, 100, true);
+    EXPECT_EQ(&ribbonManager.get(), &copy.get());
+    copy.cover(0, 20, true);
+    EXPECT_NE(&ribbonManager.get(), &copy.get());
+    EXPECT_EQ(ribbonManager.get().size(), 2);
+    EXPECT_EQ(copy.get().size(), 3);
+    EXPECT_DOUBLE_EQ(ribbonManager.getTotalUncoveredLength(), 100);
+    // the original still covers the same way it would have
+    auto copy2 = ribbonManager;
+    ribbonManager.cover(0, 20, true);
+    EXPECT_EQ(ribbonManager.dumpRibbons(), copy.dumpRibbons());
+    EXPECT_EQ(copy2.get().size(), 2);
+    // default constructed managers are empty and independent
+    RibbonManager a, b;
+    a.add(0, 0, 10, 0);
+    EXPECT_TRUE(b.done());
+    EXPECT_FALSE(a.done());
+}
+
 TEST(Benchmarks, RibbonsTSPBenhcmark) {
     auto overallStart = std::chrono::system_clock::now();
     StateGenerator generator(-5000, -5000, 5000, 5000, 0, 0, 19);
@@ -904,6 +2078,673 @@ TEST(UnitTests, RunStateGenerationTest) {
     sleep(1); // ??
 }
 
+TEST(UnitTests, RibbonManagerSameRibbonsTest) {
+    RibbonManager r1;
+    r1.add(0, 0, 0, 20);
+    r1.add(10, 0, 10, 20);
+    auto r2 = r1;
+    EXPECT_TRUE(r1.sameRibbonsAs(r2));
+    r2.cover(0, 10, false);
+    EXPECT_FALSE(r1.sameRibbonsAs(r2));
+    auto r3 = r1;
+    r3.cover(0, 10, false);
+    // separate copies that ended up the same
+    EXPECT_TRUE(r2.sameRibbonsAs(r3));
+}
+
+TEST(UnitTests, WorkerPoolTest) {
+    WorkerPool pool(4);
+    EXPECT_EQ(pool.threads(), 4);
+    std::vector<int> results(1000, 0);
+    // run a few batches to make sure the workers go back to sleep and wake up properly
+    for (int batch = 1; batch <= 3; batch++) {
+        pool.parallelFor(results.size(), [&](size_t i) { results[i] += (int)i * batch; });
+    }
+    for (size_t i = 0; i < results.size(); i++) EXPECT_EQ(results[i], (int)i * 6);
+    EXPECT_THROW(pool.parallelFor(10, [](size_t i) { if (i == 5) throw std::runtime_error("bad task"); }),
+            std::runtime_error);
+    // still usable after an exception
+    int count = 0;
+    std::mutex mutex;
+    pool.parallelFor(10, [&](size_t) { std::lock_guard<std::mutex> lock(mutex); count++; });
+    EXPECT_EQ(count, 10);
+}
+
+TEST(UnitTests, LatestTaskWorkerTest) {
+    LatestTaskWorker worker;
+    std::mutex mutex;
+    std::vector<std::string> ran;
+    std::atomic<bool> started(false), submitted(false);
+    // runs until it's told to stop (and the others are all in)
+    worker.submit([&](const std::atomic<bool>& cancelled) {
+        started = true;
+        while (!cancelled || !submitted) std::this_thread::yield();
+        std::lock_guard<std::mutex> lock(mutex);
+        ran.emplace_back("first (cancelled)");
+    });
+    while (!started) std::this_thread::yield();
+    // a burst of requests while that's going: only the last one should run
+    for (const auto& name : {"second", "third"}) {
+        std::string n(name);
+        worker.submit([&, n](const std::atomic<bool>& cancelled) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ran.push_back(n + (cancelled? " (cancelled)" : ""));
+        });
+    }
+    submitted = true;
+    worker.wait();
+    ASSERT_EQ(ran.size(), 2);
+    EXPECT_EQ(ran[0], "first (cancelled)");
+    EXPECT_EQ(ran[1], "third");
+    EXPECT_EQ(worker.superseded(), 1);
+    // and a throwing task doesn't take the worker down with it
+    worker.submit([](const std::atomic<bool>&) { throw std::runtime_error("bad map"); });
+    worker.submit([&](const std::atomic<bool>&) { std::lock_guard<std::mutex> lock(mutex); ran.emplace_back("fourth"); });
+    worker.wait();
+    EXPECT_EQ(ran.back(), "fourth");
+}
+
+TEST(UnitTests, CycleSchedulerTest) {
+    CycleScheduler scheduler(1, 0.5, 0);
+    // nothing measured yet, so planning gets the whole cycle
+    EXPECT_DOUBLE_EQ(scheduler.planningBudget(10, 10), 1);
+    EXPECT_DOUBLE_EQ(scheduler.handoffTime(10), 11);
+    // first measurement is taken as is, then it's smoothed
+    scheduler.record(CycleScheduler::Publish, 0.2);
+    EXPECT_DOUBLE_EQ(scheduler.estimate(CycleScheduler::Publish), 0.2);
+    scheduler.record(CycleScheduler::Publish, 0.4);
+    EXPECT_DOUBLE_EQ(scheduler.estimate(CycleScheduler::Publish), 0.3);
+    scheduler.record(CycleScheduler::PlanOverrun, 0.1);
+    scheduler.record(CycleScheduler::Cover, 0.5);
+    // phases before planning are already over so they don't come out of the budget
+    EXPECT_NEAR(scheduler.planningBudget(10, 10.1), 0.5, 1e-9);
+    EXPECT_NEAR(scheduler.handoffTime(10), 10.7, 1e-9);
+    EXPECT_DOUBLE_EQ(scheduler.planningBudget(10, 10.9), 0);
+    EXPECT_DOUBLE_EQ(scheduler.finishCycle(10, 10.95), 0);
+    EXPECT_NEAR(scheduler.finishCycle(11, 12.25), 0.25, 1e-9);
+    EXPECT_EQ(scheduler.cycles(), 2);
+    EXPECT_EQ(scheduler.missedDeadlines(), 1);
+}
+
+TEST(UnitTests, ProfilerTest) {
+    auto spin = [] {
+        volatile double x = 0;
+        for (int i = 0; i < 200000; i++) x += i;
+    };
+    // without a profiler attached scopes don't go anywhere
+    EXPECT_EQ(Profiler::current(), nullptr);
+    {
+        Profiler::Scope scope(Profiler::Heap);
+        spin();
+    }
+    Profiler profiler;
+    {
+        Profiler::Attach attach(&profiler);
+        EXPECT_EQ(Profiler::current(), Profiler::c_Enabled ? &profiler : nullptr);
+        // enough calls that some of them get their CPU time sampled
+        for (unsigned i = 0; i < 2 * Profiler::c_CpuSampleInterval; i++) {
+            Profiler::Scope outer(Profiler::Nearest);
+            spin();
+            EXPECT_TRUE(Profiler::measure(Profiler::Dubins, [] { return true; }));
+            outer.stop();
+            spin();
+        }
+        // worker pool threads count towards the same plan
+        WorkerPool pool(3);
+        pool.parallelFor(8, [](size_t) { Profiler::Scope scope(Profiler::MapChecks); });
+    }
+    EXPECT_EQ(Profiler::current(), nullptr);
+    auto report = profiler.report();
+    if (Profiler::c_Enabled) {
+        EXPECT_EQ(report[Profiler::Nearest].Calls, 2 * Profiler::c_CpuSampleInterval);
+        EXPECT_GT(report[Profiler::Nearest].WallTime, 0);
+        EXPECT_GT(report[Profiler::Nearest].CpuTime, 0);
+        // the spinning after stop() doesn't count
+        EXPECT_LT(report[Profiler::Nearest].CpuTime, Profiler::threadCpuTime());
+        EXPECT_EQ(report[Profiler::Dubins].Calls, 2 * Profiler::c_CpuSampleInterval);
+        EXPECT_EQ(report[Profiler::MapChecks].Calls, 8);
+    } else {
+        for (const auto& phase : report) EXPECT_EQ(phase.Calls, 0);
+    }
+    EXPECT_EQ(report[Profiler::Heap].Calls, 0);
+    EXPECT_STREQ(Profiler::phaseName(Profiler::ObstacleChecks), "obstacle checks");
+
+    auto cpu = Profiler::threadCpuTime();
+    spin();
+    EXPECT_GT(Profiler::threadCpuTime(), cpu);
+}
+
+TEST(UnitTests, AllocationCountingTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    Profiler profiler;
+    {
+        Profiler::Attach attach(&profiler);
+        auto root = Vertex::makeRoot(State(0, 0, 0, 2.5, 1), ribbonManager);
+        auto v = Vertex::connect(root, State(0, 20, 0, 2.5, 9));
+        // moving doesn't count, copying does
+        auto copy = ribbonManager;
+        auto moved = std::move(copy);
+        // covering part of a shared store copies it first
+        moved.cover(0, 20, false);
+        moved.setHeuristic(RibbonManager::TspPointRobotNoSplitKRibbons);
+        moved.approximateDistanceUntilDone(0, 0, 0);
+    }
+    // nothing afterwards
+    auto another = ribbonManager;
+    auto allocations = profiler.allocations();
+    if (Profiler::c_Enabled) {
+        EXPECT_EQ(allocations[Profiler::Vertices].Allocations, 2);
+        EXPECT_EQ(allocations[Profiler::Vertices].Bytes, 2 * sizeof(Vertex));
+        EXPECT_EQ(allocations[Profiler::Edges].Allocations, 1);
+        // the root and the new vertex each get a copy, then the one here
+        EXPECT_EQ(allocations[Profiler::RibbonManagers].Copies, 3);
+        EXPECT_EQ(allocations[Profiler::RibbonStores].Allocations, 1);
+        EXPECT_GT(allocations[Profiler::RibbonLists].Allocations, 0);
+    } else {
+        for (const auto& object : allocations) EXPECT_EQ(object.Allocations + object.Copies + object.Bytes, 0);
+    }
+    Profiler::Allocations total;
+    Profiler::accumulate(total, allocations);
+    Profiler::accumulate(total, allocations);
+    EXPECT_EQ(total[Profiler::Vertices].Allocations, 2 * allocations[Profiler::Vertices].Allocations);
+    EXPECT_STREQ(Profiler::objectName(Profiler::RibbonLists), "ribbon list nodes");
+
+    // and the plan's counts come back in its stats
+    AStarPlanner planner;
+    auto config = plannerConfig;
+    config.setVisualizations(false);
+    auto stats = planner.plan(ribbonManager, State(0, 0, 0, 2.5, 1), config, DubinsPlan(), 0.25);
+    if (Profiler::c_Enabled) EXPECT_GE(stats.Allocations[Profiler::Vertices].Allocations, stats.Generated);
+    else EXPECT_EQ(stats.Allocations[Profiler::Vertices].Allocations, 0);
+}
+
+TEST(UnitTests, BinaryVisualizerTest) {
+    // the same events through a text visualizer and through a binary one and back should read the same
+    auto report = [](Visualizer& visualizer) {
+        State s(1.5, -2.25, M_PI / 3, 2.5, 100.125);
+        visualizer.note("Ribbons: \nNone\nEnd Ribbons");
+        visualizer.vertex(s, 12.5, 10, 2.5, true, "start", {140001234});
+        visualizer.vertex(s, 13.5, 11, 2.5, false, "lastPlanEnd", {140001234, 140005678, 1, 2, 3, 4});
+        visualizer.trajectory();
+        for (int i = 0; i < 3; i++) visualizer.state(s.push(i), 3 + i, 1 + i, 2, Visualizer::TrajectoryState);
+        visualizer.state(s, 0, 0, 0, Visualizer::SampleState);
+        visualizer.note(std::string(300, 'x'));
+    };
+    std::ostringstream expected;
+    Visualizer text(expected);
+    report(text);
+    auto path = "/tmp/path_planner_binary_visualizer_test";
+    // from this thread and from another one, which gets its own ring
+    for (bool otherThread : {false, true}) {
+        {
+            BinaryVisualizer binary(path);
+            if (otherThread) std::thread([&] { report(binary); }).join();
+            else report(binary);
+            EXPECT_EQ(binary.dropped(), 0);
+        }
+        std::ostringstream converted;
+        Visualizer back(converted);
+        EXPECT_EQ(BinaryVisualizer::convert(path, back), 0);
+        EXPECT_EQ(converted.str(), expected.str());
+    }
+    unlink(path);
+
+    // sampling keeps one in so many
+    std::ostringstream sampled;
+    Visualizer some(sampled);
+    some.setSampleRate(Visualizer::Vertices, 4);
+    int kept = 0;
+    for (int i = 0; i < 20; i++) kept += some.sample(Visualizer::Vertices);
+    EXPECT_EQ(kept, 5);
+    EXPECT_TRUE(some.sample(Visualizer::Trajectories));
+}
+
+TEST(UnitTests, TracerTest) {
+    // nothing to trace to, nothing happens
+    EXPECT_EQ(Tracer::current(), nullptr);
+    {
+        Tracer::Span span("nowhere");
+    }
+    auto path = "/tmp/path_planner_tracer_test.json";
+    Tracer::install(std::make_shared<Tracer>(path));
+    ASSERT_NE(Tracer::current(), nullptr);
+    {
+        Tracer::Span span("outer");
+        span.setArg("samples", 64);
+        std::thread([] {
+            Tracer::nameThread("helper");
+            Tracer::Span inner("inner");
+        }).join();
+    }
+    Tracer::current()->flush();
+    // a plan's iterations and searches show up too
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    AStarPlanner planner;
+    auto config = plannerConfig;
+    config.setVisualizations(false);
+    planner.plan(ribbonManager, State(0, 0, 0, 2.5, 1), config, DubinsPlan(), 0.5);
+    Tracer::install(nullptr);
+    EXPECT_EQ(Tracer::current(), nullptr);
+
+    std::ifstream file(path);
+    std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    unlink(path);
+    EXPECT_EQ(trace.front(), '[');
+    EXPECT_EQ(trace.substr(trace.size() - 2), "]\n");
+    EXPECT_EQ(trace.find("nowhere"), std::string::npos);
+    EXPECT_NE(trace.find(R"("name":"outer","ph":"X")"), std::string::npos);
+    EXPECT_NE(trace.find(R"("args":{"samples":64})"), std::string::npos);
+    EXPECT_NE(trace.find(R"(,"args":{"name":"helper"})"), std::string::npos);
+    EXPECT_NE(trace.find(R"("name":"inner","ph":"X")"), std::string::npos);
+    for (auto name : {"\"plan\"", "\"iteration\"", "\"aStar\""}) EXPECT_NE(trace.find(name), std::string::npos) << name;
+    // the inner span finished first, so it's written before the outer one
+    EXPECT_LT(trace.find("inner"), trace.find("outer"));
+}
+
+TEST(UnitTests, DubinsCacheTest) {
+    DubinsCache cache(16);
+    State s1(0, 0, 0, 2.5, 1), s2(20, 30, 1, 2.5, 0);
+    DubinsWrapper uncached(s1, s2, 8), cached;
+    cache.set(cached, s1, s2, 8);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 1);
+    // different time and speed, same poses
+    State s3(0, 0, 0, 0.5, 7);
+    DubinsWrapper again;
+    cache.set(again, s3, s2, 8);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_DOUBLE_EQ(again.length(), uncached.length());
+    EXPECT_DOUBLE_EQ(again.getStartTime(), 7);
+    EXPECT_DOUBLE_EQ(again.getSpeed(), 0.5);
+    State a, b;
+    a.time() = b.time() = uncached.getEndTime();
+    uncached.sample(a);
+    cached.sample(b);
+    EXPECT_DOUBLE_EQ(a.x(), b.x());
+    EXPECT_DOUBLE_EQ(a.y(), b.y());
+    // other radius is a different path
+    cache.set(again, s1, s2, 16);
+    EXPECT_EQ(cache.misses(), 2);
+    cache.clear();
+    cache.set(again, s1, s2, 8);
+    EXPECT_EQ(cache.misses(), 3);
+}
+
+TEST(UnitTests, SharedIncumbentTest) {
+    SharedIncumbent incumbent;
+    EXPECT_DOUBLE_EQ(incumbent.f(), DBL_MAX);
+    incumbent.offer(10);
+    incumbent.offer(12);
+    EXPECT_DOUBLE_EQ(incumbent.f(), 10);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&incumbent, i] {
+            for (int j = 100; j > 0; j--) incumbent.offer(j + i * 0.5);
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_DOUBLE_EQ(incumbent.f(), 1);
+}
+
+TEST(UnitTests, StateGeneratorBatchTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 0, 0, 20);
+    StateGenerator one(-50, 50, -50, 50, 2.5, 2.5, 7, ribbonManager), bulk(-50, 50, -50, 50, 2.5, 2.5, 7, ribbonManager);
+    StateGenerator::Batch batch;
+    bulk.generate(500, batch);
+    ASSERT_EQ(batch.size(), 500);
+    for (int i = 0; i < 500; i++) {
+        auto s = one.generate();
+        EXPECT_DOUBLE_EQ(s.x(), batch.X[i]);
+        EXPECT_DOUBLE_EQ(s.y(), batch.Y[i]);
+        EXPECT_DOUBLE_EQ(s.heading(), batch.Heading[i]);
+    }
+    std::vector<unsigned char> blocked(batch.size(), 1);
+    Map().checkBlocked(batch.X.data(), batch.Y.data(), batch.size(), blocked.data());
+    EXPECT_EQ(std::count(blocked.begin(), blocked.end(), 1), 0);
+}
+
+TEST(UnitTests, HaltonStateGeneratorTest) {
+    StateGenerator g1(0, 100, -10, 10, 2.5, 2.5, 3), g2(0, 100, -10, 10, 2.5, 2.5, 3);
+    g1.setSequence(StateGenerator::Sequence::Halton);
+    g2.setSequence(StateGenerator::Sequence::Halton);
+    StateGenerator::Batch batch;
+    g1.generate(1024, batch);
+    int counts[4][4] = {};
+    for (size_t i = 0; i < batch.size(); i++) {
+        ASSERT_GE(batch.X[i], 0); ASSERT_LT(batch.X[i], 100);
+        ASSERT_GE(batch.Y[i], -10); ASSERT_LT(batch.Y[i], 10);
+        counts[(int)(batch.X[i] / 25)][(int)((batch.Y[i] + 10) / 5)]++;
+        // reproducible
+        auto s = g2.generate();
+        EXPECT_DOUBLE_EQ(s.x(), batch.X[i]);
+        EXPECT_DOUBLE_EQ(s.y(), batch.Y[i]);
+    }
+    // much more even than random - all 16 cells should get very close to 64
+    for (auto& row : counts) for (auto c : row) EXPECT_NEAR(c, 64, 3);
+}
+
+TEST(UnitTests, HeldKarpHeuristicTest) {
+    // compare against trying every order and direction, with more ribbons than the old recursion could handle
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitAllRibbons);
+    std::vector<std::pair<std::pair<double, double>, std::pair<double, double>>> ribbons;
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<> coordinate(-200, 200);
+    for (int i = 0; i < 7; i++) {
+        ribbons.emplace_back(std::make_pair(coordinate(generator), coordinate(generator)),
+                std::make_pair(coordinate(generator), coordinate(generator)));
+        ribbonManager.add(ribbons.back().first.first, ribbons.back().first.second,
+                ribbons.back().second.first, ribbons.back().second.second);
+    }
+    auto d = [](std::pair<double, double> p1, std::pair<double, double> p2) {
+        return sqrt((p1.first - p2.first) * (p1.first - p2.first) + (p1.second - p2.second) * (p1.second - p2.second));
+    };
+    std::vector<int> order = {0, 1, 2, 3, 4, 5, 6};
+    auto best = DBL_MAX;
+    do {
+        for (int directions = 0; directions < (1 << 7); directions++) {
+            auto point = std::make_pair(10.0, -20.0);
+            double length = 0;
+            for (int i : order) {
+                auto entry = ribbons[i].first, exit = ribbons[i].second;
+                if (directions & (1 << i)) std::swap(entry, exit);
+                length = fmax(length + d(entry, exit) - 2 * Ribbon::RibbonWidth + d(point, entry), 0);
+                point = exit;
+            }
+            best = fmin(best, length);
+        }
+    } while (std::next_permutation(order.begin(), order.end()));
+    EXPECT_NEAR(ribbonManager.approximateDistanceUntilDone(10, -20, 0), best, 1e-6);
+    // beyond what Held-Karp can handle we fall back to the spanning tree bound
+    for (int i = 0; i < 10; i++) ribbonManager.add(i * 10, 500, i * 10, 600);
+    ribbonManager.changeHeuristicIfTooManyRibbons();
+    RibbonManager minimumSpanningTree(RibbonManager::MinimumSpanningTree);
+    for (const auto& r : ribbonManager.get()) minimumSpanningTree.add(r.start().first, r.start().second, r.end().first, r.end().second);
+    EXPECT_DOUBLE_EQ(ribbonManager.approximateDistanceUntilDone(10, -20, 0), minimumSpanningTree.approximateDistanceUntilDone(10, -20, 0));
+}
+
+TEST(UnitTests, MinimumSpanningTreeHeuristicTest) {
+    // parallel lines 20m apart: the best tour drives each line and hops 20m between them
+    RibbonManager ribbonManager(RibbonManager::MinimumSpanningTree);
+    for (int i = 0; i < 30; i++) ribbonManager.add(0, i * 20, 1000, i * 20);
+    auto perLine = 1000 - 2 * Ribbon::RibbonWidth;
+    EXPECT_DOUBLE_EQ(ribbonManager.approximateDistanceUntilDone(-100, 0, 0), 30 * perLine + 100 + 29 * 20);
+    // much tighter than max distance, and never more than the exact heuristic
+    RibbonManager maxDistance(RibbonManager::MaxDistance);
+    for (int i = 0; i < 30; i++) maxDistance.add(0, i * 20, 1000, i * 20);
+    EXPECT_GT(ribbonManager.approximateDistanceUntilDone(-100, 0, 0), maxDistance.approximateDistanceUntilDone(-100, 0, 0));
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<> coordinate(-200, 200);
+    RibbonManager scattered(RibbonManager::MinimumSpanningTree), exact(RibbonManager::TspPointRobotNoSplitAllRibbons);
+    for (int i = 0; i < 8; i++) {
+        double x1 = coordinate(generator), y1 = coordinate(generator), x2 = coordinate(generator), y2 = coordinate(generator);
+        scattered.add(x1, y1, x2, y2);
+        exact.add(x1, y1, x2, y2);
+    }
+    for (int i = 0; i < 10; i++) {
+        double x = coordinate(generator), y = coordinate(generator);
+        EXPECT_LE(scattered.approximateDistanceUntilDone(x, y, 0), exact.approximateDistanceUntilDone(x, y, 0) + 1e-9);
+    }
+}
+
+TEST(UnitTests, HeuristicCacheTest) {
+    HeuristicCache cache;
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitAllRibbons);
+    ribbonManager.add(0, 0, 100, 0);
+    ribbonManager.add(0, 20, 100, 20);
+    auto copy = ribbonManager;
+    EXPECT_EQ(ribbonManager.heuristicKey(), copy.heuristicKey());
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(ribbonManager, -10, 5, 0.3),
+            ribbonManager.approximateDistanceUntilDone(-10, 5, 0.3));
+    EXPECT_EQ(cache.misses(), 1);
+    // a copy with the same ribbons left hits
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(copy, -10, 5, 0.3),
+            ribbonManager.approximateDistanceUntilDone(-10, 5, 0.3));
+    EXPECT_EQ(cache.hits(), 1);
+    // covering part of a ribbon (splitting it) means a different key, so the old value isn't used
+    copy.cover(50, 0, false);
+    EXPECT_NE(ribbonManager.heuristicKey(), copy.heuristicKey());
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(copy, -10, 5, 0.3), copy.approximateDistanceUntilDone(-10, 5, 0.3));
+    EXPECT_EQ(cache.misses(), 2);
+    // so does a different heuristic on the same ribbons
+    auto maxDistance = ribbonManager;
+    maxDistance.setHeuristic(RibbonManager::MaxDistance);
+    EXPECT_DOUBLE_EQ(cache.approximateDistanceUntilDone(maxDistance, -10, 5, 0.3),
+            maxDistance.approximateDistanceUntilDone(-10, 5, 0.3));
+    EXPECT_EQ(cache.misses(), 3);
+    // managers built separately with the same ribbons share entries too
+    RibbonManager rebuilt(RibbonManager::TspPointRobotNoSplitAllRibbons);
+    rebuilt.add(0, 0, 100, 0);
+    rebuilt.add(0, 20, 100, 20);
+    cache.approximateDistanceUntilDone(rebuilt, -10, 5, 0.3);
+    EXPECT_EQ(cache.hits(), 2);
+}
+
+TEST(UnitTests, RibbonStoreTest) {
+    // covering through the spatial index should do exactly what covering every ribbon in a list did
+    std::list<Ribbon> reference;
+    RibbonManager ribbonManager;
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<> coordinate(-100, 100);
+    for (int i = 0; i < 20; i++) {
+        Ribbon r(coordinate(generator), coordinate(generator), coordinate(generator), coordinate(generator));
+        reference.push_back(r);
+        ribbonManager.add(r.start().first, r.start().second, r.end().first, r.end().second);
+    }
+    std::uniform_real_distribution<> along(0, 1);
+    for (int i = 0; i < 2000; i++) {
+        // mostly points right on ribbons so things actually get covered
+        double x, y;
+        auto r = std::next(reference.begin(), generator() % reference.size());
+        auto t = along(generator);
+        x = r->start().first + t * (r->end().first - r->start().first) + coordinate(generator) / 50;
+        y = r->start().second + t * (r->end().second - r->start().second) + coordinate(generator) / 50;
+        if (i % 10 == 0) { x = coordinate(generator); y = coordinate(generator); }
+        bool strict = i % 3 == 0;
+        auto it = reference.begin();
+        while (it != reference.end()) {
+            auto split = it->split(x, y, strict);
+            if (!split.covered(strict)) reference.insert(it, split);
+            if (it->covered(strict)) it = reference.erase(it);
+            else ++it;
+        }
+        ribbonManager.cover(x, y, strict);
+        ASSERT_EQ(ribbonManager.get().size(), reference.size());
+        auto j = ribbonManager.get().begin();
+        for (const auto& ribbon : reference) {
+            EXPECT_EQ(ribbon.start(), j->start());
+            EXPECT_EQ(ribbon.end(), j->end());
+            ++j;
+        }
+        // and so should the distance to a nearby point
+        x += 3;
+        auto min = reference.empty()? 0 : DBL_MAX;
+        for (const auto& ribbon : reference) {
+            if (ribbon.contains(x, y, ribbon.getProjection(x, y), false)) { min = 0; break; }
+            min = fmin(min, fmin(sqrt(pow(ribbon.start().first - x, 2) + pow(ribbon.start().second - y, 2)),
+                                 sqrt(pow(ribbon.end().first - x, 2) + pow(ribbon.end().second - y, 2))));
+        }
+        EXPECT_DOUBLE_EQ(ribbonManager.minDistanceFrom(x, y), min);
+        if (reference.empty()) break;
+    }
+}
+
+TEST(UnitTests, BatchCoverTest) {
+    // covering a batch of points has to end up exactly where covering them one at a time does
+    std::mt19937 generator(13);
+    std::uniform_real_distribution<> coordinate(-100, 100), along(0, 1);
+    for (int ribbonCount : {4, 20}) { // without and with the index
+        RibbonManager batched, oneByOne;
+        for (int i = 0; i < ribbonCount; i++) {
+            double x1 = coordinate(generator), y1 = coordinate(generator), x2 = coordinate(generator), y2 = coordinate(generator);
+            batched.add(x1, y1, x2, y2);
+            oneByOne.add(x1, y1, x2, y2);
+        }
+        for (int i = 0; i < 200 && !oneByOne.done(); i++) {
+            // a wiggly walk partway along a ribbon, with some points off in the middle of nowhere
+            auto r = oneByOne.get()[generator() % oneByOne.get().size()];
+            std::vector<double> xs, ys;
+            auto t = along(generator);
+            for (int j = 0; j < 30; j++, t += 0.02) {
+                xs.push_back(r.start().first + t * (r.end().first - r.start().first) + coordinate(generator) / 60);
+                ys.push_back(r.start().second + t * (r.end().second - r.start().second) + coordinate(generator) / 60);
+                if (j % 7 == 0) { xs.back() = coordinate(generator); ys.back() = coordinate(generator); }
+            }
+            bool strict = i % 3 == 0;
+            batched.cover(xs, ys, strict);
+            for (size_t j = 0; j < xs.size(); j++) oneByOne.cover(xs[j], ys[j], strict);
+            ASSERT_EQ(batched.get().size(), oneByOne.get().size());
+            for (size_t j = 0; j < batched.get().size(); j++) {
+                EXPECT_EQ(batched.get()[j].start(), oneByOne.get()[j].start());
+                EXPECT_EQ(batched.get()[j].end(), oneByOne.get()[j].end());
+            }
+        }
+    }
+}
+
+TEST(UnitTests, RibbonDistanceTableTest) {
+    // precomputed distances have to give exactly the same heuristic values, including after covering part of a ribbon
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<> coordinate(-200, 200);
+    for (auto heuristic : {RibbonManager::TspDubinsNoSplitAllRibbons, RibbonManager::TspPointRobotNoSplitAllRibbons,
+                           RibbonManager::MinimumSpanningTree}) {
+        RibbonManager direct(heuristic, 8, 2);
+        for (int i = 0; i < 6; i++) {
+            direct.add(coordinate(generator), coordinate(generator), coordinate(generator), coordinate(generator));
+        }
+        auto precomputed = direct;
+        precomputed.precomputeDistances();
+        for (int i = 0; i < 10; i++) {
+            double x = coordinate(generator), y = coordinate(generator), yaw = i * 0.6;
+            EXPECT_EQ(precomputed.approximateDistanceUntilDone(x, y, yaw), direct.approximateDistanceUntilDone(x, y, yaw));
+        }
+        auto r = direct.get().front();
+        auto mid = std::make_pair((r.start().first + r.end().first) / 2, (r.start().second + r.end().second) / 2);
+        direct.cover(mid.first, mid.second, false);
+        precomputed.cover(mid.first, mid.second, false);
+        EXPECT_EQ(precomputed.approximateDistanceUntilDone(1, 2, 3), direct.approximateDistanceUntilDone(1, 2, 3));
+    }
+}
+
+TEST(UnitTests, SampleIndexTest) {
+    StateGenerator generator(-75, 75, -75, 75, 2.5, 2.5, 7);
+    vector<State> samples;
+    SampleIndex index;
+    for (int i = 0; i < 2000; i++) {
+        samples.push_back(generator.generate());
+        index.add(samples.back().x(), samples.back().y(), i);
+    }
+    // should have refined itself along the way
+    EXPECT_LT(index.cellSize(), 16);
+    for (const auto& origin : {State(0, 0, 0, 0, 0), State(70, -70, 0, 0, 0), State(300, 10, 0, 0, 0)}) {
+        vector<double> expected;
+        for (const auto& s : samples) expected.push_back(s.distanceTo(origin));
+        std::sort(expected.begin(), expected.end());
+        vector<double> visited;
+        // visit the closest 50 and make sure they come out in order
+        index.visitByDistance(origin.x(), origin.y(), [&](int i, double d) {
+            EXPECT_DOUBLE_EQ(d, samples[i].distanceTo(origin));
+            visited.push_back(d);
+            return visited.size() < 50;
+        });
+        ASSERT_EQ(visited.size(), 50);
+        for (size_t i = 0; i < visited.size(); i++) EXPECT_DOUBLE_EQ(visited[i], expected[i]);
+    }
+    int count = 0;
+    index.visitByDistance(0, 0, [&](int, double) { count++; return true; });
+    EXPECT_EQ(count, 2000);
+    // starting over starts from the coarse cells again
+    index.clear();
+    EXPECT_EQ(index.cellSize(), 16);
+}
+
+TEST(UnitTests, SamplePoolTest) {
+    auto map = make_shared<Map>();
+    SamplePool pool;
+    vector<State> samples{State(0, 0, 0, 2.5, 0), State(10, 0, 0, 2.5, 0), State(19, 19, 0, 2.5, 0)};
+    pool.keep(map, 2.5, SamplePool::Window(-20, 20, -20, 20), samples);
+    vector<State> taken;
+    // the one at the origin is outside the new window
+    auto previous = pool.take(map, 2.5, SamplePool::Window(5, 45, -20, 20), taken);
+    ASSERT_EQ(taken.size(), 2);
+    EXPECT_DOUBLE_EQ(taken[0].x(), 10);
+    EXPECT_DOUBLE_EQ(taken[1].x(), 19);
+    EXPECT_DOUBLE_EQ(previous.MinX, -20);
+    EXPECT_DOUBLE_EQ(previous.MaxY, 20);
+    EXPECT_EQ(pool.size(), 0);
+    // nothing for a different map or speed
+    pool.keep(map, 2.5, SamplePool::Window(-20, 20, -20, 20), samples);
+    EXPECT_TRUE(pool.take(make_shared<Map>(), 2.5, SamplePool::Window(-20, 20, -20, 20), taken).empty());
+    EXPECT_TRUE(taken.empty());
+    pool.keep(map, 2.5, SamplePool::Window(-20, 20, -20, 20), samples);
+    EXPECT_TRUE(pool.take(map, 2, SamplePool::Window(-20, 20, -20, 20), taken).empty());
+    EXPECT_TRUE(taken.empty());
+
+    // a planner with a pool uses the last plan's samples where the windows overlap
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    auto config = plannerConfig;
+    config.setUseHaltonSamples(true);
+    config.setSamplePool(make_shared<SamplePool>());
+    AStarPlanner planner;
+    auto stats = planner.plan(ribbonManager, State(0, 0, 0, 2.5, 1), config, DubinsPlan(), 0.2);
+    EXPECT_EQ(stats.ReusedSamples, 0);
+    EXPECT_EQ(config.samplePool()->size(), stats.Samples);
+    State next(10, 0, 0, 2.5, 2);
+    stats = planner.plan(ribbonManager, next, config, DubinsPlan(), 0.2);
+    ASSERT_FALSE(stats.Plan.empty());
+    EXPECT_GT(stats.ReusedSamples, 0);
+    EXPECT_LE(stats.ReusedSamples, stats.Samples);
+    // and everything it kept is in the new window
+    auto radius = config.maxSpeed() * config.timeHorizon();
+    auto window = config.samplePool()->take(config.map(), config.maxSpeed(), SamplePool::Window(-1e9, 1e9, -1e9, 1e9),
+                                            taken);
+    EXPECT_EQ(taken.size(), stats.Samples);
+    EXPECT_DOUBLE_EQ(window.MinX, next.x() - radius);
+    for (const auto& s : taken) EXPECT_TRUE(window.contains(s.x(), s.y()));
+}
+
+TEST(UnitTests, SampleStoreTest) {
+    // positions far from the origin still come back to well within a millimetre
+    std::mt19937 generator(54);
+    std::uniform_real_distribution<double> coordinate(-500, 500), heading(0, 2 * M_PI);
+    SampleStore store;
+    store.setKeepTrig(true);
+    std::vector<State> added;
+    for (int i = 0; i < 1000; i++) {
+        added.emplace_back(3e5 + coordinate(generator), 5e6 + coordinate(generator), heading(generator), 2.5, 0);
+        store.add(added.back().x(), added.back().y(), added.back().heading());
+    }
+    ASSERT_EQ(store.size(), added.size());
+    auto states = store.states();
+    for (size_t i = 0; i < added.size(); i++) {
+        EXPECT_NEAR(store.x(i), added[i].x(), 1e-4);
+        EXPECT_NEAR(store.y(i), added[i].y(), 1e-4);
+        EXPECT_NEAR(store.heading(i), added[i].heading(), 1e-6);
+        EXPECT_DOUBLE_EQ(states[i].x(), store.x(i));
+        EXPECT_DOUBLE_EQ(states[i].heading(), store.heading(i));
+        double c, s;
+        store.trig(i, c, s);
+        EXPECT_NEAR(c, cos(store.heading(i)), 1e-6);
+        EXPECT_NEAR(s, sin(store.heading(i)), 1e-6);
+    }
+    // the speed and time get filled in when a sample becomes a vertex
+    EXPECT_EQ(store.state(0).speed(), 0);
+    EXPECT_EQ(store.state(0, 2.5).speed(), 2.5);
+    store.clear();
+    EXPECT_TRUE(store.empty());
+    // without the trig kept it gets worked out
+    store.setKeepTrig(false);
+    store.add(1, 2, 1);
+    double c, s;
+    store.trig(0, c, s);
+    EXPECT_DOUBLE_EQ(c, cos(store.heading(0)));
+    EXPECT_DOUBLE_EQ(s, sin(store.heading(0)));
+}
+
 TEST(UnitTests, VertexTests1) {
     RibbonManager ribbonManager;
     ribbonManager.add(50, 50, 60, 50);
@@ -963,6 +2804,35 @@ TEST(UnitTests, PointerTreeStringTest) {
     cerr << v1->getPointerTreeString() << endl;
 }
 
+TEST(UnitTests, SearchArenaTest) {
+    auto arena = make_shared<SearchArena>(256);
+    auto p1 = arena->allocate(3, 1);
+    auto p2 = arena->allocate(sizeof(double), alignof(double));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p2) % alignof(double), 0);
+    EXPECT_NE(p1, p2);
+    // bigger than a block
+    arena->allocate(1000, 8);
+    EXPECT_GE(arena->capacity(), 1256);
+    arena->reset();
+    EXPECT_EQ(arena->bytesUsed(), 0);
+    // memory gets re-used after a reset
+    EXPECT_EQ(arena->allocate(3, 1), p1);
+
+    RibbonManager ribbonManager;
+    ribbonManager.add(50, 50, 60, 50);
+    auto root = Vertex::makeRoot(State(5, 5, M_PI, 2.5, 1), ribbonManager);
+    auto v1 = Vertex::connect(root, State(5, -20, M_PI, 2.5, 0), arena);
+    auto v2 = Vertex::connect(v1, State(5, -40, M_PI, 2.5, 0), 8, false, arena);
+    EXPECT_GT(arena->bytesUsed(), 0);
+    EXPECT_EQ(v2->parent(), v1);
+    EXPECT_EQ(v1->parent(), root);
+    EXPECT_EQ(v2->getDepth(), 2);
+    // the tree keeps the arena alive
+    EXPECT_GT(arena.use_count(), 1);
+    v2 = nullptr; v1 = nullptr;
+    EXPECT_EQ(arena.use_count(), 1);
+}
+
 //TEST(PlannerTests, DISABLED_DubinsWalkTest) {
 //    // runs forever // doesn't run forever anymore but fails with new EXPECTs // and fails with the even newer one too
 //    // basically all the dubins code is bad
@@ -1058,6 +2928,45 @@ TEST(UnitTests, EmptyVertexQueueTest) {
     EXPECT_THROW(planner.popVertexQueue(), std::out_of_range);
 }
 
+TEST(UnitTests, OpenListTest) {
+    RibbonManager ribbonManager;
+    auto root = Vertex::makeRoot(State(0, 0, 0, 2.5, 1), ribbonManager);
+    OpenList openList;
+    EXPECT_THROW(openList.pop(), std::out_of_range);
+    std::default_random_engine engine(7);
+    std::uniform_real_distribution<double> distribution(0, 100);
+    vector<double> fs;
+    for (int i = 0; i < 500; i++) {
+        fs.push_back(distribution(engine));
+        openList.push(fs.back(), root);
+    }
+    std::sort(fs.begin(), fs.end());
+    EXPECT_EQ(openList.size(), 500);
+    for (auto f : fs) {
+        EXPECT_DOUBLE_EQ(openList.topF(), f);
+        EXPECT_EQ(openList.pop(), root);
+    }
+    EXPECT_TRUE(openList.empty());
+    // dropping the worst leaves the best in order
+    for (auto f : fs) openList.push(f, root);
+    vector<double> dropped;
+    openList.dropWorst(100, [&](double f, Vertex::SharedPtr v) {
+        EXPECT_EQ(v, root);
+        dropped.push_back(f);
+        // the list is usable again by now
+        if (dropped.size() == 1) openList.push(-1, root);
+    });
+    std::sort(dropped.begin(), dropped.end());
+    EXPECT_EQ(dropped, vector<double>(fs.end() - 100, fs.end()));
+    EXPECT_EQ(openList.size(), 401);
+    EXPECT_DOUBLE_EQ(openList.topF(), -1);
+    openList.pop();
+    for (size_t i = 0; i < 400; i++) {
+        EXPECT_DOUBLE_EQ(openList.topF(), fs[i]);
+        openList.pop();
+    }
+}
+
 TEST(UnitTests, ExpandTest1Ribbons) {
     StateGenerator generator(-50, 50, -50, 50, 2.5, 2.5, 9);
     State start = generator.generate();
@@ -1081,6 +2990,49 @@ TEST(UnitTests, ExpandTest1Ribbons) {
     EXPECT_THROW(planner.popVertexQueue(), std::out_of_range);
 }
 
+TEST(UnitTests, ExpandForgottenTest) {
+    // children dropped to stay under the memory budget get made again when their parent comes back off the open list,
+    // but the ones still on it don't
+    StateGenerator generator(-50, 50, -50, 50, 2.5, 2.5, 9);
+    State start = generator.generate();
+    start.time() = 1;
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    const DynamicObstaclesManager& obstacles = BinaryDynamicObstaclesManager();
+    auto root = Vertex::makeRoot(start, ribbonManager);
+    root->computeApproxToGo(plannerConfig);
+    auto config = plannerConfig;
+    config.setSearchMemoryBudget(8000);
+    AStarPlanner planner;
+    planner.setConfig(config);
+    planner.addSamples(generator, 1000);
+    planner.expand(root, obstacles);
+    int expansions = 1;
+    vector<std::tuple<int, int, int>> children;
+    while (true) {
+        Vertex::SharedPtr v;
+        try {
+            v = planner.popVertexQueue();
+        } catch (const std::out_of_range&) {
+            break;
+        }
+        if (v == root) {
+            // (making every child again each time would never finish)
+            ASSERT_LT(expansions, 100);
+            planner.expand(root, obstacles);
+            expansions++;
+        } else {
+            ASSERT_EQ(v->parent(), root);
+            children.emplace_back(v->childKey().Sample, v->childKey().SpeedIndex, v->childKey().RadiusIndex);
+        }
+    }
+    EXPECT_GT(expansions, 1);
+    // the same 40 as ExpandTest1Ribbons, each once
+    EXPECT_EQ(children.size(), 40);
+    std::sort(children.begin(), children.end());
+    EXPECT_TRUE(std::adjacent_find(children.begin(), children.end()) == children.end());
+}
+
 TEST(UnitTests, ExpandDifferentTurningRadiiTest) {
     // Obsolete test - why should the top vertex have coverage allowed since we can go straight?
     State start(0, 0, 0, 2.5, 1);
@@ -1285,6 +3237,361 @@ TEST(PlannerTests, RHRSAStarTest1Ribbons) {
     for (auto s : plan.getHalfSecondSamples()) cerr << s.toString() << endl;
 }
 
+TEST(PlannerTests, SearchArenaPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setUseSearchArena(true);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    // plan a couple of times with the same planner so arenas get recycled
+    for (int i = 0; i < 2; i++) {
+        auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+        EXPECT_FALSE(stats.Plan.empty());
+        validatePlan(stats.Plan, config);
+    }
+}
+
+TEST(PlannerTests, IncrementalSearchPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    // the same samples and the same number of iterations either way, so the two searches can be compared
+    config.setSampleSeed(3);
+    config.setMaxIterations(4);
+    config.setNowFunction([] { return 0.0; });
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto fresh = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    ASSERT_FALSE(fresh.Plan.empty());
+    config.setIncrementalSearch(true);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    ASSERT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_EQ(stats.Iterations, fresh.Iterations);
+    // keeping the tree finds the same plan without sweeping the old edges again every iteration
+    EXPECT_DOUBLE_EQ(stats.PlanFValue, fresh.PlanFValue);
+    EXPECT_LT(stats.EdgesEvaluated, fresh.EdgesEvaluated);
+}
+
+TEST(UnitTests, RewireTest) {
+    // two ways to the same sample, speed and turning radius with the same ribbons left: the cheaper one survives
+    RibbonManager ribbonManager;
+    ribbonManager.add(100, 100, 100, 130);
+    auto root = Vertex::makeRoot(State(0, 0, 0, 2.5, 1), ribbonManager);
+    auto config = plannerConfig;
+    config.setIncrementalSearch(true);
+    root->computeApproxToGo(config);
+    AStarPlanner planner;
+    planner.setConfig(config);
+    auto connect = [&](const Vertex::SharedPtr& parent, const State& s) {
+        auto v = Vertex::connect(parent, s);
+        v->parentEdge()->computeTrueCost(config);
+        v->setCurrentCost();
+        v->computeApproxToGo(config);
+        return v;
+    };
+    State end(0, 10, 0, 2.5, 0);
+    auto cheap = connect(root, end);
+    auto expensive = connect(connect(root, State(3, 5, 0, 2.5, 0)), end);
+    ASSERT_TRUE(cheap->ribbonManager().sameRibbonsAs(expensive->ribbonManager()));
+    ASSERT_LT(cheap->currentCost(), expensive->currentCost());
+    ASSERT_FALSE(expensive->parentEdge()->infeasible());
+    // the cheap one first, so the expensive one doesn't get in
+    EXPECT_TRUE(planner.rewire(cheap, 5, 1, 0));
+    EXPECT_FALSE(planner.rewire(expensive, 5, 1, 0));
+    EXPECT_FALSE(cheap->replaced());
+    // the other way round (on another key), and the expensive one gets replaced
+    EXPECT_TRUE(planner.rewire(expensive, 6, 1, 0));
+    EXPECT_TRUE(planner.rewire(cheap, 6, 1, 0));
+    EXPECT_TRUE(expensive->replaced());
+    EXPECT_FALSE(cheap->replaced());
+    // a different speed is somewhere else as far as rewiring goes
+    auto other = connect(root, end);
+    EXPECT_TRUE(planner.rewire(other, 6, 0, 0));
+    EXPECT_FALSE(other->replaced());
+}
+
+TEST(PlannerTests, ClosedListPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setClosedList(true);
+    // coarse enough that the start's children and the ribbon endpoints' end up sharing cells
+    config.setClosedListResolution(2);
+    config.setClosedListHeadingResolution(0.5);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_GT(stats.Dominated, 0);
+    // and along with incremental search, where the tree lasts longer and vertices can get replaced twice over
+    config.setIncrementalSearch(true);
+    stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+}
+
+TEST(PlannerTests, MemoryBudgetPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setSampleSeed(3);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    EXPECT_EQ(stats.Forgotten, 0);
+    EXPECT_EQ(stats.Regenerated, 0);
+    auto unbounded = stats.PeakSearchMemory;
+    EXPECT_GT(unbounded, 0);
+    // a fraction of what it'd take otherwise still gets somewhere, without going over
+    config.setSearchMemoryBudget(unbounded / 4);
+    stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_GT(stats.Forgotten, 0);
+    // only the dropped ones get made again
+    EXPECT_LE(stats.Regenerated, stats.Forgotten);
+    EXPECT_LE(stats.PeakSearchMemory, unbounded / 4);
+    // and with the tree kept between iterations
+    config.setIncrementalSearch(true);
+    stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_LE(stats.PeakSearchMemory, unbounded / 4);
+}
+
+TEST(PlannerTests, LocalRibbonsPlanTest) {
+    // planning on a few lines of a big survey at a time still shows it where to go
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitKRibbons, 8, 2);
+    for (int i = 0; i < 200; i++) ribbonManager.add(i * 10, 10, i * 10, 210);
+    SurveyOrder order(ribbonManager, 0, 0);
+    auto view = order.localView(ribbonManager, 4);
+    EXPECT_EQ(4, view.get().size());
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(view, start, plannerConfig, DubinsPlan(), 0.95);
+    ASSERT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, plannerConfig);
+    // it heads up the first line
+    State end;
+    end.time() = stats.Plan.getEndTime();
+    stats.Plan.sample(end);
+    EXPECT_GT(end.y(), 20);
+    EXPECT_LT(end.x(), 20);
+}
+
+TEST(PlannerTests, ParallelEdgeEvaluationPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setEdgeEvaluationThreads(4);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+}
+
+TEST(PlannerTests, LazyEdgeEvaluationPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setLazyEdgeEvaluation(true);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    // the point is to not sweep most of the generated edges
+    EXPECT_LT(stats.EdgesEvaluated, stats.Generated);
+}
+
+TEST(PlannerTests, DubinsCachePlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setUseDubinsCache(true);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_GT(stats.DubinsCacheMisses, 0);
+    EXPECT_NEAR(stats.DubinsCacheHitRate,
+            (double)stats.DubinsCacheHits / (stats.DubinsCacheHits + stats.DubinsCacheMisses), 1e-12);
+}
+
+TEST(PlannerTests, BatchDubinsPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto config = plannerConfig;
+    config.setBatchDubins(true);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+}
+
+TEST(PlannerTests, WarmStartPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(20, 20, 20, 60);
+    auto config = plannerConfig;
+    config.setWarmStart(true);
+    // same samples every time
+    config.setUseHaltonSamples(true);
+    // and the same amount of searching, rather than whatever the machine gets through in half a second (the clock
+    // standing still so it's only the iterations that run out)
+    config.setMaxIterations(2);
+    config.setNowFunction([] { return 0.0; });
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    EXPECT_EQ(stats.WarmStartVertices, 0);
+    // same problem again, so the whole tree carries over and nothing needs sweeping again
+    stats = planner.plan(ribbonManager, start, config, stats.Plan, 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    EXPECT_GT(stats.WarmStartVertices, 0);
+    EXPECT_EQ(stats.WarmStartReused, stats.WarmStartVertices);
+    // a second later, on the plan (what's carried over depends on how far the search got, maybe just the plan itself)
+    State next;
+    next.time() = 2;
+    stats.Plan.sample(next);
+    auto previous = stats.Plan;
+    previous.changeIntoSuffix(next.time());
+    stats = planner.plan(ribbonManager, next, config, previous, 0.5);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+    EXPECT_LE(stats.WarmStartReused, stats.WarmStartVertices);
+    // nothing carries over without the option
+    config.setWarmStart(false);
+    stats = planner.plan(ribbonManager, next, config, previous, 0.5);
+    EXPECT_EQ(stats.WarmStartVertices, 0);
+}
+
+TEST(PlannerTests, PlanRevalidationTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(20, 20, 20, 60);
+    auto config = plannerConfig;
+    config.setUseHaltonSamples(true);
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    obstacles->update(1, 500, 500, 0, 0, 0, 5, 5);
+    config.setObstaclesManager(obstacles);
+    config.setCheckedPlan(std::make_shared<CheckedPlan>());
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.5);
+    ASSERT_FALSE(stats.Plan.empty());
+    EXPECT_EQ(stats.PreviousPlanEdges, 0);
+    EXPECT_GT(config.checkedPlan()->size(), 0);
+    // the far away obstacle moving doesn't matter, so none of the plan needs sweeping again
+    auto moved = std::make_shared<BinaryDynamicObstaclesManager>(*obstacles);
+    moved->update(1, 600, 500, 0, 0, 0, 5, 5);
+    config.setObstaclesManager(moved);
+    auto again = planner.plan(ribbonManager, start, config, stats.Plan, 0.5);
+    ASSERT_FALSE(again.Plan.empty());
+    EXPECT_GT(again.PreviousPlanEdges, 0);
+    EXPECT_EQ(again.PreviousPlanReused, again.PreviousPlanEdges);
+    // one turning up partway along it does, at least from there on
+    auto plan = again.Plan;
+    State onPlan;
+    onPlan.time() = plan.get().back().getStartTime();
+    plan.sample(onPlan);
+    auto blocking = std::make_shared<BinaryDynamicObstaclesManager>(*moved);
+    blocking->update(2, onPlan.x(), onPlan.y(), 0, 0, 0, 5, 5);
+    config.setObstaclesManager(blocking);
+    auto blocked = planner.plan(ribbonManager, start, config, plan, 0.5);
+    EXPECT_GT(blocked.PreviousPlanEdges, 0);
+    EXPECT_LT(blocked.PreviousPlanReused, blocked.PreviousPlanEdges);
+    // and everything does with a new map
+    config.setObstaclesManager(moved);
+    config.setMap(std::make_shared<Map>());
+    auto newMap = planner.plan(ribbonManager, start, config, blocked.Plan, 0.5);
+    EXPECT_GT(newMap.PreviousPlanEdges, 0);
+    EXPECT_EQ(newMap.PreviousPlanReused, 0);
+}
+
+TEST(PlannerTests, ProfiledPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, plannerConfig, DubinsPlan(), 0.2);
+    ASSERT_FALSE(stats.Plan.empty());
+    // planning for 0.2s is mostly CPU time
+    EXPECT_GT(stats.CpuTime, 0);
+    EXPECT_LT(stats.CpuTime, 1);
+    if (Profiler::c_Enabled) {
+        // one nearest neighbour search per expansion, and the vertices go through the heap
+        EXPECT_EQ(stats.Profile[Profiler::Nearest].Calls, stats.Expanded);
+        EXPECT_GT(stats.Profile[Profiler::Heap].Calls, stats.Expanded);
+        EXPECT_GT(stats.Profile[Profiler::Heuristic].Calls, 0);
+        EXPECT_GT(stats.Profile[Profiler::Sampling].Calls, 0);
+        EXPECT_LE(stats.Profile[Profiler::Nearest].WallTime, 0.5);
+    } else {
+        for (const auto& phase : stats.Profile) EXPECT_EQ(phase.Calls, 0);
+    }
+}
+
+TEST(PlannerTests, PortfolioPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    PortfolioPlanner planner(3);
+    EXPECT_EQ(planner.instances(), 3);
+    std::vector<int> branchingFactors(3, 0);
+    planner.setVariation([&](int instance, PlannerConfig& config, RibbonManager&) {
+        config.setBranchingFactor(config.branchingFactor() + instance);
+        branchingFactors[instance] = config.branchingFactor();
+    });
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, plannerConfig, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, plannerConfig);
+    EXPECT_EQ(branchingFactors[2], plannerConfig.branchingFactor() + 2);
+}
+
+TEST(PlannerTests, HeuristicCachePlanTest) {
+    auto config = plannerConfig;
+    config.setUseHeuristicCache(true);
+    RibbonManager ribbonManager(RibbonManager::TspPointRobotNoSplitAllRibbons, 8, 2);
+    ribbonManager.add(0, 20, 0, 60);
+    ribbonManager.add(20, 20, 20, 60);
+    AStarPlanner planner;
+    auto stats = planner.plan(ribbonManager, State(0, 0, 0, 2.5, 1), config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    EXPECT_GT(stats.HeuristicCacheMisses, 0);
+    EXPECT_GT(stats.HeuristicCacheHits, 0);
+}
+
+TEST(PlannerTests, ObstacleRasterPlanTest) {
+    RibbonManager ribbonManager;
+    ribbonManager.add(0, 10, 0, 30);
+    ribbonManager.add(10, 10, 10, 30);
+    auto obstacles = std::make_shared<BinaryDynamicObstaclesManager>();
+    obstacles->update(1, 30, 20, M_PI, 1, 1, 5, 15);
+    auto config = plannerConfig;
+    config.setObstaclesManager(obstacles);
+    config.setUseObstacleRaster(true);
+    AStarPlanner planner;
+    State start(0, 0, 0, 2.5, 1);
+    auto stats = planner.plan(ribbonManager, start, config, DubinsPlan(), 0.95);
+    EXPECT_FALSE(stats.Plan.empty());
+    validatePlan(stats.Plan, config);
+}
+
 TEST(PlannerTests, RHRSAStarTest2Ribbons) {
     RibbonManager ribbonManager;
     ribbonManager.add(0, 10, 0, 30);
@@ -1397,7 +3704,6 @@ TEST(PlannerTests, RHRSAStarSingleRibbonTSP) {
     ribbonManager.add(0, 40, 50, 40);
     AStarPlanner planner;
     State start(0, 0, 0, 2.5, 1);
-    bool headingChanged = true; // assume coverage
     DubinsPlan plan;
     Visualizer::UniquePtr visualizer(new Visualizer("/tmp/planner_test_visualizations"));
     plannerConfig.setVisualizations(true);
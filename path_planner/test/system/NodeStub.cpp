@@ -3,8 +3,8 @@
 using std::cerr;
 using std::endl;
 
-State NodeStub::publishTrajectory(std::vector<State> trajectory) {
-    m_LastTrajectory = std::move(trajectory);
+State NodeStub::publishPlan(const DubinsPlan& plan) {
+    m_LastTrajectory = plan.getHalfSecondSamples();
     cerr << "NodeStub published trajectory: \n";
 //    for (auto s : trajectory) cerr << s.toString() << endl;
 //    cerr << endl;
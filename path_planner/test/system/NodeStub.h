@@ -3,18 +3,30 @@
 
 
 #include <vector>
-#include <path_planner/State.h>
+#include <atomic>
+#include <path_planner_common/State.h>
 #include "../../src/trajectory_publisher.h"
 #include "../../src/planner/utilities/RibbonManager.h"
+#include "../../src/common/map/GridWorldMap.h"
 
 class NodeStub : public TrajectoryPublisher {
 public:
     ~NodeStub() override = default;
 
-    State publishTrajectory(std::vector<State> trajectory) override;
+    State publishPlan(const DubinsPlan& plan) override;
 
     void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory, bool dangerous) override;
 
+    void displayDynamicObstacle(double x, double y, double yaw, double width, double length, uint32_t id) override {}
+
+    void publishStats(const Planner::Stats& stats, double collisionPenalty, unsigned long cpuTime,
+                      bool lastPlanAchievable) override {}
+
+    void publishTaskLevelStats(double wallClockTime, double cumulativeCollisionPenalty, double cumulativeGValue,
+                               double uncoveredLength) override {}
+
+    void displayMap(std::shared_ptr<const GridWorldMap> map) override {}
+
     void allDone() override;
 
     std::vector<State> lastTrajectory() const;
@@ -25,9 +37,9 @@ public:
 
     void displayRibbons(const RibbonManager& ribbonManager) override;
 
-private:
+protected:
     std::vector<State> m_LastTrajectory;
-    bool m_AllDoneCalled = false;
+    std::atomic<bool> m_AllDoneCalled{false};
 };
 
 
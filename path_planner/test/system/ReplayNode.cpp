@@ -0,0 +1,73 @@
+#include <thread>
+#include "ReplayNode.h"
+
+ReplayNode::ReplayNode(double startTime, double speed, std::vector<State> replies, Replies mode)
+        : m_StartTime(startTime), m_Speed(speed), m_RealStart(std::chrono::steady_clock::now()), m_Mode(mode),
+          m_Replies(replies.begin(), replies.end()) {}
+
+State ReplayNode::publishPlan(const DubinsPlan& plan) {
+    // keeps track of the trajectory, and its guess is what we fall back on once the recording runs out of replies
+    auto guess = NodeStub::publishPlan(plan);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // the replay won't always plan when the recording did (or at all), so go by time rather than taking them in turn:
+    // replies from before this plan are for plans we didn't make, and one from after it is for a later plan
+    while (!m_Replies.empty() && m_Replies.front().time() < plan.getStartTime()) m_Replies.pop_front();
+    if (m_Replies.empty() || !plan.containsTime(m_Replies.front().time())) return guess;
+    auto reply = m_Replies.front();
+    m_Replies.pop_front();
+    if (m_Mode == Recorded) return reply;
+    plan.sample(reply);
+    return reply;
+}
+
+double ReplayNode::getTime() const {
+    return m_StartTime + m_Speed * std::chrono::duration<double>(std::chrono::steady_clock::now() - m_RealStart).count();
+}
+
+void ReplayNode::sleepUntil(double time) {
+    auto remaining = (time - getTime()) / m_Speed;
+    if (remaining > 0) std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+}
+
+void ReplayNode::publishStats(const Planner::Stats& stats, double collisionPenalty, unsigned long cpuTime,
+                              bool lastPlanAchievable) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Cycles++;
+    m_Iterations += stats.Iterations;
+    m_Expanded += stats.Expanded;
+    m_CpuTime += cpuTime * 1e-6;
+    m_CollisionPenalty += collisionPenalty;
+    if (lastPlanAchievable) m_Achievable++;
+    if (!stats.Plan.empty()) {
+        m_Plans++;
+        m_FValues += stats.PlanFValue;
+    }
+}
+
+void ReplayNode::publishTaskLevelStats(double wallClockTime, double cumulativeCollisionPenalty,
+                                       double cumulativeGValue, double uncoveredLength) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_HaveTaskLevelStats = true;
+    m_WallClockTime = wallClockTime;
+    m_CumulativeGValue = cumulativeGValue;
+    m_UncoveredLength = uncoveredLength;
+}
+
+void ReplayNode::printSummary(std::ostream& os) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto perCycle = [&](double total) { return m_Cycles == 0 ? 0 : total / m_Cycles; };
+    os << "Cycles: " << m_Cycles << "\n"
+       << "Plans found: " << m_Plans << "\n"
+       << "Achievable last plans: " << m_Achievable << "\n"
+       << "Mean iterations: " << perCycle(m_Iterations) << "\n"
+       << "Mean expanded: " << perCycle(m_Expanded) << "\n"
+       << "Mean CPU time (s): " << perCycle(m_CpuTime) << "\n"
+       << "Mean plan f: " << (m_Plans == 0 ? 0 : m_FValues / m_Plans) << "\n"
+       << "Collision penalty: " << m_CollisionPenalty << "\n";
+    if (m_HaveTaskLevelStats) {
+        os << "Task time (s): " << m_WallClockTime << "\n"
+           << "Cumulative g: " << m_CumulativeGValue << "\n"
+           << "Uncovered length (m): " << m_UncoveredLength << "\n";
+    }
+    os.flush();
+}
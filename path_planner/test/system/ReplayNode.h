@@ -0,0 +1,72 @@
+#ifndef SRC_REPLAYNODE_H
+#define SRC_REPLAYNODE_H
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include "NodeStub.h"
+
+/**
+ * Stands in for the ROS node when replaying a recorded mission (see InputLog). The clock starts at the time of the
+ * recording's first event and runs at some multiple of real time, so the executive's cycles, the planner's budget and
+ * the times inputs get fed in all speed up together. Each plan gets less real time to search in when it's sped up, so
+ * only compare runs made at the same speed.
+ *
+ * The controller's replies come from the recording: each plan gets the next one recorded during its time span, or
+ * NodeStub's guess if there isn't one. Recorded replies only make sense for plans like the ones they answered, though,
+ * so to compare planners it's better to simulate them: the reply to each plan is where the vessel would be on that plan
+ * at the time of the recorded reply.
+ */
+class ReplayNode : public NodeStub {
+public:
+    enum Replies {
+        Recorded,
+        Simulated,
+    };
+
+    /**
+     * @param startTime what the clock reads to begin with
+     * @param speed how many times faster than real time the clock runs
+     * @param replies the recorded controller replies
+     * @param mode what to reply to plans with
+     */
+    ReplayNode(double startTime, double speed, std::vector<State> replies, Replies mode);
+
+    State publishPlan(const DubinsPlan& plan) override;
+
+    double getTime() const override;
+
+    void sleepUntil(double time) override;
+
+    void publishStats(const Planner::Stats& stats, double collisionPenalty, unsigned long cpuTime,
+                      bool lastPlanAchievable) override;
+
+    void publishTaskLevelStats(double wallClockTime, double cumulativeCollisionPenalty, double cumulativeGValue,
+                               double uncoveredLength) override;
+
+    void displayRibbons(const RibbonManager& ribbonManager) override {}
+
+    /**
+     * Write totals for the replay so far, for comparing runs.
+     * @param os
+     */
+    void printSummary(std::ostream& os);
+
+private:
+    double m_StartTime, m_Speed;
+    std::chrono::steady_clock::time_point m_RealStart;
+    Replies m_Mode;
+
+    // for the replies and the totals, which the plan loop (and in pipelined mode, the thread publishing) update
+    std::mutex m_Mutex;
+    std::deque<State> m_Replies;
+
+    unsigned long m_Cycles = 0, m_Plans = 0, m_Achievable = 0, m_Iterations = 0, m_Expanded = 0;
+    double m_CpuTime = 0, m_FValues = 0, m_CollisionPenalty = 0;
+    bool m_HaveTaskLevelStats = false;
+    double m_WallClockTime = 0, m_CumulativeGValue = 0, m_UncoveredLength = 0;
+};
+
+
+#endif //SRC_REPLAYNODE_H
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include "ReplayNode.h"
+#include "../../src/executive/executive.h"
+#include "../../src/executive/InputLog.h"
+
+/*
+ * Plan a recorded mission again offline. Record one by setting input_log in the planner's dynamic reconfigure
+ * parameters, then
+ *
+ *     replay_mission <log> [--speed <x real time>] [--seed <n, -1 for none>] [--simulate-controller] [--linger <s>]
+ *
+ * Inputs go to the executive at the times they were recorded (by the replay's clock), all from this thread, and the
+ * planner draws its samples with a fixed seed (7 unless told otherwise). Totals for the run get printed at the end.
+ */
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: replay_mission <log> [--speed <multiple of real time>] [--seed <n>] [--simulate-controller]"
+                 " [--linger <s>]" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    double speed = 1, linger = 10;
+    long seed = 7;
+    auto replies = ReplayNode::Recorded;
+    for (int i = 2; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--speed") == 0 && hasValue) speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) seed = atol(argv[++i]);
+        else if (strcmp(argv[i], "--linger") == 0 && hasValue) linger = atof(argv[++i]);
+        else if (strcmp(argv[i], "--simulate-controller") == 0) replies = ReplayNode::Simulated;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (speed <= 0) {
+        std::cerr << "Speed has to be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<InputLog::Event> events;
+    try {
+        events = InputLog::read(argv[1]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (events.empty()) {
+        std::cerr << "Nothing to replay in " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<State> recordedReplies;
+    for (const auto& e : events) {
+        if (e.Kind == InputLog::ControllerReply && e.Values.size() >= 5) {
+            recordedReplies.emplace_back(e.Values[0], e.Values[1], e.Values[2], e.Values[3], e.Values[4]);
+        }
+    }
+
+    ReplayNode node(events.front().Time, speed, recordedReplies, replies);
+    {
+        Executive executive(&node);
+        executive.setSampleSeed(seed);
+        for (const auto& e : events) {
+            if (e.Kind == InputLog::ControllerReply) continue;
+            node.sleepUntil(e.Time);
+            InputLog::apply(e, executive);
+        }
+        // give the planner a little while past the end of the recording to finish up
+        auto end = events.back().Time + linger;
+        while (!node.allDoneCalled() && node.getTime() < end) node.sleepUntil(node.getTime() + 0.1);
+        executive.cancelPlanner();
+        // (and the executive waits for the plan loop to wrap up on the way out)
+    }
+    node.printSummary(std::cout);
+    return 0;
+}
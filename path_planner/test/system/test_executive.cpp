@@ -56,6 +56,142 @@ TEST(SystemTests, SimpleTwoLineTest) {
     EXPECT_TRUE(stub.allDoneCalled());
 }
 
+TEST(SystemTests, InputLogRoundTripTest) {
+    NodeStub stub;
+    auto path = "/tmp/path_planner_input_log_test";
+    {
+        Executive executive(&stub);
+        executive.addRibbon(10, 10, 20, 10);
+        executive.setWarmStart(true);
+        // the ribbon and the setting from before this should come first
+        executive.setRecording(path);
+        executive.updateCovered(1, 2, 2.5, 0.5, 3);
+        executive.updateDynamicObstacle(12345, State(5, 6, 0.1, 2, 4), 10, 30);
+        executive.setRecording("");
+        executive.addRibbon(0, 0, 0, 10);
+    }
+    auto events = InputLog::read(path);
+    ASSERT_EQ(5, events.size());
+    EXPECT_EQ(InputLog::WarmStart, events[0].Kind);
+    EXPECT_EQ(1, events[0].Values.at(0));
+    EXPECT_EQ(InputLog::ClearRibbons, events[1].Kind);
+    EXPECT_EQ(InputLog::AddRibbon, events[2].Kind);
+    EXPECT_EQ(std::vector<double>({10, 10, 20, 10}), events[2].Values);
+    EXPECT_EQ(InputLog::Position, events[3].Kind);
+    EXPECT_EQ(std::vector<double>({1, 2, 2.5, 0.5, 3}), events[3].Values);
+    EXPECT_EQ(InputLog::Contact, events[4].Kind);
+    EXPECT_EQ(12345, events[4].Values.at(0));
+    EXPECT_EQ(30, events[4].Values.at(7));
+    unlink(path);
+}
+
+TEST(SystemTests, ContactQueueTest) {
+    // a burst of reports about the same contacts only updates the managers once per contact (with the newest report)
+    SharedWorld world;
+    world.queueDynamicObstacle(1, State(5, 6, 0.1, 2, 3), 10, 30);
+    world.queueDynamicObstacle(1, State(7, 8, 0.1, 2, 5), 10, 30);
+    world.queueDynamicObstacle(1, State(6, 7, 0.1, 2, 4), 10, 30);
+    world.queueDynamicObstacle(2, State(50, 60, 1, 3, 4), 12, 40);
+    int made = 0;
+    auto distributions = [&](const State& s) {
+        made++;
+        double mean[2] = {s.x(), s.y()};
+        double covariance[2][2] = {{1, 0}, {0, 1}};
+        return std::vector<Distribution>{Distribution(mean, covariance, 5, 5, s.heading(), s.time())};
+    };
+    EXPECT_EQ(2, world.ingestDynamicObstacles(distributions));
+    EXPECT_EQ(2, made);
+    // not until the snapshot's published
+    EXPECT_TRUE(world.binaryDynamicObstacles().current()->get().empty());
+    world.binaryDynamicObstacles().publish();
+    auto obstacles = world.binaryDynamicObstacles().current();
+    ASSERT_EQ(2, obstacles->get().size());
+    EXPECT_EQ(7, obstacles->get().at(1).X);
+    EXPECT_EQ(5, obstacles->get().at(1).Time);
+    EXPECT_EQ(40, obstacles->get().at(2).Length);
+    // nothing new since
+    EXPECT_EQ(0, world.ingestDynamicObstacles(distributions));
+    world.queueDynamicObstacle(2, State(51, 60, 1, 3, 5), 12, 40);
+    world.forgetDynamicObstacles();
+    EXPECT_EQ(0, world.ingestDynamicObstacles(distributions));
+    world.binaryDynamicObstacles().publish();
+    EXPECT_TRUE(world.binaryDynamicObstacles().current()->get().empty());
+}
+
+TEST(SystemTests, ControllerTimeoutTest) {
+    // a controller that takes far longer to answer than a cycle doesn't hold up the planning
+    struct SlowController : public NodeStub {
+        State publishPlan(const DubinsPlan& plan) override {
+            std::this_thread::sleep_for(std::chrono::seconds(3));
+            return NodeStub::publishPlan(plan);
+        }
+        void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory, bool dangerous) override {
+            if (plannerTrajectory) Displayed++;
+        }
+        std::atomic<int> Displayed{0};
+    } stub;
+    {
+        Executive executive(&stub);
+        executive.setControllerTimeout(0.2);
+        executive.addRibbon(10, 10, 20, 10);
+        executive.updateCovered(0, 0, 0, 0, Executive::getCurrentTime());
+        executive.startPlanner();
+        std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+        executive.cancelPlanner();
+    }
+    // waiting each time would only have got the first plan out
+    EXPECT_GE(stub.Displayed, 2);
+}
+
+TEST(SystemTests, PortfolioSizeTest) {
+    // a portfolio of planners plans like the one does
+    struct CountingStub : public NodeStub {
+        void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory, bool dangerous) override {
+            if (plannerTrajectory && !trajectory.empty()) Displayed++;
+        }
+        std::atomic<int> Displayed{0};
+    } stub;
+    auto path = "/tmp/path_planner_portfolio_log_test";
+    {
+        Executive executive(&stub);
+        executive.setRecording(path);
+        executive.setPortfolioSize(3);
+        executive.addRibbon(10, 10, 20, 10);
+        executive.updateCovered(0, 0, 0, 0, Executive::getCurrentTime());
+        executive.startPlanner();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+        executive.cancelPlanner();
+        executive.setRecording("");
+    }
+    EXPECT_GE(stub.Displayed, 1);
+    auto events = InputLog::read(path);
+    auto setting = std::find_if(events.begin(), events.end(),
+                                [](const InputLog::Event& e) { return e.Kind == InputLog::PortfolioSize; });
+    ASSERT_NE(setting, events.end());
+    EXPECT_EQ(3, setting->Values.at(0));
+    unlink(path);
+}
+
+TEST(SystemTests, LocalRibbonsTest) {
+    // a survey much bigger than a plan can reach still gets planned on, a few lines at a time
+    struct CountingStub : public NodeStub {
+        void displayTrajectory(std::vector<State> trajectory, bool plannerTrajectory, bool dangerous) override {
+            if (plannerTrajectory && !trajectory.empty()) Displayed++;
+        }
+        std::atomic<int> Displayed{0};
+    } stub;
+    {
+        Executive executive(&stub);
+        executive.setLocalRibbons(3);
+        for (int i = 0; i < 300; i++) executive.addRibbon(10 + i * 10, 10, 10 + i * 10, 500);
+        executive.updateCovered(0, 0, 0, 0, Executive::getCurrentTime());
+        executive.startPlanner();
+        std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+        executive.cancelPlanner();
+    }
+    EXPECT_GE(stub.Displayed, 2);
+}
+
 int main(int argc, char **argv){
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,80 @@
+#ifndef SRC_DUBINSBATCH_H
+#define SRC_DUBINSBATCH_H
+
+#include <cstddef>
+#include <path_planner_common/State.h>
+
+extern "C" {
+#include "dubins.h"
+};
+
+/**
+ * Shortest Dubins paths from one start to lots of goals at once, for picking the nearest few samples to connect a
+ * vertex to. All that needs is the lengths, so this works those out (and which of the six words won) without making
+ * a DubinsPath for each goal, and path() makes real ones for the few that get picked.
+ *
+ * The start's trig is done once, and the alpha/beta trig the library does per goal comes from angle differences
+ * instead, so each goal needs the sine and cosine of its own heading and one atan2 (the library does five sines and
+ * cosines as well as the atan2). The goals go through in chunks, first a pass that
+ * works out the geometry of each one (straight arithmetic and square roots, which the compiler vectorizes) and then
+ * one that tries each word. Lengths agree with dubins_shortest_path to within rounding.
+ */
+class DubinsBatch {
+public:
+    /**
+     * @param start
+     * @param rho turning radius
+     */
+    DubinsBatch(const State& start, double rho);
+
+    /**
+     * Work out the shortest path to each goal.
+     * @param goals
+     * @param n
+     * @param lengths shortest path lengths (infinity if there's no path)
+     * @param words which word each one is (a DubinsPathType, or -1 if there's no path)
+     */
+    void solve(const State* goals, size_t n, double* lengths, int* words) const;
+
+    /**
+     * Same, with the cosine and sine of each goal's yaw already worked out.
+     * @param goals
+     * @param goalCos
+     * @param goalSin
+     * @param n
+     * @param lengths
+     * @param words
+     */
+    void solve(const State* goals, const double* goalCos, const double* goalSin, size_t n, double* lengths,
+               int* words) const;
+
+    /**
+     * Make the path to a goal that solve() found.
+     * @param goal
+     * @param word from solve()
+     * @param path
+     * @return false if there isn't one
+     */
+    bool path(const State& goal, int word, DubinsPath& path) const;
+
+    /**
+     * Closed-form lower bound on the Dubins length between two states: the path is at least as long as the straight
+     * line, and since it can't turn any tighter than rho it also needs at least rho times the (smallest) change in
+     * heading. Much cheaper than solving, so it can rule out samples that can't beat the ones already picked.
+     * @param start
+     * @param goal
+     * @param rho
+     * @return
+     */
+    static double lowerBound(const State& start, const State& goal, double rho);
+
+    static constexpr size_t c_ChunkSize = 64;
+
+private:
+    double m_Start[3];
+    double m_Rho;
+    double m_StartCos, m_StartSin;
+};
+
+
+#endif //SRC_DUBINSBATCH_H
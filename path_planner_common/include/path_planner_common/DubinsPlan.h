@@ -2,6 +2,7 @@
 #define SRC_DUBINSPLAN_H
 
 #include <vector>
+#include <deque>
 #include <path_planner_common/State.h>
 #include "DubinsWrapper.h"
 
@@ -10,7 +11,9 @@
  * query the total time of the plan. Some important constants are housed here as well. Maybe they shouldn't be here but
  * this is pretty self-contained, and everything that uses them also uses this. Maybe they should be constructor parameters?
  *
- * The paths are meant to be continuous in time, and in order, but that is not currently enforced.
+ * The paths are meant to be continuous in time, and in order, but that is not currently enforced. Looking up a time is a
+ * binary search over the paths' start times (which does rely on the order), and a Cursor makes sweeping forward
+ * through a plan cheaper still.
  */
 class DubinsPlan {
 public:
@@ -45,6 +48,40 @@ public:
      */
     void sample(State& s) const;
 
+    /**
+     * Remembers which path the last sample came from, so sampling at times that keep going forward (following a plan
+     * as it's executed, say) only ever has to look at the next path along. Going backwards falls back to the usual
+     * lookup. The plan has to outlive the cursor and not change while it's in use.
+     */
+    class Cursor {
+    public:
+        explicit Cursor(const DubinsPlan& plan) : m_Plan(plan) {}
+
+        /**
+         * Same as DubinsPlan::sample.
+         * @param s
+         */
+        void sample(State& s);
+
+        /**
+         * Same as DubinsPlan::containsTime (and it moves the cursor up too).
+         * @param time
+         * @return
+         */
+        bool containsTime(double time);
+
+    private:
+        const DubinsPlan& m_Plan;
+        size_t m_Index = 0;
+
+        /**
+         * Move to the path for a time.
+         * @param time
+         * @return false if there isn't one
+         */
+        bool seek(double time);
+    };
+
     /**
      * @return whether the plan is empty
      */
@@ -74,6 +111,7 @@ public:
 
     /**
      * Truncate this plan to start at the given time. Hey this doesn't actually do anything. Huh. Should look into that.
+     * (It does drop the paths that end before the time, each in constant time.)
      * @param startTime
      */
     void changeIntoSuffix(double startTime);
@@ -84,11 +122,19 @@ public:
      */
     std::vector<State> getHalfSecondSamples() const;
 
+    /**
+     * Get samples at a constant time interval from the start of the plan, stepping along each path with a
+     * DubinsWrapper::Sampler rather than sampling every time separately. Throws if the plan has a gap in it.
+     * @param timeInterval
+     * @return
+     */
+    std::vector<State> getSamples(double timeInterval) const;
+
     /**
      * Get the underlying container of Dubins wrappers.
      * @return
      */
-    const std::vector<DubinsWrapper>& get() const;
+    const std::deque<DubinsWrapper>& get() const;
 
     /**
      * The old density at which plans were sampled. I don't think this needs to still be here.
@@ -97,7 +143,9 @@ public:
     static constexpr double planTimeDensity() { return c_PlanTimeDensity; }
 
 private:
-    std::vector<DubinsWrapper> m_DubinsPaths;
+    std::deque<DubinsWrapper> m_DubinsPaths;
+    // start time of each path, in a separate array so the binary search doesn't drag whole paths through the cache
+    std::deque<double> m_StartTimes;
 
     bool m_Dangerous = false;
 public:
@@ -108,6 +156,14 @@ public:
 private:
 
     static constexpr double c_PlanTimeDensity = 0.5;
+
+    static constexpr size_t c_NotFound = (size_t)-1;
+
+    /**
+     * @param time
+     * @return index of the first path containing the time (same as scanning them in order), or c_NotFound
+     */
+    size_t find(double time) const;
 };
 
 
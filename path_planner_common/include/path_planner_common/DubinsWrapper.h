@@ -114,6 +114,78 @@ public:
      */
     const DubinsPath& unwrap() const;
 
+    /**
+     * Walks along a Dubins path at a fixed time step, which is a lot cheaper than calling sample() at each time. It
+     * doesn't check the time or look up the segment every time, and inside an arc it turns the heading by a fixed
+     * rotation each step rather than doing the trig again (straight segments are just a multiply-add). Crossing into
+     * the next segment puts it back on the exact start of that segment so errors don't build up across segments.
+     *
+     * Samples agree with sample() to within rounding error. Times past the end of the path give the end of the path.
+     * The path has to outlive the sampler.
+     */
+    class Sampler {
+    public:
+        /**
+         * @param path
+         * @param startTime time of the first sample (not before the path's start time)
+         * @param timeStep time between samples
+         */
+        Sampler(const DubinsWrapper& path, double startTime, double timeStep);
+
+        /**
+         * @return time of the current sample
+         */
+        double time() const { return m_StartTime + m_Step * m_TimeStep; }
+
+        /**
+         * Move on by some number of steps. Skipping ahead costs one sine and cosine no matter how far it goes.
+         * @param steps
+         */
+        void advance(size_t steps = 1);
+
+        /**
+         * Set a state to the current sample, time and speed included, the same way sample() would.
+         * @param s
+         */
+        void sample(State& s) const;
+
+        /**
+         * Fill an array with successive samples starting at the current one, stopping early at the end of the path,
+         * and leave the sampler just after the last one.
+         * @param samples
+         * @param n how much room there is
+         * @return how many it filled in
+         */
+        size_t sampleInto(State* samples, size_t n);
+
+    private:
+        const DubinsWrapper& m_Path;
+        double m_StartTime, m_TimeStep;
+        // distance along the path of the first sample, and between samples
+        double m_StartDistance, m_DistanceStep;
+        size_t m_Step = 0;
+        size_t m_Segment = 0;
+        // where each segment starts in the path's normalized (unit turning radius, starting at the origin)
+        // coordinates, and its distance along the path in the same units
+        double m_SegmentStart[3][3], m_SegmentDistance[4];
+        int m_SegmentType[3];
+        // current position in normalized coordinates, the centre of the current arc, the current yaw and its
+        // cosine and sine
+        double m_X = 0, m_Y = 0, m_CentreX = 0, m_CentreY = 0, m_Yaw = 0, m_Cos = 1, m_Sin = 0;
+        // one step's rotation on an arc
+        double m_StepCos = 1, m_StepSin = 0;
+
+        /**
+         * @return normalized distance along the path of the current sample, clamped to the ends
+         */
+        double distance() const;
+
+        /**
+         * Work out the current sample from scratch, the way the library does.
+         */
+        void place();
+    };
+
 private:
     DubinsPath m_DubinsPath{};
     double m_Speed{};
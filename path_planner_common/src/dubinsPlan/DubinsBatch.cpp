@@ -0,0 +1,138 @@
+#include <cmath>
+#include <path_planner_common/DubinsBatch.h>
+
+namespace {
+double mod2pi(double theta) {
+    return theta - 2 * M_PI * floor(theta / (2 * M_PI));
+}
+}
+
+DubinsBatch::DubinsBatch(const State& start, double rho) : m_Rho(rho) {
+    m_Start[0] = start.x(); m_Start[1] = start.y(); m_Start[2] = start.yaw();
+    m_StartCos = cos(m_Start[2]);
+    m_StartSin = sin(m_Start[2]);
+}
+
+void DubinsBatch::solve(const State* goals, size_t n, double* lengths, int* words) const {
+    solve(goals, nullptr, nullptr, n, lengths, words);
+}
+
+void DubinsBatch::solve(const State* goals, const double* goalCos, const double* goalSin, size_t n,
+                        double* lengths, int* words) const {
+    // per chunk geometry, in the library's terms
+    double d[c_ChunkSize], alpha[c_ChunkSize], beta[c_ChunkSize], sa[c_ChunkSize], sb[c_ChunkSize],
+            ca[c_ChunkSize], cb[c_ChunkSize], cab[c_ChunkSize];
+    double dx[c_ChunkSize], dy[c_ChunkSize], chunkCos[c_ChunkSize], chunkSin[c_ChunkSize], goalYaw[c_ChunkSize];
+    for (size_t first = 0; first < n; first += c_ChunkSize) {
+        const auto m = n - first < c_ChunkSize? n - first : c_ChunkSize;
+        for (size_t i = 0; i < m; i++) {
+            const auto& g = goals[first + i];
+            dx[i] = g.x() - m_Start[0];
+            dy[i] = g.y() - m_Start[1];
+            goalYaw[i] = g.yaw();
+        }
+        if (goalCos) {
+            for (size_t i = 0; i < m; i++) {
+                chunkCos[i] = goalCos[first + i];
+                chunkSin[i] = goalSin[first + i];
+            }
+        } else {
+            for (size_t i = 0; i < m; i++) {
+                chunkCos[i] = cos(goalYaw[i]);
+                chunkSin[i] = sin(goalYaw[i]);
+            }
+        }
+        // sin and cos of alpha = start - theta and beta = goal - theta, where theta is the direction to the goal
+        // (east when they're on top of each other, like the library)
+        for (size_t i = 0; i < m; i++) {
+            const auto distance = sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+            const auto nonZero = distance > 0;
+            const auto thetaCos = nonZero? dx[i] / distance : 1.0, thetaSin = nonZero? dy[i] / distance : 0.0;
+            d[i] = distance / m_Rho;
+            sa[i] = m_StartSin * thetaCos - m_StartCos * thetaSin;
+            ca[i] = m_StartCos * thetaCos + m_StartSin * thetaSin;
+            sb[i] = chunkSin[i] * thetaCos - chunkCos[i] * thetaSin;
+            cb[i] = chunkCos[i] * thetaCos + chunkSin[i] * thetaSin;
+            cab[i] = ca[i] * cb[i] + sa[i] * sb[i];
+        }
+        for (size_t i = 0; i < m; i++) {
+            const auto theta = d[i] > 0? mod2pi(atan2(dy[i], dx[i])) : 0;
+            alpha[i] = mod2pi(m_Start[2] - theta);
+            beta[i] = mod2pi(goalYaw[i] - theta);
+        }
+        // then each word, keeping the shortest the way dubins_shortest_path does
+        for (size_t i = 0; i < m; i++) {
+            const double a = alpha[i], b = beta[i], dd = d[i] * d[i];
+            double best = INFINITY;
+            int bestWord = -1;
+            auto consider = [&](int word, double t, double p, double q) {
+                auto c = t + p + q;
+                if (c < best) {
+                    best = c;
+                    bestWord = word;
+                }
+            };
+            double pSquared, tmp0, tmp1, p, phi;
+            // LSL
+            tmp0 = d[i] + sa[i] - sb[i];
+            pSquared = 2 + dd - 2 * cab[i] + 2 * d[i] * (sa[i] - sb[i]);
+            if (pSquared >= 0) {
+                tmp1 = atan2(cb[i] - ca[i], tmp0);
+                consider(LSL, mod2pi(tmp1 - a), sqrt(pSquared), mod2pi(b - tmp1));
+            }
+            // LSR
+            pSquared = -2 + dd + 2 * cab[i] + 2 * d[i] * (sa[i] + sb[i]);
+            if (pSquared >= 0) {
+                p = sqrt(pSquared);
+                tmp0 = atan2(-ca[i] - cb[i], d[i] + sa[i] + sb[i]) - atan2(-2.0, p);
+                consider(LSR, mod2pi(tmp0 - a), p, mod2pi(tmp0 - mod2pi(b)));
+            }
+            // RSL
+            pSquared = -2 + dd + 2 * cab[i] - 2 * d[i] * (sa[i] + sb[i]);
+            if (pSquared >= 0) {
+                p = sqrt(pSquared);
+                tmp0 = atan2(ca[i] + cb[i], d[i] - sa[i] - sb[i]) - atan2(2.0, p);
+                consider(RSL, mod2pi(a - tmp0), p, mod2pi(b - tmp0));
+            }
+            // RSR
+            tmp0 = d[i] - sa[i] + sb[i];
+            pSquared = 2 + dd - 2 * cab[i] + 2 * d[i] * (sb[i] - sa[i]);
+            if (pSquared >= 0) {
+                tmp1 = atan2(ca[i] - cb[i], tmp0);
+                consider(RSR, mod2pi(a - tmp1), sqrt(pSquared), mod2pi(tmp1 - b));
+            }
+            // RLR
+            tmp0 = (6. - dd + 2 * cab[i] + 2 * d[i] * (sa[i] - sb[i])) / 8.;
+            if (fabs(tmp0) <= 1) {
+                phi = atan2(ca[i] - cb[i], d[i] - sa[i] + sb[i]);
+                p = mod2pi(2 * M_PI - acos(tmp0));
+                auto t = mod2pi(a - phi + mod2pi(p / 2.));
+                consider(RLR, t, p, mod2pi(a - b - t + mod2pi(p)));
+            }
+            // LRL
+            tmp0 = (6. - dd + 2 * cab[i] + 2 * d[i] * (sb[i] - sa[i])) / 8.;
+            if (fabs(tmp0) <= 1) {
+                phi = atan2(ca[i] - cb[i], d[i] + sa[i] - sb[i]);
+                p = mod2pi(2 * M_PI - acos(tmp0));
+                auto t = mod2pi(-a - phi + p / 2.);
+                consider(LRL, t, p, mod2pi(mod2pi(b) - a - t + mod2pi(p)));
+            }
+            lengths[first + i] = best * m_Rho;
+            words[first + i] = bestWord;
+        }
+    }
+}
+
+bool DubinsBatch::path(const State& goal, int word, DubinsPath& path) const {
+    double q0[3] = {m_Start[0], m_Start[1], m_Start[2]};
+    double q1[3] = {goal.x(), goal.y(), goal.yaw()};
+    // the word the library comes up with by itself could be different if two were within rounding of each other, but
+    // then it doesn't matter which
+    if (word >= 0 && dubins_path(&path, q0, q1, m_Rho, (DubinsPathType)word) == EDUBOK) return true;
+    return dubins_shortest_path(&path, q0, q1, m_Rho) == EDUBOK;
+}
+
+double DubinsBatch::lowerBound(const State& start, const State& goal, double rho) {
+    auto turn = fabs(remainder(goal.yaw() - start.yaw(), 2 * M_PI));
+    return fmax(start.distanceTo(goal), rho * turn);
+}
@@ -1,4 +1,6 @@
 #include <path_planner_common/DubinsPlan.h>
+#include <cmath>
+#include <algorithm>
 
 void DubinsPlan::append(const DubinsPlan &plan) {
     for (auto s : plan.m_DubinsPaths) append(s);
@@ -6,20 +8,49 @@ void DubinsPlan::append(const DubinsPlan &plan) {
 
 void DubinsPlan::append(const DubinsWrapper& dubinsPath) {
     m_DubinsPaths.push_back(dubinsPath);
+    m_StartTimes.push_back(dubinsPath.getStartTime());
 }
 
 void DubinsPlan::sample(State& s) const {
-    for (const auto& p : m_DubinsPaths) {
-        if (p.containsTime(s.time())) {
-            p.sample(s);
-            return;
-        }
+    auto i = find(s.time());
+    if (i == c_NotFound) throw std::runtime_error("Requested time outside plan bounds");
+    m_DubinsPaths[i].sample(s);
+}
+
+size_t DubinsPlan::find(double time) const {
+    // last path starting at or before the time
+    auto it = std::upper_bound(m_StartTimes.begin(), m_StartTimes.end(), time);
+    if (it == m_StartTimes.begin()) return c_NotFound;
+    size_t i = it - m_StartTimes.begin() - 1;
+    // times on a boundary belong to the earlier path
+    while (i > 0 && m_DubinsPaths[i - 1].containsTime(time)) i--;
+    return m_DubinsPaths[i].containsTime(time)? i : c_NotFound;
+}
+
+void DubinsPlan::Cursor::sample(State& s) {
+    if (!seek(s.time())) throw std::runtime_error("Requested time outside plan bounds");
+    m_Plan.m_DubinsPaths[m_Index].sample(s);
+}
+
+bool DubinsPlan::Cursor::containsTime(double time) {
+    return seek(time);
+}
+
+bool DubinsPlan::Cursor::seek(double time) {
+    const auto& paths = m_Plan.m_DubinsPaths;
+    if (m_Index < paths.size() && time >= paths[m_Index].getStartTime()) {
+        // still here, or somewhere ahead
+        while (m_Index < paths.size() && paths[m_Index].getEndTime() < time) m_Index++;
+        if (m_Index < paths.size() && paths[m_Index].containsTime(time)) return true;
     }
-    throw std::runtime_error("Requested time outside plan bounds");
+    auto i = m_Plan.find(time);
+    if (i == c_NotFound) return false;
+    m_Index = i;
+    return true;
 }
 
 DubinsPlan::DubinsPlan(const State& s1, const State& s2, double rho) {
-    m_DubinsPaths.emplace_back(s1, s2, rho);
+    append(DubinsWrapper(s1, s2, rho));
 }
 
 bool DubinsPlan::empty() const {
@@ -27,19 +58,34 @@ bool DubinsPlan::empty() const {
 }
 
 std::vector<State> DubinsPlan::getHalfSecondSamples() const {
+    return getSamples(planTimeDensity());
+}
+
+std::vector<State> DubinsPlan::getSamples(double timeInterval) const {
     // should check for duplicates
     std::vector<State> result;
     if (empty()) return result;
-    State s;
-    for (double time = getStartTime(); time < getEndTime(); time += planTimeDensity()) {
-        s.time() = time;
-        sample(s);
-        result.push_back(s);
+    auto startTime = getStartTime(), endTime = getEndTime();
+    if (!(endTime > startTime)) return result;
+    result.resize((size_t)ceil((endTime - startTime) / timeInterval));
+    size_t i = 0;
+    for (const auto& p : m_DubinsPaths) {
+        if (i == result.size()) break;
+        auto time = startTime + i * timeInterval;
+        // same as sample(), each time goes to the first path that contains it
+        if (!p.containsTime(time)) {
+            if (time < p.getStartTime()) throw std::runtime_error("Requested time outside plan bounds");
+            continue;
+        }
+        DubinsWrapper::Sampler sampler(p, time, timeInterval);
+        // the last path takes whatever's left; the others only up to their end times
+        i += sampler.sampleInto(result.data() + i, result.size() - i);
     }
+    result.resize(i);
     return result;
 }
 
-const std::vector<DubinsWrapper>& DubinsPlan::get() const {
+const std::deque<DubinsWrapper>& DubinsPlan::get() const {
     return m_DubinsPaths;
 }
 
@@ -49,8 +95,7 @@ double DubinsPlan::totalTime() const {
 }
 
 bool DubinsPlan::containsTime(double time) const {
-    for (const auto& p : m_DubinsPaths) if (p.containsTime(time)) return true;
-    return false;
+    return find(time) != c_NotFound;
 }
 
 double DubinsPlan::getStartTime() const {
@@ -71,8 +116,9 @@ void DubinsPlan::changeIntoSuffix(double startTime) {
 //        }
 //    }
     // drop segments now in the past
-    while (m_DubinsPaths.front().getEndTime() < startTime) {
-        m_DubinsPaths.erase(m_DubinsPaths.begin()); // yucky operation but it happens only rarely
+    while (!m_DubinsPaths.empty() && m_DubinsPaths.front().getEndTime() < startTime) {
+        m_DubinsPaths.pop_front();
+        m_StartTimes.pop_front();
     }
 }
 
@@ -1,6 +1,7 @@
 #include <cassert>
 #include <path_planner_common/DubinsWrapper.h>
 #include <sstream>
+#include <cmath>
 
 DubinsWrapper::DubinsWrapper(const State& s1, const State& s2, double rho) {
     set(s1, s2, rho);
@@ -56,13 +57,10 @@ std::vector<State> DubinsWrapper::getSamples(double timeInterval, double offset)
     // TODO! -- offset
     // deprecated
     std::vector<State> result;
-    State intermediate;
-    intermediate.speed() = m_Speed;
-    for (auto s = m_UpdatedStartTime; s < m_EndTime; s+= timeInterval) {
-        intermediate.time() = s;
-        sample(intermediate);
-        result.push_back(intermediate);
-    }
+    if (!(m_EndTime > m_UpdatedStartTime)) return result;
+    result.resize((size_t)ceil((m_EndTime - m_UpdatedStartTime) / timeInterval));
+    Sampler sampler(*this, m_UpdatedStartTime, timeInterval);
+    result.resize(sampler.sampleInto(result.data(), result.size()));
     return result;
 }
 
@@ -122,3 +120,125 @@ void DubinsWrapper::setSpeed(double speed) {
     m_Speed = speed;
     setEndTime();
 }
+
+namespace {
+// same segment types and words as the library
+const int c_LeftSegment = 0, c_StraightSegment = 1, c_RightSegment = 2;
+const int c_SegmentTypes[6][3] = {
+        {c_LeftSegment, c_StraightSegment, c_LeftSegment}, {c_LeftSegment, c_StraightSegment, c_RightSegment},
+        {c_RightSegment, c_StraightSegment, c_LeftSegment}, {c_RightSegment, c_StraightSegment, c_RightSegment},
+        {c_RightSegment, c_LeftSegment, c_RightSegment}, {c_LeftSegment, c_RightSegment, c_LeftSegment},
+};
+
+double mod2pi(double theta) {
+    return theta - 2 * M_PI * floor(theta / (2 * M_PI));
+}
+
+/**
+ * Move t along a segment of some type from qi (normalized), with the same arithmetic as the library.
+ */
+void segment(double t, const double qi[3], double qt[3], int type) {
+    double st = sin(qi[2]), ct = cos(qi[2]);
+    if (type == c_LeftSegment) {
+        qt[0] = sin(qi[2] + t) - st; qt[1] = -cos(qi[2] + t) + ct; qt[2] = t;
+    } else if (type == c_RightSegment) {
+        qt[0] = -sin(qi[2] - t) + st; qt[1] = cos(qi[2] - t) - ct; qt[2] = -t;
+    } else {
+        qt[0] = ct * t; qt[1] = st * t; qt[2] = 0;
+    }
+    qt[0] += qi[0]; qt[1] += qi[1]; qt[2] += qi[2];
+}
+}
+
+DubinsWrapper::Sampler::Sampler(const DubinsWrapper& path, double startTime, double timeStep)
+    : m_Path(path), m_StartTime(startTime), m_TimeStep(timeStep) {
+    if (!path.isInitialized()) throw std::runtime_error("Cannot sample uninitialized Dubins wrapper");
+    const auto& p = path.m_DubinsPath;
+    m_StartDistance = (startTime - path.m_StartTime) * path.m_Speed / p.rho;
+    m_DistanceStep = timeStep * path.m_Speed / p.rho;
+    for (int i = 0; i < 3; i++) m_SegmentType[i] = c_SegmentTypes[p.type][i];
+    m_SegmentStart[0][0] = 0; m_SegmentStart[0][1] = 0; m_SegmentStart[0][2] = p.qi[2];
+    segment(p.param[0], m_SegmentStart[0], m_SegmentStart[1], m_SegmentType[0]);
+    segment(p.param[1], m_SegmentStart[1], m_SegmentStart[2], m_SegmentType[1]);
+    m_SegmentDistance[0] = 0;
+    m_SegmentDistance[1] = p.param[0];
+    m_SegmentDistance[2] = p.param[0] + p.param[1];
+    m_SegmentDistance[3] = p.param[0] + p.param[1] + p.param[2];
+    place();
+}
+
+double DubinsWrapper::Sampler::distance() const {
+    return fmax(fmin(m_StartDistance + m_Step * m_DistanceStep, m_SegmentDistance[3]), 0);
+}
+
+void DubinsWrapper::Sampler::place() {
+    auto d = distance();
+    // same choice of segment as the library
+    m_Segment = d < m_SegmentDistance[1]? 0 : d < m_SegmentDistance[2]? 1 : 2;
+    const auto* start = m_SegmentStart[m_Segment];
+    auto type = m_SegmentType[m_Segment];
+    double q[3];
+    segment(d - m_SegmentDistance[m_Segment], start, q, type);
+    m_X = q[0]; m_Y = q[1]; m_Yaw = q[2];
+    m_Cos = cos(m_Yaw); m_Sin = sin(m_Yaw);
+    // centre of the turn we're on (for a straight segment it's unused)
+    if (type == c_LeftSegment) {
+        m_CentreX = start[0] - sin(start[2]); m_CentreY = start[1] + cos(start[2]);
+    } else if (type == c_RightSegment) {
+        m_CentreX = start[0] + sin(start[2]); m_CentreY = start[1] - cos(start[2]);
+    }
+    auto turn = type == c_LeftSegment? m_DistanceStep : type == c_RightSegment? -m_DistanceStep : 0;
+    m_StepCos = cos(turn); m_StepSin = sin(turn);
+}
+
+void DubinsWrapper::Sampler::advance(size_t steps) {
+    if (steps == 0) return;
+    m_Step += steps;
+    auto d = distance();
+    if (d >= m_SegmentDistance[m_Segment + 1] && m_Segment < 2) {
+        // on to a new segment, so start over from the beginning of it
+        place();
+        return;
+    }
+    const auto* start = m_SegmentStart[m_Segment];
+    auto type = m_SegmentType[m_Segment];
+    auto along = d - m_SegmentDistance[m_Segment];
+    if (type == c_StraightSegment) {
+        m_X = start[0] + m_Cos * along;
+        m_Y = start[1] + m_Sin * along;
+        return;
+    }
+    double rotationCos = m_StepCos, rotationSin = m_StepSin;
+    if (steps > 1 || d == m_SegmentDistance[3]) {
+        // skipping ahead (or stuck at the end)
+        auto turn = (type == c_LeftSegment? along : -along) - (m_Yaw - start[2]);
+        rotationCos = cos(turn); rotationSin = sin(turn);
+    }
+    auto c = m_Cos * rotationCos - m_Sin * rotationSin;
+    m_Sin = m_Sin * rotationCos + m_Cos * rotationSin;
+    m_Cos = c;
+    m_Yaw = start[2] + (type == c_LeftSegment? along : -along);
+    if (type == c_LeftSegment) {
+        m_X = m_CentreX + m_Sin; m_Y = m_CentreY - m_Cos;
+    } else {
+        m_X = m_CentreX - m_Sin; m_Y = m_CentreY + m_Cos;
+    }
+}
+
+void DubinsWrapper::Sampler::sample(State& s) const {
+    const auto& p = m_Path.m_DubinsPath;
+    s.x() = m_X * p.rho + p.qi[0];
+    s.y() = m_Y * p.rho + p.qi[1];
+    s.setYaw(mod2pi(m_Yaw));
+    s.speed() = m_Path.m_Speed;
+    s.time() = time();
+}
+
+size_t DubinsWrapper::Sampler::sampleInto(State* samples, size_t n) {
+    size_t i = 0;
+    for (; i < n && time() < m_Path.m_EndTime; i++) {
+        sample(samples[i]);
+        advance();
+    }
+    return i;
+}